@@ -2,8 +2,12 @@ package identity
 
 import (
 	"bufio"
+	"encoding/binary"
+	"encoding/hex"
 	"encoding/json"
+	"errors"
 	"fmt"
+	"io"
 	"net"
 	"strings"
 	"sync"
@@ -20,6 +24,47 @@ type Identity struct {
 	wr   *bufio.Writer
 }
 
+// Binary protocol
+const (
+	binaryMagic        = "IDB"
+	binaryVersion      = 1
+	binaryAuthenticate = 1
+	binaryBatch        = 2
+	binaryIssue        = 3
+	binaryValidate     = 4
+	binaryRevoke       = 5
+	binarySign         = 6
+	binaryNameMax      = 64
+	binaryBatchMax     = 64
+)
+
+// TokenSize is the length of a raw session token. Issue hex encodes it
+const TokenSize = 16
+
+// Status byte of a binary reply
+const (
+	StatusOkay        = 0
+	StatusDenied      = 1
+	StatusMalformed   = 2
+	StatusUnsupported = 3
+	StatusBusy        = 4
+)
+
+// ErrBusy means the server had no room to check the password. The password
+// may well be right, so try again later instead of counting a failed login.
+var ErrBusy = errors.New("identity: server busy checking passwords")
+
+// ErrCannotSign means the credential is right, but the server can not sign a
+// token for the user: it has no key, or the user has a role or group id too
+// large for a token.
+var ErrCannotSign = errors.New("identity: server can not sign a token for this user")
+
+// Credential is one username and the raw SHA-256 digest of its password
+type Credential struct {
+	User   string
+	Digest [32]byte
+}
+
 type AuthenticationRequest struct {
 	Username string `json:"user"`
 	Password string `json:"pass"`
@@ -104,8 +149,11 @@ func (id *Identity) Authenticate(user, pass string) (string, error) {
 	}
 	fmt.Printf("wrote message\n")
 
+	// a reply may arrive in pieces
 	var res []byte = make([]byte, 8)
-	id.conn.Read(res)
+	if _, err = io.ReadFull(id.conn, res); err != nil {
+		return "", err
+	}
 
 	var len uint64
 	len = uint64(res[0]) |
@@ -120,7 +168,9 @@ func (id *Identity) Authenticate(user, pass string) (string, error) {
 	res = make([]byte, len)
 	fmt.Printf("got %d bytes\n", len)
 
-	id.conn.Read(res)
+	if _, err = io.ReadFull(id.conn, res); err != nil {
+		return "", err
+	}
 
 	var ress string = string(res)
 	ress = strings.TrimRight(ress, "\x00")
@@ -128,3 +178,242 @@ func (id *Identity) Authenticate(user, pass string) (string, error) {
 
 	return ress, nil
 }
+
+// AuthenticateBinary authenticates with the compact binary protocol. The
+// digest is the raw SHA-256 of the password, and the reply is one status byte.
+func (id *Identity) AuthenticateBinary(user string, digest [32]byte) (bool, error) {
+	if len(user) == 0 || len(user) > binaryNameMax {
+		return false, fmt.Errorf("username must be 1 to %d bytes", binaryNameMax)
+	}
+
+	id.mu.Lock()
+	defer id.mu.Unlock()
+
+	if id.conn == nil {
+		return false, fmt.Errorf("no active connection")
+	}
+
+	// 8 byte header, then the length prefixed username and the digest
+	body := 1 + len(user) + len(digest)
+	req := binaryHeader(binaryAuthenticate, body)
+	req = appendCredential(req, Credential{User: user, Digest: digest})
+
+	if _, err := id.wr.Write(req); err != nil {
+		return false, err
+	}
+	if err := id.wr.Flush(); err != nil {
+		return false, err
+	}
+
+	status, err := id.rd.ReadByte()
+	if err != nil {
+		return false, err
+	}
+
+	switch status {
+	case StatusOkay:
+		return true, nil
+	case StatusDenied:
+		return false, nil
+	case StatusBusy:
+		return false, ErrBusy
+	default:
+		return false, fmt.Errorf("identity server replied with status %d", status)
+	}
+}
+
+// AuthenticateBatch authenticates many credentials in one binary frame. The
+// result for each credential is in the same position as the credential. A
+// credential the server was too busy to check is false.
+func (id *Identity) AuthenticateBatch(creds []Credential) ([]bool, error) {
+	if len(creds) == 0 || len(creds) > binaryBatchMax {
+		return nil, fmt.Errorf("a batch holds 1 to %d credentials", binaryBatchMax)
+	}
+
+	// count, then each length prefixed username and digest
+	body := 1
+	for _, c := range creds {
+		if len(c.User) == 0 || len(c.User) > binaryNameMax {
+			return nil, fmt.Errorf("username must be 1 to %d bytes", binaryNameMax)
+		}
+		body += 1 + len(c.User) + len(c.Digest)
+	}
+	req := binaryHeader(binaryBatch, body)
+	req = append(req, byte(len(creds)))
+	for _, c := range creds {
+		req = appendCredential(req, c)
+	}
+
+	id.mu.Lock()
+	defer id.mu.Unlock()
+
+	if id.conn == nil {
+		return nil, fmt.Errorf("no active connection")
+	}
+	if _, err := id.wr.Write(req); err != nil {
+		return nil, err
+	}
+	if err := id.wr.Flush(); err != nil {
+		return nil, err
+	}
+
+	// a rejected batch is answered with a single status byte
+	status, err := id.rd.ReadByte()
+	if err != nil {
+		return nil, err
+	}
+	if status != StatusOkay && status != StatusDenied && status != StatusBusy {
+		return nil, fmt.Errorf("identity server replied with status %d", status)
+	}
+
+	res := make([]bool, len(creds))
+	res[0] = status == StatusOkay
+	for i := 1; i < len(creds); i++ {
+		if status, err = id.rd.ReadByte(); err != nil {
+			return nil, err
+		}
+		res[i] = status == StatusOkay
+	}
+	return res, nil
+}
+
+// Issue authenticates a credential and returns a session token for its user,
+// hex encoded so it fits in a cookie. The token is empty if the credential is
+// denied. Later requests check the token with Validate instead of the password.
+func (id *Identity) Issue(user string, digest [32]byte) (string, error) {
+	if len(user) == 0 || len(user) > binaryNameMax {
+		return "", fmt.Errorf("username must be 1 to %d bytes", binaryNameMax)
+	}
+
+	body := 1 + len(user) + len(digest)
+	req := binaryHeader(binaryIssue, body)
+	req = appendCredential(req, Credential{User: user, Digest: digest})
+
+	id.mu.Lock()
+	defer id.mu.Unlock()
+
+	status, err := id.exchange(req)
+	if err != nil {
+		return "", err
+	}
+
+	switch status {
+	case StatusOkay:
+		var token [TokenSize]byte
+		if _, err := io.ReadFull(id.rd, token[:]); err != nil {
+			return "", err
+		}
+		return hex.EncodeToString(token[:]), nil
+	case StatusDenied:
+		return "", nil
+	default:
+		return "", fmt.Errorf("identity server replied with status %d", status)
+	}
+}
+
+// Sign authenticates a credential and returns a signed token with the claims
+// of its user, hex encoded. The token is empty if the credential is denied.
+// Services check the token locally with a Verifier.
+func (id *Identity) Sign(user string, digest [32]byte) (string, error) {
+	if len(user) == 0 || len(user) > binaryNameMax {
+		return "", fmt.Errorf("username must be 1 to %d bytes", binaryNameMax)
+	}
+
+	body := 1 + len(user) + len(digest)
+	req := binaryHeader(binarySign, body)
+	req = appendCredential(req, Credential{User: user, Digest: digest})
+
+	id.mu.Lock()
+	defer id.mu.Unlock()
+
+	status, err := id.exchange(req)
+	if err != nil {
+		return "", err
+	}
+
+	switch status {
+	case StatusOkay:
+		n, err := id.rd.ReadByte()
+		if err != nil {
+			return "", err
+		}
+		token := make([]byte, n)
+		if _, err := io.ReadFull(id.rd, token); err != nil {
+			return "", err
+		}
+		return hex.EncodeToString(token), nil
+	case StatusDenied:
+		return "", nil
+	case StatusUnsupported:
+		return "", ErrCannotSign
+	default:
+		return "", fmt.Errorf("identity server replied with status %d", status)
+	}
+}
+
+// Validate checks a session token from Issue. A token that is not hex, or is
+// the wrong length, is not a session, so it is reported as invalid.
+func (id *Identity) Validate(token string) (bool, error) {
+	return id.tokenRequest(binaryValidate, token)
+}
+
+// Revoke ends the session of a token from Issue, like on sign out.
+func (id *Identity) Revoke(token string) (bool, error) {
+	return id.tokenRequest(binaryRevoke, token)
+}
+
+func (id *Identity) tokenRequest(kind byte, token string) (bool, error) {
+	raw, err := hex.DecodeString(token)
+	if err != nil || len(raw) != TokenSize {
+		return false, nil
+	}
+	req := binaryHeader(kind, TokenSize)
+	req = append(req, raw...)
+
+	id.mu.Lock()
+	defer id.mu.Unlock()
+
+	status, err := id.exchange(req)
+	if err != nil {
+		return false, err
+	}
+
+	switch status {
+	case StatusOkay:
+		return true, nil
+	case StatusDenied:
+		return false, nil
+	default:
+		return false, fmt.Errorf("identity server replied with status %d", status)
+	}
+}
+
+// exchange sends one binary request and reads the status byte of its reply.
+// The caller holds id.mu.
+func (id *Identity) exchange(req []byte) (byte, error) {
+	if id.conn == nil {
+		return 0, fmt.Errorf("no active connection")
+	}
+	if _, err := id.wr.Write(req); err != nil {
+		return 0, err
+	}
+	if err := id.wr.Flush(); err != nil {
+		return 0, err
+	}
+	return id.rd.ReadByte()
+}
+
+func binaryHeader(kind byte, body int) []byte {
+	hdr := make([]byte, 8, 8+body)
+	copy(hdr, binaryMagic)
+	hdr[3] = binaryVersion
+	hdr[4] = kind
+	binary.LittleEndian.PutUint16(hdr[6:], uint16(body))
+	return hdr
+}
+
+func appendCredential(b []byte, c Credential) []byte {
+	b = append(b, byte(len(c.User)))
+	b = append(b, c.User...)
+	return append(b, c.Digest[:]...)
+}
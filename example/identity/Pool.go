@@ -0,0 +1,360 @@
+package identity
+
+import (
+	"bufio"
+	"encoding/binary"
+	"encoding/hex"
+	"errors"
+	"fmt"
+	"io"
+	"net"
+	"sync"
+	"sync/atomic"
+	"time"
+)
+
+// Tagged frames. See PROTOCOL_BINARY_FLAG_TAGGED in include/identity/protocol.h
+const (
+	binaryTagged    = 0x01
+	replyHeaderSize = 8
+)
+
+// ErrTimeout means a request got no reply in time. The connection stays up,
+// and the late reply is dropped.
+var ErrTimeout = errors.New("identity: no reply in time")
+
+// Pool keeps several connections to one server, and multiplexes requests on
+// each of them. Every request carries an id, and a goroutine per connection
+// hands each reply to the request with the same id, so many requests are in
+// flight at once instead of queueing behind one another. Requests go to the
+// connections in turn. A connection that fails is dialed again on its next
+// request. A Pool is safe for concurrent use.
+type Pool struct {
+	addr    string
+	timeout time.Duration
+	next    atomic.Uint32
+	slots   []poolSlot
+	closed  atomic.Bool
+}
+
+type poolSlot struct {
+	mu   sync.Mutex
+	conn *muxConn
+}
+
+// muxConn is one connection, with the requests waiting on it
+type muxConn struct {
+	conn net.Conn
+
+	wmu sync.Mutex
+	wr  *bufio.Writer
+
+	mu      sync.Mutex
+	id      uint32
+	pending map[uint32]chan []byte
+	err     error
+}
+
+// NewPool makes a pool of conns connections to a server. Connections open
+// on first use. timeout bounds each dial and each request, or 0 for none.
+func NewPool(addr string, conns int, timeout time.Duration) *Pool {
+	if conns <= 0 {
+		conns = 1
+	}
+	return &Pool{addr: addr, timeout: timeout, slots: make([]poolSlot, conns)}
+}
+
+// Close closes every connection. Requests in flight fail.
+func (p *Pool) Close() error {
+	p.closed.Store(true)
+	for i := range p.slots {
+		s := &p.slots[i]
+		s.mu.Lock()
+		if s.conn != nil {
+			s.conn.fail(net.ErrClosed)
+			s.conn = nil
+		}
+		s.mu.Unlock()
+	}
+	return nil
+}
+
+// get returns the next connection, dialing it if it is not up.
+func (p *Pool) get() (*muxConn, error) {
+	s := &p.slots[p.next.Add(1)%uint32(len(p.slots))]
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	if p.closed.Load() {
+		return nil, net.ErrClosed
+	}
+	if s.conn != nil && s.conn.alive() {
+		return s.conn, nil
+	}
+	conn, err := net.DialTimeout("tcp", p.addr, p.timeout)
+	if err != nil {
+		return nil, err
+	}
+	s.conn = &muxConn{conn: conn, wr: bufio.NewWriter(conn), pending: make(map[uint32]chan []byte)}
+	go s.conn.read()
+	return s.conn, nil
+}
+
+// roundTrip sends one tagged request and waits for its reply, which is at
+// least the status byte.
+func (p *Pool) roundTrip(kind byte, body []byte) ([]byte, error) {
+	c, err := p.get()
+	if err != nil {
+		return nil, err
+	}
+	reply, err := c.roundTrip(kind, body, p.timeout)
+	if err != nil {
+		return nil, err
+	}
+	if len(reply) == 0 {
+		return nil, fmt.Errorf("identity server sent an empty reply")
+	}
+	return reply, nil
+}
+
+func (c *muxConn) alive() bool {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	return c.err == nil
+}
+
+func (c *muxConn) roundTrip(kind byte, body []byte, timeout time.Duration) ([]byte, error) {
+	ch := make(chan []byte, 1)
+
+	c.mu.Lock()
+	if c.err != nil {
+		err := c.err
+		c.mu.Unlock()
+		return nil, err
+	}
+	c.id++
+	id := c.id
+	c.pending[id] = ch
+	c.mu.Unlock()
+
+	// the request id leads the body
+	req := binaryHeader(kind, 4+len(body))
+	req[5] = binaryTagged
+	req = binary.LittleEndian.AppendUint32(req, id)
+	req = append(req, body...)
+
+	c.wmu.Lock()
+	if timeout > 0 {
+		c.conn.SetWriteDeadline(time.Now().Add(timeout))
+	}
+	_, err := c.wr.Write(req)
+	if err == nil {
+		err = c.wr.Flush()
+	}
+	c.wmu.Unlock()
+	if err != nil {
+		c.fail(err)
+		return nil, err
+	}
+
+	var expired <-chan time.Time
+	if timeout > 0 {
+		t := time.NewTimer(timeout)
+		defer t.Stop()
+		expired = t.C
+	}
+
+	select {
+	case reply, ok := <-ch:
+		if !ok {
+			c.mu.Lock()
+			defer c.mu.Unlock()
+			return nil, c.err
+		}
+		return reply, nil
+	case <-expired:
+		c.mu.Lock()
+		delete(c.pending, id)
+		c.mu.Unlock()
+		return nil, ErrTimeout
+	}
+}
+
+// read hands each reply to the request waiting on its id, until the
+// connection fails.
+func (c *muxConn) read() {
+	rd := bufio.NewReader(c.conn)
+	var hdr [replyHeaderSize]byte
+	for {
+		if _, err := io.ReadFull(rd, hdr[:]); err != nil {
+			c.fail(err)
+			return
+		}
+		id := binary.LittleEndian.Uint32(hdr[0:])
+		reply := make([]byte, binary.LittleEndian.Uint16(hdr[4:]))
+		if _, err := io.ReadFull(rd, reply); err != nil {
+			c.fail(err)
+			return
+		}
+
+		c.mu.Lock()
+		ch := c.pending[id]
+		delete(c.pending, id)
+		c.mu.Unlock()
+
+		// a request that timed out is no longer waiting
+		if ch != nil {
+			ch <- reply
+		}
+	}
+}
+
+// fail closes the connection, and fails every request waiting on it.
+func (c *muxConn) fail(err error) {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	if c.err != nil {
+		return
+	}
+	c.err = err
+	c.conn.Close()
+	for id, ch := range c.pending {
+		close(ch)
+		delete(c.pending, id)
+	}
+}
+
+// AuthenticateBinary authenticates with the binary protocol, like
+// Identity.AuthenticateBinary.
+func (p *Pool) AuthenticateBinary(user string, digest [32]byte) (bool, error) {
+	if len(user) == 0 || len(user) > binaryNameMax {
+		return false, fmt.Errorf("username must be 1 to %d bytes", binaryNameMax)
+	}
+
+	reply, err := p.roundTrip(binaryAuthenticate, appendCredential(nil, Credential{User: user, Digest: digest}))
+	if err != nil {
+		return false, err
+	}
+
+	switch reply[0] {
+	case StatusOkay:
+		return true, nil
+	case StatusDenied:
+		return false, nil
+	case StatusBusy:
+		return false, ErrBusy
+	default:
+		return false, fmt.Errorf("identity server replied with status %d", reply[0])
+	}
+}
+
+// AuthenticateBatch authenticates many credentials in one frame, like
+// Identity.AuthenticateBatch.
+func (p *Pool) AuthenticateBatch(creds []Credential) ([]bool, error) {
+	if len(creds) == 0 || len(creds) > binaryBatchMax {
+		return nil, fmt.Errorf("a batch holds 1 to %d credentials", binaryBatchMax)
+	}
+
+	body := []byte{byte(len(creds))}
+	for _, c := range creds {
+		if len(c.User) == 0 || len(c.User) > binaryNameMax {
+			return nil, fmt.Errorf("username must be 1 to %d bytes", binaryNameMax)
+		}
+		body = appendCredential(body, c)
+	}
+
+	reply, err := p.roundTrip(binaryBatch, body)
+	if err != nil {
+		return nil, err
+	}
+
+	// a rejected batch is answered with a single status byte
+	if status := reply[0]; status != StatusOkay && status != StatusDenied && status != StatusBusy {
+		return nil, fmt.Errorf("identity server replied with status %d", status)
+	}
+	if len(reply) != len(creds) {
+		return nil, fmt.Errorf("identity server replied with %d statuses for %d credentials", len(reply), len(creds))
+	}
+
+	res := make([]bool, len(creds))
+	for i, status := range reply {
+		res[i] = status == StatusOkay
+	}
+	return res, nil
+}
+
+// Issue authenticates a credential and returns a hex session token, like
+// Identity.Issue.
+func (p *Pool) Issue(user string, digest [32]byte) (string, error) {
+	if len(user) == 0 || len(user) > binaryNameMax {
+		return "", fmt.Errorf("username must be 1 to %d bytes", binaryNameMax)
+	}
+
+	reply, err := p.roundTrip(binaryIssue, appendCredential(nil, Credential{User: user, Digest: digest}))
+	if err != nil {
+		return "", err
+	}
+
+	switch {
+	case reply[0] == StatusOkay && len(reply) == 1+TokenSize:
+		return hex.EncodeToString(reply[1:]), nil
+	case reply[0] == StatusDenied:
+		return "", nil
+	default:
+		return "", fmt.Errorf("identity server replied with status %d", reply[0])
+	}
+}
+
+// Sign authenticates a credential and returns a hex signed token, like
+// Identity.Sign.
+func (p *Pool) Sign(user string, digest [32]byte) (string, error) {
+	if len(user) == 0 || len(user) > binaryNameMax {
+		return "", fmt.Errorf("username must be 1 to %d bytes", binaryNameMax)
+	}
+
+	reply, err := p.roundTrip(binarySign, appendCredential(nil, Credential{User: user, Digest: digest}))
+	if err != nil {
+		return "", err
+	}
+
+	switch {
+	case reply[0] == StatusOkay && len(reply) >= 2 && len(reply) == 2+int(reply[1]):
+		return hex.EncodeToString(reply[2:]), nil
+	case reply[0] == StatusDenied:
+		return "", nil
+	case reply[0] == StatusUnsupported:
+		return "", ErrCannotSign
+	default:
+		return "", fmt.Errorf("identity server replied with status %d", reply[0])
+	}
+}
+
+// Validate checks a session token from Issue, like Identity.Validate.
+func (p *Pool) Validate(token string) (bool, error) {
+	return p.tokenRequest(binaryValidate, token)
+}
+
+// Revoke ends the session of a token from Issue, like Identity.Revoke.
+func (p *Pool) Revoke(token string) (bool, error) {
+	return p.tokenRequest(binaryRevoke, token)
+}
+
+func (p *Pool) tokenRequest(kind byte, token string) (bool, error) {
+	raw, err := hex.DecodeString(token)
+	if err != nil || len(raw) != TokenSize {
+		return false, nil
+	}
+
+	reply, err := p.roundTrip(kind, raw)
+	if err != nil {
+		return false, err
+	}
+
+	switch reply[0] {
+	case StatusOkay:
+		return true, nil
+	case StatusDenied:
+		return false, nil
+	default:
+		return false, fmt.Errorf("identity server replied with status %d", reply[0])
+	}
+}
@@ -0,0 +1,285 @@
+package identity
+
+import (
+	"bufio"
+	"errors"
+	"fmt"
+	"os"
+	"sort"
+	"strings"
+	"sync"
+	"time"
+)
+
+// Ring settings. See include/identity/router.h, which builds the same ring
+const (
+	RouterVirtualNodes = 128
+	routerNodesMax     = 64
+	routerFailuresMax  = 3
+	routerEjectTime    = 5 * time.Second
+)
+
+// ErrNoNodes means every node has been ejected for failing.
+var ErrNoNodes = errors.New("identity: every node is ejected")
+
+// Router sends each username to the node that owns its shard, by consistent
+// hashing, so the user space can be split across nodes. Each node sits on the
+// ring at many virtual points, and a username belongs to the first point at
+// or after its hash. A node that fails three times in a row is ejected, and
+// its usernames go to the next node on the ring for a while. Sessions live on
+// the node that issued them, so Validate and Revoke take the username too.
+// Each node has a Pool of connections. A Router is safe for concurrent use.
+type Router struct {
+	nodes []*routerNode
+	ring  []ringPoint
+}
+
+type ringPoint struct {
+	hash uint64
+	node int
+}
+
+type routerNode struct {
+	addr string
+	pool *Pool
+
+	mu       sync.Mutex
+	failures int
+	ejected  time.Time
+}
+
+// NewRouter builds a ring over the nodes. vnodes is the quantity of virtual
+// nodes per node, or 0 for RouterVirtualNodes. Each node gets a Pool of conns
+// connections, which open on first use.
+func NewRouter(addrs []string, vnodes, conns int, timeout time.Duration) (*Router, error) {
+	if len(addrs) == 0 || len(addrs) > routerNodesMax {
+		return nil, fmt.Errorf("a router holds 1 to %d nodes", routerNodesMax)
+	}
+	if vnodes <= 0 {
+		vnodes = RouterVirtualNodes
+	}
+
+	r := &Router{ring: make([]ringPoint, 0, len(addrs)*vnodes)}
+	seen := make(map[string]bool, len(addrs))
+	for i, addr := range addrs {
+		if addr == "" || seen[addr] {
+			return nil, fmt.Errorf("node %q is empty or listed twice", addr)
+		}
+		seen[addr] = true
+		r.nodes = append(r.nodes, &routerNode{addr: addr, pool: NewPool(addr, conns, timeout)})
+		for j := 0; j < vnodes; j++ {
+			r.ring = append(r.ring, ringPoint{hash: routerHash(fmt.Sprintf("%s#%d", addr, j)), node: i})
+		}
+	}
+
+	// order by hash, then by node, like the C router
+	sort.Slice(r.ring, func(a, b int) bool {
+		if r.ring[a].hash != r.ring[b].hash {
+			return r.ring[a].hash < r.ring[b].hash
+		}
+		return r.ring[a].node < r.ring[b].node
+	})
+	return r, nil
+}
+
+// LoadRouter builds a ring over the nodes in a file with one address per
+// line, like the servers.txt that test.sh writes.
+func LoadRouter(path string, vnodes, conns int, timeout time.Duration) (*Router, error) {
+	f, err := os.Open(path)
+	if err != nil {
+		return nil, err
+	}
+	defer f.Close()
+
+	var addrs []string
+	sc := bufio.NewScanner(f)
+	for sc.Scan() {
+		if addr := strings.TrimSpace(sc.Text()); addr != "" {
+			addrs = append(addrs, addr)
+		}
+	}
+	if err := sc.Err(); err != nil {
+		return nil, err
+	}
+	return NewRouter(addrs, vnodes, conns, timeout)
+}
+
+// routerHash is FNV-1a with the murmur3 finalizer, the same as router_hash.
+func routerHash(key string) uint64 {
+	h := uint64(0xcbf29ce484222325)
+	for i := 0; i < len(key); i++ {
+		h ^= uint64(key[i])
+		h *= 0x100000001b3
+	}
+	h ^= h >> 33
+	h *= 0xff51afd7ed558ccd
+	h ^= h >> 33
+	h *= 0xc4ceb9fe1a85ec53
+	h ^= h >> 33
+	return h
+}
+
+// find returns the first point at or after the hash, wrapping around.
+func (r *Router) find(hash uint64) int {
+	i := sort.Search(len(r.ring), func(i int) bool { return r.ring[i].hash >= hash })
+	if i == len(r.ring) {
+		return 0
+	}
+	return i
+}
+
+// Owner returns the address of the node that owns a username, ejected or not.
+func (r *Router) Owner(user string) string {
+	return r.nodes[r.ring[r.find(routerHash(user))].node].addr
+}
+
+// route returns the first node on the ring, from the username, that is not
+// ejected.
+func (r *Router) route(user string) (*routerNode, error) {
+	start := r.find(routerHash(user))
+	for i := range r.ring {
+		n := r.nodes[r.ring[(start+i)%len(r.ring)].node]
+		if !n.isEjected() {
+			return n, nil
+		}
+	}
+	return nil, ErrNoNodes
+}
+
+func (n *routerNode) isEjected() bool {
+	n.mu.Lock()
+	defer n.mu.Unlock()
+	return n.failures >= routerFailuresMax && time.Since(n.ejected) < routerEjectTime
+}
+
+// report records how a request went. A busy server, or one that can not sign
+// for a user, is healthy. The pool dials a failed connection again by itself.
+func (n *routerNode) report(err error) {
+	n.mu.Lock()
+	defer n.mu.Unlock()
+	if err == nil || errors.Is(err, ErrBusy) || errors.Is(err, ErrCannotSign) {
+		n.failures = 0
+		return
+	}
+	n.failures++
+	if n.failures >= routerFailuresMax {
+		n.ejected = time.Now()
+	}
+}
+
+// do runs one request against the node that serves a username.
+func (r *Router) do(user string, fn func(*Pool) error) error {
+	n, err := r.route(user)
+	if err != nil {
+		return err
+	}
+	err = fn(n.pool)
+	n.report(err)
+	return err
+}
+
+// AuthenticateBinary authenticates on the node that owns the username.
+func (r *Router) AuthenticateBinary(user string, digest [32]byte) (ok bool, err error) {
+	err = r.do(user, func(p *Pool) (err error) {
+		ok, err = p.AuthenticateBinary(user, digest)
+		return
+	})
+	return
+}
+
+// AuthenticateBatch splits the credentials by node, sends each node its
+// share at once, and puts the results back in the order of the credentials.
+func (r *Router) AuthenticateBatch(creds []Credential) ([]bool, error) {
+	if len(creds) == 0 || len(creds) > binaryBatchMax {
+		return nil, fmt.Errorf("a batch holds 1 to %d credentials", binaryBatchMax)
+	}
+
+	// group the credentials by node
+	shares := make(map[*routerNode][]int)
+	for i, c := range creds {
+		n, err := r.route(c.User)
+		if err != nil {
+			return nil, err
+		}
+		shares[n] = append(shares[n], i)
+	}
+
+	var (
+		wg       sync.WaitGroup
+		mu       sync.Mutex
+		firstErr error
+		res      = make([]bool, len(creds))
+	)
+	for n, idx := range shares {
+		wg.Add(1)
+		go func(n *routerNode, idx []int) {
+			defer wg.Done()
+			share := make([]Credential, len(idx))
+			for i, j := range idx {
+				share[i] = creds[j]
+			}
+			ok, err := n.pool.AuthenticateBatch(share)
+			n.report(err)
+			if err != nil {
+				mu.Lock()
+				if firstErr == nil {
+					firstErr = err
+				}
+				mu.Unlock()
+				return
+			}
+			for i, j := range idx {
+				res[j] = ok[i]
+			}
+		}(n, idx)
+	}
+	wg.Wait()
+	return res, firstErr
+}
+
+// Issue issues a session token on the node that owns the username.
+func (r *Router) Issue(user string, digest [32]byte) (token string, err error) {
+	err = r.do(user, func(p *Pool) (err error) {
+		token, err = p.Issue(user, digest)
+		return
+	})
+	return
+}
+
+// Sign signs a token on the node that owns the username.
+func (r *Router) Sign(user string, digest [32]byte) (token string, err error) {
+	err = r.do(user, func(p *Pool) (err error) {
+		token, err = p.Sign(user, digest)
+		return
+	})
+	return
+}
+
+// Validate checks a session token on the node that issued it to the user.
+func (r *Router) Validate(user, token string) (ok bool, err error) {
+	err = r.do(user, func(p *Pool) (err error) {
+		ok, err = p.Validate(token)
+		return
+	})
+	return
+}
+
+// Revoke ends a session on the node that issued it to the user.
+func (r *Router) Revoke(user, token string) (ok bool, err error) {
+	err = r.do(user, func(p *Pool) (err error) {
+		ok, err = p.Revoke(token)
+		return
+	})
+	return
+}
+
+// Close closes the connections to every node.
+func (r *Router) Close() error {
+	var firstErr error
+	for _, n := range r.nodes {
+		if err := n.pool.Close(); err != nil && firstErr == nil {
+			firstErr = err
+		}
+	}
+	return firstErr
+}
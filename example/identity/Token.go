@@ -0,0 +1,133 @@
+package identity
+
+import (
+	"crypto/hmac"
+	"crypto/sha256"
+	"encoding/binary"
+	"encoding/hex"
+	"errors"
+	"sync"
+	"time"
+)
+
+// Signed token layout. See include/identity/token.h
+const (
+	tokenVersion    = 1
+	tokenHeaderSize = 32
+	tokenMacSize    = 32
+	tokenBitsetMax  = 64
+)
+
+var (
+	ErrTokenMalformed = errors.New("identity: malformed token")
+	ErrTokenKey       = errors.New("identity: token signed by an unknown key")
+	ErrTokenSignature = errors.New("identity: bad token signature")
+	ErrTokenExpired   = errors.New("identity: token expired")
+)
+
+// Claims are the contents of a verified token. Roles holds the user's own
+// roles and the roles of their groups, as a bitset indexed by role id.
+type Claims struct {
+	UserID  uint64
+	OrgID   uint64
+	Expires time.Time
+	Roles   []byte
+	Groups  []byte
+}
+
+// HasRole reports whether the token grants a role.
+func (c *Claims) HasRole(id uint) bool {
+	return bitsetHas(c.Roles, id)
+}
+
+// InGroup reports whether the user is in a group.
+func (c *Claims) InGroup(id uint) bool {
+	return bitsetHas(c.Groups, id)
+}
+
+func bitsetHas(b []byte, id uint) bool {
+	return id/8 < uint(len(b)) && b[id/8]>>(id%8)&1 == 1
+}
+
+// Verifier checks signed tokens locally, with the same keys as the identity
+// server, so a service never needs a round trip to trust a token. Add the new
+// key before the server signs with it, and remove the old one once its tokens
+// have expired. A Verifier is safe for concurrent use.
+type Verifier struct {
+	mu   sync.RWMutex
+	keys map[byte][]byte
+}
+
+func NewVerifier() *Verifier {
+	return &Verifier{keys: make(map[byte][]byte)}
+}
+
+// AddKey adds a key, or replaces the key with the same id.
+func (v *Verifier) AddKey(id byte, secret []byte) {
+	v.mu.Lock()
+	defer v.mu.Unlock()
+	v.keys[id] = append([]byte(nil), secret...)
+}
+
+// RemoveKey removes a key. Tokens it signed no longer verify.
+func (v *Verifier) RemoveKey(id byte) {
+	v.mu.Lock()
+	defer v.mu.Unlock()
+	delete(v.keys, id)
+}
+
+// Verify checks a hex encoded token from Identity.Sign, and returns its claims.
+func (v *Verifier) Verify(token string) (*Claims, error) {
+	v.mu.RLock()
+	defer v.mu.RUnlock()
+	return v.verify(token, time.Now())
+}
+
+// VerifyBatch checks many tokens under one lock of the keys. The result for
+// each token is in the same position as the token.
+func (v *Verifier) VerifyBatch(tokens []string) ([]*Claims, []error) {
+	claims := make([]*Claims, len(tokens))
+	errs := make([]error, len(tokens))
+	now := time.Now()
+
+	v.mu.RLock()
+	defer v.mu.RUnlock()
+	for i, t := range tokens {
+		claims[i], errs[i] = v.verify(t, now)
+	}
+	return claims, errs
+}
+
+func (v *Verifier) verify(token string, now time.Time) (*Claims, error) {
+	raw, err := hex.DecodeString(token)
+	if err != nil || len(raw) < tokenHeaderSize+tokenMacSize || raw[0] != tokenVersion {
+		return nil, ErrTokenMalformed
+	}
+	roles, groups := int(raw[2]), int(raw[3])
+	if roles > tokenBitsetMax || groups > tokenBitsetMax || len(raw) != tokenHeaderSize+roles+groups+tokenMacSize {
+		return nil, ErrTokenMalformed
+	}
+
+	key, ok := v.keys[raw[1]]
+	if !ok {
+		return nil, ErrTokenKey
+	}
+	body := raw[:len(raw)-tokenMacSize]
+	mac := hmac.New(sha256.New, key)
+	mac.Write(body)
+	if !hmac.Equal(mac.Sum(nil), raw[len(body):]) {
+		return nil, ErrTokenSignature
+	}
+
+	expires := int64(binary.LittleEndian.Uint64(raw[24:]))
+	if expires <= now.Unix() {
+		return nil, ErrTokenExpired
+	}
+	return &Claims{
+		UserID:  binary.LittleEndian.Uint64(raw[8:]),
+		OrgID:   binary.LittleEndian.Uint64(raw[16:]),
+		Expires: time.Unix(expires, 0),
+		Roles:   raw[tokenHeaderSize : tokenHeaderSize+roles],
+		Groups:  raw[tokenHeaderSize+roles : tokenHeaderSize+roles+groups],
+	}, nil
+}
@@ -20,31 +20,49 @@ var kvdb *db.KeyValueDb = nil
 func main() {
 
 	id = identity.NewIdentity("localhost:6714", 5*time.Second)
-	kvdb, _ := db.NewKeyValueDb("localhost:6713")
+	kvdb, _ = db.NewKeyValueDb("localhost:6713")
+
+	http.Handle("/", protectedHandler("g10"))
+	http.ListenAndServe(":8080", nil)
 }
 
-func protectedHandler(realm, wantUser, wantPass string) http.Handler {
+// sessionCookie holds the session token issued after a successful login
+const sessionCookie = "g10_session"
+
+func protectedHandler(realm string) http.Handler {
 	return http.HandlerFunc(func(w http.ResponseWriter, r *http.Request) {
-		// Check Authorization header
-		authz := r.Header.Get("Authorization")
-		if checkBasic(authz, wantUser, wantPass) == "\"okay\"" {
+		// A live session skips the credential check entirely
+		if c, err := r.Cookie(sessionCookie); err == nil {
+			if ok, _ := id.Validate(c.Value); ok {
+				w.Header().Set("Content-Type", "text/plain; charset=utf-8")
+				fmt.Fprintf(w, "Authenticated\n")
+				return
+			}
+		}
+
+		// Otherwise sign in with the Authorization header, and start a session
+		token := ""
+		if user, digest, ok := basicCredential(r.Header.Get("Authorization")); ok {
+			token, _ = id.Issue(user, digest)
+		}
+		if token == "" {
 			w.Header().Add("WWW-Authenticate", fmt.Sprintf(`Basic realm="%s", charset="UTF-8"`, realm))
 			w.Header().Add("WWW-Authenticate", `Newauth realm="apps", type=1, title="Login to apps"`)
-			http.SetCookie(w, &http.Cookie{
-				Name:     "g10_auth",
-				Value:    "okay",
-				Path:     "/",
-				Domain:   ".g10.app",
-				HttpOnly: true,
-				Secure:   true,
-				SameSite: http.SameSiteLaxMode,
-				Expires:  time.Now().Add(24 * time.Hour),
-			})
 			w.Header().Set("Content-Type", "text/plain; charset=utf-8")
 			w.WriteHeader(http.StatusUnauthorized)
 			fmt.Fprintln(w, "Unauthorized")
 			return
 		}
+		http.SetCookie(w, &http.Cookie{
+			Name:     sessionCookie,
+			Value:    token,
+			Path:     "/",
+			Domain:   ".g10.app",
+			HttpOnly: true,
+			Secure:   true,
+			SameSite: http.SameSiteLaxMode,
+			Expires:  time.Now().Add(24 * time.Hour),
+		})
 
 		// Authenticated
 		w.Header().Set("Content-Type", "text/plain; charset=utf-8")
@@ -52,27 +70,20 @@ func protectedHandler(realm, wantUser, wantPass string) http.Handler {
 	})
 }
 
-func checkBasic(header, wantUser, wantPass string) string {
-	if header == "" {
-		return "not okay"
-	}
+// basicCredential parses a Basic Authorization header into a username and
+// the SHA-256 digest of the password
+func basicCredential(header string) (string, [32]byte, bool) {
 	scheme, b64, ok := strings.Cut(header, " ")
 	if !ok || !strings.EqualFold(scheme, "Basic") {
-		return "not okay"
+		return "", [32]byte{}, false
 	}
 	dec, err := base64.StdEncoding.DecodeString(b64)
 	if err != nil {
-		return "not okay"
+		return "", [32]byte{}, false
 	}
-	creds := string(dec)
-	user, pass, ok := strings.Cut(creds, ":")
+	user, pass, ok := strings.Cut(string(dec), ":")
 	if !ok {
-		return "not okay"
+		return "", [32]byte{}, false
 	}
-	sum := sha256.Sum256([]byte(pass))
-	pass = fmt.Sprintf("%x", sum[:])
-	fmt.Printf("user=%s,pass=%s\n", user, pass)
-	s, _ := id.Authenticate(user, pass)
-
-	return s
+	return user, sha256.Sum256([]byte(pass)), true
 }
@@ -17,6 +17,11 @@
 #include <core/log.h>
 #include <core/pack.h>
 
+// identity
+#include <identity/router.h>
+
+// preprocessor definitions
+#define IDENTITY_CLIENT_SERVERS "servers.txt"
 
 // forward declarations
 /** !
@@ -33,16 +38,36 @@ void print_usage ( const char *argv0 );
  * 
  * @param argc            the argc parameter of the entry point
  * @param argv            the argv parameter of the entry point
+ * @param pp_servers_path return. the file that lists each node
+ * @param p_vnodes        return. virtual nodes per node
+ * @param p_names         return. the index of the first username in argv
  * 
  * @return void on success, program abort on failure
  */
-void parse_command_line_arguments ( int argc, const char *argv[] );
+void parse_command_line_arguments ( int argc, const char *argv[], const char **pp_servers_path, size_t *p_vnodes, size_t *p_names );
 
 // entry point
 int main ( int argc, const char *argv[] )
 {
 
-    // todo
+    // initialized data
+    router     *p_router  = NULL;
+    const char *p_servers = IDENTITY_CLIENT_SERVERS;
+    size_t      vnodes    = 0;
+    size_t      names     = (size_t) argc;
+
+    // parse command line arguments
+    parse_command_line_arguments(argc, argv, &p_servers, &vnodes, &names);
+
+    // build the ring
+    if ( 0 == router_load(&p_router, p_servers, vnodes) ) return EXIT_FAILURE;
+
+    // print the node that owns each username
+    for (size_t i = names; i < (size_t) argc; i++)
+        printf("%s %s\n", argv[i], router_address(p_router, router_owner(p_router, argv[i], strlen(argv[i]))));
+
+    // release the ring
+    (void) router_destroy(&p_router);
 
     // success
     return EXIT_SUCCESS;
@@ -55,44 +80,37 @@ void print_usage ( const char *argv0 )
     if ( argv0 == (void *) 0 ) exit(EXIT_FAILURE);
 
     // Print a usage message to standard out
-    printf("Usage: %s ...\n", argv0);
+    printf("Usage: %s [-s servers file] [-v virtual nodes] username ...\n", argv0);
 
     // done
     return;
 }
 
-void parse_command_line_arguments ( int argc, const char *argv[] )
+void parse_command_line_arguments ( int argc, const char *argv[], const char **pp_servers_path, size_t *p_vnodes, size_t *p_names )
 {
 
-    // If no command line arguments are supplied, run all the examples
-    if ( argc == 1 ) goto default_options;
-
-    // error check
-    //
-
-    // Iterate through each command line argument
+    // Iterate through each option
     for (size_t i = 1; i < (size_t) argc; i++)
     {
 
-        if ( strcmp(argv[i], "-n") == 0 )
+        // the usernames follow the options
+        if ( '-' != argv[i][0] ) return (void) ( *p_names = i );
 
-            // Set the name
-            ;//
+        // every option takes a value
+        if ( i + 1 >= (size_t) argc ) goto invalid_arguments;
+
+        // Set the servers file
+        if      ( strcmp(argv[i], "-s") == 0 ) *pp_servers_path = argv[++i];
+
+        // Set the quantity of virtual nodes
+        else if ( strcmp(argv[i], "-v") == 0 ) *p_vnodes        = (size_t) atoi(argv[++i]);
 
         // Default
         else goto invalid_arguments;
     }
-    
-    // success
-    return;
 
-    // default
-    default_options:
-    {
-
-        // success
-        return;
-    }
+    // no usernames
+    goto invalid_arguments;
 
     // error handling
     {
@@ -11,6 +11,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <unistd.h>
 
 // gsdk
 #include <gsdk.h>
@@ -24,188 +25,217 @@
 #include <identity/group.h>
 #include <identity/org.h>
 
+// preprocessor definitions
+#define IDENTITY_SERVER_PATH "resources/acme"
+
 // forward declarations
 /// pack/unpack
 //// string
 int string_pack   ( void *p_buffer, const void *const p_value );
 int string_unpack ( void *const p_value, void *p_buffer );
 
+/** !
+ * Print a usage message to standard out
+ * 
+ * @param argv0 the name of the program
+ * 
+ * @return void
+ */
+void print_usage ( const char *argv0 );
+
+/** !
+ * Parse command line arguments
+ * 
+ * @param argc             the argc parameter of the entry point
+ * @param argv             the argv parameter of the entry point
+ * @param p_config         return. the server configuration
+ * @param pp_path          return. the organization directory to load
+ * @param pp_snapshot_path return. the snapshot file to map, or to write after loading the directory
+ * @param pp_wal_path      return. the write ahead log to replay and append to
+ * @param pp_key_path      return. the keys that sign tokens
+ * @param p_serve_port     return. the port to serve replicas on, or 0
+ * @param pp_follow        return. the host:port of a primary to follow, or null
+ * 
+ * @return void on success, program abort on failure
+ */
+void parse_command_line_arguments ( int argc, const char *argv[], identity_config *p_config, const char **pp_path, const char **pp_snapshot_path, const char **pp_wal_path, const char **pp_key_path, uint16_t *p_serve_port, const char **pp_follow );
+
 // entry point
 int main ( int argc, const char *argv[] )
 {
 
     // initialized data
-    identity *p_identity   = NULL;
-    org      *_p_org    [] = { NULL, NULL };
-    user *p_user = NULL;
+    identity        *p_identity   = NULL;
+    identity_config  _config      = IDENTITY_CONFIG_DEFAULT;
+    const char      *p_path       = IDENTITY_SERVER_PATH;
+    const char      *p_snapshot   = NULL;
+    const char      *p_wal        = NULL;
+    const char      *p_keys       = NULL;
+    const char      *p_follow     = NULL;
+    uint16_t         serve_port   = 0;
+
+    // parse command line arguments
+    parse_command_line_arguments(argc, argv, &_config, &p_path, &p_snapshot, &p_wal, &p_keys, &serve_port, &p_follow);
 
     // construct an identity server
-    identity_construct(&p_identity);
+    if ( 0 == identity_construct(&p_identity, &_config) ) return EXIT_FAILURE;
 
-    // construct acme
+    // add the keys that sign tokens
+    if ( p_keys && 0 == identity_token_keys_load(p_identity, p_keys) ) return EXIT_FAILURE;
+
+    // a replica gets everything from its primary
+    if ( p_follow )
     {
 
         // initialized data
-        role  *_p_roles [] = { NULL, NULL, NULL, NULL, NULL, NULL };
-        group *_p_groups[] = { NULL, NULL, NULL, NULL };
-        user  *_p_users [] = { NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+        char        _host[256] = { 0 };
+        const char *p_port     = strrchr(p_follow, ':');
 
-        // construct organization
-        (void) org_construct(&_p_org[0], 0, "acme");
-        (void) identity_org_add(p_identity, _p_org[0]);
+        // error check
+        if ( NULL == p_port || (size_t) ( p_port - p_follow ) >= sizeof(_host) ) return print_usage(argv[0]), EXIT_FAILURE;
 
-        // add roles
-        {
+        // split the host from the port
+        memcpy(_host, p_follow, (size_t) ( p_port - p_follow ));
 
-            // initialized data
-            const char *_owner_permissions[] = { "*:*" };
-            const char *_admin_permissions[] = { "read:*", "write:*", "manage:users", "manage:billing" };
-            const char *_editor_permissions[] = { "read:docs/*", "write:docs/*", "read:issues/*", "write:issues/*" };
-            const char *_viewer_permissions[] = { "read:*" };
-            const char *_billing_permissions[] = { "read:billing", "write:billing" };
-            const char *_support_permissions[] = { "read:tickets/*", "write:tickets/*" };
-
-            // construct roles
-            (void) role_construct(&_p_roles[0], 0, "owner"  , 0, _owner_permissions  , 1),
-            (void) role_construct(&_p_roles[1], 1, "admin"  , 0, _admin_permissions  , 4),
-            (void) role_construct(&_p_roles[2], 2, "editor" , 0, _editor_permissions , 4),
-            (void) role_construct(&_p_roles[3], 3, "viewer" , 0, _viewer_permissions , 1),
-            (void) role_construct(&_p_roles[4], 4, "billing", 0, _billing_permissions, 2),
-            (void) role_construct(&_p_roles[5], 5, "support", 0, _support_permissions, 2);
-
-            // add roles to organization
-            for (size_t i = 0; i < sizeof(_p_roles) / sizeof(*_p_roles); i++)
-                (void) identity_role_add(p_identity, _p_roles[i]);
-        }
+        // follow the primary
+        if ( 0 == identity_replication_follow(p_identity, _host, (uint16_t) atoi(p_port + 1)) ) return EXIT_FAILURE;
+    }
 
-        // add groups
-        {
+    // map the snapshot if there is one, else load the organization
+    else if ( NULL == p_snapshot || 0 != access(p_snapshot, R_OK) || 0 == identity_snapshot_load(p_identity, p_snapshot) )
+        if ( 0 == identity_load(p_identity, p_path) ) return EXIT_FAILURE;
 
-            // initialized data
-            const size_t _dev_roles[]     = { 2 };
-            const size_t _finance_roles[] = { 4 };
-            const size_t _ops_roles[]     = { 1 };
-            const size_t _support_roles[] = { 5 };
-
-            // construct groups
-            (void) group_construct(&_p_groups[0], 0, "dev"    , 0, _dev_roles    , 1),
-            (void) group_construct(&_p_groups[1], 1, "finance", 0, _finance_roles, 1),
-            (void) group_construct(&_p_groups[2], 2, "ops"    , 0, _ops_roles    , 1),
-            (void) group_construct(&_p_groups[3], 3, "support", 0, _support_roles, 1);
-
-            // add groups to organization
-            for (size_t i = 0; i < sizeof(_p_groups) / sizeof(*_p_groups); i++)
-                (void) identity_group_add(p_identity, _p_groups[i]);
-        }
+    // replay the log on top, and log from here on
+    if ( NULL == p_follow && p_wal && 0 == identity_wal_open(p_identity, p_wal) ) return EXIT_FAILURE;
 
-        // add users
-        {
+    // fold everything into a snapshot for the next start, which empties the log
+    if ( NULL == p_follow && p_snapshot ) (void) identity_snapshot_save(p_identity, p_snapshot);
 
-            // initialized data
-            const size_t _dev_group    [] = { 0 };
-            const size_t _finance_group[] = { 1 };
-            const size_t _ops_group    [] = { 2 };
-            const size_t _support_group[] = { 3 };
-
-            const size_t _zoe_roles  [] = { 0 };
-
-            // construct users
-            (void) user_construct(&_p_users[0], 0, "Alice", "a", 0, _dev_group, 1, NULL      , 0),
-            (void) user_construct(&_p_users[1], 1, "Bob"  , "b", 0, _dev_group, 1, NULL      , 0),
-            (void) user_construct(&_p_users[2], 2, "Carol", "c", 0, _dev_group, 1, NULL      , 0),
-            (void) user_construct(&_p_users[3], 3, "Dana" , "d", 0, _dev_group, 1, NULL      , 0),
-            (void) user_construct(&_p_users[4], 4, "Erin" , "e", 0, _dev_group, 1, NULL      , 0),
-            (void) user_construct(&_p_users[5], 5, "Frank", "f", 0, _dev_group, 1, NULL      , 0),
-            (void) user_construct(&_p_users[6], 6, "Zoe"  , "z", 0, _dev_group, 1, _zoe_roles, 1);
-
-            // add users
-            for (size_t i = 0; i < sizeof(_p_users)/sizeof(*_p_users); i++)
-                (void) identity_user_add(p_identity, _p_users[i]);
-        }
+    // ship every later mutation to replicas
+    if ( serve_port && 0 == identity_replication_serve(p_identity, serve_port) ) return EXIT_FAILURE;
 
-        // log
-        log_info("[identity] Constructed identity server\n");
-    }
+    // log
+    log_info("[identity] Constructed identity server\n");
+
+    // print the identity server
+    identity_print(p_identity);
+
+    sleep(300);
     
-    // construct g10
-    /*
+    // success
+    return EXIT_SUCCESS;
+}
+
+int string_pack ( void *p_buffer, const void *const p_value )
+{
+
+    // done
+    return pack_pack(p_buffer, "%s", p_value);
+}
+
+int string_unpack ( void *const p_value, void *p_buffer )
+{
+
+    // done
+    return pack_unpack(p_buffer, "%s", p_value);
+}
+
+void print_usage ( const char *argv0 )
+{
+
+    // argument check
+    if ( argv0 == (void *) 0 ) exit(EXIT_FAILURE);
+
+    // Print a usage message to standard out
+    printf("Usage: %s [-p port] [-a acceptors] [-w workers] [-q queue depth] [-c cache entries] [-t cache ttl ms] [-n negative cache ttl ms] [-m max sessions] [-e session ttl ms] [-x token ttl s] [-v password threads] [-i passwords in flight] [-k key file] [-d organization directory] [-s snapshot file] [-l write ahead log] [-r replication port] [-f primary host:port]\n", argv0);
+
+    // done
+    return;
+}
+
+void parse_command_line_arguments ( int argc, const char *argv[], identity_config *p_config, const char **pp_path, const char **pp_snapshot_path, const char **pp_wal_path, const char **pp_key_path, uint16_t *p_serve_port, const char **pp_follow )
+{
+
+    // Iterate through each command line argument
+    for (size_t i = 1; i < (size_t) argc; i++)
     {
 
-        // initialized data
-        role  *_p_roles [] = { NULL };
-        group *_p_groups[] = { NULL };
-        user  *_p_users [] = { NULL };
+        // every option takes a value
+        if ( i + 1 >= (size_t) argc ) goto invalid_arguments;
 
-        // construct organization
-        (void) org_construct(&_p_org[0], 0, "g10");
-        (void) identity_org_add(p_identity, _p_org[0]);
+        // Set the port
+        if      ( strcmp(argv[i], "-p") == 0 ) p_config->port                       = (socket_port) atoi(argv[++i]);
 
-        // add roles
-        {
+        // Set the quantity of acceptors
+        else if ( strcmp(argv[i], "-a") == 0 ) p_config->acceptor_quantity          = (size_t) atoi(argv[++i]);
 
-            // initialized data
-            const char *_owner_permissions[] = { "*:*" };
+        // Set the quantity of workers
+        else if ( strcmp(argv[i], "-w") == 0 ) p_config->worker_quantity            = (size_t) atoi(argv[++i]);
 
-            // construct roles
-            (void) role_construct(&_p_roles[0], 0, "owner", 0, _owner_permissions, 1);
+        // Set the queue depth
+        else if ( strcmp(argv[i], "-q") == 0 ) p_config->queue_depth                = (size_t) atoi(argv[++i]);
 
-            // add roles to organization
-            for (size_t i = 0; i < sizeof(_p_roles) / sizeof(*_p_roles); i++)
-                (void) identity_role_add(p_identity, _p_roles[i]);
-        }
+        // Set the quantity of cached verdicts
+        else if ( strcmp(argv[i], "-c") == 0 ) p_config->auth_cache_entries         = (size_t) atoi(argv[++i]);
 
-        // add groups
-        {
+        // Set the time to live of an allowed verdict
+        else if ( strcmp(argv[i], "-t") == 0 ) p_config->auth_cache_ttl_ms          = (size_t) atoi(argv[++i]);
 
-            // initialized data
-            const size_t _dev_roles[] = { };
+        // Set the time to live of a denied verdict
+        else if ( strcmp(argv[i], "-n") == 0 ) p_config->auth_cache_negative_ttl_ms = (size_t) atoi(argv[++i]);
 
-            // construct groups
-            (void) group_construct(&_p_groups[0], 0, "dev", 0, _dev_roles, 1);
+        // Set the quantity of live sessions
+        else if ( strcmp(argv[i], "-m") == 0 ) p_config->sessions_max               = (size_t) atoi(argv[++i]);
 
-            // add groups to organization
-            for (size_t i = 0; i < sizeof(_p_groups) / sizeof(*_p_groups); i++)
-                (void) identity_group_add(p_identity, _p_groups[i]);
-        }
+        // Set the time to live of a session token
+        else if ( strcmp(argv[i], "-e") == 0 ) p_config->session_ttl_ms             = (size_t) atoi(argv[++i]);
 
-        // add users
-        {
+        // Set the time to live of a signed token
+        else if ( strcmp(argv[i], "-x") == 0 ) p_config->token_ttl_s                = (size_t) atoi(argv[++i]);
 
-            // initialized data
-            const size_t _zoe_roles[] = { 0 };
+        // Set the quantity of password threads
+        else if ( strcmp(argv[i], "-v") == 0 ) p_config->verify_threads             = (size_t) atoi(argv[++i]);
 
-            // construct users
-            (void) user_construct(&_p_users[0], 0, "jacob", "abc123", 0, NULL, 0, _zoe_roles, 1);
+        // Set the quantity of passwords stretched at once
+        else if ( strcmp(argv[i], "-i") == 0 ) p_config->verify_in_flight           = (size_t) atoi(argv[++i]);
 
-            // add users
-            for (size_t i = 0; i < sizeof(_p_users)/sizeof(*_p_users); i++)
-                (void) identity_user_add(p_identity, _p_users[i]);
-        }
+        // Set the key file
+        else if ( strcmp(argv[i], "-k") == 0 ) *pp_key_path                         = argv[++i];
 
-        // log
-        log_info("[identity] Constructed identity server\n");
-    }
-    */
+        // Set the organization directory
+        else if ( strcmp(argv[i], "-d") == 0 ) *pp_path                             = argv[++i];
 
-    // print the identity server
-    identity_print(p_identity);
+        // Set the snapshot file
+        else if ( strcmp(argv[i], "-s") == 0 ) *pp_snapshot_path                    = argv[++i];
 
-    sleep(300);
+        // Set the write ahead log
+        else if ( strcmp(argv[i], "-l") == 0 ) *pp_wal_path                         = argv[++i];
+
+        // Set the port to serve replicas on
+        else if ( strcmp(argv[i], "-r") == 0 ) *p_serve_port                        = (uint16_t) atoi(argv[++i]);
+
+        // Set the primary to follow
+        else if ( strcmp(argv[i], "-f") == 0 ) *pp_follow                           = argv[++i];
+
+        // Default
+        else goto invalid_arguments;
+    }
     
     // success
-    return EXIT_SUCCESS;
-}
+    return;
 
-int string_pack ( void *p_buffer, const void *const p_value )
-{
-
-    // done
-    return pack_pack(p_buffer, "%s", p_value);
-}
+    // error handling
+    {
 
-int string_unpack ( void *const p_value, void *p_buffer )
-{
+        // argument errors
+        {
+            invalid_arguments:
+                
+                // Print a usage message to standard out
+                print_usage(argv[0]);
 
-    // done
-    return pack_unpack(p_buffer, "%s", p_value);
+                // Abort
+                exit(EXIT_FAILURE);
+        }
+    }
 }
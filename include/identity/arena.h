@@ -0,0 +1,41 @@
+/** !
+ * Arena
+ *
+ * @file identity/arena.h
+ *
+ * @author Jacob Smith
+ */
+
+// standard library
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+// gsdk
+#include <gsdk.h>
+
+/// core
+#include <core/log.h>
+
+// preprocessor definitions
+#define ARENA_ALIGNMENT 16
+
+// structure declarations
+struct arena_s;
+
+// type definitions
+typedef struct arena_s arena;
+
+// forward declarations
+/// constructors
+int arena_construct ( arena **pp_arena, size_t size );
+
+/// allocators
+void *arena_alloc ( arena *p_arena, size_t size );
+
+/// reset
+int arena_reset ( arena *p_arena );
+
+/// destructors
+int arena_destroy ( arena **pp_arena );
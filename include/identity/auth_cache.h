@@ -0,0 +1,127 @@
+/** !
+ * Authentication cache
+ *
+ * Remembers the verdict for a username and a password digest, so a client
+ * retrying the same credential skips the lookup and the password check.
+ * Denials are cached too, for their own, usually shorter, time to live
+ *
+ * The cache is split into shards, each with its own lock. A shard is a table
+ * of sets of AUTH_CACHE_WAYS entries, and a username always maps to the same
+ * set, so every entry of a user is found, or dropped, in one place. A full
+ * set evicts the entry closest to expiring
+ *
+ * Each shard counts its invalidations. A verdict is only stored if its shard
+ * has not been invalidated since the lookup that missed, so a verdict that
+ * raced a change to the user is never cached
+ *
+ * @file identity/auth_cache.h
+ *
+ * @author Jacob Smith
+ */
+
+// standard library
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// gsdk
+#include <gsdk.h>
+
+/// core
+#include <core/log.h>
+#include <core/hash.h>
+#include <core/sha.h>
+#include <core/sync.h>
+
+// identity
+#include <identity/user.h>
+
+// preprocessor definitions
+#define AUTH_CACHE_SHARDS 64
+#define AUTH_CACHE_WAYS   4
+
+// enumeration definitions
+enum auth_cache_verdict_e
+{
+    AUTH_CACHE_MISS  = 0,
+    AUTH_CACHE_ALLOW = 1,
+    AUTH_CACHE_DENY  = 2
+};
+
+// structure declarations
+struct auth_cache_s;
+
+// type definitions
+typedef struct auth_cache_s auth_cache;
+
+// forward declarations
+/// constructors
+/** !
+ * Construct an authentication cache
+ *
+ * @param pp_auth_cache   return
+ * @param entries         the most verdicts to keep, spread over every shard
+ * @param ttl_ms          how long an allowed credential is remembered, in milliseconds
+ * @param negative_ttl_ms how long a denied credential is remembered, in milliseconds. 0 never caches denials
+ *
+ * @return 1 on success, 0 on error
+ */
+int auth_cache_construct ( auth_cache **pp_auth_cache, size_t entries, size_t ttl_ms, size_t negative_ttl_ms );
+
+/// accessors
+/** !
+ * Look up the verdict for a credential
+ *
+ * @param p_auth_cache the authentication cache
+ * @param p_name       the username, not null terminated
+ * @param name_len     the length of the username
+ * @param digest       the password digest
+ * @param pp_user      return. the user, if allowed
+ * @param p_generation return. pass to auth_cache_insert after a miss
+ *
+ * @return the verdict, or AUTH_CACHE_MISS
+ */
+enum auth_cache_verdict_e auth_cache_lookup ( auth_cache *p_auth_cache, const char *p_name, size_t name_len, const sha256_hash digest, user **pp_user, uint64_t *p_generation );
+
+/** !
+ * Get the hits and misses of every shard
+ *
+ * @param p_auth_cache the authentication cache
+ * @param p_hits       return
+ * @param p_misses     return
+ *
+ * @return 1 on success, 0 on error
+ */
+int auth_cache_stats ( auth_cache *p_auth_cache, size_t *p_hits, size_t *p_misses );
+
+/// mutators
+/** !
+ * Remember the verdict for a credential, unless the user changed since the
+ * lookup that missed
+ *
+ * @param p_auth_cache the authentication cache
+ * @param p_name       the username, not null terminated
+ * @param name_len     the length of the username
+ * @param digest       the password digest
+ * @param p_user       the user if allowed, else null
+ * @param generation   from auth_cache_lookup
+ *
+ * @return 1 if the verdict is stored, else 0
+ */
+int auth_cache_insert ( auth_cache *p_auth_cache, const char *p_name, size_t name_len, const sha256_hash digest, user *p_user, uint64_t generation );
+
+/** !
+ * Forget every verdict for a username
+ *
+ * @param p_auth_cache the authentication cache
+ * @param p_name       the username, not null terminated
+ * @param name_len     the length of the username
+ *
+ * @return 1 on success, 0 on error
+ */
+int auth_cache_invalidate ( auth_cache *p_auth_cache, const char *p_name, size_t name_len );
+
+/// destructors
+int auth_cache_destroy ( auth_cache **pp_auth_cache );
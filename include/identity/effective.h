@@ -0,0 +1,136 @@
+/** !
+ * Effective permissions
+ *
+ * Every user's permissions, from their own roles and the roles of their
+ * groups, as one bitset over the dense ids of a permission matcher. Sets are
+ * updated as users and groups are added, and rebuilt when the matcher is
+ * recompiled, so authorizing a user reads one set
+ *
+ * Sets live in fixed size chunks that never move, so a set stays put while
+ * others are added. A second index from each group to its members finds the
+ * sets a group touches
+ *
+ * Readers take no lock. A changed set is written to a new entry, swapped in,
+ * and the old entry is reused once no reader can see it. A rebuild computes
+ * every set for the new matcher on the side, then publishes the matcher and
+ * its sets together. Writers must be serialized by the caller
+ *
+ * @file identity/effective.h
+ *
+ * @author Jacob Smith
+ */
+
+// standard library
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// gsdk
+#include <gsdk.h>
+
+/// core
+#include <core/log.h>
+
+// identity
+#include <identity/hash_index.h>
+#include <identity/group.h>
+#include <identity/user.h>
+#include <identity/permission.h>
+
+// preprocessor definitions
+#define EFFECTIVE_CHUNK_QUANTITY 4096
+
+// structure declarations
+struct effective_s;
+
+// type definitions
+typedef struct effective_s effective;
+
+// forward declarations
+/// constructors
+/** !
+ * Construct an empty set of effective permissions
+ *
+ * @param pp_effective return
+ * @param p_users      the users, by id
+ * @param p_groups     the groups, by id
+ *
+ * @return 1 on success, 0 on error
+ */
+int effective_construct ( effective **pp_effective, hash_index *p_users, hash_index *p_groups );
+
+/// accessors
+/** !
+ * Get a user's effective permissions, and the matcher whose ids they use.
+ * Call between epoch_enter and epoch_exit, and use both only until
+ * epoch_exit
+ *
+ * @param p_effective    the effective permissions
+ * @param user_id        the id of the user
+ * @param pp_permissions return. the compiled permissions the set was computed with
+ * @param pp_set         return. one bit per permission id
+ *
+ * @return 1 if the user has a set, else 0
+ */
+int effective_get ( effective *p_effective, size_t user_id, const permission_matcher **pp_permissions, const uint64_t **pp_set );
+
+/** !
+ * Test a set for any of some permission ids
+ *
+ * @param _set    the set
+ * @param _ids    the permission ids
+ * @param ids_len the quantity of permission ids
+ *
+ * @return true if any id is in the set, else false
+ */
+bool effective_any ( const uint64_t *_set, const uint32_t *_ids, size_t ids_len );
+
+/// mutators
+/** !
+ * Compute, or recompute, a user's effective permissions
+ *
+ * @param p_effective   the effective permissions
+ * @param p_permissions the compiled permissions
+ * @param p_user        the user
+ *
+ * @return 1 on success, 0 on error
+ */
+int effective_user_update ( effective *p_effective, const permission_matcher *p_permissions, const user *p_user );
+
+/** !
+ * Drop a user's effective permissions
+ *
+ * @param p_effective the effective permissions
+ * @param p_user      the user
+ *
+ * @return 1 on success, 0 on error
+ */
+int effective_user_remove ( effective *p_effective, const user *p_user );
+
+/** !
+ * Recompute the effective permissions of every member of a group, after the
+ * group is added or its roles change
+ *
+ * @param p_effective   the effective permissions
+ * @param p_permissions the compiled permissions
+ * @param group_id      the id of the group
+ *
+ * @return 1 on success, 0 on error
+ */
+int effective_group_update ( effective *p_effective, const permission_matcher *p_permissions, size_t group_id );
+
+/** !
+ * Recompute every user's effective permissions, after the permissions are
+ * recompiled and their ids change
+ *
+ * @param p_effective   the effective permissions
+ * @param p_permissions the compiled permissions
+ *
+ * @return 1 on success, 0 on error
+ */
+int effective_rebuild ( effective *p_effective, const permission_matcher *p_permissions );
+
+/// destructors
+int effective_destroy ( effective **pp_effective );
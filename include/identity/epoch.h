@@ -0,0 +1,95 @@
+/** !
+ * Epoch
+ *
+ * Epoch based reclamation, so readers never lock. A reader brackets its
+ * reads with epoch_enter and epoch_exit, which cost one store each and never
+ * wait. A writer publishes a new version with an atomic store, then hands
+ * the old one to epoch_retire. The old version is released once every reader
+ * that could have seen it has exited
+ *
+ * There is one epoch for the process. Each thread gets a record the first
+ * time it enters, and gives it back when it exits
+ *
+ * @file identity/epoch.h
+ *
+ * @author Jacob Smith
+ */
+
+// standard library
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <threads.h>
+
+// gsdk
+#include <gsdk.h>
+
+/// core
+#include <core/log.h>
+#include <core/sync.h>
+
+// type definitions
+/** !
+ * Release a retired value
+ *
+ * @param p_value the value
+ *
+ * @return void
+ */
+typedef void (fn_epoch_free) ( void *p_value );
+
+// forward declarations
+/// readers
+/** !
+ * Enter a read side critical section. Values read from here to the matching
+ * epoch_exit stay valid. Sections nest
+ *
+ * @return void
+ */
+void epoch_enter ( void );
+
+/** !
+ * Exit a read side critical section
+ *
+ * @return void
+ */
+void epoch_exit ( void );
+
+/// writers
+/** !
+ * Start a new epoch, after unlinking some values
+ *
+ * @return the epoch the values were unlinked in, for epoch_passed
+ */
+uint64_t epoch_advance ( void );
+
+/** !
+ * Test if every reader that could see values unlinked in an epoch has exited
+ *
+ * @param epoch the return of epoch_advance
+ *
+ * @return true if the values are unreachable, else false
+ */
+bool epoch_passed ( uint64_t epoch );
+
+/** !
+ * Release a value once no reader can see it. The value must already be
+ * unlinked
+ *
+ * @param p_value  the value
+ * @param pfn_free releases the value
+ *
+ * @return void
+ */
+void epoch_retire ( void *p_value, fn_epoch_free *pfn_free );
+
+/** !
+ * Wait for every reader inside a read side critical section to exit, then
+ * release every retired value. A reader must not call this
+ *
+ * @return void
+ */
+void epoch_synchronize ( void );
@@ -0,0 +1,84 @@
+/** !
+ * Event loop
+ *
+ * @file identity/event_loop.h
+ *
+ * @author Jacob Smith
+ */
+
+// standard library
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+// gsdk
+#include <gsdk.h>
+
+/// core
+#include <core/log.h>
+#include <core/socket.h>
+#include <core/sync.h>
+
+/// performance
+#include <performance/thread_pool.h>
+
+// preprocessor definitions
+#define EVENT_LOOP_BUFFER_SIZE      16384
+#define EVENT_LOOP_RESPONSE_MAX     1024
+#define EVENT_LOOP_EVENTS           256
+#define EVENT_LOOP_BACKLOG          4096
+#define EVENT_LOOP_BUFFERS_IDLE_MAX 256
+
+// structure declarations
+struct event_loop_s;
+
+// type definitions
+typedef struct event_loop_s event_loop;
+
+/** !
+ * Measure the frame at the start of a buffer
+ *
+ * @param p_parameter the parameter passed to event_loop_construct
+ * @param p_buffer    the buffered bytes
+ * @param len         the quantity of buffered bytes
+ * @param p_frame_len return. the length of the whole frame, or 0 if more bytes are needed to tell
+ *
+ * @return 1 on success, 0 if the frame is malformed
+ */
+typedef int (fn_event_loop_frame)   ( void *p_parameter, const char *p_buffer, size_t len, size_t *p_frame_len );
+
+/** !
+ * Serve one complete frame
+ *
+ * @param p_parameter the parameter passed to event_loop_construct
+ * @param p_request   the frame
+ * @param request_len the length of the frame
+ * @param p_response  return. at least EVENT_LOOP_RESPONSE_MAX bytes for the framed response
+ *
+ * @return the length of the framed response
+ */
+typedef int (fn_event_loop_request) ( void *p_parameter, char *p_request, size_t request_len, char *p_response );
+
+// forward declarations
+/// constructors
+int event_loop_construct
+(
+    event_loop **pp_event_loop,
+
+    socket_port            port,
+    bool                   reuse_port,
+    int                    cpu,
+    thread_pool           *p_thread_pool,
+    size_t                 in_flight_max,
+    fn_event_loop_frame   *pfn_frame,
+    fn_event_loop_request *pfn_request,
+    void                  *p_parameter
+);
+
+/// run
+int event_loop_run  ( event_loop *p_event_loop );
+int event_loop_stop ( event_loop *p_event_loop );
+
+/// destructors
+int event_loop_destroy ( event_loop **pp_event_loop );
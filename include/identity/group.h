@@ -11,6 +11,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 // gsdk
 #include <gsdk.h>
@@ -26,6 +27,13 @@
 /// reflection
 #include <reflection/json.h>
 
+// identity
+#include <identity/intern.h>
+
+// preprocessor definitions
+#define GROUP_NAME_MAX  64
+#define GROUP_ROLES_MAX 256
+
 // structure declarations
 struct group_s;
 
@@ -53,8 +61,33 @@ int group_print ( group *p_group );
 void *group_key_accessor ( group *p_group );
 int group_comparator ( size_t id_a, size_t id_b );
 
+/// accessors
+const char *group_name_get ( const group *p_group );
+uint32_t group_name_id ( const group *p_group );
+size_t group_org_id_get ( const group *p_group );
+int group_roles_get ( const group *p_group, const uint64_t **pp_roles, size_t *p_roles_len );
+
 /// pack 
+/** !
+ * Pack a group into a buffer. Groups are stored packed, so this is a copy
+ *
+ * @param p_buffer the buffer, or null to measure the group
+ * @param p_group  the group
+ *
+ * @return the size of the packed group in bytes, or 0 on error
+ */
 int group_pack ( void *p_buffer, const group *const p_group );
 
 /// unpack
-int group_unpack ( void *const p_value, void *p_buffer );
+/** !
+ * Bind a group to a packed record in place. Nothing is copied or allocated,
+ * so the buffer must outlive the group. Its strings are interned again, and
+ * their ids written into the record, so the buffer must be writable
+ *
+ * @param pp_group return
+ * @param p_buffer the packed record, 8 byte aligned
+ * @param size     the bytes available at p_buffer
+ *
+ * @return the size of the packed group in bytes, or 0 if the record is malformed
+ */
+int group_unpack ( group **pp_group, void *p_buffer, size_t size );
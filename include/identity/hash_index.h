@@ -0,0 +1,149 @@
+/** !
+ * Hash index
+ *
+ * An open addressing hash table from size_t keys to values. Keys live in the
+ * table next to their values, so a lookup touches one or two cache lines.
+ *
+ * A key is either an id, which is unique, or a precomputed hash of some
+ * larger key, like a name. Values keyed by hash may share a key, and a match
+ * function tells them apart
+ *
+ * One writer at a time may change the index while any number of readers
+ * search it without locks. A slot's key is written before its value is
+ * published, and never changes while the table is live. A removed value
+ * leaves a tombstone rather than moving others, so a reader never misses a
+ * value that was moved past it. Growing copies into a new table, publishes
+ * it, and retires the old one, so readers must be inside epoch_enter and
+ * epoch_exit
+ *
+ * @file identity/hash_index.h
+ *
+ * @author Jacob Smith
+ */
+
+// standard library
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// gsdk
+#include <gsdk.h>
+
+/// core
+#include <core/log.h>
+
+// identity
+#include <identity/epoch.h>
+
+// preprocessor definitions
+#define HASH_INDEX_CAPACITY_MIN 16
+
+// structure declarations
+struct hash_index_s;
+
+// type definitions
+typedef struct hash_index_s hash_index;
+
+/** !
+ * Visit one value
+ *
+ * @param p_value the value
+ *
+ * @return 1 on success, 0 on error
+ */
+typedef int (fn_hash_index_traverse) ( void *p_value );
+
+/** !
+ * Test if a value has some key
+ *
+ * @param p_value the value
+ * @param p_key   the key passed to hash_index_match
+ *
+ * @return true if the value has the key, else false
+ */
+typedef bool (fn_hash_index_match) ( const void *p_value, const void *p_key );
+
+// forward declarations
+/// constructors
+/** !
+ * Construct an empty hash index
+ *
+ * @param pp_hash_index return
+ * @param pfn_key       returns the id or the hash of a value
+ * @param pfn_match     null when keys are unique ids, else tells values with equal hashes apart
+ * @param quantity      the quantity of values to make room for
+ *
+ * @return 1 on success, 0 on error
+ */
+int hash_index_construct ( hash_index **pp_hash_index, fn_key_accessor *pfn_key, fn_hash_index_match *pfn_match, size_t quantity );
+
+/// accessors
+int hash_index_search ( hash_index *p_hash_index, size_t key, void **pp_value );
+
+/** !
+ * Find the value with a hash that also matches a key
+ *
+ * @param p_hash_index the hash index
+ * @param hash         the hash of the key
+ * @param p_key        the key, passed to the match function
+ * @param pp_value     return
+ *
+ * @return 1 if found, else 0
+ */
+int hash_index_match ( hash_index *p_hash_index, size_t hash, const void *p_key, void **pp_value );
+size_t hash_index_size ( hash_index *p_hash_index );
+
+/// mutators
+/** !
+ * Make room for a quantity of values, so that inserting them never rehashes
+ *
+ * @param p_hash_index the hash index
+ * @param quantity     the total quantity of values
+ *
+ * @return 1 on success, 0 on error
+ */
+int hash_index_reserve ( hash_index *p_hash_index, size_t quantity );
+int hash_index_insert ( hash_index *p_hash_index, void *p_value );
+int hash_index_remove ( hash_index *p_hash_index, void *p_value );
+
+/** !
+ * Swap a value for another with the same key, in one atomic store. A reader
+ * finds either value, and never neither
+ *
+ * @param p_hash_index the hash index
+ * @param p_old        the value in the index
+ * @param p_new        the value to take its place
+ *
+ * @return 1 on success, 0 if the old value is not in the index
+ */
+int hash_index_replace ( hash_index *p_hash_index, void *p_old, void *p_new );
+
+/** !
+ * Insert many values at once. Space is reserved for all of them up front,
+ * which is how the index should be filled at startup
+ *
+ * @param p_hash_index the hash index
+ * @param pp_values    the values
+ * @param quantity     the quantity of values
+ *
+ * @return 1 on success, 0 on error
+ */
+int hash_index_build ( hash_index *p_hash_index, void **pp_values, size_t quantity );
+
+/// iterators
+int hash_index_traverse ( hash_index *p_hash_index, fn_hash_index_traverse *pfn_traverse );
+
+/** !
+ * Copy every value out of the hash index, in no particular order
+ *
+ * @param p_hash_index the hash index
+ * @param pp_values    return. room for hash_index_size values
+ *
+ * @return the quantity of values copied
+ */
+size_t hash_index_values ( hash_index *p_hash_index, void **pp_values );
+
+/// destructors
+int hash_index_destroy ( hash_index **pp_hash_index );
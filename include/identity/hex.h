@@ -0,0 +1,54 @@
+/** !
+ * Hex
+ *
+ * Hex encoding and decoding kernels. Every request carries a hex digest or a
+ * hex token, so these run once or twice per request. On x86-64 the kernels
+ * convert 32 or 16 characters at a time with AVX2 or SSE2, picked on first
+ * use from what the processor supports. Elsewhere, and for the tail of odd
+ * sized input, a table driven scalar loop does the work
+ *
+ * @file identity/hex.h
+ *
+ * @author Jacob Smith
+ */
+
+// standard library
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <threads.h>
+
+// forward declarations
+/// encode
+/** !
+ * Encode bytes as lower case hex
+ *
+ * @param p_bytes the bytes
+ * @param len     the quantity of bytes
+ * @param p_hex   return. 2 * len characters, not terminated
+ *
+ * @return 2 * len
+ */
+size_t hex_encode ( const unsigned char *p_bytes, size_t len, char *p_hex );
+
+/// decode
+/** !
+ * Decode hex of either case into bytes
+ *
+ * @param p_hex   the hex
+ * @param hex_len the quantity of characters. Must be even
+ * @param p_bytes return. hex_len / 2 bytes
+ *
+ * @return 1 on success, 0 if a character is not hex
+ */
+int hex_decode ( const char *p_hex, size_t hex_len, unsigned char *p_bytes );
+
+/// kernels
+/** !
+ * Get the name of the kernels in use, like "avx2", "sse2" or "scalar"
+ *
+ * @return the name
+ */
+const char *hex_kernel_name ( void );
@@ -0,0 +1,93 @@
+/** !
+ * HMAC
+ *
+ * HMAC-SHA256 over the gsdk sha256, and PBKDF2-HMAC-SHA256 on top of it. A
+ * key keeps the hash states after its inner and outer pads, so each MAC with
+ * it hashes the message and the inner digest, and never the pads again. That
+ * halves the cost of every PBKDF2 iteration
+ *
+ * @file identity/hmac.h
+ *
+ * @author Jacob Smith
+ */
+
+// standard library
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// gsdk
+#include <gsdk.h>
+
+/// core
+#include <core/sha.h>
+
+// preprocessor definitions
+#define HMAC_BLOCK_SIZE 64 // of SHA-256, and so of the pads
+
+// structure declarations
+struct hmac_key_s;
+
+// type definitions
+typedef struct hmac_key_s hmac_key;
+
+// structure definitions
+struct hmac_key_s
+{
+    sha256_state _inner; // after the key XOR the inner pad
+    sha256_state _outer; // after the key XOR the outer pad
+};
+
+// forward declarations
+/// constructors
+/** !
+ * Absorb a secret into a key. Secrets longer than a block are hashed first
+ *
+ * @param p_key    return
+ * @param p_secret the secret
+ * @param len      the length of the secret, in bytes
+ *
+ * @return void
+ */
+void hmac_key_construct ( hmac_key *p_key, const void *p_secret, size_t len );
+
+/// mac
+/** !
+ * Compute the HMAC-SHA256 of a message
+ *
+ * @param p_key     the key
+ * @param p_message the message
+ * @param len       the length of the message, in bytes
+ * @param mac       return
+ *
+ * @return void
+ */
+void hmac_sha256 ( const hmac_key *p_key, const void *p_message, size_t len, sha256_hash mac );
+
+/// key derivation
+/** !
+ * Derive a 32 byte key from a password with PBKDF2-HMAC-SHA256
+ *
+ * @param p_password   the password
+ * @param password_len the length of the password, in bytes
+ * @param p_salt       the salt
+ * @param salt_len     the length of the salt, in bytes
+ * @param iterations   the cost. at least 1
+ * @param derived      return
+ *
+ * @return void
+ */
+void hmac_pbkdf2 ( const void *p_password, size_t password_len, const void *p_salt, size_t salt_len, uint32_t iterations, sha256_hash derived );
+
+/// compare
+/** !
+ * Compare two macs in constant time
+ *
+ * @param a a mac
+ * @param b another mac
+ *
+ * @return true if the macs are equal, else false
+ */
+bool hmac_equals ( const unsigned char *a, const unsigned char *b );
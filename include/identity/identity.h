@@ -19,6 +19,7 @@
 #include <core/log.h>
 #include <core/socket.h>
 #include <core/pack.h>
+#include <core/sync.h>
 
 /// data
 #include <data/array.h>
@@ -27,24 +28,138 @@
 /// performance
 #include <performance/thread_pool.h>
 
+// identity
+#include <identity/event_loop.h>
+#include <identity/hash_index.h>
+#include <identity/loader.h>
+#include <identity/protocol.h>
+#include <identity/snapshot.h>
+#include <identity/replication.h>
+#include <identity/permission.h>
+#include <identity/effective.h>
+#include <identity/auth_cache.h>
+#include <identity/session.h>
+#include <identity/token.h>
+#include <identity/password.h>
+#include <identity/tenant.h>
+
 // auth
 #include <identity/org.h>
 #include <identity/role.h>
 #include <identity/group.h>
 #include <identity/user.h>
 
+// preprocessor definitions
+#define IDENTITY_REQUEST_MAX       PROTOCOL_REQUEST_MAX
+#define IDENTITY_RESPONSE_MAX      1024
+#define IDENTITY_ARENA_SIZE        262144
+#define IDENTITY_CONNECTION_BUFFER 16384
+#define IDENTITY_PORT              6708
+#define IDENTITY_WORKER_QUANTITY   4
+#define IDENTITY_QUEUE_DEPTH       64
+#define IDENTITY_ACCEPTOR_QUANTITY 1
+#define IDENTITY_ACCEPTOR_MAX      64
+#define IDENTITY_INDEX_QUANTITY    2048
+
+#define IDENTITY_AUTH_CACHE_ENTRIES         65536
+#define IDENTITY_AUTH_CACHE_TTL_MS          30000
+#define IDENTITY_AUTH_CACHE_NEGATIVE_TTL_MS 5000
+
+#define IDENTITY_SESSIONS_MAX   1048576
+#define IDENTITY_SESSION_TTL_MS 86400000
+#define IDENTITY_TOKEN_TTL_S    900
+
+#define IDENTITY_VERIFY_THREADS   2
+#define IDENTITY_VERIFY_IN_FLIGHT 2
+
+#ifndef IDENTITY_LISTENER
+    #ifdef __linux__
+        #define IDENTITY_LISTENER IDENTITY_LISTENER_EVENT_LOOP
+    #else
+        #define IDENTITY_LISTENER IDENTITY_LISTENER_BLOCKING
+    #endif
+#endif
+
+#define IDENTITY_CONFIG_DEFAULT                                         \
+{                                                                       \
+    .port                       = IDENTITY_PORT,                        \
+    .listener                   = IDENTITY_LISTENER,                    \
+    .acceptor_quantity          = IDENTITY_ACCEPTOR_QUANTITY,           \
+    .worker_quantity            = IDENTITY_WORKER_QUANTITY,             \
+    .queue_depth                = IDENTITY_QUEUE_DEPTH,                 \
+    .auth_cache_entries         = IDENTITY_AUTH_CACHE_ENTRIES,          \
+    .auth_cache_ttl_ms          = IDENTITY_AUTH_CACHE_TTL_MS,           \
+    .auth_cache_negative_ttl_ms = IDENTITY_AUTH_CACHE_NEGATIVE_TTL_MS,  \
+    .sessions_max               = IDENTITY_SESSIONS_MAX,                \
+    .session_ttl_ms             = IDENTITY_SESSION_TTL_MS,              \
+    .token_ttl_s                = IDENTITY_TOKEN_TTL_S,                 \
+    .verify_threads             = IDENTITY_VERIFY_THREADS,              \
+    .verify_in_flight           = IDENTITY_VERIFY_IN_FLIGHT             \
+}
+
+// enumeration definitions
+enum identity_listener_e
+{
+    IDENTITY_LISTENER_BLOCKING   = 0, // one blocking accept loop, one worker per connection
+    IDENTITY_LISTENER_EVENT_LOOP = 1  // non blocking epoll loop, workers per complete request
+};
+
 // structure declarations
 struct identity_s;
+struct identity_config_s;
 
 // type definitions
-typedef struct identity_s identity;
+typedef struct identity_s        identity;
+typedef struct identity_config_s identity_config;
+
+// structure definitions
+struct identity_config_s
+{
+    socket_port              port;                       // listening port
+    enum identity_listener_e listener;                   // listener front end
+    size_t                   acceptor_quantity;          // event loops sharing the port with SO_REUSEPORT, each pinned to a core
+    size_t                   worker_quantity;            // threads serving connections
+    size_t                   queue_depth;                // connections waiting for a worker before the listener blocks
+    size_t                   auth_cache_entries;         // verdicts to remember. 0 turns the cache off
+    size_t                   auth_cache_ttl_ms;          // how long an allowed credential is remembered
+    size_t                   auth_cache_negative_ttl_ms; // how long a denied credential is remembered. 0 never remembers denials
+    size_t                   sessions_max;               // live session tokens. 0 turns sessions off
+    size_t                   session_ttl_ms;             // how long a session token is valid after it is issued
+    size_t                   token_ttl_s;                // how long a signed token is valid after it is signed
+    size_t                   verify_threads;             // threads that stretch passwords. 0 stretches on the workers
+    size_t                   verify_in_flight;           // passwords stretched at once. Beyond this, logins are busy
+};
 
 // forward declarations
 /// constructors
-int identity_construct ( identity **pp_identity );
+int identity_construct ( identity **pp_identity, const identity_config *p_config );
 
 /// accessors
+// Lookups take no lock. Call them between epoch_enter and epoch_exit, as
+// requests are, and use the user only until epoch_exit
 int identity_user_lookup ( identity *p_identity, size_t id, user **pp_user );
+int identity_user_lookup_name ( identity *p_identity, const char *p_name, size_t name_len, user **pp_user );
+int identity_user_lookup_org_name ( identity *p_identity, size_t org_id, const char *p_name, size_t name_len, user **pp_user );
+
+/// orgs
+// Each org keeps its records in indices of its own, so these lookups only
+// find records of the org, and only probe tables sized for it
+int identity_org_user_lookup ( identity *p_identity, size_t org_id, size_t id, user **pp_user );
+int identity_org_role_lookup ( identity *p_identity, size_t org_id, size_t id, role **pp_role );
+int identity_org_group_lookup ( identity *p_identity, size_t org_id, size_t id, group **pp_group );
+
+/** !
+ * Count the records of an org
+ *
+ * @param p_identity   the identity
+ * @param org_id       the id of the org
+ * @param p_users_len  return. the quantity of users. May be null
+ * @param p_roles_len  return. the quantity of roles. May be null
+ * @param p_groups_len return. the quantity of groups. May be null
+ *
+ * @return 1 on success, 0 if the org has no records
+ */
+int identity_org_size ( identity *p_identity, size_t org_id, size_t *p_users_len, size_t *p_roles_len, size_t *p_groups_len );
 
 
 /// mutators
@@ -52,5 +167,212 @@ int identity_org_add ( identity *p_identity, org *p_org );
 int identity_role_add ( identity *p_identity, role *p_role );
 int identity_group_add ( identity *p_identity, group *p_group );
 int identity_user_add ( identity *p_identity, user *p_user );
+int identity_users_add ( identity *p_identity, user **pp_users, size_t quantity );
+
+/// load
+/** !
+ * Load an organization directory into the identity
+ *
+ * @param p_identity the identity
+ * @param p_path     the organization directory, like resources/acme
+ *
+ * @return 1 on success, 0 on error
+ */
+int identity_load ( identity *p_identity, const char *p_path );
+
+/** !
+ * Drop every record of an org from memory, then wait until no reader can
+ * see them, so the caller may free them. The unload is logged and shipped to
+ * replicas, so replaying the log unloads the org again, and replicas drop it
+ * too. Load the org again with identity_load
+ *
+ * @param p_identity the identity
+ * @param org_id     the id of the org
+ *
+ * @return 1 on success, 0 on error
+ */
+int identity_org_unload ( identity *p_identity, size_t org_id );
+
+/// snapshot
+/** !
+ * Write every org, role, group and user to a snapshot file
+ *
+ * @param p_identity the identity
+ * @param p_path     the snapshot file
+ *
+ * @return 1 on success, 0 on error
+ */
+int identity_snapshot_save ( identity *p_identity, const char *p_path );
+
+/** !
+ * Map a snapshot file into the identity. The records are used in place, and
+ * the file stays mapped for the life of the identity
+ *
+ * @param p_identity the identity
+ * @param p_path     the snapshot file
+ *
+ * @return 1 on success, 0 on error
+ */
+int identity_snapshot_load ( identity *p_identity, const char *p_path );
+
+/// write ahead log
+/** !
+ * Replay a write ahead log on top of the loaded state, then log every later
+ * mutation to it. Mutators return once their record is on disk
+ *
+ * @param p_identity the identity
+ * @param p_path     the log file, created if missing
+ *
+ * @return 1 on success, 0 on error
+ */
+int identity_wal_open ( identity *p_identity, const char *p_path );
+
+/// replication
+/** !
+ * Ship every later mutation to replicas, and serve a snapshot to replicas
+ * that are too far behind. Call after the write ahead log is open, if any
+ *
+ * @param p_identity the identity
+ * @param port       the port replicas connect to
+ *
+ * @return 1 on success, 0 on error
+ */
+int identity_replication_serve ( identity *p_identity, uint16_t port );
+
+/** !
+ * Follow a primary, applying what it logs and serving reads. Records the
+ * replica already holds are skipped. The replica does not remember its
+ * place, so it loads a snapshot each time it starts
+ *
+ * @param p_identity the identity
+ * @param p_host     the address of the primary
+ * @param port       the replication port of the primary
+ *
+ * @return 1 on success, 0 on error
+ */
+int identity_replication_follow ( identity *p_identity, const char *p_host, uint16_t port );
+
+/** !
+ * Get the replication status. A primary reports each connected replica, and
+ * a replica reports itself
+ *
+ * @param p_identity the identity
+ * @param _statuses  return
+ * @param max        the most statuses to return
+ *
+ * @return the quantity of statuses
+ */
+size_t identity_replication_status ( identity *p_identity, replication_status *_statuses, size_t max );
+
+/// authorization
+/** !
+ * Compile the permissions of every role, and recompute the effective
+ * permissions of every user. Loads and role adds call this
+ *
+ * @param p_identity the identity
+ *
+ * @return 1 on success, 0 on error
+ */
+int identity_permissions_compile ( identity *p_identity );
+
+/** !
+ * Check if a user may perform an action on a resource, through their own
+ * roles or the roles of their groups. Call between epoch_enter and
+ * epoch_exit
+ *
+ * @param p_identity the identity
+ * @param p_user     the user
+ * @param p_action   the action, like "read"
+ * @param p_resource the resource, like "docs/readme"
+ *
+ * @return true if some role grants it, else false
+ */
+bool identity_authorize ( identity *p_identity, const user *p_user, const char *p_action, const char *p_resource );
+
+/// sessions
+/** !
+ * Authenticate a credential, then issue a session token to its user
+ *
+ * @param p_identity   the identity
+ * @param p_credential the credential
+ * @param token        return
+ *
+ * @return 1 on success, 0 if the credential is denied or sessions are off
+ */
+int identity_session_issue ( identity *p_identity, const protocol_credential *p_credential, unsigned char token[SESSION_TOKEN_SIZE] );
+
+/** !
+ * Check a session token, without touching user records
+ *
+ * @param p_identity the identity
+ * @param token      the token
+ * @param p_user_id  return. the id of the user, if the token is live. May be null
+ *
+ * @return true if the token is live, else false
+ */
+bool identity_session_validate ( identity *p_identity, const unsigned char token[SESSION_TOKEN_SIZE], size_t *p_user_id );
+
+/** !
+ * Revoke a session token, like on sign out
+ *
+ * @param p_identity the identity
+ * @param token      the token
+ *
+ * @return 1 if the token was live, else 0
+ */
+int identity_session_revoke ( identity *p_identity, const unsigned char token[SESSION_TOKEN_SIZE] );
+
+/// signed tokens
+/** !
+ * Add a signing key, or replace the key with the same id. The key signs
+ * every token from now on, and older keys still verify
+ *
+ * @param p_identity the identity
+ * @param key_id     the id of the key
+ * @param p_secret   the secret
+ * @param len        the length of the secret, in bytes
+ *
+ * @return 1 on success, 0 on error
+ */
+int identity_token_key_add ( identity *p_identity, uint8_t key_id, const void *p_secret, size_t len );
+
+/** !
+ * Remove a key once every token it signed has expired
+ *
+ * @param p_identity the identity
+ * @param key_id     the id of the key
+ *
+ * @return 1 on success, 0 on error
+ */
+int identity_token_key_remove ( identity *p_identity, uint8_t key_id );
+
+/** !
+ * Add every key in a key file. Each line is a key id and a hex secret, like
+ * "1 8f3a...". The last line signs
+ *
+ * @param p_identity the identity
+ * @param p_path     the key file
+ *
+ * @return 1 on success, 0 on error
+ */
+int identity_token_keys_load ( identity *p_identity, const char *p_path );
+
+/** !
+ * Authenticate a credential, then sign a token with the claims of its user.
+ * The token carries the user's own roles, the roles of their groups, and
+ * their groups
+ *
+ * @param p_identity   the identity
+ * @param p_credential the credential
+ * @param p_token      return. at least TOKEN_SIZE_MAX bytes
+ * @param p_len        return. the length of the token, in bytes
+ * @param p_status     return. PROTOCOL_STATUS_DENIED if the credential is
+ *                     denied, or PROTOCOL_STATUS_UNSUPPORTED if there is no
+ *                     key, or the user has a role or group id of TOKEN_ID_MAX
+ *                     or more, which a token can not hold
+ *
+ * @return 1 on success, else 0
+ */
+int identity_token_sign ( identity *p_identity, const protocol_credential *p_credential, unsigned char *p_token, size_t *p_len, unsigned char *p_status );
 
 int identity_print ( identity *p_identity );
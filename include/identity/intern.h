@@ -0,0 +1,90 @@
+/** !
+ * Intern
+ *
+ * One process wide table of distinct strings, like role names, group names
+ * and permissions. Each string is stored once, in a list of arenas, and gets
+ * a 32 bit id, dense from 0. Records keep ids, so equal strings compare as
+ * equal integers
+ *
+ * Adding and finding a string take a lock. Getting the string of an id does
+ * not, since strings and their directory pages never move once written
+ *
+ * @file identity/intern.h
+ *
+ * @author Jacob Smith
+ */
+
+// standard library
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <threads.h>
+
+// gsdk
+#include <gsdk.h>
+
+/// core
+#include <core/log.h>
+#include <core/hash.h>
+#include <core/sync.h>
+
+// identity
+#include <identity/arena.h>
+
+// preprocessor definitions
+#define INTERN_NONE          UINT32_MAX
+#define INTERN_ARENA_SIZE    65536
+#define INTERN_PAGE_QUANTITY 4096
+#define INTERN_PAGES_MAX     4096
+
+// forward declarations
+/// mutators
+/** !
+ * Get the id of a string, adding it if it is new
+ *
+ * @param p_string the string
+ * @param len      the length of the string, in bytes
+ * @param p_id     return
+ *
+ * @return 1 on success, 0 on error
+ */
+int intern_string_add ( const char *p_string, size_t len, uint32_t *p_id );
+
+/// accessors
+/** !
+ * Get the id of a string, without adding it
+ *
+ * @param p_string the string
+ * @param len      the length of the string, in bytes
+ * @param p_id     return
+ *
+ * @return 1 if the string is interned, else 0
+ */
+int intern_string_find ( const char *p_string, size_t len, uint32_t *p_id );
+
+/** !
+ * Get the string of an id
+ *
+ * @param id the id
+ *
+ * @return the null terminated string, or null if the id is unknown
+ */
+const char *intern_string_get ( uint32_t id );
+
+/** !
+ * Get the length of the string of an id
+ *
+ * @param id the id
+ *
+ * @return the length of the string, in bytes
+ */
+size_t intern_string_len ( uint32_t id );
+
+/** !
+ * Get the quantity of interned strings. Every id is less than this
+ *
+ * @return the quantity of interned strings
+ */
+size_t intern_size ( void );
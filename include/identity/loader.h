@@ -0,0 +1,86 @@
+/** !
+ * Loader
+ *
+ * Loads an organization directory
+ *
+ *   <path>/org.json
+ *   <path>/roles/<role>.json
+ *   <path>/groups/<group>.json
+ *   <path>/users/<user>.json
+ *
+ * Files are read and parsed in parallel on a thread pool
+ *
+ * @file identity/loader.h
+ *
+ * @author Jacob Smith
+ */
+
+// standard library
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+// gsdk
+#include <gsdk.h>
+
+/// core
+#include <core/log.h>
+#include <core/sync.h>
+
+/// performance
+#include <performance/thread_pool.h>
+
+// identity
+#include <identity/org.h>
+#include <identity/role.h>
+#include <identity/group.h>
+#include <identity/user.h>
+
+// preprocessor definitions
+#define LOADER_PATH_MAX         4096
+#define LOADER_TASKS_PER_WORKER 4
+
+// structure declarations
+struct loader_result_s;
+
+// type definitions
+typedef struct loader_result_s loader_result;
+
+// structure definitions
+struct loader_result_s
+{
+    org    *p_org;
+    role  **pp_roles;
+    size_t  roles_len;
+    group **pp_groups;
+    size_t  groups_len;
+    user  **pp_users;
+    size_t  users_len;
+    size_t  failures; // files that could not be read or parsed
+    size_t  bytes;    // bytes read
+};
+
+// forward declarations
+/// load
+/** !
+ * Load an organization directory
+ *
+ * @param p_path          the organization directory
+ * @param p_thread_pool   the thread pool to parse on
+ * @param worker_quantity the quantity of threads in the thread pool
+ * @param p_result        return. release with loader_result_release
+ *
+ * @return 1 on success, 0 on error
+ */
+int loader_load ( const char *p_path, thread_pool *p_thread_pool, size_t worker_quantity, loader_result *p_result );
+
+/// release
+/** !
+ * Release the arrays of a loader result. The loaded values are not released
+ *
+ * @param p_result the loader result
+ *
+ * @return 1 on success, 0 on error
+ */
+int loader_result_release ( loader_result *p_result );
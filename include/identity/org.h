@@ -11,6 +11,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 // gsdk
 #include <gsdk.h>
@@ -51,7 +52,25 @@ void *org_key_accessor ( org *p_org );
 int org_comparator ( org *p_a, org *p_b );
 
 /// pack 
+/** !
+ * Pack an org into a buffer. Orgs are stored packed, so this is a copy
+ *
+ * @param p_buffer the buffer, or null to measure the org
+ * @param p_org    the org
+ *
+ * @return the size of the packed org in bytes, or 0 on error
+ */
 int org_pack ( void *p_buffer, const org *const p_org );
 
 /// unpack
-int org_unpack ( void *const p_value, void *p_buffer );
+/** !
+ * Bind an org to a packed record in place. Nothing is copied or allocated,
+ * so the buffer must outlive the org
+ *
+ * @param pp_org   return
+ * @param p_buffer the packed record, 8 byte aligned
+ * @param size     the bytes available at p_buffer
+ *
+ * @return the size of the packed org in bytes, or 0 if the record is malformed
+ */
+int org_unpack ( org **pp_org, void *p_buffer, size_t size );
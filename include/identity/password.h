@@ -0,0 +1,82 @@
+/** !
+ * Password
+ *
+ * A dedicated pool of threads for stretching passwords. A stretched password
+ * costs milliseconds, a token check costs nanoseconds, so stretching never
+ * runs on a request worker. The pool admits at most in_flight_max passwords
+ * at once. A password that finds the pool full is not queued behind the
+ * others, it is refused as busy, so a burst of logins can neither pile up
+ * work nor hold request workers for long
+ *
+ * @file identity/password.h
+ *
+ * @author Jacob Smith
+ */
+
+// standard library
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+// gsdk
+#include <gsdk.h>
+
+/// core
+#include <core/log.h>
+#include <core/sha.h>
+#include <core/sync.h>
+
+/// performance
+#include <performance/thread_pool.h>
+
+// identity
+#include <identity/user.h>
+
+// preprocessor definitions
+#define PASSWORD_BATCH_MAX 64 // passwords admitted by one call
+
+// enumeration definitions
+enum password_verdict_e
+{
+    PASSWORD_MISMATCH = 0,
+    PASSWORD_MATCH    = 1,
+    PASSWORD_BUSY     = 2  // the pool was full, so the password was not checked
+};
+
+// structure declarations
+struct password_pool_s;
+
+// type definitions
+typedef struct password_pool_s password_pool;
+
+// forward declarations
+/// constructors
+/** !
+ * Construct a password pool
+ *
+ * @param pp_password_pool return
+ * @param threads          the quantity of threads that stretch passwords
+ * @param in_flight_max    the most passwords admitted at once
+ *
+ * @return 1 on success, 0 on error
+ */
+int password_pool_construct ( password_pool **pp_password_pool, size_t threads, size_t in_flight_max );
+
+/// verify
+/** !
+ * Check passwords against their users on the pool, and wait for the verdicts.
+ * Passwords past the pool's free capacity are not checked, and are busy
+ *
+ * @param p_password_pool the password pool
+ * @param _p_users        the users
+ * @param _digests        the SHA-256 digest of each password
+ * @param count           the quantity of passwords
+ * @param _verdicts       return. the verdict of each password
+ *
+ * @return the quantity of passwords checked, busy ones excluded
+ */
+size_t password_pool_verify ( password_pool *p_password_pool, const user *const *_p_users, const unsigned char *const *_digests, size_t count, enum password_verdict_e *_verdicts );
+
+/// destructors
+int password_pool_destroy ( password_pool **pp_password_pool );
@@ -0,0 +1,111 @@
+/** !
+ * Permission matcher
+ *
+ * Compiles the permissions of every role into one deterministic automaton
+ * over path segments. A permission is an action and a resource
+ *
+ *   read:*          read anything
+ *   write:issues/7  write issue 7
+ *   *:*             do anything to anything
+ *
+ * The action is the first segment, and the resource is split on '/'. A '*'
+ * segment matches any one segment, or, as the last segment, any one or more.
+ * Matching walks one state per segment, so a check costs time in the length
+ * of the path, however many permissions there are
+ *
+ * @file identity/permission.h
+ *
+ * @author Jacob Smith
+ */
+
+// standard library
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// gsdk
+#include <gsdk.h>
+
+/// core
+#include <core/log.h>
+#include <core/hash.h>
+
+// identity
+#include <identity/role.h>
+
+// preprocessor definitions
+#define PERMISSION_SEGMENTS_MAX 64
+#define PERMISSION_MATCH_MAX    256
+
+// structure declarations
+struct permission_matcher_s;
+
+// type definitions
+typedef struct permission_matcher_s permission_matcher;
+
+// forward declarations
+/// constructors
+/** !
+ * Compile the permissions of some roles. Equal permission strings share an
+ * id, and ids are dense from 0
+ *
+ * @param pp_permission_matcher return
+ * @param pp_roles              the roles
+ * @param roles_len             the quantity of roles
+ *
+ * @return 1 on success, 0 on error
+ */
+int permission_matcher_construct ( permission_matcher **pp_permission_matcher, role **pp_roles, size_t roles_len );
+
+/// accessors
+/** !
+ * Get the quantity of distinct permissions
+ *
+ * @param p_permission_matcher the permission matcher
+ *
+ * @return the quantity of distinct permissions
+ */
+size_t permission_matcher_size ( const permission_matcher *p_permission_matcher );
+
+/** !
+ * Get the ids of a role's permissions, in ascending order
+ *
+ * @param p_permission_matcher the permission matcher
+ * @param role_id              the id of the role
+ * @param pp_ids               return
+ * @param p_ids_len            return
+ *
+ * @return 1 if the role is known, else 0
+ */
+int permission_matcher_role_get ( const permission_matcher *p_permission_matcher, size_t role_id, const uint32_t **pp_ids, size_t *p_ids_len );
+
+/** !
+ * Find every permission that grants an action on a resource
+ *
+ * @param p_permission_matcher the permission matcher
+ * @param p_action             the action, like "read"
+ * @param p_resource           the resource, like "docs/readme"
+ * @param _ids                 return. the ids of the matching permissions
+ * @param ids_max              room in _ids. Matches past it are not returned
+ *
+ * @return the quantity of matching permissions, at most ids_max
+ */
+size_t permission_matcher_match ( const permission_matcher *p_permission_matcher, const char *p_action, const char *p_resource, uint32_t *_ids, size_t ids_max );
+
+/** !
+ * Test whether any permission that grants an action on a resource is in a
+ * set. Every match is tested, however many there are
+ *
+ * @param p_permission_matcher the permission matcher
+ * @param p_action             the action, like "read"
+ * @param p_resource           the resource, like "docs/readme"
+ * @param _set                 the set. bit i % 64 of word i / 64 is set for permission i
+ *
+ * @return true if a matching permission is in the set, else false
+ */
+bool permission_matcher_any ( const permission_matcher *p_permission_matcher, const char *p_action, const char *p_resource, const uint64_t *_set );
+
+/// destructors
+int permission_matcher_destroy ( permission_matcher **pp_permission_matcher );
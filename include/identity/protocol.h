@@ -0,0 +1,181 @@
+/** !
+ * Protocol
+ *
+ * @file identity/protocol.h
+ *
+ * @author Jacob Smith
+ */
+
+// standard library
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// gsdk
+#include <gsdk.h>
+
+/// core
+#include <core/log.h>
+#include <core/sha.h>
+
+// identity
+#include <identity/arena.h>
+
+// preprocessor definitions
+//
+// Two framings share the port, and every frame says which one it uses.
+//
+// JSON frames start with an 8 byte little endian length, followed by that
+// many bytes of JSON. The length never exceeds PROTOCOL_REQUEST_MAX, so the
+// upper bytes of the length are always zero.
+//
+// Binary frames start with an 8 byte header that begins with the magic
+// "IDB". The magic can never be mistaken for a JSON length.
+//
+//   offset size field
+//   0      3    magic    'I' 'D' 'B'
+//   3      1    version  PROTOCOL_BINARY_VERSION
+//   4      1    type     PROTOCOL_BINARY_*
+//   5      1    flags    PROTOCOL_BINARY_FLAG_*, or zero
+//   6      2    length   bytes of body after the header, little endian
+//
+// A credential is a 1 byte username length, the username, and the raw 32
+// byte SHA-256 digest of the password. An authenticate body is one
+// credential, and the reply is one status byte. A batch body is a 1 byte
+// count followed by that many credentials, and the reply is one status byte
+// per credential, in order. An issue body is one credential, and the reply
+// is one status byte, followed by a PROTOCOL_TOKEN_SIZE byte session token
+// if the status is okay. Validate and revoke bodies are one token, and the
+// reply is one status byte. A sign body is one credential, and the reply is
+// one status byte, followed by a 1 byte token length and a signed token if
+// the status is okay. Sign replies unsupported when the server has no key,
+// or the user has a role or group id too large for a token. A malformed or unsupported request of any type is
+// answered with a single status byte.
+//
+// Replies carry no header, so a client must wait for one before it knows
+// where the next begins. A client that keeps many requests in flight on one
+// connection sets PROTOCOL_BINARY_FLAG_TAGGED instead. The body of a tagged
+// request starts with a 4 byte little endian request id, counted in the
+// length, and its reply follows a header that repeats the id
+//
+//   offset size field
+//   0      4    id       the request id
+//   4      2    length   bytes of reply after the header, little endian
+//   6      2    zero
+//
+// Replies still come back in the order of the requests on a connection, but
+// a client matches them by id. A tagged request too short to hold an id is
+// answered with id 0 and a malformed status.
+#define PROTOCOL_REQUEST_MAX           8192
+#define PROTOCOL_HEADER_SIZE           8
+#define PROTOCOL_BINARY_MAGIC          "IDB"
+#define PROTOCOL_BINARY_VERSION        1
+#define PROTOCOL_BINARY_AUTHENTICATE   1
+#define PROTOCOL_BINARY_BATCH          2
+#define PROTOCOL_BINARY_ISSUE          3
+#define PROTOCOL_BINARY_VALIDATE       4
+#define PROTOCOL_BINARY_REVOKE         5
+#define PROTOCOL_BINARY_SIGN           6
+#define PROTOCOL_BINARY_FLAG_TAGGED    0x01
+#define PROTOCOL_REPLY_HEADER_SIZE     8
+#define PROTOCOL_TOKEN_SIZE            16
+#define PROTOCOL_NAME_MAX              64
+#define PROTOCOL_BATCH_MAX             64
+#define PROTOCOL_JSON_DEPTH_MAX        16
+
+// enumeration definitions
+enum protocol_status_e
+{
+    PROTOCOL_STATUS_OKAY        = 0,
+    PROTOCOL_STATUS_DENIED      = 1,
+    PROTOCOL_STATUS_MALFORMED   = 2,
+    PROTOCOL_STATUS_UNSUPPORTED = 3,
+    PROTOCOL_STATUS_BUSY        = 4  // the password was not checked. Try again later
+};
+
+enum protocol_json_type_e
+{
+    PROTOCOL_JSON_NULL    = 0,
+    PROTOCOL_JSON_BOOLEAN = 1,
+    PROTOCOL_JSON_INTEGER = 2,
+    PROTOCOL_JSON_NUMBER  = 3,
+    PROTOCOL_JSON_STRING  = 4,
+    PROTOCOL_JSON_ARRAY   = 5,
+    PROTOCOL_JSON_OBJECT  = 6
+};
+
+// structure declarations
+struct protocol_binary_header_s;
+struct protocol_binary_reply_s;
+struct protocol_credential_s;
+struct protocol_json_s;
+
+// type definitions
+typedef struct protocol_binary_header_s protocol_binary_header;
+typedef struct protocol_binary_reply_s  protocol_binary_reply;
+typedef struct protocol_credential_s    protocol_credential;
+typedef struct protocol_json_s          protocol_json;
+
+// structure definitions
+struct protocol_binary_header_s
+{
+    unsigned char _magic[3];
+    uint8_t       version;
+    uint8_t       type;
+    uint8_t       flags;
+    uint16_t      length;
+};
+
+struct protocol_binary_reply_s
+{
+    uint32_t id;
+    uint16_t length;
+    uint16_t _reserved;
+};
+
+struct protocol_credential_s
+{
+    const char  *p_name;   // not null terminated
+    size_t       name_len;
+    sha256_hash  _digest;
+};
+
+// A JSON value parsed into an arena. Strings without escapes point into the
+// request itself, so none of them are null terminated. Elements of an array
+// and members of an object are chained through p_next
+struct protocol_json_s
+{
+    enum protocol_json_type_e  type;
+    const char                *p_key;    // member name, when the parent is an object
+    size_t                     key_len;
+    size_t                     len;      // string bytes, or array elements, or object members
+    union
+    {
+        bool           boolean;
+        long long      integer;
+        double         number;
+        const char    *p_string;
+        protocol_json *p_first;
+    };
+    protocol_json             *p_next;
+};
+
+// forward declarations
+/// frames
+int protocol_frame_length ( const char *p_buffer, size_t len, size_t *p_frame_len );
+bool protocol_frame_is_binary ( const char *p_frame );
+
+/// binary
+int protocol_binary_authenticate_parse ( const char *p_body, size_t body_len, protocol_credential *p_credential );
+int protocol_binary_batch_parse ( const char *p_body, size_t body_len, protocol_credential *_credentials, size_t *p_count );
+
+/// json
+int protocol_json_parse ( arena *p_arena, const char *p_text, size_t len, protocol_json **pp_value );
+protocol_json *protocol_json_get ( const protocol_json *p_object, const char *p_key );
+bool protocol_json_string_equals ( const protocol_json *p_value, const char *p_string );
+
+/// hex
+int protocol_hex_decode ( const char *p_hex, size_t hex_len, unsigned char *p_bytes );
+size_t protocol_hex_encode ( const unsigned char *p_bytes, size_t len, char *p_hex );
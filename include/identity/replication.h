@@ -0,0 +1,219 @@
+/** !
+ * Replication
+ *
+ * A primary ships every record it logs to its replicas over TCP, and the
+ * replicas apply them and serve reads. Each message is a header followed by
+ * a payload
+ *
+ *   offset size field
+ *   0      4    kind      see enum replication_message_e
+ *   4      4    size      bytes of payload
+ *   8      8    sequence  depends on the kind
+ *
+ * A replica says hello with the last sequence it applied, and the generation
+ * of the primary it applied it from. Each start of a primary is a new
+ * generation, since its sequences may start over. If the generation matches,
+ * and the primary still holds every record after the sequence, it sends
+ * them. Else it sends a snapshot, every record it holds stamped with no
+ * sequence, then the sequence the snapshot holds, then the records after it. From then on
+ * records follow as they are logged, and a heartbeat with the primary's
+ * last sequence when there are none. The replica acknowledges what it has
+ * applied, so both ends know how far behind it is
+ *
+ * The primary keeps the newest records in a backlog of at most
+ * REPLICATION_BACKLOG_MAX bytes. A replica further behind than the backlog
+ * gets a snapshot. The snapshot replaces the replica's state: a record it
+ * holds replaces the replica's record with the same id, and a record it
+ * does not hold is dropped
+ *
+ * @file identity/replication.h
+ *
+ * @author Jacob Smith
+ */
+
+// standard library
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// gsdk
+#include <gsdk.h>
+
+/// core
+#include <core/log.h>
+#include <core/sync.h>
+
+/// parallel
+#include <parallel/thread.h>
+
+// identity
+#include <identity/wal.h>
+
+// preprocessor definitions
+#define REPLICATION_MAGIC         0x50524449 // "IDRP"
+#define REPLICATION_VERSION       1
+#define REPLICATION_HEADER_SIZE   16
+#define REPLICATION_BACKLOG_MAX   ( 16 * 1024 * 1024 )
+#define REPLICATION_CHUNK_MAX     65536      // bytes of records in one message
+#define REPLICATION_REPLICAS_MAX  16
+#define REPLICATION_HEARTBEAT_MS  1000
+#define REPLICATION_RETRY_MS      1000
+
+// enumeration definitions
+enum replication_message_e
+{
+    REPLICATION_HELLO        = 1, // replica -> primary. struct replication_hello_s. sequence is the last one applied
+    REPLICATION_RECORDS      = 2, // primary -> replica. records. sequence is the last one
+    REPLICATION_SNAPSHOT     = 3, // primary -> replica. records without sequences
+    REPLICATION_SNAPSHOT_END = 4, // primary -> replica. the generation. sequence is the one the snapshot holds
+    REPLICATION_HEARTBEAT    = 5, // primary -> replica. sequence is the primary's last one
+    REPLICATION_ACK          = 6  // replica -> primary. sequence is the last one applied
+};
+
+enum replication_snapshot_e
+{
+    REPLICATION_SNAPSHOT_BEGIN  = 0, // before the first record of a snapshot
+    REPLICATION_SNAPSHOT_FINISH = 1, // after the last. The snapshot is the primary's whole state
+    REPLICATION_SNAPSHOT_CANCEL = 2  // the connection cut the snapshot short
+};
+
+// structure declarations
+struct replication_primary_s;
+struct replication_replica_s;
+struct replication_hello_s;
+struct replication_status_s;
+
+// type definitions
+typedef struct replication_primary_s replication_primary;
+typedef struct replication_replica_s replication_replica;
+typedef struct replication_status_s  replication_status;
+
+/** !
+ * Pack every record a primary holds, for a snapshot. Called by the thread
+ * serving a replica, and must not race the records logged after it
+ *
+ * @param p_context   the context passed to replication_primary_construct
+ * @param pp_records  return. the records, in one allocation owned by the caller
+ * @param p_len       return. the bytes of records
+ * @param p_sequence  return. the sequence the records hold
+ *
+ * @return 1 on success, 0 on error
+ */
+typedef int (fn_replication_dump) ( void *p_context, char **pp_records, size_t *p_len, uint64_t *p_sequence );
+
+/** !
+ * Start, finish or cancel a snapshot on a replica. A finished snapshot
+ * replaces the replica's state, so records it did not hold are dropped. A
+ * cancelled one drops nothing, since the rest of it never arrived
+ *
+ * @param p_context the context passed to replication_replica_construct
+ * @param stage     see enum replication_snapshot_e
+ *
+ * @return 1 on success, 0 on error
+ */
+typedef int (fn_replication_snapshot) ( void *p_context, enum replication_snapshot_e stage );
+
+// structure definitions
+struct replication_hello_s
+{
+    uint32_t magic;      // REPLICATION_MAGIC
+    uint32_t version;    // REPLICATION_VERSION
+    uint64_t generation; // of the primary the replica last followed, or 0
+};
+
+struct replication_status_s
+{
+    bool      connected;  // the replica has a live connection to the primary
+    uint32_t  address;    // ipv4 address of the other end
+    uint16_t  port;       // port of the other end
+    uint64_t  applied;    // the last sequence the replica applied
+    uint64_t  primary;    // the last sequence the primary logged, as far as this end knows
+    uint64_t  lag;        // primary - applied
+    size_t    contact_ms; // milliseconds since the other end was last heard from
+};
+
+// forward declarations
+/// constructors
+/** !
+ * Start serving replicas
+ *
+ * @param pp_primary return
+ * @param port       the port replicas connect to
+ * @param sequence   the last sequence already logged
+ * @param pfn_dump   packs a snapshot
+ * @param p_context  passed to pfn_dump
+ *
+ * @return 1 on success, 0 on error
+ */
+int replication_primary_construct ( replication_primary **pp_primary, uint16_t port, uint64_t sequence, fn_replication_dump *pfn_dump, void *p_context );
+
+/** !
+ * Follow a primary from a thread of its own, reconnecting when the
+ * connection drops
+ *
+ * @param pp_replica   return
+ * @param p_host       the address of the primary
+ * @param port         the replication port of the primary
+ * @param pfn_apply    applies one record. Takes ownership of the value
+ * @param pfn_snapshot brackets a snapshot
+ * @param p_context    passed to pfn_apply and pfn_snapshot
+ *
+ * @return 1 on success, 0 on error
+ */
+int replication_replica_construct ( replication_replica **pp_replica, const char *p_host, uint16_t port, fn_wal_replay *pfn_apply, fn_replication_snapshot *pfn_snapshot, void *p_context );
+
+/// accessors
+/** !
+ * Get the status of each connected replica
+ *
+ * @param p_primary the primary
+ * @param _statuses return
+ * @param max       the most statuses to return
+ *
+ * @return the quantity of statuses
+ */
+size_t replication_primary_status ( replication_primary *p_primary, replication_status *_statuses, size_t max );
+
+/** !
+ * Get the status of a replica
+ *
+ * @param p_replica the replica
+ * @param p_status  return
+ *
+ * @return 1 on success, 0 on error
+ */
+int replication_replica_status ( replication_replica *p_replica, replication_status *p_status );
+
+/// mutators
+/** !
+ * Ship a logged record to every replica. Call in the order records are
+ * logged, under the same lock. Only for records that are not written ahead,
+ * see replication_primary_append_records
+ *
+ * @param p_primary the primary
+ * @param type      the type of the value
+ * @param p_value   the value
+ * @param sequence  the sequence of the record
+ *
+ * @return 1 on success, 0 on error
+ */
+int replication_primary_append ( replication_primary *p_primary, enum wal_record_e type, const void *p_value, uint64_t sequence );
+
+/** !
+ * Ship records that are already packed, and durable, to every replica. A
+ * fn_wal_durable, so the log hands over each batch once it is on disk, and
+ * replicas never hold a record the primary could still lose
+ *
+ * @param p_primary the primary
+ * @param p_records the packed records, in sequence order
+ * @param len       the length of the records, in bytes
+ *
+ * @return 1 on success, 0 on error
+ */
+int replication_primary_append_records ( replication_primary *p_primary, const void *p_records, size_t len );
+
+/// destructors
+int replication_primary_destroy ( replication_primary **pp_primary );
+int replication_replica_destroy ( replication_replica **pp_replica );
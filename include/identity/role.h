@@ -11,6 +11,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 // gsdk
 #include <gsdk.h>
@@ -26,6 +27,13 @@
 /// reflection
 #include <reflection/json.h>
 
+// identity
+#include <identity/intern.h>
+
+// preprocessor definitions
+#define ROLE_NAME_MAX        64
+#define ROLE_PERMISSIONS_MAX 256
+
 // structure declarations
 struct role_s;
 
@@ -53,8 +61,45 @@ int role_print ( role *p_role );
 void *role_key_accessor ( role *p_role );
 int role_comparator ( size_t id_a, size_t id_b );
 
+/// accessors
+const char *role_name_get ( const role *p_role );
+uint32_t role_name_id ( const role *p_role );
+size_t role_org_id_get ( const role *p_role );
+size_t role_permissions_len ( const role *p_role );
+const char *role_permission_get ( const role *p_role, size_t index );
+
+/** !
+ * Get the interned id of a permission. Equal permissions have equal ids, in
+ * every role
+ *
+ * @param p_role the role
+ * @param index  the index of the permission
+ *
+ * @return the id, or INTERN_NONE if index is out of bounds
+ */
+uint32_t role_permission_id_get ( const role *p_role, size_t index );
+
 /// pack 
+/** !
+ * Pack a role into a buffer. Roles are stored packed, so this is a copy
+ *
+ * @param p_buffer the buffer, or null to measure the role
+ * @param p_role   the role
+ *
+ * @return the size of the packed role in bytes, or 0 on error
+ */
 int role_pack ( void *p_buffer, const role *const p_role );
 
 /// unpack
-int role_unpack ( void *const p_value, void *p_buffer );
+/** !
+ * Bind a role to a packed record in place. Nothing is copied or allocated,
+ * so the buffer must outlive the role. Its strings are interned again, and
+ * their ids written into the record, so the buffer must be writable
+ *
+ * @param pp_role  return
+ * @param p_buffer the packed record, 8 byte aligned
+ * @param size     the bytes available at p_buffer
+ *
+ * @return the size of the packed role in bytes, or 0 if the record is malformed
+ */
+int role_unpack ( role **pp_role, void *p_buffer, size_t size );
@@ -0,0 +1,128 @@
+/** !
+ * Router
+ *
+ * Routes each username to the node that owns its shard, by consistent
+ * hashing. Each node is hashed onto a ring at many points, its virtual
+ * nodes, and a username belongs to the first point at or after its own
+ * hash. Adding or removing a node moves only the usernames next to its
+ * points, and the virtual nodes spread the load evenly
+ *
+ * A node that fails ROUTER_FAILURES_MAX times in a row is ejected, and its
+ * usernames go to the next node on the ring, until ROUTER_EJECT_MS pass.
+ * Then it is tried again. One more failure ejects it again, and a success
+ * restores it
+ *
+ * The Go client in example/identity/Router.go builds the same ring, so
+ * both route a username to the same node
+ *
+ * @file identity/router.h
+ *
+ * @author Jacob Smith
+ */
+
+// standard library
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// gsdk
+#include <gsdk.h>
+
+/// core
+#include <core/log.h>
+#include <core/sync.h>
+
+// preprocessor definitions
+#define ROUTER_NODES_MAX     64
+#define ROUTER_ADDRESS_MAX   256
+#define ROUTER_VNODES        128  // virtual nodes per node, when the caller passes 0
+#define ROUTER_FAILURES_MAX  3    // failures in a row that eject a node
+#define ROUTER_EJECT_MS      5000 // how long an ejected node sits out
+
+// structure declarations
+struct router_s;
+
+// type definitions
+typedef struct router_s router;
+
+// forward declarations
+/// constructors
+/** !
+ * Construct a router over a set of nodes
+ *
+ * @param pp_router    return
+ * @param pp_addresses the address of each node, like 10.0.0.2:6714
+ * @param quantity     the quantity of nodes
+ * @param vnodes       virtual nodes per node, or 0 for ROUTER_VNODES
+ *
+ * @return 1 on success, 0 on error
+ */
+int router_construct ( router **pp_router, const char *const *pp_addresses, size_t quantity, size_t vnodes );
+
+/** !
+ * Construct a router over the nodes in a file, one address per line, like
+ * the servers.txt test.sh writes. Blank lines are skipped
+ *
+ * @param pp_router return
+ * @param p_path    the file
+ * @param vnodes    virtual nodes per node, or 0 for ROUTER_VNODES
+ *
+ * @return 1 on success, 0 on error
+ */
+int router_load ( router **pp_router, const char *p_path, size_t vnodes );
+
+/// accessors
+/** !
+ * Hash a key onto the ring
+ *
+ * @param p_key the key
+ * @param len   the length of the key
+ *
+ * @return the hash
+ */
+uint64_t router_hash ( const void *p_key, size_t len );
+
+size_t router_size ( router *p_router );
+const char *router_address ( router *p_router, size_t node );
+
+/** !
+ * Find the node that serves a username, skipping ejected nodes
+ *
+ * @param p_router the router
+ * @param p_name   the username
+ * @param name_len the length of the username
+ * @param p_node   return. the index of the node
+ *
+ * @return 1 on success, 0 if every node is ejected
+ */
+int router_route ( router *p_router, const char *p_name, size_t name_len, size_t *p_node );
+
+/** !
+ * Find the node that owns a username, ejected or not
+ *
+ * @param p_router the router
+ * @param p_name   the username
+ * @param name_len the length of the username
+ *
+ * @return the index of the node
+ */
+size_t router_owner ( router *p_router, const char *p_name, size_t name_len );
+
+bool router_ejected ( router *p_router, size_t node );
+
+/// mutators
+/** !
+ * Report how a request to a node went. Safe to call from any thread
+ *
+ * @param p_router the router
+ * @param node     the index of the node
+ * @param healthy  the node answered
+ *
+ * @return void
+ */
+void router_report ( router *p_router, size_t node, bool healthy );
+
+/// destructors
+int router_destroy ( router **pp_router );
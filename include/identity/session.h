@@ -0,0 +1,100 @@
+/** !
+ * Session
+ *
+ * A table of opaque session tokens, issued after a successful login. A token
+ * is SESSION_TOKEN_SIZE random bytes, so its own bytes pick the shard and the
+ * slot, and validating it is one probe of one shard. The table only keeps the
+ * id of the user, so validating never touches user records
+ *
+ * Each shard is an open addressing table with its own lock. Tokens expire a
+ * fixed time after they are issued. Expired and revoked tokens stay in their
+ * slot until the shard is next rehashed, which drops them
+ *
+ * @file identity/session.h
+ *
+ * @author Jacob Smith
+ */
+
+// standard library
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// gsdk
+#include <gsdk.h>
+
+/// core
+#include <core/log.h>
+#include <core/sync.h>
+
+// preprocessor definitions
+#define SESSION_TOKEN_SIZE 16
+#define SESSION_SHARDS     64
+
+// structure declarations
+struct session_table_s;
+
+// type definitions
+typedef struct session_table_s session_table;
+
+// forward declarations
+/// constructors
+/** !
+ * Construct a session table
+ *
+ * @param pp_session_table return
+ * @param sessions_max     the most live sessions, spread over every shard
+ * @param ttl_ms           how long a token is valid after it is issued, in milliseconds
+ *
+ * @return 1 on success, 0 on error
+ */
+int session_table_construct ( session_table **pp_session_table, size_t sessions_max, size_t ttl_ms );
+
+/// accessors
+/** !
+ * Check a session token
+ *
+ * @param p_session_table the session table
+ * @param token           the token
+ * @param p_user_id       return. the id of the user the token was issued to
+ *
+ * @return true if the token is live, else false
+ */
+bool session_validate ( session_table *p_session_table, const unsigned char token[SESSION_TOKEN_SIZE], size_t *p_user_id );
+
+/// mutators
+/** !
+ * Issue a session token to a user
+ *
+ * @param p_session_table the session table
+ * @param user_id         the id of the user
+ * @param token           return
+ *
+ * @return 1 on success, 0 on error, like a full shard
+ */
+int session_issue ( session_table *p_session_table, size_t user_id, unsigned char token[SESSION_TOKEN_SIZE] );
+
+/** !
+ * Revoke a session token
+ *
+ * @param p_session_table the session table
+ * @param token           the token
+ *
+ * @return 1 if the token was live, else 0
+ */
+int session_revoke ( session_table *p_session_table, const unsigned char token[SESSION_TOKEN_SIZE] );
+
+/** !
+ * Revoke every session token of a user. This scans every shard
+ *
+ * @param p_session_table the session table
+ * @param user_id         the id of the user
+ *
+ * @return the quantity of revoked tokens
+ */
+size_t session_revoke_user ( session_table *p_session_table, size_t user_id );
+
+/// destructors
+int session_table_destroy ( session_table **pp_session_table );
@@ -0,0 +1,117 @@
+/** !
+ * Snapshot
+ *
+ * A binary image of every org, role, group and user, written with the
+ * *_pack functions and read back by mapping the file. Loading binds each
+ * record in place with the *_unpack functions, so nothing is parsed and no
+ * record is allocated
+ *
+ *   header   magic, version, endianness, size, write ahead log sequence,
+ *            and a table of sections
+ *   orgs     packed orgs
+ *   roles    packed roles
+ *   groups   packed groups
+ *   users    packed users
+ *
+ * Every record starts on an 8 byte boundary. The format is native endian and
+ * tied to the record layouts, so a snapshot from another version or another
+ * byte order is refused, and the organization directory is the fallback
+ *
+ * @file identity/snapshot.h
+ *
+ * @author Jacob Smith
+ */
+
+// standard library
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// gsdk
+#include <gsdk.h>
+
+/// core
+#include <core/log.h>
+
+// identity
+#include <identity/org.h>
+#include <identity/role.h>
+#include <identity/group.h>
+#include <identity/user.h>
+
+// preprocessor definitions
+#define SNAPSHOT_MAGIC    "IDSNAP"
+#define SNAPSHOT_VERSION  4
+#define SNAPSHOT_ENDIAN   0x01020304
+#define SNAPSHOT_PATH_MAX 4096
+
+// structure declarations
+struct snapshot_s;
+
+// type definitions
+typedef struct snapshot_s snapshot;
+
+// structure definitions
+struct snapshot_s
+{
+    void     *p_map;     // the mapped file, or null
+    size_t    size;      // bytes mapped
+    uint64_t  sequence;  // the last write ahead log record the snapshot holds
+    org     **pp_orgs;
+    size_t    orgs_len;
+    role    **pp_roles;
+    size_t    roles_len;
+    group   **pp_groups;
+    size_t    groups_len;
+    user    **pp_users;
+    size_t    users_len;
+};
+
+// forward declarations
+/// save
+/** !
+ * Write the values of a snapshot to a file. The file is written next to the
+ * path and renamed into place, so readers never see half a snapshot. The
+ * directory is synced after the rename, so on success the snapshot survives
+ * a crash, and the log it covers may be cut
+ *
+ * @param p_path     the snapshot file
+ * @param p_snapshot the values to write. p_map and size are ignored
+ *
+ * @return 1 on success, 0 on error
+ */
+int snapshot_save ( const char *p_path, const snapshot *p_snapshot );
+
+/// load
+/** !
+ * Map a snapshot file and bind every record in place
+ *
+ * @param p_path     the snapshot file
+ * @param p_snapshot return. release the arrays with snapshot_release, and
+ *                   unmap with snapshot_destroy once no record is in use
+ *
+ * @return 1 on success, 0 on error
+ */
+int snapshot_load ( const char *p_path, snapshot *p_snapshot );
+
+/// release
+/** !
+ * Release the arrays of a snapshot. The mapping, and the records in it, stay
+ *
+ * @param p_snapshot the snapshot
+ *
+ * @return 1 on success, 0 on error
+ */
+int snapshot_release ( snapshot *p_snapshot );
+
+/// destructors
+/** !
+ * Release the arrays of a snapshot and unmap the file
+ *
+ * @param p_snapshot the snapshot
+ *
+ * @return 1 on success, 0 on error
+ */
+int snapshot_destroy ( snapshot *p_snapshot );
@@ -0,0 +1,95 @@
+/** !
+ * Tenant
+ *
+ * The records of one organization, in indices of their own. Org scoped
+ * lookups probe a table sized for one org, so a large org never grows the
+ * tables a small one is read from, and an org can be dropped as a unit
+ *
+ * Like every hash index, a tenant is read without locks between epoch_enter
+ * and epoch_exit, and written by one writer at a time
+ *
+ * @file identity/tenant.h
+ *
+ * @author Jacob Smith
+ */
+
+// standard library
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// gsdk
+#include <gsdk.h>
+
+/// core
+#include <core/log.h>
+
+// identity
+#include <identity/hash_index.h>
+#include <identity/role.h>
+#include <identity/group.h>
+#include <identity/user.h>
+
+// structure declarations
+struct tenant_s;
+
+// type definitions
+typedef struct tenant_s tenant;
+
+// forward declarations
+/// constructors
+/** !
+ * Construct an empty tenant
+ *
+ * @param pp_tenant return
+ * @param org_id    the id of the organization
+ *
+ * @return 1 on success, 0 on error
+ */
+int tenant_construct ( tenant **pp_tenant, size_t org_id );
+
+/// accessors
+void *tenant_key_accessor ( tenant *p_tenant );
+
+/** !
+ * Count the records of a tenant
+ *
+ * @param p_tenant     the tenant
+ * @param p_users_len  return. the quantity of users. May be null
+ * @param p_roles_len  return. the quantity of roles. May be null
+ * @param p_groups_len return. the quantity of groups. May be null
+ *
+ * @return 1 on success, 0 on error
+ */
+int tenant_size ( tenant *p_tenant, size_t *p_users_len, size_t *p_roles_len, size_t *p_groups_len );
+
+int tenant_user_lookup ( tenant *p_tenant, size_t id, user **pp_user );
+int tenant_user_lookup_name ( tenant *p_tenant, const char *p_name, size_t name_len, user **pp_user );
+int tenant_role_lookup ( tenant *p_tenant, size_t id, role **pp_role );
+int tenant_group_lookup ( tenant *p_tenant, size_t id, group **pp_group );
+
+/** !
+ * Get every record of one kind. Each buffer must have room for the quantity
+ * tenant_size reports
+ *
+ * @param p_tenant  the tenant
+ * @param pp_users  return. May be null
+ * @param pp_roles  return. May be null
+ * @param pp_groups return. May be null
+ *
+ * @return 1 on success, 0 on error
+ */
+int tenant_values ( tenant *p_tenant, user **pp_users, role **pp_roles, group **pp_groups );
+
+/// mutators
+int tenant_user_insert ( tenant *p_tenant, user *p_user );
+int tenant_user_remove ( tenant *p_tenant, user *p_user );
+int tenant_role_insert ( tenant *p_tenant, role *p_role );
+int tenant_role_remove ( tenant *p_tenant, role *p_role );
+int tenant_group_insert ( tenant *p_tenant, group *p_group );
+int tenant_group_remove ( tenant *p_tenant, group *p_group );
+
+/// destructors
+int tenant_destroy ( tenant **pp_tenant );
@@ -0,0 +1,185 @@
+/** !
+ * Token
+ *
+ * Self contained signed tokens. A token carries the claims of a user, and an
+ * HMAC-SHA256 of those claims, so any service holding the key can verify it
+ * without asking the identity server
+ *
+ *   offset size field
+ *   0      1    version       TOKEN_VERSION
+ *   1      1    key id        the key that signed the token
+ *   2      1    roles length  bytes of the role bitset
+ *   3      1    groups length bytes of the group bitset
+ *   4      4    reserved      zero
+ *   8      8    user id       little endian
+ *   16     8    org id        little endian
+ *   24     8    expires       seconds since the epoch, little endian
+ *   32     ...  role bitset   bit i of byte i / 8 is set if the user has role i
+ *   ...    ...  group bitset  bit i of byte i / 8 is set if the user is in group i
+ *   ...    32   mac           HMAC-SHA256 of every byte before it
+ *
+ * Roles and groups are bits, indexed by their id, so only ids under
+ * TOKEN_ID_MAX fit. The identity refuses to sign a token for a user with a
+ * larger id, and loads such users like any other
+ *
+ * A keyring holds up to TOKEN_KEYS_MAX keys, each with a one byte id. The
+ * newest key signs, and every key verifies, so keys rotate by adding the new
+ * key, then removing the old one once its tokens have expired
+ *
+ * @file identity/token.h
+ *
+ * @author Jacob Smith
+ */
+
+// standard library
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+// gsdk
+#include <gsdk.h>
+
+/// core
+#include <core/log.h>
+#include <core/sha.h>
+#include <core/sync.h>
+
+// identity
+#include <identity/hmac.h>
+
+// preprocessor definitions
+#define TOKEN_VERSION     1
+#define TOKEN_KEYS_MAX    4
+#define TOKEN_BITSET_MAX  64 // bytes of a bitset
+#define TOKEN_ID_MAX      ( TOKEN_BITSET_MAX * 8 ) // role and group ids are under this
+#define TOKEN_HEADER_SIZE 32
+#define TOKEN_MAC_SIZE    32
+#define TOKEN_SIZE_MAX    ( TOKEN_HEADER_SIZE + 2 * TOKEN_BITSET_MAX + TOKEN_MAC_SIZE )
+
+// structure declarations
+struct token_keyring_s;
+struct token_claims_s;
+
+// type definitions
+typedef struct token_keyring_s token_keyring;
+typedef struct token_claims_s  token_claims;
+
+// structure definitions
+struct token_claims_s
+{
+    uint64_t      user_id;
+    uint64_t      org_id;
+    int64_t       expires;                   // seconds since the epoch
+    size_t        roles_len;                 // bytes of _roles in use
+    size_t        groups_len;                // bytes of _groups in use
+    unsigned char _roles[TOKEN_BITSET_MAX];
+    unsigned char _groups[TOKEN_BITSET_MAX];
+};
+
+// forward declarations
+/// constructors
+/** !
+ * Construct an empty keyring
+ *
+ * @param pp_keyring return
+ *
+ * @return 1 on success, 0 on error
+ */
+int token_keyring_construct ( token_keyring **pp_keyring );
+
+/// keys
+/** !
+ * Add a key, or replace the key with the same id. The key signs every token
+ * from now on
+ *
+ * @param p_keyring the keyring
+ * @param key_id    the id of the key
+ * @param p_secret  the secret
+ * @param len       the length of the secret, in bytes
+ *
+ * @return 1 on success, 0 on error, like a full keyring
+ */
+int token_keyring_key_add ( token_keyring *p_keyring, uint8_t key_id, const void *p_secret, size_t len );
+
+/** !
+ * Remove a key. Tokens it signed no longer verify. The signing key can not
+ * be removed
+ *
+ * @param p_keyring the keyring
+ * @param key_id    the id of the key
+ *
+ * @return 1 on success, 0 on error
+ */
+int token_keyring_key_remove ( token_keyring *p_keyring, uint8_t key_id );
+
+/// claims
+/** !
+ * Add a role to the claims
+ *
+ * @param p_claims the claims
+ * @param role_id  the id of the role
+ *
+ * @return 1 on success, 0 if the id does not fit in the bitset
+ */
+int token_claims_role_add ( token_claims *p_claims, size_t role_id );
+
+/** !
+ * Add a group to the claims
+ *
+ * @param p_claims the claims
+ * @param group_id the id of the group
+ *
+ * @return 1 on success, 0 if the id does not fit in the bitset
+ */
+int token_claims_group_add ( token_claims *p_claims, size_t group_id );
+
+bool token_claims_has_role ( const token_claims *p_claims, size_t role_id );
+bool token_claims_in_group ( const token_claims *p_claims, size_t group_id );
+
+/// sign
+/** !
+ * Sign claims with the newest key
+ *
+ * @param p_keyring the keyring
+ * @param p_claims  the claims
+ * @param p_token   return. at least TOKEN_SIZE_MAX bytes
+ * @param p_len     return. the length of the token, in bytes
+ *
+ * @return 1 on success, 0 on error
+ */
+int token_sign ( token_keyring *p_keyring, const token_claims *p_claims, unsigned char *p_token, size_t *p_len );
+
+/// verify
+/** !
+ * Verify a token, and get its claims
+ *
+ * @param p_keyring the keyring
+ * @param p_token   the token
+ * @param len       the length of the token, in bytes
+ * @param now       seconds since the epoch
+ * @param p_claims  return. May be null
+ *
+ * @return true if the token is well formed, signed by a key in the keyring, and unexpired, else false
+ */
+bool token_verify ( token_keyring *p_keyring, const unsigned char *p_token, size_t len, time_t now, token_claims *p_claims );
+
+/** !
+ * Verify many tokens under one lock of the keyring
+ *
+ * @param p_keyring the keyring
+ * @param pp_tokens the tokens
+ * @param _lens     the length of each token, in bytes
+ * @param count     the quantity of tokens
+ * @param now       seconds since the epoch
+ * @param _claims   return. the claims of each token. May be null
+ * @param _valid    return. the verdict of each token
+ *
+ * @return the quantity of valid tokens
+ */
+size_t token_verify_batch ( token_keyring *p_keyring, const unsigned char *const *pp_tokens, const size_t *_lens, size_t count, time_t now, token_claims *_claims, bool *_valid );
+
+/// destructors
+int token_keyring_destroy ( token_keyring **pp_keyring );
@@ -1,6 +1,11 @@
 /** !
  * User 
  * 
+ * Clients send the SHA-256 digest of a password. A user stores that digest
+ * stretched with PBKDF2-HMAC-SHA256 under its own salt and iteration count.
+ * Users with an iteration count of 0 store the digest itself, as users did
+ * before salting, and still verify
+ *
  * @file identity/user.h
  * 
  * @author Jacob Smith
@@ -11,12 +16,14 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 // gsdk
 #include <gsdk.h>
 
 /// core
 #include <core/log.h>
+#include <core/hash.h>
 #include <core/pack.h>
 #include <core/sha.h>
 
@@ -27,6 +34,14 @@
 /// reflection
 #include <reflection/json.h>
 
+// preprocessor definitions
+#define USER_NAME_MAX   64
+#define USER_GROUPS_MAX 256
+#define USER_ROLES_MAX  256
+
+#define USER_SALT_SIZE           16
+#define USER_PASSWORD_ITERATIONS 100000
+
 // structure declarations
 struct user_s;
 
@@ -35,6 +50,12 @@ typedef struct user_s user;
 
 // forward declarations
 /// constructors
+/** !
+ * Construct a user from a password. The password is salted, and stretched
+ * with USER_PASSWORD_ITERATIONS iterations
+ *
+ * @return 1 on success, 0 on error
+ */
 int user_construct
 (
     user **pp_user,
@@ -49,6 +70,79 @@ int user_construct
     size_t *p_roles , size_t roles_len 
 );
 
+/** !
+ * Construct a user from the digest of its password, instead of the password
+ *
+ * @param pp_user    return
+ * @param id         the id of the user
+ * @param p_name     the name of the user
+ * @param digest     the SHA-256 digest of the password
+ * @param org_id     the id of the user's organization
+ * @param p_groups   the ids of the user's groups
+ * @param groups_len the quantity of groups
+ * @param p_roles    the ids of the user's roles
+ * @param roles_len  the quantity of roles
+ *
+ * @return 1 on success, 0 on error
+ */
+int user_construct_digest
+(
+    user **pp_user,
+
+    size_t id,
+    const char *p_name,
+    const sha256_hash digest,
+
+    size_t org_id,
+
+    const size_t *p_groups, size_t groups_len,
+    const size_t *p_roles , size_t roles_len 
+);
+
+/** !
+ * Construct a user from a stretched password hash
+ *
+ * @param pp_user    return
+ * @param id         the id of the user
+ * @param p_name     the name of the user
+ * @param iterations the PBKDF2 iteration count, or 0 if hash is the digest of the password
+ * @param salt       the salt. May be null if iterations is 0
+ * @param hash       PBKDF2-HMAC-SHA256 of the password digest
+ * @param org_id     the id of the user's organization
+ * @param p_groups   the ids of the user's groups
+ * @param groups_len the quantity of groups
+ * @param p_roles    the ids of the user's roles
+ * @param roles_len  the quantity of roles
+ *
+ * @return 1 on success, 0 on error
+ */
+int user_construct_hash
+(
+    user **pp_user,
+
+    size_t id,
+    const char *p_name,
+    uint32_t iterations,
+    const unsigned char salt[USER_SALT_SIZE],
+    const sha256_hash hash,
+
+    size_t org_id,
+
+    const size_t *p_groups, size_t groups_len,
+    const size_t *p_roles , size_t roles_len 
+);
+
+/** !
+ * Construct a user from a json object, with the properties "id", "name",
+ * "pass", "org_id", "group_ids" and "role_ids". If "iterations" is present,
+ * "pass" is the stretched hash, and "salt" is its hex salt. Else "pass" is
+ * the hex digest of the password
+ *
+ * @param pp_user return
+ * @param p_value the json object
+ *
+ * @return 1 on success, 0 on error
+ */
 int user_from_json ( user **pp_user, json_value *p_value );
 
 /// print
@@ -56,13 +150,60 @@ int user_print ( user *p_user );
 
 void *user_key_accessor ( user *p_user );
 int user_comparator ( size_t id_a, size_t id_b );
-int user_password_comparator ( void *id_a, void *id_b );
-void *user_password_key_accessor ( user *p_user );
+void *user_name_key_accessor ( user *p_user );
+void *user_org_name_key_accessor ( user *p_user );
+
+/// hash
+hash64 user_name_hash ( const char *p_name, size_t name_len );
+hash64 user_org_name_hash ( size_t org_id, hash64 name_hash );
 
+/// accessors
 int user_name_get ( user *p_user, char *_name );
+bool user_name_equals ( const user *p_user, const char *p_name, size_t name_len );
+size_t user_org_id_get ( const user *p_user );
+int user_groups_get ( const user *p_user, const uint64_t **pp_groups, size_t *p_groups_len );
+int user_roles_get ( const user *p_user, const uint64_t **pp_roles, size_t *p_roles_len );
+
+/** !
+ * Get the cost of verifying a user's password
+ *
+ * @param p_user the user
+ *
+ * @return the PBKDF2 iteration count, or 0 if verifying is one compare
+ */
+uint32_t user_password_cost ( const user *p_user );
+
+/** !
+ * Check a password digest against a user's, in constant time. This stretches
+ * the digest first, so it takes as long as user_password_cost says
+ *
+ * @param p_user the user
+ * @param digest the SHA-256 digest of the password
+ *
+ * @return true if the password is the user's, else false
+ */
+bool user_password_verify ( const user *p_user, const sha256_hash digest );
 
 /// pack 
+/** !
+ * Pack a user into a buffer. Users are stored packed, so this is a copy
+ *
+ * @param p_buffer the buffer, or null to measure the user
+ * @param p_user   the user
+ *
+ * @return the size of the packed user in bytes, or 0 on error
+ */
 int user_pack ( void *p_buffer, const user *const p_user );
 
 /// unpack
-int user_unpack ( void *const p_value, void *p_buffer );
+/** !
+ * Bind a user to a packed record in place. Nothing is copied or allocated,
+ * so the buffer must outlive the user
+ *
+ * @param pp_user  return
+ * @param p_buffer the packed record, 8 byte aligned
+ * @param size     the bytes available at p_buffer
+ *
+ * @return the size of the packed user in bytes, or 0 if the record is malformed
+ */
+int user_unpack ( user **pp_user, void *p_buffer, size_t size );
@@ -0,0 +1,235 @@
+/** !
+ * Write ahead log
+ *
+ * An append only log of every org, role, group and user added at run time,
+ * and every org unloaded. The log starts with a header
+ *
+ *   magic     WAL_MAGIC, padded to 8 bytes
+ *   version   u32, WAL_VERSION
+ *   endian    u32, WAL_ENDIAN as the writer stored it
+ *
+ * then holds records, each a header followed by the packed value
+ *
+ *   sequence  u64, one more than the record before it
+ *   checksum  u64, over the header and the value
+ *   type      u32, see enum wal_record_e
+ *   size      u32, bytes in the value
+ *   value     the *_pack of the value, a multiple of 8 bytes
+ *
+ * Writers append under a lock, then wait in wal_commit. The first waiter
+ * writes and syncs everything appended so far, while the rest wait for it,
+ * so one fsync covers every concurrent writer. Once a batch is on disk, the
+ * writer hands it to the function set with wal_durable_set, batch by batch in
+ * sequence order, so records leave the process only once they are durable.
+ * Replay stops at the first torn
+ * or corrupt record, and cuts the log there. Like a snapshot, the log is
+ * native endian and tied to the record layouts, so a log from another version
+ * or another byte order is refused rather than read
+ *
+ * The same records travel from a primary to its replicas, so the record
+ * functions are public
+ *
+ * @file identity/wal.h
+ *
+ * @author Jacob Smith
+ */
+
+// standard library
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// gsdk
+#include <gsdk.h>
+
+/// core
+#include <core/log.h>
+#include <core/hash.h>
+#include <core/sync.h>
+
+// identity
+#include <identity/org.h>
+#include <identity/role.h>
+#include <identity/group.h>
+#include <identity/user.h>
+
+// preprocessor definitions
+#define WAL_MAGIC       "IDWAL"
+#define WAL_VERSION     1
+#define WAL_ENDIAN      0x01020304
+#define WAL_BUFFER_SIZE 65536
+#define WAL_HEADER_SIZE 24
+
+// enumeration definitions
+enum wal_record_e
+{
+    WAL_RECORD_ORG   = 1,
+    WAL_RECORD_ROLE  = 2,
+    WAL_RECORD_GROUP = 3,
+    WAL_RECORD_USER  = 4,
+    WAL_RECORD_ORG_UNLOAD = 5, // the value is the uint64_t id of the org
+    WAL_RECORD_QUANTITY
+};
+
+// structure declarations
+struct wal_s;
+
+// type definitions
+typedef struct wal_s wal;
+
+/** !
+ * Apply one replayed record
+ *
+ * @param p_context the context passed to wal_replay
+ * @param type      the type of the value
+ * @param p_value   the value, in its own allocation, owned by the callee
+ *
+ * @return 1 on success, 0 on error
+ */
+typedef int (fn_wal_replay) ( void *p_context, enum wal_record_e type, void *p_value );
+
+/** !
+ * Take a batch of records that just reached the disk
+ *
+ * @param p_context the context passed to wal_durable_set
+ * @param p_records the packed records, in sequence order
+ * @param len       the length of the records, in bytes
+ *
+ * @return 1 on success, 0 on error
+ */
+typedef int (fn_wal_durable) ( void *p_context, const void *p_records, size_t len );
+
+// forward declarations
+/// replay
+/** !
+ * Replay every record after a sequence, then cut off any torn tail. A
+ * missing log is an empty log. A log with the wrong magic, version or byte
+ * order is an error, and is left as it is
+ *
+ * @param p_path          the log file
+ * @param after           records up to and including this sequence are skipped
+ * @param pfn_replay      called once per record, in order
+ * @param p_context       passed to pfn_replay
+ * @param p_last_sequence return. the last sequence in the log, or after if it is greater
+ *
+ * @return 1 on success, 0 on error
+ */
+int wal_replay ( const char *p_path, uint64_t after, fn_wal_replay *pfn_replay, void *p_context, uint64_t *p_last_sequence );
+
+/// records
+/** !
+ * Pack a record
+ *
+ * @param p_buffer the buffer, or null to measure the record
+ * @param type     the type of the value
+ * @param p_value  the value
+ * @param sequence the sequence of the record
+ *
+ * @return the size of the record in bytes, or 0 on error
+ */
+size_t wal_record_pack ( void *p_buffer, enum wal_record_e type, const void *p_value, uint64_t sequence );
+
+/** !
+ * Get the size of a record from its header
+ *
+ * @param p_header the first WAL_HEADER_SIZE bytes of the record
+ *
+ * @return the size of the record in bytes, or 0 if the header is malformed
+ */
+size_t wal_record_size ( const void *p_header );
+
+/** !
+ * Get the sequence of a record from its header
+ *
+ * @param p_header the first WAL_HEADER_SIZE bytes of the record
+ *
+ * @return the sequence of the record
+ */
+uint64_t wal_record_sequence ( const void *p_header );
+
+/** !
+ * Check a record, and unpack its value into its own allocation
+ *
+ * @param p_record   the record
+ * @param len        the bytes available at p_record
+ * @param p_sequence return. the sequence of the record
+ * @param p_type     return. the type of the value
+ * @param pp_value   return. the value, owned by the caller
+ *
+ * @return the size of the record in bytes, or 0 if the record is torn or corrupt
+ */
+size_t wal_record_unpack ( const void *p_record, size_t len, uint64_t *p_sequence, enum wal_record_e *p_type, void **pp_value );
+
+/// constructors
+/** !
+ * Open a log for appending
+ *
+ * @param pp_wal   return
+ * @param p_path   the log file, created if missing
+ * @param sequence the last sequence already applied. new records follow it
+ *
+ * @return 1 on success, 0 on error
+ */
+int wal_construct ( wal **pp_wal, const char *p_path, uint64_t sequence );
+
+/// accessors
+/** !
+ * Get the sequence of the last appended record
+ *
+ * @param p_wal the log
+ *
+ * @return the sequence
+ */
+uint64_t wal_sequence ( wal *p_wal );
+
+/// mutators
+/** !
+ * Append a record. The record is buffered, and durable once wal_commit
+ * returns for its sequence
+ *
+ * @param p_wal      the log
+ * @param type       the type of the value
+ * @param p_value    the value
+ * @param p_sequence return. the sequence of the record
+ *
+ * @return 1 on success, 0 on error
+ */
+int wal_append ( wal *p_wal, enum wal_record_e type, const void *p_value, uint64_t *p_sequence );
+
+/** !
+ * Wait until a record, and every record before it, is on disk
+ *
+ * @param p_wal    the log
+ * @param sequence the sequence of the record
+ *
+ * @return 1 on success, 0 if the log could not be written
+ */
+int wal_commit ( wal *p_wal, uint64_t sequence );
+
+/** !
+ * Set the function that takes each batch once it is durable. It runs on the
+ * committing thread, before any waiter on the batch returns, and before the
+ * next batch is written
+ *
+ * @param p_wal       the log
+ * @param pfn_durable the function, or null for none
+ * @param p_context   passed to pfn_durable
+ *
+ * @return void
+ */
+void wal_durable_set ( wal *p_wal, fn_wal_durable *pfn_durable, void *p_context );
+
+/** !
+ * Empty the log, but for its header, if a snapshot holds every record in it
+ *
+ * @param p_wal    the log
+ * @param sequence the sequence the snapshot holds
+ *
+ * @return 1 if the log was emptied, else 0
+ */
+int wal_checkpoint ( wal *p_wal, uint64_t sequence );
+
+/// destructors
+int wal_destroy ( wal **pp_wal );
@@ -0,0 +1,122 @@
+/** !
+ * Arena
+ *
+ * @file src/arena.c
+ *
+ * @author Jacob Smith
+ */
+
+// header
+#include <identity/arena.h>
+
+// structure definitions
+struct arena_s
+{
+    size_t        size;
+    size_t        offset;
+    unsigned char _data[];
+};
+
+int arena_construct ( arena **pp_arena, size_t size )
+{
+
+    // argument check
+    if ( NULL == pp_arena ) goto no_arena;
+    if ( 0    ==     size ) goto no_size;
+
+    // initialized data
+    arena *p_arena = default_allocator(0, sizeof(arena) + size);
+
+    // error check
+    if ( NULL == p_arena ) goto no_mem;
+
+    // populate the arena
+    p_arena->size   = size,
+    p_arena->offset = 0;
+
+    // return a pointer to the caller
+    *pp_arena = p_arena;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_arena:
+                #ifndef NDEBUG
+                    log_error("[identity] [arena] Null pointer provided for parameter \"pp_arena\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_size:
+                #ifndef NDEBUG
+                    log_error("[identity] [arena] Parameter \"size\" must be greater than zero in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // standard library errors
+        {
+            no_mem:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+void *arena_alloc ( arena *p_arena, size_t size )
+{
+
+    // argument check
+    if ( NULL == p_arena ) return NULL;
+
+    // initialized data
+    size_t offset = ( p_arena->offset + ( ARENA_ALIGNMENT - 1 ) ) & ~(size_t)( ARENA_ALIGNMENT - 1 );
+
+    // the arena is exhausted. Callers treat this like any other
+    // allocation failure, and the arena recovers at the next reset
+    if ( offset > p_arena->size || size > p_arena->size - offset ) return NULL;
+
+    // bump
+    p_arena->offset = offset + size;
+
+    // success
+    return &p_arena->_data[offset];
+}
+
+int arena_reset ( arena *p_arena )
+{
+
+    // argument check
+    if ( NULL == p_arena ) return 0;
+
+    // release everything at once
+    p_arena->offset = 0;
+
+    // success
+    return 1;
+}
+
+int arena_destroy ( arena **pp_arena )
+{
+
+    // argument check
+    if ( NULL == pp_arena ) return 0;
+
+    // release the arena
+    *pp_arena = default_allocator(*pp_arena, 0);
+
+    // success
+    return 1;
+}
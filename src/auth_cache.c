@@ -0,0 +1,461 @@
+/** !
+ * Authentication cache
+ *
+ * @file src/auth_cache.c
+ *
+ * @author Jacob Smith
+ */
+
+// header
+#include <identity/auth_cache.h>
+
+// identity
+#include <identity/hmac.h>
+
+// structure definitions
+struct auth_cache_entry_s
+{
+    uint64_t    hash;                 // of the name and the digest, 0 when empty
+    timestamp   expires;
+    user       *p_user;               // null for a denial
+    uint32_t    name_len;
+    char        _name[USER_NAME_MAX];
+    sha256_hash _digest;
+};
+
+struct auth_cache_shard_s
+{
+    mutex                      _lock;
+    uint64_t                   generation; // invalidations so far
+    size_t                     hits;
+    size_t                     misses;
+    struct auth_cache_entry_s *_entries;   // sets of AUTH_CACHE_WAYS entries
+};
+
+struct auth_cache_s
+{
+    size_t                    sets_mask;    // sets per shard - 1. The quantity of sets is a power of two
+    timestamp                 ttl;          // in timer ticks
+    timestamp                 negative_ttl; // in timer ticks
+    struct auth_cache_shard_s _shards[AUTH_CACHE_SHARDS];
+};
+
+// function declarations
+struct auth_cache_entry_s *auth_cache_set ( auth_cache *p_auth_cache, const char *p_name, size_t name_len, struct auth_cache_shard_s **pp_shard );
+uint64_t auth_cache_key ( const char *p_name, size_t name_len, const sha256_hash digest );
+bool auth_cache_entry_match ( const struct auth_cache_entry_s *p_entry, uint64_t key, const char *p_name, size_t name_len, const sha256_hash digest );
+
+struct auth_cache_entry_s *auth_cache_set ( auth_cache *p_auth_cache, const char *p_name, size_t name_len, struct auth_cache_shard_s **pp_shard )
+{
+
+    // initialized data
+    uint64_t                   hash    = hash_fnv64(p_name, name_len);
+    struct auth_cache_shard_s *p_shard = &p_auth_cache->_shards[hash & ( AUTH_CACHE_SHARDS - 1 )];
+
+    // return the shard to the caller
+    *pp_shard = p_shard;
+
+    // the low bits pick the shard, and the next bits pick the set
+    return &p_shard->_entries[( ( hash / AUTH_CACHE_SHARDS ) & p_auth_cache->sets_mask ) * AUTH_CACHE_WAYS];
+}
+
+uint64_t auth_cache_key ( const char *p_name, size_t name_len, const sha256_hash digest )
+{
+
+    // done. never 0, which marks an empty entry
+    return ( hash_fnv64(p_name, name_len) ^ hash_fnv64(digest, sizeof(sha256_hash)) ) | 1;
+}
+
+bool auth_cache_entry_match ( const struct auth_cache_entry_s *p_entry, uint64_t key, const char *p_name, size_t name_len, const sha256_hash digest )
+{
+
+    // done. the digest is compared in constant time
+    return key                == p_entry->hash
+        && name_len           == p_entry->name_len
+        && 0 == memcmp(p_entry->_name, p_name, name_len)
+        && hmac_equals(p_entry->_digest, digest);
+}
+
+int auth_cache_construct ( auth_cache **pp_auth_cache, size_t entries, size_t ttl_ms, size_t negative_ttl_ms )
+{
+
+    // argument check
+    if ( NULL == pp_auth_cache ) goto no_auth_cache;
+    if ( 0    ==       entries ) goto no_entries;
+
+    // initialized data
+    auth_cache *p_auth_cache = default_allocator(NULL, sizeof(auth_cache));
+    size_t      sets         = 1;
+    size_t      constructed  = 0;
+
+    // error check
+    if ( NULL == p_auth_cache ) goto no_mem;
+
+    // start empty
+    memset(p_auth_cache, 0, sizeof(auth_cache));
+
+    // enough sets for every entry
+    while ( sets * AUTH_CACHE_SHARDS * AUTH_CACHE_WAYS < entries ) sets <<= 1;
+
+    // populate the auth cache struct
+    p_auth_cache->sets_mask    = sets - 1,
+    p_auth_cache->ttl          = (timestamp) ttl_ms          * timer_seconds_divisor() / 1000,
+    p_auth_cache->negative_ttl = (timestamp) negative_ttl_ms * timer_seconds_divisor() / 1000;
+
+    // construct each shard
+    for (; constructed < AUTH_CACHE_SHARDS; constructed++)
+    {
+
+        // initialized data
+        struct auth_cache_shard_s *p_shard = &p_auth_cache->_shards[constructed];
+
+        // allocate the entries
+        p_shard->_entries = default_allocator(NULL, sets * AUTH_CACHE_WAYS * sizeof(struct auth_cache_entry_s));
+
+        // error check
+        if ( NULL == p_shard->_entries ) goto no_mem_1;
+
+        // every entry starts empty
+        memset(p_shard->_entries, 0, sets * AUTH_CACHE_WAYS * sizeof(struct auth_cache_entry_s));
+
+        // construct the lock
+        if ( 0 == mutex_create(&p_shard->_lock) ) goto failed_to_construct_mutex;
+    }
+
+    // return a pointer to the caller
+    *pp_auth_cache = p_auth_cache;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_auth_cache:
+                #ifndef NDEBUG
+                    log_error("[identity] [auth cache] Null pointer provided for parameter \"pp_auth_cache\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_entries:
+                #ifndef NDEBUG
+                    log_error("[identity] [auth cache] Parameter \"entries\" must be greater than zero in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // sync errors
+        {
+            failed_to_construct_mutex:
+                #ifndef NDEBUG
+                    log_error("[identity] [auth cache] Failed to construct mutex in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // clean up
+                p_auth_cache->_shards[constructed]._entries = default_allocator(p_auth_cache->_shards[constructed]._entries, 0);
+                while ( constructed-- )
+                    mutex_destroy(&p_auth_cache->_shards[constructed]._lock),
+                    p_auth_cache->_shards[constructed]._entries = default_allocator(p_auth_cache->_shards[constructed]._entries, 0);
+                p_auth_cache = default_allocator(p_auth_cache, 0);
+
+                // error
+                return 0;
+        }
+
+        // standard library errors
+        {
+            no_mem_1:
+
+                // clean up
+                while ( constructed-- )
+                    mutex_destroy(&p_auth_cache->_shards[constructed]._lock),
+                    p_auth_cache->_shards[constructed]._entries = default_allocator(p_auth_cache->_shards[constructed]._entries, 0);
+                p_auth_cache = default_allocator(p_auth_cache, 0);
+
+                // fall through
+                goto no_mem;
+
+            no_mem:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+enum auth_cache_verdict_e auth_cache_lookup ( auth_cache *p_auth_cache, const char *p_name, size_t name_len, const sha256_hash digest, user **pp_user, uint64_t *p_generation )
+{
+
+    // initialized data
+    struct auth_cache_shard_s *p_shard = NULL;
+    struct auth_cache_entry_s *_set    = NULL;
+    enum auth_cache_verdict_e  verdict = AUTH_CACHE_MISS;
+    uint64_t                   key     = 0;
+    timestamp                  now     = 0;
+
+    // names that do not fit are never cached
+    if ( USER_NAME_MAX < name_len ) return ( *p_generation = UINT64_MAX, AUTH_CACHE_MISS );
+
+    // find the set
+    _set = auth_cache_set(p_auth_cache, p_name, name_len, &p_shard),
+    key  = auth_cache_key(p_name, name_len, digest),
+    now  = timer_high_precision();
+
+    // lock
+    mutex_lock(&p_shard->_lock);
+
+    // store the generation
+    *p_generation = p_shard->generation;
+
+    // search the set
+    for (size_t i = 0; i < AUTH_CACHE_WAYS; i++)
+    {
+
+        // initialized data
+        struct auth_cache_entry_s *p_entry = &_set[i];
+
+        // skip other credentials
+        if ( false == auth_cache_entry_match(p_entry, key, p_name, name_len, digest) ) continue;
+
+        // drop an expired verdict
+        if ( p_entry->expires <= now ) { p_entry->hash = 0; break; }
+
+        // the verdict
+        verdict = ( p_entry->p_user ) ? AUTH_CACHE_ALLOW : AUTH_CACHE_DENY;
+        if ( pp_user ) *pp_user = p_entry->p_user;
+        break;
+    }
+
+    // count
+    if ( AUTH_CACHE_MISS == verdict ) p_shard->misses++;
+    else                              p_shard->hits++;
+
+    // unlock
+    mutex_unlock(&p_shard->_lock);
+
+    // done
+    return verdict;
+}
+
+int auth_cache_stats ( auth_cache *p_auth_cache, size_t *p_hits, size_t *p_misses )
+{
+
+    // argument check
+    if ( NULL == p_auth_cache ) goto no_auth_cache;
+
+    // initialized data
+    size_t hits   = 0,
+           misses = 0;
+
+    // sum every shard
+    for (size_t i = 0; i < AUTH_CACHE_SHARDS; i++)
+    {
+        mutex_lock(&p_auth_cache->_shards[i]._lock);
+        hits   += p_auth_cache->_shards[i].hits,
+        misses += p_auth_cache->_shards[i].misses;
+        mutex_unlock(&p_auth_cache->_shards[i]._lock);
+    }
+
+    // return the counts to the caller
+    if ( p_hits   ) *p_hits   = hits;
+    if ( p_misses ) *p_misses = misses;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_auth_cache:
+                #ifndef NDEBUG
+                    log_error("[identity] [auth cache] Null pointer provided for parameter \"p_auth_cache\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int auth_cache_insert ( auth_cache *p_auth_cache, const char *p_name, size_t name_len, const sha256_hash digest, user *p_user, uint64_t generation )
+{
+
+    // initialized data
+    struct auth_cache_shard_s *p_shard  = NULL;
+    struct auth_cache_entry_s *_set     = NULL,
+                              *p_victim = NULL;
+    uint64_t                   key      = 0;
+    timestamp                  now      = 0,
+                               ttl      = ( p_user ) ? p_auth_cache->ttl : p_auth_cache->negative_ttl;
+
+    // fast exit
+    if ( USER_NAME_MAX < name_len || 0 >= ttl ) return 0;
+
+    // find the set
+    _set = auth_cache_set(p_auth_cache, p_name, name_len, &p_shard),
+    key  = auth_cache_key(p_name, name_len, digest),
+    now  = timer_high_precision();
+
+    // lock
+    mutex_lock(&p_shard->_lock);
+
+    // the user changed since the lookup, so the verdict may be stale
+    if ( generation != p_shard->generation ) goto stale;
+
+    // pick an entry. the same credential, else an empty or expired entry, else the one closest to expiring
+    for (size_t i = 0; i < AUTH_CACHE_WAYS; i++)
+    {
+
+        // initialized data
+        struct auth_cache_entry_s *p_entry = &_set[i];
+
+        // the same credential
+        if ( auth_cache_entry_match(p_entry, key, p_name, name_len, digest) ) { p_victim = p_entry; break; }
+
+        // an empty or expired entry
+        if ( 0 == p_entry->hash || p_entry->expires <= now ) { if ( NULL == p_victim || p_victim->hash ) p_victim = p_entry; continue; }
+
+        // the entry closest to expiring
+        if ( NULL == p_victim || ( p_victim->hash && p_entry->expires < p_victim->expires ) ) p_victim = p_entry;
+    }
+
+    // store the verdict
+    p_victim->hash     = key,
+    p_victim->expires  = now + ttl,
+    p_victim->p_user   = p_user,
+    p_victim->name_len = (uint32_t) name_len;
+    memcpy(p_victim->_name  , p_name, name_len);
+    memcpy(p_victim->_digest, digest, sizeof(sha256_hash));
+
+    // unlock
+    mutex_unlock(&p_shard->_lock);
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // cache errors
+        {
+            stale:
+
+                // unlock
+                mutex_unlock(&p_shard->_lock);
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int auth_cache_invalidate ( auth_cache *p_auth_cache, const char *p_name, size_t name_len )
+{
+
+    // argument check
+    if ( NULL == p_auth_cache ) goto no_auth_cache;
+    if ( NULL ==       p_name ) goto no_name;
+
+    // initialized data
+    struct auth_cache_shard_s *p_shard = NULL;
+    struct auth_cache_entry_s *_set    = NULL;
+
+    // fast exit
+    if ( USER_NAME_MAX < name_len ) return 1;
+
+    // find the set
+    _set = auth_cache_set(p_auth_cache, p_name, name_len, &p_shard);
+
+    // lock
+    mutex_lock(&p_shard->_lock);
+
+    // verdicts computed before now are stale
+    p_shard->generation++;
+
+    // drop every verdict for the name
+    for (size_t i = 0; i < AUTH_CACHE_WAYS; i++)
+        if ( _set[i].hash && name_len == _set[i].name_len && 0 == memcmp(_set[i]._name, p_name, name_len) )
+            _set[i].hash = 0;
+
+    // unlock
+    mutex_unlock(&p_shard->_lock);
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_auth_cache:
+                #ifndef NDEBUG
+                    log_error("[identity] [auth cache] Null pointer provided for parameter \"p_auth_cache\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_name:
+                #ifndef NDEBUG
+                    log_error("[identity] [auth cache] Null pointer provided for parameter \"p_name\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int auth_cache_destroy ( auth_cache **pp_auth_cache )
+{
+
+    // argument check
+    if ( NULL == pp_auth_cache ) goto no_auth_cache;
+
+    // initialized data
+    auth_cache *p_auth_cache = *pp_auth_cache;
+
+    // no more pointer for caller
+    *pp_auth_cache = NULL;
+
+    // fast exit
+    if ( NULL == p_auth_cache ) return 1;
+
+    // release each shard
+    for (size_t i = 0; i < AUTH_CACHE_SHARDS; i++)
+        mutex_destroy(&p_auth_cache->_shards[i]._lock),
+        p_auth_cache->_shards[i]._entries = default_allocator(p_auth_cache->_shards[i]._entries, 0);
+
+    // release the cache
+    p_auth_cache = default_allocator(p_auth_cache, 0);
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_auth_cache:
+                #ifndef NDEBUG
+                    log_error("[identity] [auth cache] Null pointer provided for parameter \"pp_auth_cache\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
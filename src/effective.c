@@ -0,0 +1,834 @@
+/** !
+ * Effective permissions
+ *
+ * @file src/effective.c
+ *
+ * @author Jacob Smith
+ */
+
+// header
+#include <identity/effective.h>
+
+// structure definitions
+struct effective_entry_s
+{
+    uint64_t                  user_id;
+    uint64_t                  epoch;   // the epoch the entry was unlinked in
+    struct effective_entry_s *p_next;  // while the entry is retired or free
+    uint64_t                  _set[];
+};
+
+struct effective_members_s
+{
+    uint64_t  group_id;
+    size_t    len;
+    size_t    max;
+    uint64_t *_user_ids;
+};
+
+// The sets of one compiled matcher. Readers find the state, then a set in
+// it, and never see a set from one matcher with the ids of another. A set is
+// never changed in place. A new entry replaces it, and the old entry is only
+// reused once every reader that could see it has left
+struct effective_state_s
+{
+    const permission_matcher  *p_permissions; // the matcher the sets were computed with
+    hash_index                *p_entries;     // user id -> entry
+    hash_index                *p_members;     // group id -> members. Only writers read this
+    size_t                     words;         // 64 bit words in a set
+    size_t                     stride;        // bytes in an entry
+    unsigned char            **pp_chunks;
+    size_t                     chunks_len;
+    size_t                     chunk_used;    // entries taken from the last chunk
+    struct effective_entry_s  *p_free;        // entries no reader can see
+    struct effective_entry_s  *p_retired,     // entries readers may still see, oldest first
+                              *p_retired_tail;
+};
+
+struct effective_s
+{
+    hash_index                          *p_users;  // borrowed
+    hash_index                          *p_groups; // borrowed
+    _Atomic(struct effective_state_s *)  p_state;
+};
+
+// function declarations
+void *effective_entry_key ( struct effective_entry_s *p_entry );
+void *effective_members_key ( struct effective_members_s *p_members );
+struct effective_entry_s *effective_entry_alloc ( struct effective_state_s *p_state );
+void effective_entry_retire ( struct effective_state_s *p_state, struct effective_entry_s *p_entry );
+int effective_members_add ( struct effective_state_s *p_state, size_t group_id, size_t user_id );
+void effective_members_remove ( struct effective_state_s *p_state, size_t group_id, size_t user_id );
+void effective_role_add ( const permission_matcher *p_permissions, size_t role_id, uint64_t *_set );
+void effective_compute ( effective *p_effective, struct effective_state_s *p_state, const user *p_user, uint64_t *_set );
+int effective_state_construct ( struct effective_state_s **pp_state, const permission_matcher *p_permissions, size_t quantity );
+void effective_state_destroy ( struct effective_state_s *p_state );
+int effective_state_user_update ( effective *p_effective, struct effective_state_s *p_state, const user *p_user );
+void effective_state_user_remove ( struct effective_state_s *p_state, const user *p_user );
+
+void *effective_entry_key ( struct effective_entry_s *p_entry )
+{
+
+    // done
+    return (void *)(size_t) p_entry->user_id;
+}
+
+void *effective_members_key ( struct effective_members_s *p_members )
+{
+
+    // done
+    return (void *)(size_t) p_members->group_id;
+}
+
+struct effective_entry_s *effective_entry_alloc ( struct effective_state_s *p_state )
+{
+
+    // initialized data
+    struct effective_entry_s *p_entry = p_state->p_free;
+
+    // reuse a free entry
+    if ( p_entry ) return ( p_state->p_free = p_entry->p_next, p_entry );
+
+    // reuse the oldest retired entry, once no reader can see it
+    if ( p_state->p_retired && epoch_passed(p_state->p_retired->epoch) )
+    {
+        p_entry            = p_state->p_retired,
+        p_state->p_retired = p_entry->p_next;
+        if ( NULL == p_state->p_retired ) p_state->p_retired_tail = NULL;
+
+        // done
+        return p_entry;
+    }
+
+    // start a new chunk
+    if ( 0 == p_state->chunks_len || EFFECTIVE_CHUNK_QUANTITY == p_state->chunk_used )
+    {
+
+        // initialized data
+        unsigned char **pp_chunks = default_allocator(p_state->pp_chunks, ( p_state->chunks_len + 1 ) * sizeof(unsigned char *)),
+                       *p_chunk   = NULL;
+
+        // error check
+        if ( NULL == pp_chunks ) return NULL;
+
+        // store the chunks
+        p_state->pp_chunks = pp_chunks;
+
+        // allocate a chunk
+        p_chunk = default_allocator(NULL, EFFECTIVE_CHUNK_QUANTITY * p_state->stride);
+
+        // error check
+        if ( NULL == p_chunk ) return NULL;
+
+        // store the chunk
+        p_state->pp_chunks[p_state->chunks_len++] = p_chunk,
+        p_state->chunk_used                       = 0;
+    }
+
+    // done
+    return (struct effective_entry_s *) ( p_state->pp_chunks[p_state->chunks_len - 1] + p_state->chunk_used++ * p_state->stride );
+}
+
+void effective_entry_retire ( struct effective_state_s *p_state, struct effective_entry_s *p_entry )
+{
+
+    // stamp the entry with the epoch it was unlinked in
+    p_entry->epoch  = epoch_advance(),
+    p_entry->p_next = NULL;
+
+    // append
+    if ( p_state->p_retired_tail ) p_state->p_retired_tail->p_next = p_entry;
+    else                           p_state->p_retired              = p_entry;
+    p_state->p_retired_tail = p_entry;
+}
+
+int effective_members_add ( struct effective_state_s *p_state, size_t group_id, size_t user_id )
+{
+
+    // initialized data
+    struct effective_members_s *p_members = NULL;
+
+    // find the members of the group
+    if ( 0 == hash_index_search(p_state->p_members, group_id, (void **) &p_members) )
+    {
+
+        // allocate the members
+        p_members = default_allocator(NULL, sizeof(struct effective_members_s));
+
+        // error check
+        if ( NULL == p_members ) return 0;
+
+        // populate the members
+        *p_members = (struct effective_members_s) { .group_id = group_id };
+
+        // index the members
+        if ( 0 == hash_index_insert(p_state->p_members, p_members) ) return ( default_allocator(p_members, 0), 0 );
+    }
+
+    // grow
+    if ( p_members->len == p_members->max )
+    {
+
+        // initialized data
+        size_t    max        = p_members->max ? p_members->max * 2 : 8;
+        uint64_t *_user_ids  = default_allocator(p_members->_user_ids, max * sizeof(uint64_t));
+
+        // error check
+        if ( NULL == _user_ids ) return 0;
+
+        // store the members
+        p_members->_user_ids = _user_ids,
+        p_members->max       = max;
+    }
+
+    // add the user
+    p_members->_user_ids[p_members->len++] = user_id;
+
+    // success
+    return 1;
+}
+
+void effective_members_remove ( struct effective_state_s *p_state, size_t group_id, size_t user_id )
+{
+
+    // initialized data
+    struct effective_members_s *p_members = NULL;
+
+    // find the members of the group
+    if ( 0 == hash_index_search(p_state->p_members, group_id, (void **) &p_members) ) return;
+
+    // swap the user out
+    for (size_t i = 0; i < p_members->len; i++)
+        if ( user_id == p_members->_user_ids[i] )
+        {
+            p_members->_user_ids[i] = p_members->_user_ids[--p_members->len];
+            return;
+        }
+}
+
+void effective_role_add ( const permission_matcher *p_permissions, size_t role_id, uint64_t *_set )
+{
+
+    // initialized data
+    const uint32_t *_ids    = NULL;
+    size_t          ids_len = 0;
+
+    // unknown roles grant nothing
+    if ( 0 == permission_matcher_role_get(p_permissions, role_id, &_ids, &ids_len) ) return;
+
+    // set a bit for each permission
+    for (size_t i = 0; i < ids_len; i++)
+        _set[_ids[i] >> 6] |= 1ULL << ( _ids[i] & 63 );
+}
+
+void effective_compute ( effective *p_effective, struct effective_state_s *p_state, const user *p_user, uint64_t *_set )
+{
+
+    // initialized data
+    const uint64_t *_roles     = NULL,
+                   *_groups    = NULL;
+    size_t          roles_len  = 0,
+                    groups_len = 0;
+
+    // initialized data
+    const permission_matcher *p_permissions = p_state->p_permissions;
+
+    // start empty
+    memset(_set, 0, p_state->words * sizeof(uint64_t));
+
+    // the user's own roles
+    (void) user_roles_get(p_user, &_roles, &roles_len);
+    for (size_t i = 0; i < roles_len; i++)
+        effective_role_add(p_permissions, (size_t) _roles[i], _set);
+
+    // the roles of the user's groups
+    (void) user_groups_get(p_user, &_groups, &groups_len);
+    for (size_t i = 0; i < groups_len; i++)
+    {
+
+        // initialized data
+        group *p_group = NULL;
+
+        // groups that are not added yet grant nothing, until they are
+        if ( 0 == hash_index_search(p_effective->p_groups, (size_t) _groups[i], (void **) &p_group) ) continue;
+
+        // the group's roles
+        (void) group_roles_get(p_group, &_roles, &roles_len);
+        for (size_t j = 0; j < roles_len; j++)
+            effective_role_add(p_permissions, (size_t) _roles[j], _set);
+    }
+}
+
+int effective_state_construct ( struct effective_state_s **pp_state, const permission_matcher *p_permissions, size_t quantity )
+{
+
+    // initialized data
+    size_t                    words   = ( p_permissions ) ? ( permission_matcher_size(p_permissions) + 63 ) / 64 : 0;
+    struct effective_state_s *p_state = default_allocator(NULL, sizeof(struct effective_state_s));
+
+    // error check
+    if ( NULL == p_state ) return 0;
+
+    // populate the state
+    *p_state = (struct effective_state_s)
+    {
+        .p_permissions = p_permissions,
+        .words         = words,
+        .stride        = sizeof(struct effective_entry_s) + words * sizeof(uint64_t)
+    };
+
+    // construct the indices, with room for every user
+    if ( 0 == hash_index_construct(&p_state->p_entries, (fn_key_accessor *) effective_entry_key  , NULL, quantity               ) ) goto failed;
+    if ( 0 == hash_index_construct(&p_state->p_members, (fn_key_accessor *) effective_members_key, NULL, HASH_INDEX_CAPACITY_MIN) ) goto failed;
+
+    // return a pointer to the caller
+    *pp_state = p_state;
+
+    // success
+    return 1;
+
+    // clean up
+    failed:
+        effective_state_destroy(p_state);
+
+        // error
+        return 0;
+}
+
+void effective_state_destroy ( struct effective_state_s *p_state )
+{
+
+    // release the member lists
+    if ( p_state->p_members )
+    {
+
+        // initialized data
+        size_t                       members_len = hash_index_size(p_state->p_members);
+        struct effective_members_s **pp_members  = default_allocator(NULL, ( members_len + 1 ) * sizeof(struct effective_members_s *));
+
+        // release each list
+        if ( pp_members )
+        {
+            members_len = hash_index_values(p_state->p_members, (void **) pp_members);
+            for (size_t i = 0; i < members_len; i++)
+                pp_members[i]->_user_ids = default_allocator(pp_members[i]->_user_ids, 0),
+                pp_members[i]            = default_allocator(pp_members[i], 0);
+            pp_members = default_allocator(pp_members, 0);
+        }
+    }
+
+    // release the chunks
+    for (size_t i = 0; i < p_state->chunks_len; i++)
+        p_state->pp_chunks[i] = default_allocator(p_state->pp_chunks[i], 0);
+
+    // release the indices
+    if ( p_state->p_entries ) (void) hash_index_destroy(&p_state->p_entries);
+    if ( p_state->p_members ) (void) hash_index_destroy(&p_state->p_members);
+    p_state->pp_chunks = default_allocator(p_state->pp_chunks, 0);
+
+    // release the state
+    p_state = default_allocator(p_state, 0);
+}
+
+int effective_construct ( effective **pp_effective, hash_index *p_users, hash_index *p_groups )
+{
+
+    // argument check
+    if ( NULL == pp_effective ) goto no_effective;
+    if ( NULL ==      p_users ) goto no_users;
+    if ( NULL ==     p_groups ) goto no_groups;
+
+    // initialized data
+    effective *p_effective = default_allocator(NULL, sizeof(effective));
+
+    // error check
+    if ( NULL == p_effective ) goto no_mem;
+
+    // initialized data
+    struct effective_state_s *p_state = NULL;
+
+    // populate the effective struct
+    *p_effective = (effective)
+    {
+        .p_users  = p_users,
+        .p_groups = p_groups,
+        .p_state  = NULL
+    };
+
+    // start with no matcher, and no sets
+    if ( 0 == effective_state_construct(&p_state, NULL, HASH_INDEX_CAPACITY_MIN) ) goto failed_to_construct_index;
+    atomic_init(&p_effective->p_state, p_state);
+
+    // return a pointer to the caller
+    *pp_effective = p_effective;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_effective:
+                #ifndef NDEBUG
+                    log_error("[identity] [effective] Null pointer provided for parameter \"pp_effective\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_users:
+                #ifndef NDEBUG
+                    log_error("[identity] [effective] Null pointer provided for parameter \"p_users\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_groups:
+                #ifndef NDEBUG
+                    log_error("[identity] [effective] Null pointer provided for parameter \"p_groups\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // data errors
+        {
+            failed_to_construct_index:
+                #ifndef NDEBUG
+                    log_error("[identity] [effective] Failed to construct index in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // clean up
+                p_effective = default_allocator(p_effective, 0);
+
+                // error
+                return 0;
+        }
+
+        // standard library errors
+        {
+            no_mem:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int effective_get ( effective *p_effective, size_t user_id, const permission_matcher **pp_permissions, const uint64_t **pp_set )
+{
+
+    // initialized data
+    struct effective_state_s *p_state = atomic_load_explicit(&p_effective->p_state, memory_order_acquire);
+    struct effective_entry_s *p_entry = NULL;
+
+    // no permissions are compiled
+    if ( NULL == p_state->p_permissions ) return 0;
+
+    // find the user's entry
+    if ( 0 == hash_index_search(p_state->p_entries, user_id, (void **) &p_entry) ) return 0;
+
+    // return the matcher and the set to the caller
+    *pp_permissions = p_state->p_permissions,
+    *pp_set         = p_entry->_set;
+
+    // success
+    return 1;
+}
+
+bool effective_any ( const uint64_t *_set, const uint32_t *_ids, size_t ids_len )
+{
+
+    // test each id
+    for (size_t i = 0; i < ids_len; i++)
+        if ( _set[_ids[i] >> 6] & ( 1ULL << ( _ids[i] & 63 ) ) )
+            return true;
+
+    // none
+    return false;
+}
+
+int effective_state_user_update ( effective *p_effective, struct effective_state_s *p_state, const user *p_user )
+{
+
+    // initialized data
+    struct effective_entry_s *p_entry    = NULL,
+                             *p_old      = NULL;
+    size_t                    user_id    = (size_t) user_key_accessor((user *) p_user);
+    const uint64_t           *_groups    = NULL;
+    size_t                    groups_len = 0;
+
+    // allocate an entry
+    p_entry = effective_entry_alloc(p_state);
+
+    // error check
+    if ( NULL == p_entry ) goto no_mem;
+
+    // compute the set
+    p_entry->user_id = user_id;
+    effective_compute(p_effective, p_state, p_user, p_entry->_set);
+
+    // swap out an existing set. Readers see the old set or the new one, never half of each
+    if ( hash_index_search(p_state->p_entries, user_id, (void **) &p_old) )
+    {
+        if ( 0 == hash_index_replace(p_state->p_entries, p_old, p_entry) ) goto failed_to_index;
+
+        // reuse the old entry once no reader can see it
+        effective_entry_retire(p_state, p_old);
+
+        // success
+        return 1;
+    }
+
+    // index the entry
+    if ( 0 == hash_index_insert(p_state->p_entries, p_entry) ) goto failed_to_index;
+
+    // the user is a member of each of their groups
+    (void) user_groups_get(p_user, &_groups, &groups_len);
+    for (size_t i = 0; i < groups_len; i++)
+        if ( 0 == effective_members_add(p_state, (size_t) _groups[i], user_id) ) goto failed_to_add_member;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // data errors
+        {
+            failed_to_index:
+                #ifndef NDEBUG
+                    log_error("[identity] [effective] Failed to index user %zu in call to function \"%s\"\n", user_id, __FUNCTION__);
+                #endif
+
+                // free the entry. No reader has seen it
+                p_entry->p_next  = p_state->p_free,
+                p_state->p_free  = p_entry;
+
+                // error
+                return 0;
+
+            failed_to_add_member:
+                #ifndef NDEBUG
+                    log_error("[identity] [effective] Failed to add user %zu to a group in call to function \"%s\"\n", user_id, __FUNCTION__);
+                #endif
+
+                // undo the user
+                effective_state_user_remove(p_state, p_user);
+
+                // error
+                return 0;
+        }
+
+        // standard library errors
+        {
+            no_mem:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+void effective_state_user_remove ( struct effective_state_s *p_state, const user *p_user )
+{
+
+    // initialized data
+    struct effective_entry_s *p_entry    = NULL;
+    size_t                    user_id    = (size_t) user_key_accessor((user *) p_user);
+    const uint64_t           *_groups    = NULL;
+    size_t                    groups_len = 0;
+
+    // fast exit
+    if ( 0 == hash_index_search(p_state->p_entries, user_id, (void **) &p_entry) ) return;
+
+    // the user leaves each of their groups
+    (void) user_groups_get(p_user, &_groups, &groups_len);
+    for (size_t i = 0; i < groups_len; i++)
+        effective_members_remove(p_state, (size_t) _groups[i], user_id);
+
+    // unlink the entry, and reuse it once no reader can see it
+    (void) hash_index_remove(p_state->p_entries, p_entry);
+    effective_entry_retire(p_state, p_entry);
+}
+
+int effective_user_update ( effective *p_effective, const permission_matcher *p_permissions, const user *p_user )
+{
+
+    // argument check
+    if ( NULL ==   p_effective ) goto no_effective;
+    if ( NULL == p_permissions ) goto no_permissions;
+    if ( NULL ==        p_user ) goto no_user;
+
+    // initialized data
+    struct effective_state_s *p_state = atomic_load_explicit(&p_effective->p_state, memory_order_relaxed);
+
+    // the permissions were recompiled without a rebuild
+    if ( p_state->p_permissions != p_permissions ) return effective_rebuild(p_effective, p_permissions);
+
+    // done
+    return effective_state_user_update(p_effective, p_state, p_user);
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_effective:
+                #ifndef NDEBUG
+                    log_error("[identity] [effective] Null pointer provided for parameter \"p_effective\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_permissions:
+                #ifndef NDEBUG
+                    log_error("[identity] [effective] Null pointer provided for parameter \"p_permissions\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_user:
+                #ifndef NDEBUG
+                    log_error("[identity] [effective] Null pointer provided for parameter \"p_user\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int effective_user_remove ( effective *p_effective, const user *p_user )
+{
+
+    // argument check
+    if ( NULL == p_effective ) goto no_effective;
+    if ( NULL ==      p_user ) goto no_user;
+
+    // remove the user's set
+    effective_state_user_remove(atomic_load_explicit(&p_effective->p_state, memory_order_relaxed), p_user);
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_effective:
+                #ifndef NDEBUG
+                    log_error("[identity] [effective] Null pointer provided for parameter \"p_effective\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_user:
+                #ifndef NDEBUG
+                    log_error("[identity] [effective] Null pointer provided for parameter \"p_user\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int effective_group_update ( effective *p_effective, const permission_matcher *p_permissions, size_t group_id )
+{
+
+    // argument check
+    if ( NULL ==   p_effective ) goto no_effective;
+    if ( NULL == p_permissions ) goto no_permissions;
+
+    // initialized data
+    struct effective_state_s   *p_state   = atomic_load_explicit(&p_effective->p_state, memory_order_relaxed);
+    struct effective_members_s *p_members = NULL;
+
+    // the permissions were recompiled without a rebuild
+    if ( p_state->p_permissions != p_permissions ) return effective_rebuild(p_effective, p_permissions);
+
+    // fast exit
+    if ( 0 == hash_index_search(p_state->p_members, group_id, (void **) &p_members) ) return 1;
+
+    // recompute each member
+    for (size_t i = 0; i < p_members->len; i++)
+    {
+
+        // initialized data
+        user *p_user = NULL;
+
+        // find the member
+        if ( 0 == hash_index_search(p_effective->p_users, (size_t) p_members->_user_ids[i], (void **) &p_user) ) continue;
+
+        // recompute the member's set
+        if ( 0 == effective_state_user_update(p_effective, p_state, p_user) ) return 0;
+    }
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_effective:
+                #ifndef NDEBUG
+                    log_error("[identity] [effective] Null pointer provided for parameter \"p_effective\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_permissions:
+                #ifndef NDEBUG
+                    log_error("[identity] [effective] Null pointer provided for parameter \"p_permissions\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int effective_rebuild ( effective *p_effective, const permission_matcher *p_permissions )
+{
+
+    // argument check
+    if ( NULL ==   p_effective ) goto no_effective;
+    if ( NULL == p_permissions ) goto no_permissions;
+
+    // initialized data
+    size_t                    users_len = hash_index_size(p_effective->p_users);
+    user                    **pp_users  = default_allocator(NULL, ( users_len + 1 ) * sizeof(user *));
+    struct effective_state_s *p_state   = NULL,
+                             *p_old     = NULL;
+
+    // error check
+    if ( NULL == pp_users ) goto no_mem;
+
+    // build the sets for the new permissions where no reader can see them
+    if ( 0 == effective_state_construct(&p_state, p_permissions, users_len) ) goto failed_to_construct_state;
+
+    // compute every set
+    users_len = hash_index_values(p_effective->p_users, (void **) pp_users);
+    for (size_t i = 0; i < users_len; i++)
+        if ( 0 == effective_state_user_update(p_effective, p_state, pp_users[i]) ) goto failed_to_update;
+
+    // publish the new sets, and free the old ones once no reader can see them
+    p_old = atomic_exchange_explicit(&p_effective->p_state, p_state, memory_order_acq_rel);
+    epoch_retire(p_old, (fn_epoch_free *) effective_state_destroy);
+
+    // release the users
+    pp_users = default_allocator(pp_users, 0);
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_effective:
+                #ifndef NDEBUG
+                    log_error("[identity] [effective] Null pointer provided for parameter \"p_effective\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_permissions:
+                #ifndef NDEBUG
+                    log_error("[identity] [effective] Null pointer provided for parameter \"p_permissions\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // data errors
+        {
+            failed_to_update:
+
+                // release the unpublished sets
+                effective_state_destroy(p_state);
+
+                // fall through
+            failed_to_construct_state:
+                #ifndef NDEBUG
+                    log_error("[identity] [effective] Failed to rebuild effective permissions in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // release the users
+                pp_users = default_allocator(pp_users, 0);
+
+                // error
+                return 0;
+        }
+
+        // standard library errors
+        {
+            no_mem:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int effective_destroy ( effective **pp_effective )
+{
+
+    // argument check
+    if ( NULL == pp_effective ) goto no_effective;
+
+    // initialized data
+    effective *p_effective = *pp_effective;
+
+    // no more pointer for caller
+    *pp_effective = NULL;
+
+    // fast exit
+    if ( NULL == p_effective ) return 1;
+
+    // release everything
+    effective_state_destroy(atomic_load_explicit(&p_effective->p_state, memory_order_relaxed));
+    p_effective = default_allocator(p_effective, 0);
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_effective:
+                #ifndef NDEBUG
+                    log_error("[identity] [effective] Null pointer provided for parameter \"pp_effective\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
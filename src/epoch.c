@@ -0,0 +1,327 @@
+/** !
+ * Epoch
+ *
+ * @file src/epoch.c
+ *
+ * @author Jacob Smith
+ */
+
+// header
+#include <identity/epoch.h>
+
+// structure definitions
+struct epoch_record_s
+{
+    _Atomic uint64_t       active; // the epoch the thread entered in, or 0 outside
+    atomic_bool            used;
+    size_t                 depth;  // nested sections. Only the owner touches this
+    struct epoch_record_s *p_next; // records are never unlinked
+};
+
+struct epoch_retired_s
+{
+    void                   *p_value;
+    fn_epoch_free          *pfn_free;
+    uint64_t                epoch;
+    struct epoch_retired_s *p_next;
+};
+
+struct epoch_s
+{
+    _Atomic uint64_t                 global;    // starts at 1, so 0 means outside
+    _Atomic(struct epoch_record_s *) p_records;
+    mutex                            _lock;     // guards the retired values
+    struct epoch_retired_s          *p_head,    // oldest first
+                                    *p_tail;
+    tss_t                            _key;      // gives a record back when its thread exits
+};
+
+// data
+static struct epoch_s                     _epoch       = { .global = 1 };
+static once_flag                          _constructed = ONCE_FLAG_INIT;
+static _Thread_local struct epoch_record_s *p_record    = NULL;
+
+// function declarations
+void epoch_construct ( void );
+void epoch_record_release ( struct epoch_record_s *p_epoch_record );
+struct epoch_record_s *epoch_record_acquire ( void );
+uint64_t epoch_oldest ( void );
+void epoch_reclaim ( void );
+
+void epoch_construct ( void )
+{
+
+    // construct the lock
+    (void) mutex_create(&_epoch._lock);
+
+    // give records back as threads exit
+    (void) tss_create(&_epoch._key, (tss_dtor_t) epoch_record_release);
+}
+
+void epoch_record_release ( struct epoch_record_s *p_epoch_record )
+{
+
+    // the record is free for the next thread
+    atomic_store_explicit(&p_epoch_record->active, 0, memory_order_release);
+    atomic_store_explicit(&p_epoch_record->used, false, memory_order_release);
+}
+
+struct epoch_record_s *epoch_record_acquire ( void )
+{
+
+    // initialized data
+    struct epoch_record_s *p_epoch_record = NULL;
+
+    // construct the epoch
+    call_once(&_constructed, epoch_construct);
+
+    // reuse the record of an exited thread
+    for (p_epoch_record = atomic_load(&_epoch.p_records); p_epoch_record; p_epoch_record = p_epoch_record->p_next)
+    {
+
+        // initialized data
+        bool expected = false;
+
+        // claim
+        if ( atomic_compare_exchange_strong(&p_epoch_record->used, &expected, true) ) goto done;
+    }
+
+    // allocate a record
+    p_epoch_record = default_allocator(NULL, sizeof(struct epoch_record_s));
+
+    // error check
+    if ( NULL == p_epoch_record ) return NULL;
+
+    // populate the record
+    atomic_init(&p_epoch_record->active, 0),
+    atomic_init(&p_epoch_record->used, true),
+    p_epoch_record->depth = 0;
+
+    // push the record
+    p_epoch_record->p_next = atomic_load(&_epoch.p_records);
+    while ( false == atomic_compare_exchange_weak(&_epoch.p_records, &p_epoch_record->p_next, p_epoch_record) );
+
+    done:
+
+    // give the record back when the thread exits
+    (void) tss_set(_epoch._key, p_epoch_record);
+
+    // done
+    return p_record = p_epoch_record;
+}
+
+void epoch_enter ( void )
+{
+
+    // initialized data
+    struct epoch_record_s *p_epoch_record = ( p_record ) ? p_record : epoch_record_acquire();
+
+    // error check
+    if ( NULL == p_epoch_record ) goto no_record;
+
+    // nested
+    if ( p_epoch_record->depth++ ) return;
+
+    // announce the epoch, before reading anything it protects
+    atomic_store(&p_epoch_record->active, atomic_load(&_epoch.global));
+    atomic_thread_fence(memory_order_seq_cst);
+
+    // done
+    return;
+
+    // error handling
+    {
+
+        // standard library errors
+        {
+            no_record:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // abort. A reader that can not announce itself is unsafe
+                abort();
+        }
+    }
+}
+
+void epoch_exit ( void )
+{
+
+    // nested
+    if ( --p_record->depth ) return;
+
+    // leave
+    atomic_store_explicit(&p_record->active, 0, memory_order_release);
+}
+
+uint64_t epoch_advance ( void )
+{
+
+    // done
+    return atomic_fetch_add(&_epoch.global, 1);
+}
+
+uint64_t epoch_oldest ( void )
+{
+
+    // initialized data
+    uint64_t oldest = UINT64_MAX;
+
+    // unlinking happens before the scan
+    atomic_thread_fence(memory_order_seq_cst);
+
+    // find the oldest epoch any reader is in
+    for (struct epoch_record_s *p_i = atomic_load(&_epoch.p_records); p_i; p_i = p_i->p_next)
+    {
+
+        // initialized data
+        uint64_t active = atomic_load(&p_i->active);
+
+        // keep the oldest
+        if ( active && active < oldest ) oldest = active;
+    }
+
+    // done
+    return oldest;
+}
+
+bool epoch_passed ( uint64_t epoch )
+{
+
+    // readers that entered after the epoch saw the new version
+    return epoch < epoch_oldest();
+}
+
+void epoch_reclaim ( void )
+{
+
+    // initialized data
+    struct epoch_retired_s *p_free = NULL;
+    uint64_t                oldest = epoch_oldest();
+
+    // unlink every value no reader can see. They were retired in order
+    mutex_lock(&_epoch._lock);
+    while ( _epoch.p_head && _epoch.p_head->epoch < oldest )
+    {
+
+        // initialized data
+        struct epoch_retired_s *p_retired = _epoch.p_head;
+
+        // unlink
+        _epoch.p_head = p_retired->p_next;
+        if ( NULL == _epoch.p_head ) _epoch.p_tail = NULL;
+
+        // collect
+        p_retired->p_next = p_free,
+        p_free            = p_retired;
+    }
+    mutex_unlock(&_epoch._lock);
+
+    // release them, without the lock
+    while ( p_free )
+    {
+
+        // initialized data
+        struct epoch_retired_s *p_next = p_free->p_next;
+
+        // release
+        p_free->pfn_free(p_free->p_value);
+        p_free = default_allocator(p_free, 0);
+
+        // next
+        p_free = p_next;
+    }
+}
+
+void epoch_retire ( void *p_value, fn_epoch_free *pfn_free )
+{
+
+    // initialized data
+    struct epoch_retired_s *p_retired = default_allocator(NULL, sizeof(struct epoch_retired_s));
+
+    // construct the epoch
+    call_once(&_constructed, epoch_construct);
+
+    // out of memory. Wait for the readers instead of deferring
+    if ( NULL == p_retired ) goto no_mem;
+
+    // populate the retired value
+    *p_retired = (struct epoch_retired_s)
+    {
+        .p_value  = p_value,
+        .pfn_free = pfn_free,
+        .epoch    = epoch_advance(),
+        .p_next   = NULL
+    };
+
+    // append
+    mutex_lock(&_epoch._lock);
+    if ( _epoch.p_tail ) _epoch.p_tail->p_next = p_retired;
+    else                 _epoch.p_head         = p_retired;
+    _epoch.p_tail = p_retired;
+    mutex_unlock(&_epoch._lock);
+
+    // release whatever readers have left behind
+    epoch_reclaim();
+
+    // done
+    return;
+
+    // error handling
+    {
+
+        // standard library errors
+        {
+            no_mem:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // release the value the slow way
+                epoch_synchronize();
+                pfn_free(p_value);
+
+                // done
+                return;
+        }
+    }
+}
+
+void epoch_synchronize ( void )
+{
+
+    // initialized data
+    uint64_t epoch = 0;
+
+    // error check
+    if ( p_record && p_record->depth ) goto reader;
+
+    // construct the epoch
+    call_once(&_constructed, epoch_construct);
+
+    // start a new epoch, and wait for every reader in an older one
+    epoch = epoch_advance();
+    while ( false == epoch_passed(epoch) ) thrd_yield();
+
+    // release every retired value
+    epoch_reclaim();
+
+    // done
+    return;
+
+    // error handling
+    {
+
+        // epoch errors
+        {
+            reader:
+                #ifndef NDEBUG
+                    log_error("[identity] [epoch] A reader can not wait for readers in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return;
+        }
+    }
+}
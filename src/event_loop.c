@@ -0,0 +1,936 @@
+/** !
+ * Event loop
+ *
+ * @file src/event_loop.c
+ *
+ * @author Jacob Smith
+ */
+
+// feature test macros
+#define _GNU_SOURCE
+
+// header
+#include <identity/event_loop.h>
+
+#ifdef __linux__
+
+// standard library
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+// structure definitions
+struct event_loop_s
+{
+    bool                            running;
+    int                             epoll_fd;
+    int                             listen_fd;
+    int                             cpu;
+    thread_pool                    *p_thread_pool;
+    mutex                           _in_flight_lock;
+    size_t                          in_flight;
+    size_t                          in_flight_max;
+    struct event_loop_connection_s *p_pending;      // ready connections waiting for an in flight slot
+    struct event_loop_connection_s *p_pending_tail;
+    mutex                           _buffers_lock;
+    void                           *p_buffers;
+    size_t                          buffers_idle;
+    fn_event_loop_frame            *pfn_frame;
+    fn_event_loop_request          *pfn_request;
+    void                           *p_parameter;
+};
+
+struct event_loop_connection_s
+{
+    event_loop                     *p_event_loop;
+    int                             fd;
+    bool                            closing;
+    size_t                          read_len;
+    char                           *p_read;
+    size_t                          write_offset; // the first unsent byte
+    size_t                          write_len;    // unsent bytes, waiting for room in the socket
+    char                           *p_write;
+    struct event_loop_connection_s *p_next;       // the next pending connection
+};
+
+// function declarations
+int event_loop_listen ( int *p_fd, socket_port port, bool reuse_port );
+void *event_loop_connection_task ( struct event_loop_connection_s *p_connection );
+char *event_loop_buffer_acquire ( event_loop *p_event_loop );
+void event_loop_buffer_release ( event_loop *p_event_loop, char *p_buffer );
+
+int event_loop_construct
+(
+    event_loop **pp_event_loop,
+
+    socket_port            port,
+    bool                   reuse_port,
+    int                    cpu,
+    thread_pool           *p_thread_pool,
+    size_t                 in_flight_max,
+    fn_event_loop_frame   *pfn_frame,
+    fn_event_loop_request *pfn_request,
+    void                  *p_parameter
+)
+{
+
+    // argument check
+    if ( NULL == pp_event_loop ) goto no_event_loop;
+    if ( NULL == p_thread_pool ) goto no_thread_pool;
+    if ( NULL ==     pfn_frame ) goto no_frame;
+    if ( NULL ==   pfn_request ) goto no_request;
+    if ( 0    == in_flight_max ) goto no_in_flight;
+
+    // initialized data
+    event_loop         *p_event_loop = default_allocator(0, sizeof(event_loop));
+    struct epoll_event  _event       = { .events = EPOLLIN, .data.ptr = NULL };
+
+    // error check
+    if ( NULL == p_event_loop ) goto no_mem;
+
+    // populate the event loop
+    *p_event_loop = (event_loop)
+    {
+        .running        = true,
+        .epoll_fd       = -1,
+        .listen_fd      = -1,
+        .cpu            = cpu,
+        .p_thread_pool  = p_thread_pool,
+        .in_flight      = 0,
+        .in_flight_max  = in_flight_max,
+        .p_pending      = NULL,
+        .p_pending_tail = NULL,
+        .p_buffers      = NULL,
+        .buffers_idle   = 0,
+        .pfn_frame      = pfn_frame,
+        .pfn_request    = pfn_request,
+        .p_parameter    = p_parameter
+    };
+
+    // bound the quantity of connections handed to workers at once
+    if ( 0 == mutex_create(&p_event_loop->_in_flight_lock) ) goto failed_to_construct_in_flight_lock;
+
+    // guard the pool of idle read buffers
+    if ( 0 == mutex_create(&p_event_loop->_buffers_lock) ) goto failed_to_construct_mutex;
+
+    // open the listening socket
+    if ( 0 == event_loop_listen(&p_event_loop->listen_fd, port, reuse_port) ) goto failed_to_listen;
+
+    // construct the epoll instance
+    p_event_loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if ( -1 == p_event_loop->epoll_fd ) goto failed_to_epoll;
+
+    // watch the listening socket. A null data pointer marks the listener
+    if ( -1 == epoll_ctl(p_event_loop->epoll_fd, EPOLL_CTL_ADD, p_event_loop->listen_fd, &_event) ) goto failed_to_epoll;
+
+    // return a pointer to the caller
+    *pp_event_loop = p_event_loop;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_event_loop:
+                #ifndef NDEBUG
+                    log_error("[identity] [event loop] Null pointer provided for parameter \"pp_event_loop\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_thread_pool:
+                #ifndef NDEBUG
+                    log_error("[identity] [event loop] Null pointer provided for parameter \"p_thread_pool\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_frame:
+                #ifndef NDEBUG
+                    log_error("[identity] [event loop] Null pointer provided for parameter \"pfn_frame\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_request:
+                #ifndef NDEBUG
+                    log_error("[identity] [event loop] Null pointer provided for parameter \"pfn_request\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_in_flight:
+                #ifndef NDEBUG
+                    log_error("[identity] [event loop] Parameter \"in_flight_max\" must be greater than zero in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // linux errors
+        {
+            failed_to_epoll:
+                #ifndef NDEBUG
+                    log_error("[linux] Failed to construct epoll instance in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // release the sockets
+                if ( -1 != p_event_loop->epoll_fd ) close(p_event_loop->epoll_fd);
+                close(p_event_loop->listen_fd);
+
+                // fall through
+                goto failed_to_listen;
+        }
+
+        // sync errors
+        {
+            failed_to_listen:
+                mutex_destroy(&p_event_loop->_buffers_lock);
+
+            failed_to_construct_mutex:
+                mutex_destroy(&p_event_loop->_in_flight_lock);
+
+            failed_to_construct_in_flight_lock:
+                p_event_loop = default_allocator(p_event_loop, 0);
+
+                // error
+                return 0;
+        }
+
+        // standard library errors
+        {
+            no_mem:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int event_loop_listen ( int *p_fd, socket_port port, bool reuse_port )
+{
+
+    // initialized data
+    int                _fd      = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int                _one     = 1;
+    struct sockaddr_in _address =
+    {
+        .sin_family      = AF_INET,
+        .sin_port        = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_ANY)
+    };
+
+    // error check
+    if ( -1 == _fd ) goto failed_to_socket;
+
+    // allow quick restarts
+    (void) setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &_one, sizeof(_one));
+
+    // share the port with sibling event loops. The kernel spreads incoming
+    // connections across every socket bound to it
+    if ( reuse_port )
+        if ( -1 == setsockopt(_fd, SOL_SOCKET, SO_REUSEPORT, &_one, sizeof(_one)) ) goto failed_to_bind;
+
+    // bind and listen
+    if ( -1 == bind(_fd, (struct sockaddr *) &_address, sizeof(_address)) ) goto failed_to_bind;
+    if ( -1 == listen(_fd, EVENT_LOOP_BACKLOG) ) goto failed_to_bind;
+
+    // return the socket to the caller
+    *p_fd = _fd;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // linux errors
+        {
+            failed_to_socket:
+                #ifndef NDEBUG
+                    log_error("[linux] Failed to open socket in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            failed_to_bind:
+                #ifndef NDEBUG
+                    log_error("[linux] Failed to listen on port %hu in call to function \"%s\"\n", port, __FUNCTION__);
+                #endif
+
+                // release the socket
+                close(_fd);
+
+                // error
+                return 0;
+        }
+    }
+}
+
+char *event_loop_buffer_acquire ( event_loop *p_event_loop )
+{
+
+    // initialized data
+    char *p_buffer = NULL;
+
+    // lock
+    mutex_lock(&p_event_loop->_buffers_lock);
+
+    // pop an idle buffer. The first bytes of an idle buffer link to the next
+    if ( p_event_loop->p_buffers )
+    {
+        p_buffer = p_event_loop->p_buffers;
+        memcpy(&p_event_loop->p_buffers, p_buffer, sizeof(void *));
+        p_event_loop->buffers_idle--;
+    }
+
+    // unlock
+    mutex_unlock(&p_event_loop->_buffers_lock);
+
+    // the pool is empty. grow it
+    if ( NULL == p_buffer ) p_buffer = default_allocator(0, EVENT_LOOP_BUFFER_SIZE);
+
+    // done
+    return p_buffer;
+}
+
+void event_loop_buffer_release ( event_loop *p_event_loop, char *p_buffer )
+{
+
+    // lock
+    mutex_lock(&p_event_loop->_buffers_lock);
+
+    // push the buffer, unless the pool is full
+    if ( EVENT_LOOP_BUFFERS_IDLE_MAX > p_event_loop->buffers_idle )
+    {
+        memcpy(p_buffer, &p_event_loop->p_buffers, sizeof(void *));
+        p_event_loop->p_buffers = p_buffer;
+        p_event_loop->buffers_idle++;
+        p_buffer = NULL;
+    }
+
+    // unlock
+    mutex_unlock(&p_event_loop->_buffers_lock);
+
+    // the pool is full
+    if ( p_buffer ) p_buffer = default_allocator(p_buffer, 0);
+}
+
+int event_loop_connection_close ( struct event_loop_connection_s *p_connection )
+{
+
+    // closing the descriptor also removes it from the epoll set
+    close(p_connection->fd);
+
+    // release the connection
+    if ( p_connection->p_read  ) event_loop_buffer_release(p_connection->p_event_loop, p_connection->p_read);
+    if ( p_connection->p_write ) event_loop_buffer_release(p_connection->p_event_loop, p_connection->p_write);
+    p_connection = default_allocator(p_connection, 0);
+
+    // success
+    return 1;
+}
+
+int event_loop_connection_arm ( struct event_loop_connection_s *p_connection )
+{
+
+    // initialized data
+    struct epoll_event _event =
+    {
+        .events   = ( ( p_connection->write_len ) ? EPOLLOUT : EPOLLIN ) | EPOLLRDHUP | EPOLLONESHOT,
+        .data.ptr = p_connection
+    };
+
+    // wait for room for the unsent replies, else for the next request. One
+    // shot events guarantee that at most one thread owns the connection at a time
+    return ( 0 == epoll_ctl(p_connection->p_event_loop->epoll_fd, EPOLL_CTL_MOD, p_connection->fd, &_event) );
+}
+
+int event_loop_connection_flush ( struct event_loop_connection_s *p_connection )
+{
+
+    // send the unsent bytes, until the socket is full
+    while ( p_connection->write_len )
+    {
+
+        // initialized data
+        ssize_t sent = send(p_connection->fd, &p_connection->p_write[p_connection->write_offset], p_connection->write_len, MSG_NOSIGNAL);
+
+        // the socket buffer is full. The rest waits for EPOLLOUT
+        if ( -1 == sent && ( EAGAIN == errno || EWOULDBLOCK == errno ) ) return 1;
+
+        // interrupted
+        if ( -1 == sent && EINTR == errno ) continue;
+
+        // error check
+        if ( -1 == sent ) return 0;
+
+        // advance
+        p_connection->write_offset += (size_t) sent,
+        p_connection->write_len    -= (size_t) sent;
+    }
+
+    // everything is sent. idle connections don't hold a buffer
+    event_loop_buffer_release(p_connection->p_event_loop, p_connection->p_write),
+    p_connection->p_write      = NULL,
+    p_connection->write_offset = 0;
+
+    // success
+    return 1;
+}
+
+int event_loop_send ( struct event_loop_connection_s *p_connection, const char *p_buffer, size_t len )
+{
+
+    // send what the socket takes, unless earlier bytes are still waiting
+    while ( len && 0 == p_connection->write_len )
+    {
+
+        // initialized data
+        ssize_t sent = send(p_connection->fd, p_buffer, len, MSG_NOSIGNAL);
+
+        // the socket buffer is full
+        if ( -1 == sent && ( EAGAIN == errno || EWOULDBLOCK == errno ) ) break;
+
+        // interrupted
+        if ( -1 == sent && EINTR == errno ) continue;
+
+        // error check
+        if ( -1 == sent ) return 0;
+
+        // advance
+        p_buffer += sent,
+        len      -= (size_t) sent;
+    }
+
+    // done
+    if ( 0 == len ) return 1;
+
+    // keep the rest on the connection, instead of waiting for the client
+    if ( NULL == p_connection->p_write )
+    {
+        p_connection->p_write = event_loop_buffer_acquire(p_connection->p_event_loop);
+        if ( NULL == p_connection->p_write ) return 0;
+    }
+
+    // the client reads too slowly
+    if ( p_connection->write_len + len > EVENT_LOOP_BUFFER_SIZE ) return 0;
+
+    // move the unsent bytes to the front, to make room after them
+    if ( p_connection->write_offset + p_connection->write_len + len > EVENT_LOOP_BUFFER_SIZE )
+        memmove(p_connection->p_write, &p_connection->p_write[p_connection->write_offset], p_connection->write_len),
+        p_connection->write_offset = 0;
+
+    // append
+    memcpy(&p_connection->p_write[p_connection->write_offset + p_connection->write_len], p_buffer, len);
+    p_connection->write_len += len;
+
+    // success
+    return 1;
+}
+
+void event_loop_in_flight_release ( event_loop *p_event_loop )
+{
+
+    // hand the slot on, until a pending connection takes it
+    for (;;)
+    {
+
+        // initialized data
+        struct event_loop_connection_s *p_next = NULL;
+
+        // lock
+        mutex_lock(&p_event_loop->_in_flight_lock);
+
+        // pop the oldest pending connection, or free the slot
+        p_next = p_event_loop->p_pending;
+        if ( p_next )
+        {
+            p_event_loop->p_pending = p_next->p_next;
+            if ( NULL == p_event_loop->p_pending ) p_event_loop->p_pending_tail = NULL;
+        }
+        else
+            p_event_loop->in_flight--;
+
+        // unlock
+        mutex_unlock(&p_event_loop->_in_flight_lock);
+
+        // no connection is waiting
+        if ( NULL == p_next ) return;
+
+        // the slot passes to the pending connection
+        if ( thread_pool_execute(p_event_loop->p_thread_pool, (fn_thread_pool_task *) event_loop_connection_task, p_next) ) return;
+
+        // it can not run, so the slot passes on
+        event_loop_connection_close(p_next);
+    }
+}
+
+int event_loop_dispatch ( struct event_loop_connection_s *p_connection )
+{
+
+    // initialized data
+    event_loop *p_event_loop = p_connection->p_event_loop;
+    bool        admitted     = false;
+
+    // lock
+    mutex_lock(&p_event_loop->_in_flight_lock);
+
+    // take an in flight slot, without waiting for one
+    if ( p_event_loop->in_flight < p_event_loop->in_flight_max )
+        p_event_loop->in_flight++,
+        admitted = true;
+
+    // or wait in line. The task that frees a slot dispatches the connection
+    else
+    {
+        p_connection->p_next = NULL;
+        if ( p_event_loop->p_pending_tail ) p_event_loop->p_pending_tail->p_next = p_connection;
+        else                                p_event_loop->p_pending = p_connection;
+        p_event_loop->p_pending_tail = p_connection;
+    }
+
+    // unlock
+    mutex_unlock(&p_event_loop->_in_flight_lock);
+
+    // the connection is pending
+    if ( false == admitted ) return 1;
+
+    // dispatch
+    if ( 0 == thread_pool_execute(p_event_loop->p_thread_pool, (fn_thread_pool_task *) event_loop_connection_task, p_connection) ) goto failed_to_execute;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // thread pool errors
+        {
+            failed_to_execute:
+
+                // free the slot. The caller closes the connection
+                event_loop_in_flight_release(p_event_loop);
+
+                // error
+                return 0;
+        }
+    }
+}
+
+void *event_loop_connection_task ( struct event_loop_connection_s *p_connection )
+{
+
+    // initialized data
+    event_loop *p_event_loop = p_connection->p_event_loop;
+    char        _write[EVENT_LOOP_BUFFER_SIZE];
+    size_t      write_len    = 0,
+                offset       = 0;
+
+    // serve every complete frame, until replies have to wait for the client
+    while ( offset < p_connection->read_len && 0 == p_connection->write_len )
+    {
+
+        // initialized data
+        size_t frame_len = 0;
+
+        // measure the frame
+        if ( 0 == p_event_loop->pfn_frame(p_event_loop->p_parameter, &p_connection->p_read[offset], p_connection->read_len - offset, &frame_len) ) goto close;
+
+        // stop at a partial frame
+        if ( 0 == frame_len || p_connection->read_len - offset < frame_len ) break;
+
+        // make room for the response
+        if ( sizeof(_write) - write_len < EVENT_LOOP_RESPONSE_MAX )
+        {
+            if ( 0 == event_loop_send(p_connection, _write, write_len) ) goto close;
+            write_len = 0;
+
+            // the client is not reading. Serve the rest once it catches up
+            if ( p_connection->write_len ) break;
+        }
+
+        // serve the frame
+        write_len += (size_t) p_event_loop->pfn_request(p_event_loop->p_parameter, &p_connection->p_read[offset], frame_len, &_write[write_len]);
+
+        // next frame
+        offset += frame_len;
+    }
+
+    // send the responses. What the socket does not take waits on the connection
+    if ( 0 == event_loop_send(p_connection, _write, write_len) ) goto close;
+
+    // the client hung up after its last request, and has every reply
+    if ( p_connection->closing && 0 == p_connection->write_len ) goto close;
+
+    // keep the partial frame, if any
+    p_connection->read_len -= offset;
+    if ( p_connection->read_len )
+        memmove(p_connection->p_read, &p_connection->p_read[offset], p_connection->read_len);
+
+    // idle connections don't hold a buffer
+    else
+        event_loop_buffer_release(p_event_loop, p_connection->p_read),
+        p_connection->p_read = NULL;
+
+    // hand the connection back to the event loop, to read, or to finish sending
+    if ( 0 == event_loop_connection_arm(p_connection) ) goto close;
+
+    // done
+    goto done;
+
+    // close the connection
+    close:
+        event_loop_connection_close(p_connection);
+
+    done:
+
+    // free the in flight slot, or hand it to a pending connection
+    event_loop_in_flight_release(p_event_loop);
+
+    // done
+    return NULL;
+}
+
+int event_loop_accept ( event_loop *p_event_loop )
+{
+
+    // accept every pending connection
+    while ( p_event_loop->running )
+    {
+
+        // initialized data
+        struct event_loop_connection_s *p_connection = NULL;
+        struct epoll_event              _event       = { 0 };
+        int                             _one         = 1;
+        int                             fd           = accept4(p_event_loop->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+        // drained
+        if ( -1 == fd ) return ( EAGAIN == errno || EWOULDBLOCK == errno );
+
+        // replies are small and latency bound
+        (void) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &_one, sizeof(_one));
+
+        // allocate a connection
+        p_connection = default_allocator(0, sizeof(struct event_loop_connection_s));
+
+        // error check
+        if ( NULL == p_connection ) { close(fd); continue; }
+
+        // populate the connection
+        *p_connection = (struct event_loop_connection_s)
+        {
+            .p_event_loop = p_event_loop,
+            .fd           = fd,
+            .closing      = false,
+            .read_len     = 0,
+            .p_read       = NULL,
+            .write_offset = 0,
+            .write_len    = 0,
+            .p_write      = NULL,
+            .p_next       = NULL
+        };
+
+        // watch the connection
+        _event = (struct epoll_event)
+        {
+            .events   = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT,
+            .data.ptr = p_connection
+        };
+
+        // error check
+        if ( -1 == epoll_ctl(p_event_loop->epoll_fd, EPOLL_CTL_ADD, fd, &_event) ) event_loop_connection_close(p_connection);
+    }
+
+    // success
+    return 1;
+}
+
+int event_loop_connection_read ( struct event_loop_connection_s *p_connection )
+{
+
+    // initialized data
+    event_loop *p_event_loop = p_connection->p_event_loop;
+    size_t      frame_len    = 0;
+
+    // finish sending earlier replies before reading, so a client that does
+    // not read stops being served, without holding a worker
+    if ( p_connection->write_len )
+    {
+
+        // send
+        if ( 0 == event_loop_connection_flush(p_connection) ) goto failed;
+
+        // the socket is still full. wait for room
+        if ( p_connection->write_len )
+        {
+            if ( 0 == event_loop_connection_arm(p_connection) ) goto failed;
+            return 1;
+        }
+    }
+
+    // allocate a buffer for an idle connection
+    if ( NULL == p_connection->p_read )
+    {
+        p_connection->p_read = event_loop_buffer_acquire(p_event_loop);
+        if ( NULL == p_connection->p_read ) goto failed;
+    }
+
+    // drain the socket
+    while ( p_connection->read_len < EVENT_LOOP_BUFFER_SIZE )
+    {
+
+        // initialized data
+        ssize_t received = recv(p_connection->fd, &p_connection->p_read[p_connection->read_len], EVENT_LOOP_BUFFER_SIZE - p_connection->read_len, 0);
+
+        // the client hung up
+        if ( 0 == received ) { p_connection->closing = true; break; }
+
+        // drained
+        if ( -1 == received )
+        {
+            if ( EAGAIN == errno || EWOULDBLOCK == errno ) break;
+            if ( EINTR  == errno ) continue;
+            goto failed;
+        }
+
+        // accumulate
+        p_connection->read_len += (size_t) received;
+    }
+
+    // measure the first frame
+    if ( p_connection->read_len )
+        if ( 0 == p_event_loop->pfn_frame(p_event_loop->p_parameter, p_connection->p_read, p_connection->read_len, &frame_len) ) goto failed;
+
+    // a complete frame is ready. hand the connection to a worker
+    if ( frame_len && frame_len <= p_connection->read_len )
+    {
+
+        // dispatch, or wait in line for an in flight slot
+        if ( 0 == event_loop_dispatch(p_connection) ) goto failed;
+
+        // success
+        return 1;
+    }
+
+    // the client hung up mid frame
+    if ( p_connection->closing ) goto failed;
+
+    // the frame can never fit in the buffer
+    if ( EVENT_LOOP_BUFFER_SIZE == p_connection->read_len ) goto failed;
+
+    // wait for the rest of the frame
+    if ( 0 == event_loop_connection_arm(p_connection) ) goto failed;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+        failed:
+
+            // close the connection
+            event_loop_connection_close(p_connection);
+
+            // error
+            return 0;
+    }
+}
+
+int event_loop_run ( event_loop *p_event_loop )
+{
+
+    // argument check
+    if ( NULL == p_event_loop ) goto no_event_loop;
+
+    // initialized data
+    struct epoll_event _events[EVENT_LOOP_EVENTS];
+
+    // pin the loop to its core
+    if ( -1 != p_event_loop->cpu )
+    {
+
+        // initialized data
+        cpu_set_t _cpus;
+
+        // only this core
+        CPU_ZERO(&_cpus);
+        CPU_SET(p_event_loop->cpu, &_cpus);
+
+        // pin
+        if ( pthread_setaffinity_np(pthread_self(), sizeof(_cpus), &_cpus) )
+            log_error("[identity] [event loop] Failed to pin event loop to core %d\n", p_event_loop->cpu);
+    }
+
+    // log
+    log_info("[identity] [event loop] Listening for incoming connections...\n");
+
+    // wait for events
+    while ( p_event_loop->running )
+    {
+
+        // initialized data
+        int ready = epoll_wait(p_event_loop->epoll_fd, _events, EVENT_LOOP_EVENTS, 250);
+
+        // error check
+        if ( -1 == ready && EINTR != errno ) goto failed_to_wait;
+
+        // dispatch each event
+        for (int i = 0; i < ready; i++)
+        {
+            if ( NULL == _events[i].data.ptr ) (void) event_loop_accept(p_event_loop);
+            else                               (void) event_loop_connection_read(_events[i].data.ptr);
+        }
+    }
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_event_loop:
+                #ifndef NDEBUG
+                    log_error("[identity] [event loop] Null pointer provided for parameter \"p_event_loop\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // linux errors
+        {
+            failed_to_wait:
+                #ifndef NDEBUG
+                    log_error("[linux] Failed to wait for events in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int event_loop_stop ( event_loop *p_event_loop )
+{
+
+    // argument check
+    if ( NULL == p_event_loop ) return 0;
+
+    // the loop notices within one wait timeout
+    p_event_loop->running = false;
+
+    // success
+    return 1;
+}
+
+int event_loop_destroy ( event_loop **pp_event_loop )
+{
+
+    // argument check
+    if ( NULL == pp_event_loop ) return 0;
+
+    // initialized data
+    event_loop *p_event_loop = *pp_event_loop;
+
+    // no more pointer for caller
+    *pp_event_loop = NULL;
+
+    // nothing to release
+    if ( NULL == p_event_loop ) return 1;
+
+    // stop listening
+    close(p_event_loop->epoll_fd);
+    close(p_event_loop->listen_fd);
+
+    // release the idle buffers
+    while ( p_event_loop->p_buffers )
+    {
+
+        // initialized data
+        void *p_buffer = p_event_loop->p_buffers;
+
+        // pop
+        memcpy(&p_event_loop->p_buffers, p_buffer, sizeof(void *));
+
+        // release
+        p_buffer = default_allocator(p_buffer, 0);
+    }
+
+    // release the locks
+    mutex_destroy(&p_event_loop->_buffers_lock);
+    mutex_destroy(&p_event_loop->_in_flight_lock);
+
+    // release the event loop
+    p_event_loop = default_allocator(p_event_loop, 0);
+
+    // success
+    return 1;
+}
+
+#else
+
+int event_loop_construct
+(
+    event_loop **pp_event_loop,
+
+    socket_port            port,
+    bool                   reuse_port,
+    int                    cpu,
+    thread_pool           *p_thread_pool,
+    size_t                 in_flight_max,
+    fn_event_loop_frame   *pfn_frame,
+    fn_event_loop_request *pfn_request,
+    void                  *p_parameter
+)
+{
+
+    // unsupported
+    log_error("[identity] [event loop] The event loop requires epoll\n");
+
+    // error
+    return 0;
+}
+
+int event_loop_run ( event_loop *p_event_loop )
+{
+
+    // error
+    return 0;
+}
+
+int event_loop_stop ( event_loop *p_event_loop )
+{
+
+    // error
+    return 0;
+}
+
+int event_loop_destroy ( event_loop **pp_event_loop )
+{
+
+    // error
+    return 0;
+}
+
+#endif
@@ -10,10 +10,19 @@
 #include <identity/group.h>
 
 // structure definitions
+//
+// A group is one contiguous record. The role ids follow the fixed fields,
+// then the name, so a record means the same thing on the heap and in a mapped
+// snapshot. The name is interned again whenever a record is bound
 struct group_s
 {
-    size_t id;
-    char   _name[64+1];
+    uint64_t id;
+    uint64_t org_id;
+    uint64_t size;         // bytes in the whole record
+    uint32_t name_id;      // interned
+    uint32_t name_offset;
+    uint32_t roles_len;
+    uint32_t roles_offset;
 };
 
 int group_construct
@@ -31,23 +40,51 @@ int group_construct
     // argument check
     if ( NULL == pp_group ) goto no_group;
     if ( NULL == p_name ) goto no_name;
+    if ( NULL == _roles && 0 < _roles_length ) goto no_roles;
 
     // initialized data
-    group *p_group = default_allocator(NULL, sizeof(group));
+    group      *p_group      = NULL;
+    uint64_t   *p_roles      = NULL;
+    const char *p_end        = memchr(p_name, '\0', GROUP_NAME_MAX);
+    size_t      name_len     = ( p_end ) ? (size_t)( p_end - p_name ) : GROUP_NAME_MAX,
+                roles_offset = ( sizeof(group) + 7 ) & ~(size_t) 7,
+                name_offset  = roles_offset + _roles_length * sizeof(uint64_t),
+                size         = ( name_offset + name_len + 1 + 7 ) & ~(size_t) 7;
+
+    // error check
+    if ( GROUP_ROLES_MAX < _roles_length ) goto too_many_roles;
+
+    // allocate the record
+    p_group = default_allocator(NULL, size);
 
     // error check
     if ( NULL == p_group ) goto no_mem;
 
+    // zero the record, so packed records have no stray bytes
+    memset(p_group, 0, size);
+
     // populate the group struct
     *p_group = (group)
     {
-        .id    = id,
-        ._name = { 0 }
+        .id           = id,
+        .org_id       = org_id,
+        .size         = size,
+        .name_id      = INTERN_NONE,
+        .name_offset  = (uint32_t) name_offset,
+        .roles_len    = (uint32_t) _roles_length,
+        .roles_offset = (uint32_t) roles_offset
     };
 
     // copy the name
-    strncpy(p_group->_name, p_name, sizeof(p_group->_name) - 1);
-    p_group->_name[strlen(p_name)] = '\0';
+    memcpy((char *) p_group + name_offset, p_name, name_len);
+
+    // store the role ids
+    p_roles = (uint64_t *)( (char *) p_group + roles_offset );
+    for (size_t i = 0; i < _roles_length; ++i)
+        p_roles[i] = _roles[i];
+
+    // intern the name
+    if ( 0 == intern_string_add(p_name, name_len, &p_group->name_id) ) goto failed_to_intern;
 
     // return a pointer to the caller
     *pp_group = p_group;
@@ -100,10 +137,31 @@ int group_construct
                 // error
                 return 0;
         }
+
+        // group errors
+        {
+            too_many_roles:
+                #ifndef NDEBUG
+                    log_error("[identity] [group] Parameter \"_roles_length\" is greater than %d in call to function \"%s\"\n", GROUP_ROLES_MAX, __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            failed_to_intern:
+                #ifndef NDEBUG
+                    log_error("[identity] [group] Failed to intern group name in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // clean up
+                p_group = default_allocator(p_group, 0);
+
+                // error
+                return 0;
+        }
     
         // standard library errors
         {
-            no_mem_1: p_group = default_allocator(p_group, 0);
             no_mem:
                 #ifndef NDEBUG
                     log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
@@ -127,13 +185,13 @@ int group_from_json
     if ( NULL == p_value ) goto no_value;
 
     // initialized data
-    group        *p_group    = default_allocator(NULL, sizeof(group));
-    dict       *p_dict   = NULL;
-    json_value *p_name   = NULL,
-               *p_group_id = NULL;
-
-    // error check
-    if ( NULL == p_group ) goto no_mem;
+    dict       *p_dict     = NULL;
+    json_value *p_name     = NULL,
+               *p_group_id = NULL,
+               *p_org_id   = NULL,
+               *p_role_ids = NULL;
+    size_t      _roles[GROUP_ROLES_MAX] = { 0 };
+    size_t      roles_len  = 0;
 
     // type check
     if ( JSON_VALUE_OBJECT != p_value->type ) goto wrong_type;
@@ -141,9 +199,11 @@ int group_from_json
     // store the object
     p_dict = p_value->object;
 
-    // get the name
-    p_name = dict_get(p_dict, "name");
-    p_group_id = dict_get(p_dict, "group_id");
+    // get the properties
+    p_name     = dict_get(p_dict, "name");
+    p_group_id = dict_get(p_dict, "id");
+    p_org_id   = dict_get(p_dict, "org_id");
+    p_role_ids = dict_get(p_dict, "role_ids");
 
     // error check
     if ( NULL ==   p_name ) goto no_name;
@@ -152,23 +212,41 @@ int group_from_json
     // type check
     if (  JSON_VALUE_STRING !=   p_name->type ) goto name_wrong_type;
     if ( JSON_VALUE_INTEGER != p_group_id->type ) goto group_id_wrong_type;
+    if ( p_org_id   && JSON_VALUE_INTEGER != p_org_id->type   ) goto org_id_wrong_type;
+    if ( p_role_ids && JSON_VALUE_ARRAY   != p_role_ids->type ) goto role_ids_wrong_type;
 
-    // populate the group struct
-    *p_group = (group)
+    // get the role ids
+    if ( p_role_ids )
     {
-        .id    = p_group_id->integer,
-        ._name = { 0 }
-    };
 
-    // copy the name
-    strncpy(p_group->_name, p_name->string, sizeof(p_group->_name) - 1);
-    p_group->_name[strlen(p_name->string)] = '\0';
+        // initialized data
+        json_value *_p_values[GROUP_ROLES_MAX] = { 0 };
 
-    // return a pointer to the caller
-    *pp_group = p_group;
+        // error check
+        roles_len = array_size(p_role_ids->list);
+        if ( GROUP_ROLES_MAX < roles_len ) goto too_many_roles;
 
-    // success
-    return 1;
+        // get the values
+        array_get(p_role_ids->list, (void **) _p_values, NULL);
+
+        // type check
+        for (size_t i = 0; i < roles_len; i++)
+        {
+            if ( JSON_VALUE_INTEGER != _p_values[i]->type ) goto role_ids_wrong_type;
+            _roles[i] = (size_t) _p_values[i]->integer;
+        }
+    }
+
+    // construct the group
+    return group_construct
+    (
+        pp_group,
+        (size_t) p_group_id->integer,
+        p_name->string,
+        ( p_org_id ) ? (size_t) p_org_id->integer : 0,
+        _roles,
+        roles_len
+    );
 
     // error handling
     {
@@ -212,7 +290,7 @@ int group_from_json
 
             no_group_id:
                 #ifndef NDEBUG
-                    log_error("[identity] [group] Parameter \"p_value\" missing property \"group_id\" in call to function \"%s\"\n", __FUNCTION__);
+                    log_error("[identity] [group] Parameter \"p_value\" missing property \"id\" in call to function \"%s\"\n", __FUNCTION__);
                 #endif
 
                 // error
@@ -228,18 +306,31 @@ int group_from_json
             
             group_id_wrong_type:
                 #ifndef NDEBUG
-                    log_error("[identity] [group] Property \"group_id\" of parameter \"p_value\" must be of type [ integer ] in call to function \"%s\"\n", __FUNCTION__);
+                    log_error("[identity] [group] Property \"id\" of parameter \"p_value\" must be of type [ integer ] in call to function \"%s\"\n", __FUNCTION__);
                 #endif
 
                 // error
                 return 0;
-        }
 
-        // standard library errors
-        {
-            no_mem:
+            org_id_wrong_type:
                 #ifndef NDEBUG
-                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                    log_error("[identity] [group] Property \"org_id\" of parameter \"p_value\" must be of type [ integer ] in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            role_ids_wrong_type:
+                #ifndef NDEBUG
+                    log_error("[identity] [group] Property \"role_ids\" of parameter \"p_value\" must be of type [ array ] of [ integer ] in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            too_many_roles:
+                #ifndef NDEBUG
+                    log_error("[identity] [group] Property \"role_ids\" of parameter \"p_value\" has more than %d elements in call to function \"%s\"\n", GROUP_ROLES_MAX, __FUNCTION__);
                 #endif
 
                 // error
@@ -257,7 +348,8 @@ int group_print ( group *p_group )
     // formatting
     log_info("group @%p\n", (void *)p_group);
     printf(" - ID   : %lld\n", p_group->id);
-    printf(" - Name : %s\n", p_group->_name);
+    printf(" - Name : %s\n", group_name_get(p_group));
+    printf(" - Roles[%u]: \n", p_group->roles_len);
 
     // success
     return 1;
@@ -282,37 +374,152 @@ int group_comparator ( size_t id_a, size_t id_b )
 {
 
     // success
-    return id_b - id_a;
+    return ( id_b > id_a ) - ( id_b < id_a );
 }
 
 void *group_key_accessor ( group *p_group )
 {
 
     // success
-    return (void *)p_group->id;
+    return (void *)(size_t) p_group->id;
 }
 
-int group_pack ( void *p_buffer, const group *const p_group )
+const char *group_name_get ( const group *p_group )
 {
 
-    // initialized data
-    char *p_offset = (char *) p_buffer;
+    // done
+    return intern_string_get(p_group->name_id);
+}
+
+uint32_t group_name_id ( const group *p_group )
+{
+
+    // done
+    return p_group->name_id;
+}
+
+size_t group_org_id_get ( const group *p_group )
+{
+
+    // done
+    return (size_t) p_group->org_id;
+}
+
+int group_roles_get ( const group *p_group, const uint64_t **pp_roles, size_t *p_roles_len )
+{
+
+    // return the role ids to the caller
+    *pp_roles    = (const uint64_t *)( (const char *) p_group + p_group->roles_offset ),
+    *p_roles_len = p_group->roles_len;
+
+    // success
+    return 1;
+}
 
-    // pack group id
-    p_offset += pack_pack(p_offset, "%i64", p_group->id),
+int group_pack ( void *p_buffer, const group *const p_group )
+{
 
-    // pack the name
-    p_offset += pack_pack(p_offset, "%s", p_group->_name);
+    // argument check
+    if ( NULL == p_group ) goto no_group;
+
+    // the record is already packed. A null buffer asks for the size
+    if ( p_buffer ) memcpy(p_buffer, p_group, p_group->size);
 
     // done
-    return (void *)p_offset - (void *)p_buffer;
+    return (int) p_group->size;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_group:
+                #ifndef NDEBUG
+                    log_error("[identity] [group] Null pointer provided for parameter \"p_group\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
 }
 
-int group_unpack ( void *const p_value, void *p_buffer )
+int group_unpack ( group **pp_group, void *p_buffer, size_t size )
 {
 
-    // 
+    // argument check
+    if ( NULL == pp_group ) goto no_group;
+    if ( NULL == p_buffer ) goto no_buffer;
+
+    // initialized data
+    group *p_group = p_buffer;
+
+    // check the fixed fields
+    if ( 0 != ( (size_t) p_buffer & 7 ) ) goto bad_record;
+    if ( size < sizeof(group) || p_group->size < sizeof(group) || p_group->size > size || 0 != ( p_group->size & 7 ) ) goto bad_record;
+
+    // check the name
+    if ( p_group->name_offset < sizeof(group) || p_group->name_offset >= p_group->size ) goto bad_record;
+    if ( NULL == memchr((const char *) p_group + p_group->name_offset, '\0', p_group->size - p_group->name_offset) ) goto bad_record;
+
+    // check the role ids
+    if ( p_group->roles_offset < sizeof(group) || 0 != ( p_group->roles_offset & 7 ) || (uint64_t) p_group->roles_offset + (uint64_t) p_group->roles_len * sizeof(uint64_t) > p_group->size ) goto bad_record;
+
+    // intern the name in this process
+    {
+
+        // initialized data
+        const char *p_name = (const char *) p_group + p_group->name_offset;
+
+        // intern the name
+        if ( 0 == intern_string_add(p_name, strlen(p_name), &p_group->name_id) ) goto failed_to_intern;
+    }
+
+    // bind the record in place
+    *pp_group = p_group;
 
     // done
-    return 0;
+    return (int) p_group->size;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_group:
+                #ifndef NDEBUG
+                    log_error("[identity] [group] Null pointer provided for parameter \"pp_group\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_buffer:
+                #ifndef NDEBUG
+                    log_error("[identity] [group] Null pointer provided for parameter \"p_buffer\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // group errors
+        {
+            bad_record:
+                #ifndef NDEBUG
+                    log_error("[identity] [group] Malformed group record in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            failed_to_intern:
+                #ifndef NDEBUG
+                    log_error("[identity] [group] Failed to intern group name in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
 }
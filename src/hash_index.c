@@ -0,0 +1,746 @@
+/** !
+ * Hash index
+ *
+ * @file src/hash_index.c
+ *
+ * @author Jacob Smith
+ */
+
+// header
+#include <identity/hash_index.h>
+
+// preprocessor definitions
+#define HASH_INDEX_TOMBSTONE ( (void *) &_hash_index_tombstone )
+
+// structure definitions
+struct hash_index_slot_s
+{
+    size_t           key;
+    _Atomic(void *)  p_value; // null when the slot is empty
+};
+
+struct hash_index_table_s
+{
+    size_t                   mask;     // capacity - 1. The capacity is a power of two
+    struct hash_index_slot_s _slots[];
+};
+
+struct hash_index_s
+{
+    fn_key_accessor                      *pfn_key;
+    fn_hash_index_match                  *pfn_match;
+    size_t                                size;
+    size_t                                tombstones; // slots of removed values, until the next rehash
+    _Atomic(struct hash_index_table_s *)  p_table;
+};
+
+// data
+static const char _hash_index_tombstone = 0;
+
+// function declarations
+size_t hash_index_hash ( size_t key );
+size_t hash_index_capacity ( size_t quantity );
+int hash_index_rehash ( hash_index *p_hash_index, size_t capacity );
+void hash_index_place ( struct hash_index_table_s *p_table, size_t key, void *p_value );
+void hash_index_table_free ( struct hash_index_table_s *p_table );
+struct hash_index_slot_s *hash_index_slot_find ( struct hash_index_table_s *p_table, size_t key, const void *p_value );
+
+size_t hash_index_hash ( size_t key )
+{
+
+    // initialized data
+    uint64_t x = (uint64_t) key;
+
+    // splitmix64 finalizer. Ids are mostly sequential, and this spreads them
+    // over every bit before the mask keeps the low ones
+    x ^= x >> 30, x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27, x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+
+    // done
+    return (size_t) x;
+}
+
+size_t hash_index_capacity ( size_t quantity )
+{
+
+    // initialized data
+    size_t capacity = HASH_INDEX_CAPACITY_MIN;
+
+    // keep the load factor under 3/4
+    while ( capacity / 4 * 3 < quantity ) capacity <<= 1;
+
+    // done
+    return capacity;
+}
+
+void hash_index_place ( struct hash_index_table_s *p_table, size_t key, void *p_value )
+{
+
+    // initialized data
+    size_t i = hash_index_hash(key) & p_table->mask;
+
+    // probe for an empty slot. Tombstones stay put, so readers probing past
+    // them still reach the values after them
+    while ( atomic_load_explicit(&p_table->_slots[i].p_value, memory_order_relaxed) ) i = ( i + 1 ) & p_table->mask;
+
+    // store the key, then publish the value
+    p_table->_slots[i].key = key;
+    atomic_store_explicit(&p_table->_slots[i].p_value, p_value, memory_order_release);
+}
+
+void hash_index_table_free ( struct hash_index_table_s *p_table )
+{
+
+    // release the table
+    p_table = default_allocator(p_table, 0);
+}
+
+struct hash_index_slot_s *hash_index_slot_find ( struct hash_index_table_s *p_table, size_t key, const void *p_value )
+{
+
+    // initialized data
+    size_t  i       = hash_index_hash(key) & p_table->mask;
+    void   *p_maybe = NULL;
+
+    // probe until the value or an empty slot. Hashed keys may repeat, so
+    // compare the value itself
+    while ( ( p_maybe = atomic_load_explicit(&p_table->_slots[i].p_value, memory_order_relaxed) ) )
+    {
+
+        // found
+        if ( p_value == p_maybe ) return &p_table->_slots[i];
+
+        // next slot
+        i = ( i + 1 ) & p_table->mask;
+    }
+
+    // not found
+    return NULL;
+}
+
+int hash_index_rehash ( hash_index *p_hash_index, size_t capacity )
+{
+
+    // initialized data
+    struct hash_index_table_s *p_old   = atomic_load_explicit(&p_hash_index->p_table, memory_order_relaxed),
+                              *p_table = default_allocator(0, sizeof(struct hash_index_table_s) + capacity * sizeof(struct hash_index_slot_s));
+
+    // error check
+    if ( NULL == p_table ) goto no_mem;
+
+    // every slot starts empty
+    memset(p_table, 0, sizeof(struct hash_index_table_s) + capacity * sizeof(struct hash_index_slot_s));
+    p_table->mask = capacity - 1;
+
+    // copy every value, and drop the tombstones
+    if ( p_old )
+        for (size_t i = 0; i <= p_old->mask; i++)
+        {
+
+            // initialized data
+            void *p_value = atomic_load_explicit(&p_old->_slots[i].p_value, memory_order_relaxed);
+
+            // copy
+            if ( p_value && HASH_INDEX_TOMBSTONE != p_value ) hash_index_place(p_table, p_old->_slots[i].key, p_value);
+        }
+
+    // publish the new table
+    atomic_store_explicit(&p_hash_index->p_table, p_table, memory_order_release);
+    p_hash_index->tombstones = 0;
+
+    // release the old table, once no reader is probing it
+    if ( p_old ) epoch_retire(p_old, (fn_epoch_free *) hash_index_table_free);
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // standard library errors
+        {
+            no_mem:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int hash_index_construct ( hash_index **pp_hash_index, fn_key_accessor *pfn_key, fn_hash_index_match *pfn_match, size_t quantity )
+{
+
+    // argument check
+    if ( NULL == pp_hash_index ) goto no_hash_index;
+    if ( NULL ==       pfn_key ) goto no_key;
+
+    // initialized data
+    hash_index *p_hash_index = default_allocator(0, sizeof(hash_index));
+
+    // error check
+    if ( NULL == p_hash_index ) goto no_mem;
+
+    // populate the hash index
+    *p_hash_index = (hash_index)
+    {
+        .pfn_key   = pfn_key,
+        .pfn_match = pfn_match,
+        .size       = 0,
+        .tombstones = 0,
+        .p_table    = NULL
+    };
+
+    // allocate the table
+    if ( 0 == hash_index_rehash(p_hash_index, hash_index_capacity(quantity)) ) goto failed_to_allocate_slots;
+
+    // return a pointer to the caller
+    *pp_hash_index = p_hash_index;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_hash_index:
+                #ifndef NDEBUG
+                    log_error("[identity] [hash index] Null pointer provided for parameter \"pp_hash_index\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_key:
+                #ifndef NDEBUG
+                    log_error("[identity] [hash index] Null pointer provided for parameter \"pfn_key\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // standard library errors
+        {
+            failed_to_allocate_slots:
+                p_hash_index = default_allocator(p_hash_index, 0);
+
+                // error
+                return 0;
+
+            no_mem:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int hash_index_search ( hash_index *p_hash_index, size_t key, void **pp_value )
+{
+
+    // argument check
+    if ( NULL == p_hash_index ) goto no_hash_index;
+    if ( NULL ==     pp_value ) goto no_value;
+
+    // initialized data
+    struct hash_index_table_s *p_table = atomic_load_explicit(&p_hash_index->p_table, memory_order_acquire);
+    size_t                     i       = hash_index_hash(key) & p_table->mask;
+    void                      *p_value = NULL;
+
+    // probe until the key or an empty slot. The key is only read once its
+    // value is seen, so it is the key the value was published with
+    while ( ( p_value = atomic_load_explicit(&p_table->_slots[i].p_value, memory_order_acquire) ) )
+    {
+
+        // found
+        if ( HASH_INDEX_TOMBSTONE != p_value && key == p_table->_slots[i].key )
+        {
+
+            // return the value to the caller
+            *pp_value = p_value;
+
+            // success
+            return 1;
+        }
+
+        // next slot
+        i = ( i + 1 ) & p_table->mask;
+    }
+
+    // not found
+    return 0;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_hash_index:
+                #ifndef NDEBUG
+                    log_error("[identity] [hash index] Null pointer provided for parameter \"p_hash_index\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_value:
+                #ifndef NDEBUG
+                    log_error("[identity] [hash index] Null pointer provided for parameter \"pp_value\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int hash_index_match ( hash_index *p_hash_index, size_t hash, const void *p_key, void **pp_value )
+{
+
+    // argument check
+    if ( NULL == p_hash_index ) goto no_hash_index;
+    if ( NULL ==     pp_value ) goto no_value;
+
+    // initialized data
+    struct hash_index_table_s *p_table = atomic_load_explicit(&p_hash_index->p_table, memory_order_acquire);
+    size_t                     i       = hash_index_hash(hash) & p_table->mask;
+    void                      *p_value = NULL;
+
+    // probe until a match or an empty slot
+    while ( ( p_value = atomic_load_explicit(&p_table->_slots[i].p_value, memory_order_acquire) ) )
+    {
+
+        // found
+        if ( HASH_INDEX_TOMBSTONE != p_value && hash == p_table->_slots[i].key && ( NULL == p_hash_index->pfn_match || p_hash_index->pfn_match(p_value, p_key) ) )
+        {
+
+            // return the value to the caller
+            *pp_value = p_value;
+
+            // success
+            return 1;
+        }
+
+        // next slot
+        i = ( i + 1 ) & p_table->mask;
+    }
+
+    // not found
+    return 0;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_hash_index:
+                #ifndef NDEBUG
+                    log_error("[identity] [hash index] Null pointer provided for parameter \"p_hash_index\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_value:
+                #ifndef NDEBUG
+                    log_error("[identity] [hash index] Null pointer provided for parameter \"pp_value\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+size_t hash_index_size ( hash_index *p_hash_index )
+{
+
+    // done
+    return ( p_hash_index ) ? p_hash_index->size : 0;
+}
+
+int hash_index_reserve ( hash_index *p_hash_index, size_t quantity )
+{
+
+    // argument check
+    if ( NULL == p_hash_index ) goto no_hash_index;
+
+    // initialized data
+    size_t capacity = atomic_load_explicit(&p_hash_index->p_table, memory_order_relaxed)->mask + 1;
+
+    // already large enough. Tombstones take up slots until the next rehash
+    if ( hash_index_capacity(quantity + p_hash_index->tombstones) <= capacity ) return 1;
+
+    // grow, or just drop the tombstones
+    return hash_index_rehash(p_hash_index, ( hash_index_capacity(quantity) > capacity ) ? hash_index_capacity(quantity) : capacity);
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_hash_index:
+                #ifndef NDEBUG
+                    log_error("[identity] [hash index] Null pointer provided for parameter \"p_hash_index\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int hash_index_insert ( hash_index *p_hash_index, void *p_value )
+{
+
+    // argument check
+    if ( NULL == p_hash_index ) goto no_hash_index;
+    if ( NULL ==      p_value ) goto no_value;
+
+    // initialized data
+    size_t  key          = (size_t) p_hash_index->pfn_key(p_value);
+    void   *p_duplicate  = NULL;
+
+    // error check. Hashed keys may repeat, and the caller checks the full key
+    if ( NULL == p_hash_index->pfn_match && hash_index_search(p_hash_index, key, &p_duplicate) ) goto duplicate_key;
+
+    // grow before the load factor passes 3/4
+    if ( 0 == hash_index_reserve(p_hash_index, p_hash_index->size + 1) ) return 0;
+
+    // store the value
+    hash_index_place(atomic_load_explicit(&p_hash_index->p_table, memory_order_relaxed), key, p_value);
+
+    // increment the size
+    p_hash_index->size++;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_hash_index:
+                #ifndef NDEBUG
+                    log_error("[identity] [hash index] Null pointer provided for parameter \"p_hash_index\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_value:
+                #ifndef NDEBUG
+                    log_error("[identity] [hash index] Null pointer provided for parameter \"p_value\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // hash index errors
+        {
+            duplicate_key:
+                #ifndef NDEBUG
+                    log_error("[identity] [hash index] Key %zu is already present in call to function \"%s\"\n", key, __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int hash_index_remove ( hash_index *p_hash_index, void *p_value )
+{
+
+    // argument check
+    if ( NULL == p_hash_index ) goto no_hash_index;
+    if ( NULL ==      p_value ) goto no_value;
+
+    // initialized data
+    struct hash_index_slot_s *p_slot = hash_index_slot_find(atomic_load_explicit(&p_hash_index->p_table, memory_order_relaxed), (size_t) p_hash_index->pfn_key(p_value), p_value);
+
+    // not found
+    if ( NULL == p_slot ) return 0;
+
+    // leave a tombstone. Moving the rest of the cluster back would let a
+    // reader probing behind the move skip over a value
+    atomic_store_explicit(&p_slot->p_value, HASH_INDEX_TOMBSTONE, memory_order_release);
+
+    // decrement the size
+    p_hash_index->size--,
+    p_hash_index->tombstones++;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_hash_index:
+                #ifndef NDEBUG
+                    log_error("[identity] [hash index] Null pointer provided for parameter \"p_hash_index\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_value:
+                #ifndef NDEBUG
+                    log_error("[identity] [hash index] Null pointer provided for parameter \"p_value\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int hash_index_replace ( hash_index *p_hash_index, void *p_old, void *p_new )
+{
+
+    // argument check
+    if ( NULL == p_hash_index ) goto no_hash_index;
+    if ( NULL ==        p_old ) goto no_value;
+    if ( NULL ==        p_new ) goto no_value;
+
+    // initialized data
+    size_t                    key    = (size_t) p_hash_index->pfn_key(p_old);
+    struct hash_index_slot_s *p_slot = NULL;
+
+    // error check
+    if ( key != (size_t) p_hash_index->pfn_key(p_new) ) goto different_keys;
+
+    // find the old value
+    p_slot = hash_index_slot_find(atomic_load_explicit(&p_hash_index->p_table, memory_order_relaxed), key, p_old);
+
+    // not found
+    if ( NULL == p_slot ) return 0;
+
+    // publish the new value in its place
+    atomic_store_explicit(&p_slot->p_value, p_new, memory_order_release);
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_hash_index:
+                #ifndef NDEBUG
+                    log_error("[identity] [hash index] Null pointer provided for parameter \"p_hash_index\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_value:
+                #ifndef NDEBUG
+                    log_error("[identity] [hash index] Null pointer provided for parameter \"p_old\" or \"p_new\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // hash index errors
+        {
+            different_keys:
+                #ifndef NDEBUG
+                    log_error("[identity] [hash index] Parameters \"p_old\" and \"p_new\" have different keys in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int hash_index_build ( hash_index *p_hash_index, void **pp_values, size_t quantity )
+{
+
+    // argument check
+    if ( NULL == p_hash_index ) goto no_hash_index;
+    if ( NULL ==    pp_values && quantity ) goto no_values;
+
+    // size the table once
+    if ( 0 == hash_index_reserve(p_hash_index, p_hash_index->size + quantity) ) return 0;
+
+    // insert each value. Inserting never rehashes from here
+    for (size_t i = 0; i < quantity; i++)
+        if ( 0 == hash_index_insert(p_hash_index, pp_values[i]) ) return 0;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_hash_index:
+                #ifndef NDEBUG
+                    log_error("[identity] [hash index] Null pointer provided for parameter \"p_hash_index\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_values:
+                #ifndef NDEBUG
+                    log_error("[identity] [hash index] Null pointer provided for parameter \"pp_values\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int hash_index_traverse ( hash_index *p_hash_index, fn_hash_index_traverse *pfn_traverse )
+{
+
+    // argument check
+    if ( NULL == p_hash_index ) goto no_hash_index;
+    if ( NULL == pfn_traverse ) goto no_traverse;
+
+    // initialized data
+    struct hash_index_table_s *p_table = atomic_load_explicit(&p_hash_index->p_table, memory_order_acquire);
+
+    // visit every value
+    for (size_t i = 0; i <= p_table->mask; i++)
+    {
+
+        // initialized data
+        void *p_value = atomic_load_explicit(&p_table->_slots[i].p_value, memory_order_acquire);
+
+        // visit
+        if ( p_value && HASH_INDEX_TOMBSTONE != p_value ) (void) pfn_traverse(p_value);
+    }
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_hash_index:
+                #ifndef NDEBUG
+                    log_error("[identity] [hash index] Null pointer provided for parameter \"p_hash_index\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_traverse:
+                #ifndef NDEBUG
+                    log_error("[identity] [hash index] Null pointer provided for parameter \"pfn_traverse\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+size_t hash_index_values ( hash_index *p_hash_index, void **pp_values )
+{
+
+    // argument check
+    if ( NULL == p_hash_index ) goto no_hash_index;
+    if ( NULL ==    pp_values ) goto no_values;
+
+    // initialized data
+    struct hash_index_table_s *p_table = atomic_load_explicit(&p_hash_index->p_table, memory_order_acquire);
+    size_t                     len     = 0;
+
+    // copy every value
+    for (size_t i = 0; i <= p_table->mask; i++)
+    {
+
+        // initialized data
+        void *p_value = atomic_load_explicit(&p_table->_slots[i].p_value, memory_order_acquire);
+
+        // copy
+        if ( p_value && HASH_INDEX_TOMBSTONE != p_value ) pp_values[len++] = p_value;
+    }
+
+    // done
+    return len;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_hash_index:
+                #ifndef NDEBUG
+                    log_error("[identity] [hash index] Null pointer provided for parameter \"p_hash_index\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_values:
+                #ifndef NDEBUG
+                    log_error("[identity] [hash index] Null pointer provided for parameter \"pp_values\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int hash_index_destroy ( hash_index **pp_hash_index )
+{
+
+    // argument check
+    if ( NULL == pp_hash_index ) goto no_hash_index;
+
+    // initialized data
+    hash_index *p_hash_index = *pp_hash_index;
+
+    // no more pointer for caller
+    *pp_hash_index = NULL;
+
+    // release the table. The owner has already waited out the readers
+    if ( p_hash_index ) hash_index_table_free(atomic_load_explicit(&p_hash_index->p_table, memory_order_relaxed));
+
+    // release the hash index
+    p_hash_index = default_allocator(p_hash_index, 0);
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_hash_index:
+                #ifndef NDEBUG
+                    log_error("[identity] [hash index] Null pointer provided for parameter \"pp_hash_index\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
@@ -0,0 +1,328 @@
+/** !
+ * Hex
+ *
+ * @file src/hex.c
+ *
+ * @author Jacob Smith
+ */
+
+// header
+#include <identity/hex.h>
+
+// x86-64 kernels
+#if defined(__x86_64__) && ( defined(__GNUC__) || defined(__clang__) )
+    #include <immintrin.h>
+    #define HEX_X86_64
+    #define HEX_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+// type definitions
+typedef size_t (fn_hex_encode)( const unsigned char *p_bytes, size_t len, char *p_hex );
+typedef int    (fn_hex_decode)( const char *p_hex, size_t hex_len, unsigned char *p_bytes );
+
+// structure definitions
+struct hex_kernels_s
+{
+    const char    *p_name;
+    fn_hex_encode *pfn_encode; // whole blocks only. Returns the bytes encoded
+    fn_hex_decode *pfn_decode; // whole blocks only. Returns the bytes decoded, or -1 on a non hex character
+};
+
+// data
+//
+// The value of each hex character, plus one, so that zero means not hex
+static const unsigned char _hex_values[256] =
+{
+    ['0'] =  1, ['1'] =  2, ['2'] =  3, ['3'] =  4, ['4'] =  5,
+    ['5'] =  6, ['6'] =  7, ['7'] =  8, ['8'] =  9, ['9'] = 10,
+    ['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+    ['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16
+};
+static const char           _hex_digits[16] = "0123456789abcdef";
+static struct hex_kernels_s _hex_kernels    = { 0 };
+static once_flag            _hex_resolved   = ONCE_FLAG_INIT;
+
+// function declarations
+void hex_resolve ( void );
+
+size_t hex_encode_scalar ( const unsigned char *p_bytes, size_t len, char *p_hex )
+{
+
+    // convert each byte into a pair of characters
+    for (size_t i = 0; i < len; i++)
+        p_hex[2 * i]     = _hex_digits[p_bytes[i] >> 4],
+        p_hex[2 * i + 1] = _hex_digits[p_bytes[i] & 0xf];
+
+    // done
+    return len;
+}
+
+int hex_decode_scalar ( const char *p_hex, size_t hex_len, unsigned char *p_bytes )
+{
+
+    // initialized data
+    unsigned char invalid = 0;
+
+    // convert each pair of characters into a byte. Check once at the end, so
+    // the loop has no branch per character
+    for (size_t i = 0; i < hex_len / 2; i++)
+    {
+        unsigned char hi = _hex_values[(unsigned char) p_hex[2 * i]],
+                      lo = _hex_values[(unsigned char) p_hex[2 * i + 1]];
+
+        invalid   |= (unsigned char) ( ( 0 == hi ) | ( 0 == lo ) );
+        p_bytes[i] = (unsigned char) ( ( (unsigned) ( hi - 1 ) << 4 ) | ( (unsigned) ( lo - 1 ) & 0xf ) );
+    }
+
+    // done
+    return ( invalid ) ? -1 : (int) ( hex_len / 2 );
+}
+
+#ifdef HEX_X86_64
+
+size_t hex_encode_sse2 ( const unsigned char *p_bytes, size_t len, char *p_hex )
+{
+
+    // initialized data
+    const __m128i nibble = _mm_set1_epi8(0x0f),
+                  nine   = _mm_set1_epi8(9),
+                  zero   = _mm_set1_epi8('0'),
+                  letter = _mm_set1_epi8('a' - '0' - 10);
+    size_t        i      = 0;
+
+    // 16 bytes into 32 characters
+    for (; i + 16 <= len; i += 16)
+    {
+
+        // split each byte into its nibbles, high nibble first
+        __m128i b  = _mm_loadu_si128((const __m128i *) &p_bytes[i]),
+                hi = _mm_and_si128(_mm_srli_epi16(b, 4), nibble),
+                lo = _mm_and_si128(b, nibble),
+                n0 = _mm_unpacklo_epi8(hi, lo),
+                n1 = _mm_unpackhi_epi8(hi, lo);
+
+        // nibbles into digits. Past 9, skip to 'a'
+        n0 = _mm_add_epi8(_mm_add_epi8(n0, zero), _mm_and_si128(_mm_cmpgt_epi8(n0, nine), letter));
+        n1 = _mm_add_epi8(_mm_add_epi8(n1, zero), _mm_and_si128(_mm_cmpgt_epi8(n1, nine), letter));
+
+        // store
+        _mm_storeu_si128((__m128i *) &p_hex[2 * i]     , n0);
+        _mm_storeu_si128((__m128i *) &p_hex[2 * i + 16], n1);
+    }
+
+    // done
+    return i;
+}
+
+int hex_decode_sse2 ( const char *p_hex, size_t hex_len, unsigned char *p_bytes )
+{
+
+    // initialized data
+    const __m128i case_bit = _mm_set1_epi8(0x20),
+                  below_0  = _mm_set1_epi8('0' - 1),
+                  above_9  = _mm_set1_epi8('9' + 1),
+                  below_a  = _mm_set1_epi8('a' - 1),
+                  above_f  = _mm_set1_epi8('f' + 1),
+                  zero     = _mm_set1_epi8('0'),
+                  letter   = _mm_set1_epi8('a' - 10),
+                  low_byte = _mm_set1_epi16(0x00ff);
+    __m128i       valid    = _mm_set1_epi8(-1);
+    size_t        i        = 0;
+
+    // 32 characters into 16 bytes
+    for (; i + 32 <= hex_len; i += 32)
+    {
+
+        // initialized data
+        __m128i _values[2];
+
+        for (size_t j = 0; j < 2; j++)
+        {
+
+            // classify. Bytes past 0x7f are negative, so they are neither
+            __m128i c     = _mm_loadu_si128((const __m128i *) &p_hex[i + 16 * j]),
+                    lower = _mm_or_si128(c, case_bit),
+                    digit = _mm_and_si128(_mm_cmpgt_epi8(c, below_0), _mm_cmplt_epi8(c, above_9)),
+                    alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, below_a), _mm_cmplt_epi8(lower, above_f));
+
+            // remember any character that is neither
+            valid = _mm_and_si128(valid, _mm_or_si128(digit, alpha));
+
+            // characters into nibbles
+            _values[j] = _mm_or_si128(_mm_and_si128(digit, _mm_sub_epi8(c, zero)), _mm_andnot_si128(digit, _mm_sub_epi8(lower, letter)));
+
+            // pairs of nibbles into bytes, one per 16 bit lane
+            _values[j] = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(_values[j], low_byte), 4), _mm_srli_epi16(_values[j], 8));
+        }
+
+        // store
+        _mm_storeu_si128((__m128i *) &p_bytes[i / 2], _mm_packus_epi16(_values[0], _values[1]));
+    }
+
+    // done
+    return ( 0xffff == _mm_movemask_epi8(valid) ) ? (int) ( i / 2 ) : -1;
+}
+
+HEX_TARGET_AVX2 size_t hex_encode_avx2 ( const unsigned char *p_bytes, size_t len, char *p_hex )
+{
+
+    // initialized data
+    const __m256i nibble = _mm256_set1_epi8(0x0f),
+                  nine   = _mm256_set1_epi8(9),
+                  zero   = _mm256_set1_epi8('0'),
+                  letter = _mm256_set1_epi8('a' - '0' - 10);
+    size_t        i      = 0;
+
+    // 32 bytes into 64 characters
+    for (; i + 32 <= len; i += 32)
+    {
+
+        // split each byte into its nibbles, high nibble first. Unpacking
+        // stays within each 128 bit lane, so put the lanes back in order
+        __m256i b  = _mm256_loadu_si256((const __m256i *) &p_bytes[i]),
+                hi = _mm256_and_si256(_mm256_srli_epi16(b, 4), nibble),
+                lo = _mm256_and_si256(b, nibble),
+                u0 = _mm256_unpacklo_epi8(hi, lo),
+                u1 = _mm256_unpackhi_epi8(hi, lo),
+                n0 = _mm256_permute2x128_si256(u0, u1, 0x20),
+                n1 = _mm256_permute2x128_si256(u0, u1, 0x31);
+
+        // nibbles into digits. Past 9, skip to 'a'
+        n0 = _mm256_add_epi8(_mm256_add_epi8(n0, zero), _mm256_and_si256(_mm256_cmpgt_epi8(n0, nine), letter));
+        n1 = _mm256_add_epi8(_mm256_add_epi8(n1, zero), _mm256_and_si256(_mm256_cmpgt_epi8(n1, nine), letter));
+
+        // store
+        _mm256_storeu_si256((__m256i *) &p_hex[2 * i]     , n0);
+        _mm256_storeu_si256((__m256i *) &p_hex[2 * i + 32], n1);
+    }
+
+    // the rest, 16 at a time
+    return i + hex_encode_sse2(&p_bytes[i], len - i, &p_hex[2 * i]);
+}
+
+HEX_TARGET_AVX2 int hex_decode_avx2 ( const char *p_hex, size_t hex_len, unsigned char *p_bytes )
+{
+
+    // initialized data
+    const __m256i case_bit = _mm256_set1_epi8(0x20),
+                  below_0  = _mm256_set1_epi8('0' - 1),
+                  above_9  = _mm256_set1_epi8('9' + 1),
+                  below_a  = _mm256_set1_epi8('a' - 1),
+                  above_f  = _mm256_set1_epi8('f' + 1),
+                  zero     = _mm256_set1_epi8('0'),
+                  letter   = _mm256_set1_epi8('a' - 10),
+                  low_byte = _mm256_set1_epi16(0x00ff);
+    __m256i       valid    = _mm256_set1_epi8(-1);
+    size_t        i        = 0;
+    int           rest     = 0;
+
+    // 64 characters into 32 bytes
+    for (; i + 64 <= hex_len; i += 64)
+    {
+
+        // initialized data
+        __m256i _values[2];
+
+        for (size_t j = 0; j < 2; j++)
+        {
+
+            // classify. Bytes past 0x7f are negative, so they are neither
+            __m256i c     = _mm256_loadu_si256((const __m256i *) &p_hex[i + 32 * j]),
+                    lower = _mm256_or_si256(c, case_bit),
+                    digit = _mm256_and_si256(_mm256_cmpgt_epi8(c, below_0), _mm256_cmpgt_epi8(above_9, c)),
+                    alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, below_a), _mm256_cmpgt_epi8(above_f, lower));
+
+            // remember any character that is neither
+            valid = _mm256_and_si256(valid, _mm256_or_si256(digit, alpha));
+
+            // characters into nibbles
+            _values[j] = _mm256_blendv_epi8(_mm256_sub_epi8(lower, letter), _mm256_sub_epi8(c, zero), digit);
+
+            // pairs of nibbles into bytes, one per 16 bit lane
+            _values[j] = _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(_values[j], low_byte), 4), _mm256_srli_epi16(_values[j], 8));
+        }
+
+        // packing stays within each 128 bit lane, so put the lanes back in order
+        _mm256_storeu_si256((__m256i *) &p_bytes[i / 2], _mm256_permute4x64_epi64(_mm256_packus_epi16(_values[0], _values[1]), 0xd8));
+    }
+
+    // error check
+    if ( -1 != _mm256_movemask_epi8(valid) ) return -1;
+
+    // the rest, 32 at a time
+    rest = hex_decode_sse2(&p_hex[i], hex_len - i, &p_bytes[i / 2]);
+
+    // done
+    return ( rest < 0 ) ? -1 : (int) ( i / 2 ) + rest;
+}
+
+#endif
+
+void hex_resolve ( void )
+{
+
+    // the portable kernels
+    _hex_kernels = (struct hex_kernels_s) { "scalar", hex_encode_scalar, hex_decode_scalar };
+
+    #ifdef HEX_X86_64
+
+        // every x86-64 processor has SSE2
+        _hex_kernels = (struct hex_kernels_s) { "sse2", hex_encode_sse2, hex_decode_sse2 };
+
+        // most have AVX2
+        __builtin_cpu_init();
+        if ( __builtin_cpu_supports("avx2") )
+            _hex_kernels = (struct hex_kernels_s) { "avx2", hex_encode_avx2, hex_decode_avx2 };
+    #endif
+}
+
+size_t hex_encode ( const unsigned char *p_bytes, size_t len, char *p_hex )
+{
+
+    // initialized data
+    size_t done = 0;
+
+    // pick the kernels
+    call_once(&_hex_resolved, hex_resolve);
+
+    // whole blocks
+    done = _hex_kernels.pfn_encode(p_bytes, len, p_hex);
+
+    // the tail
+    (void) hex_encode_scalar(&p_bytes[done], len - done, &p_hex[2 * done]);
+
+    // done
+    return 2 * len;
+}
+
+int hex_decode ( const char *p_hex, size_t hex_len, unsigned char *p_bytes )
+{
+
+    // initialized data
+    int done = 0;
+
+    // error check
+    if ( hex_len % 2 ) return 0;
+
+    // pick the kernels
+    call_once(&_hex_resolved, hex_resolve);
+
+    // whole blocks
+    done = _hex_kernels.pfn_decode(p_hex, hex_len, p_bytes);
+
+    // error check
+    if ( done < 0 ) return 0;
+
+    // the tail
+    return 0 <= hex_decode_scalar(&p_hex[2 * (size_t) done], hex_len - 2 * (size_t) done, &p_bytes[done]);
+}
+
+const char *hex_kernel_name ( void )
+{
+
+    // pick the kernels
+    call_once(&_hex_resolved, hex_resolve);
+
+    // done
+    return _hex_kernels.p_name;
+}
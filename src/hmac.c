@@ -0,0 +1,111 @@
+/** !
+ * HMAC
+ *
+ * @file src/hmac.c
+ *
+ * @author Jacob Smith
+ */
+
+// header
+#include <identity/hmac.h>
+
+void hmac_key_construct ( hmac_key *p_key, const void *p_secret, size_t len )
+{
+
+    // initialized data
+    unsigned char _block[HMAC_BLOCK_SIZE] = { 0 };
+    unsigned char _pad[HMAC_BLOCK_SIZE]   = { 0 };
+
+    // a key longer than a block is hashed, and a shorter one is padded with zeros
+    if ( HMAC_BLOCK_SIZE < len )
+    {
+
+        // initialized data
+        sha256_state _state = { 0 };
+
+        // hash the key
+        sha256_construct(&_state),
+        sha256_update(&_state, p_secret, len),
+        sha256_final(&_state, _block);
+    }
+    else memcpy(_block, p_secret, len);
+
+    // absorb the key XOR the inner pad
+    for (size_t i = 0; i < HMAC_BLOCK_SIZE; i++) _pad[i] = _block[i] ^ 0x36;
+    sha256_construct(&p_key->_inner),
+    sha256_update(&p_key->_inner, _pad, HMAC_BLOCK_SIZE);
+
+    // absorb the key XOR the outer pad
+    for (size_t i = 0; i < HMAC_BLOCK_SIZE; i++) _pad[i] = _block[i] ^ 0x5c;
+    sha256_construct(&p_key->_outer),
+    sha256_update(&p_key->_outer, _pad, HMAC_BLOCK_SIZE);
+
+    // forget the key
+    memset(_block, 0, sizeof(_block)),
+    memset(_pad  , 0, sizeof(_pad));
+}
+
+void hmac_sha256 ( const hmac_key *p_key, const void *p_message, size_t len, sha256_hash mac )
+{
+
+    // initialized data
+    sha256_state _state = p_key->_inner;
+    sha256_hash  _inner = { 0 };
+
+    // H((K ^ ipad) || message)
+    sha256_update(&_state, p_message, len),
+    sha256_final(&_state, _inner);
+
+    // H((K ^ opad) || inner)
+    _state = p_key->_outer;
+    sha256_update(&_state, _inner, sizeof(sha256_hash)),
+    sha256_final(&_state, mac);
+}
+
+void hmac_pbkdf2 ( const void *p_password, size_t password_len, const void *p_salt, size_t salt_len, uint32_t iterations, sha256_hash derived )
+{
+
+    // initialized data
+    static const unsigned char _block_index[4] = { 0, 0, 0, 1 };
+    hmac_key                   _key            = { 0 };
+    sha256_state               _state          = { 0 };
+    sha256_hash                _u              = { 0 };
+
+    // absorb the password once, for every iteration
+    hmac_key_construct(&_key, p_password, password_len);
+
+    // U1 = HMAC(password, salt || INT(1)). One block covers a 32 byte key
+    _state = _key._inner;
+    sha256_update(&_state, p_salt, salt_len),
+    sha256_update(&_state, _block_index, sizeof(_block_index)),
+    sha256_final(&_state, _u);
+    _state = _key._outer;
+    sha256_update(&_state, _u, sizeof(sha256_hash)),
+    sha256_final(&_state, _u);
+
+    // T = U1 ^ U2 ^ ... ^ Un, where Ui = HMAC(password, Ui-1)
+    memcpy(derived, _u, sizeof(sha256_hash));
+    for (uint32_t i = 1; i < iterations; i++)
+    {
+        hmac_sha256(&_key, _u, sizeof(sha256_hash), _u);
+        for (size_t j = 0; j < sizeof(sha256_hash); j++) derived[j] ^= _u[j];
+    }
+
+    // forget the key
+    memset(&_key, 0, sizeof(_key)),
+    memset(_u   , 0, sizeof(_u));
+}
+
+bool hmac_equals ( const unsigned char *a, const unsigned char *b )
+{
+
+    // initialized data
+    volatile unsigned char difference = 0;
+
+    // compare every byte, so the time taken says nothing about where the macs differ
+    for (size_t i = 0; i < sizeof(sha256_hash); i++)
+        difference |= a[i] ^ b[i];
+
+    // done
+    return 0 == difference;
+}
@@ -9,130 +9,3191 @@
 // header
 #include <identity/identity.h>
 
+// standard library
+#include <assert.h>
+#include <unistd.h>
+
+// a session token travels the wire as is
+static_assert(PROTOCOL_TOKEN_SIZE == SESSION_TOKEN_SIZE, "protocol and session tokens differ in size");
+
+// a tagged reply fits where an untagged one does
+static_assert(sizeof(protocol_binary_reply) == PROTOCOL_REPLY_HEADER_SIZE, "the reply header is not packed");
+static_assert(PROTOCOL_REPLY_HEADER_SIZE + 2 + TOKEN_SIZE_MAX <= EVENT_LOOP_RESPONSE_MAX, "a tagged reply overflows a response");
+
 // structure definitions
 struct identity_s
 {
     bool running;
 
-    binary_tree *p_users;
-    binary_tree *p_orgs;
-    binary_tree *p_roles;
-    binary_tree *p_groups;
-    binary_tree *p_reverse_users;
-
+    hash_index  *p_users;
+    hash_index  *p_user_names;
+    hash_index  *p_tenants;    // org id -> tenant, the records of one org in indices of their own
+    hash_index  *p_orgs;
+    hash_index  *p_roles;
+    hash_index  *p_groups;
+    snapshot     _snapshot;    // the mapped snapshot the records live in, if any
+    wal         *p_wal;        // the write ahead log, if any
+    uint64_t     sequence;     // the last log record applied before the log was opened
+    bool         loading;      // a bulk load is running, so permissions compile once at the end
+    replication_primary *p_primary; // ships every logged record to replicas, or null
+    replication_replica *p_replica; // follows a primary, or null
+    hash_index  *_p_stale[WAL_RECORD_QUANTITY]; // during a snapshot, the held records it has not sent yet
+
+    permission_matcher *p_permissions; // every role permission, compiled
+    effective          *p_effective;   // every user's permissions, as one set each
+    auth_cache         *p_auth_cache;  // recent verdicts, or null
+    session_table      *p_sessions;    // live session tokens, or null
+    token_keyring      *p_keyring;     // keys that sign and verify tokens
+    password_pool      *p_password_pool; // threads that stretch passwords, or null
+    mutex        _write_lock;  // serializes mutations, so the log is in the order they were applied
+
+    identity_config  _config;
     thread_pool     *p_thread_pool;
+    semaphore        _queue_slots;
     socket_tcp       _socket;
+    event_loop      *_p_event_loops[IDENTITY_ACCEPTOR_MAX];
+    parallel_thread *_p_acceptor_threads[IDENTITY_ACCEPTOR_MAX];
     parallel_thread *p_listener_thread;
 };
 
-int identity_server_accept( socket_tcp _socket_tcp, socket_ip_address ip_address, socket_port port_number, identity *p_identity )
+// Each worker parses requests in its own arena, so the request path never
+// calls the allocator once the arena exists
+static _Thread_local arena *p_request_arena = NULL;
+
+struct identity_connection_s
+{
+    identity  *p_identity;
+    socket_tcp _socket;
+    size_t     read_len;
+    size_t     write_len;
+    char       _read [IDENTITY_CONNECTION_BUFFER];
+    char       _write[IDENTITY_CONNECTION_BUFFER];
+};
+
+int identity_frame_length ( identity *p_identity, const char *p_buffer, size_t len, size_t *p_frame_len )
+{
+
+    // unused
+    (void) p_identity;
+
+    // done
+    return protocol_frame_length(p_buffer, len, p_frame_len);
+}
+
+bool identity_user_name_match ( const user *p_user, const protocol_credential *p_credential )
+{
+
+    // done
+    return user_name_equals(p_user, p_credential->p_name, p_credential->name_len);
+}
+
+int identity_authenticate_users ( identity *p_identity, const protocol_credential *_credentials, size_t count, unsigned char *_statuses, user **_p_users )
 {
 
     // initialized data
-    size_t      len      = 0;
-    char       *p_buffer = 0;
-    json_value *p_value  = 0;
-    user       *p_maybe_user = NULL;
+    hash64                   _name_hashes[PROTOCOL_BATCH_MAX] = { 0 };
+    uint64_t                 _generations[PROTOCOL_BATCH_MAX] = { 0 };
+    bool                     _cached[PROTOCOL_BATCH_MAX]      = { 0 };
+    size_t                   _costly[PROTOCOL_BATCH_MAX]      = { 0 };
+    const user              *_p_costly_users[PROTOCOL_BATCH_MAX];
+    const unsigned char     *_costly_digests[PROTOCOL_BATCH_MAX];
+    enum password_verdict_e  _verdicts[PROTOCOL_BATCH_MAX];
+    size_t                   costly_len                       = 0;
 
-    // log the connection
-    log_info("[identity] Accepted incoming connection from %hhu.%hhu.%hhu.%hhu:%hu\n", 
-            (ip_address >> 24) & 0xFF, 
-            (ip_address >> 16) & 0xFF, 
-            (ip_address >>  8) & 0xFF, 
-            (ip_address >>  0) & 0xFF, 
-            
-            port_number
-    );
+    // error check
+    if ( PROTOCOL_BATCH_MAX < count ) return 0;
+
+    // answer retried credentials from the cache
+    if ( p_identity->p_auth_cache )
+        for (size_t i = 0; i < count; i++)
+            switch ( auth_cache_lookup(p_identity->p_auth_cache, _credentials[i].p_name, _credentials[i].name_len, _credentials[i]._digest, &_p_users[i], &_generations[i]) )
+            {
+                case AUTH_CACHE_ALLOW: _statuses[i] = PROTOCOL_STATUS_OKAY  , _cached[i] = true; break;
+                case AUTH_CACHE_DENY:  _statuses[i] = PROTOCOL_STATUS_DENIED, _cached[i] = true; break;
+                default:                                                                          break;
+            }
+
+    // hash every other name
+    for (size_t i = 0; i < count; i++)
+        if ( false == _cached[i] )
+            _name_hashes[i] = user_name_hash(_credentials[i].p_name, _credentials[i].name_len);
 
-    // parse the request
+    // run every lookup back to back, while the index is hot in cache
+    for (size_t i = 0; i < count; i++)
+        if ( false == _cached[i] && 0 == hash_index_match(p_identity->p_user_names, _name_hashes[i], &_credentials[i], (void **)&_p_users[i]) )
+            _p_users[i] = NULL;
+
+    // then check every cheap password here, and set aside the stretched ones
+    for (size_t i = 0; i < count; i++)
     {
 
-        // get the length of the request
-        socket_tcp_receive(_socket_tcp, &len, sizeof(size_t));
+        // skip cached verdicts
+        if ( _cached[i] ) continue;
 
-        // error check
-        if ( 4096 < len ) goto too_long;
+        // a stretched password goes to the password pool, never a worker
+        if ( _p_users[i] && p_identity->p_password_pool && user_password_cost(_p_users[i]) )
+        {
+            _costly[costly_len]         = i,
+            _p_costly_users[costly_len] = _p_users[i],
+            _costly_digests[costly_len] = _credentials[i]._digest,
+            costly_len++;
+            continue;
+        }
+
+        // check the password
+        _statuses[i] = ( _p_users[i] && user_password_verify(_p_users[i], _credentials[i]._digest) ) ? PROTOCOL_STATUS_OKAY : PROTOCOL_STATUS_DENIED;
+    }
+
+    // stretch the rest on the password pool, all at once
+    if ( costly_len )
+    {
+
+        // wait for the verdicts
+        (void) password_pool_verify(p_identity->p_password_pool, _p_costly_users, _costly_digests, costly_len, _verdicts);
+
+        // store the verdicts
+        for (size_t j = 0; j < costly_len; j++)
+            _statuses[_costly[j]] = ( PASSWORD_MATCH == _verdicts[j] ) ? PROTOCOL_STATUS_OKAY
+                                  : ( PASSWORD_BUSY  == _verdicts[j] ) ? PROTOCOL_STATUS_BUSY
+                                  :                                      PROTOCOL_STATUS_DENIED;
+    }
+
+    // remember the verdicts. Busy is not a verdict
+    if ( p_identity->p_auth_cache )
+        for (size_t i = 0; i < count; i++)
+            if ( false == _cached[i] && PROTOCOL_STATUS_BUSY != _statuses[i] )
+                (void) auth_cache_insert(p_identity->p_auth_cache, _credentials[i].p_name, _credentials[i].name_len, _credentials[i]._digest, ( PROTOCOL_STATUS_OKAY == _statuses[i] ) ? _p_users[i] : NULL, _generations[i]);
+
+    // success
+    return 1;
+}
+
+int identity_authenticate ( identity *p_identity, const protocol_credential *p_credential, user **pp_user )
+{
+
+    // initialized data
+    user          *p_user = NULL;
+    unsigned char  status = PROTOCOL_STATUS_DENIED;
+
+    // authenticate one credential
+    (void) identity_authenticate_users(p_identity, p_credential, 1, &status, &p_user);
+
+    // error check
+    if ( PROTOCOL_STATUS_OKAY != status ) return 0;
+
+    // return the user to the caller
+    if ( pp_user ) *pp_user = p_user;
+
+    // success
+    return 1;
+}
+
+int identity_authenticate_batch ( identity *p_identity, const protocol_credential *_credentials, size_t count, unsigned char *_statuses )
+{
 
-        // allocate a buffer for the rest of the message
-        p_buffer = default_allocator(0, len);
-        if ( NULL == p_buffer ) goto no_mem;
+    // initialized data
+    user *_p_users[PROTOCOL_BATCH_MAX] = { 0 };
+
+    // done
+    return identity_authenticate_users(p_identity, _credentials, count, _statuses, _p_users);
+}
+
+int identity_json_credential ( protocol_json *p_value, protocol_credential *p_credential )
+{
+
+    // initialized data
+    protocol_json *p_user = protocol_json_get(p_value, "user"),
+                  *p_pass = protocol_json_get(p_value, "pass");
+
+    // error check
+    if ( NULL == p_user || PROTOCOL_JSON_STRING != p_user->type ) return 0;
+    if ( NULL == p_pass || PROTOCOL_JSON_STRING != p_pass->type ) return 0;
+    if ( 2 * sizeof(sha256_hash) != p_pass->len ) return 0;
+    if ( PROTOCOL_NAME_MAX < p_user->len ) return 0;
+
+    // store the username
+    p_credential->p_name   = p_user->p_string,
+    p_credential->name_len = p_user->len;
+
+    // convert hex string into binary sha256_hash
+    return protocol_hex_decode(p_pass->p_string, 2 * sizeof(sha256_hash), p_credential->_digest);
+}
+
+char *identity_json_string ( arena *p_arena, protocol_json *p_value )
+{
+
+    // initialized data
+    char *p_string = NULL;
+
+    // type check
+    if ( NULL == p_value || PROTOCOL_JSON_STRING != p_value->type ) return NULL;
+
+    // copy the string out of the frame, with a terminator
+    p_string = arena_alloc(p_arena, p_value->len + 1);
+
+    // error check
+    if ( NULL == p_string ) return NULL;
+
+    // copy the string
+    memcpy(p_string, p_value->p_string, p_value->len);
+    p_string[p_value->len] = '\0';
+
+    // done
+    return p_string;
+}
+
+int identity_json_token ( protocol_json *p_value, unsigned char token[SESSION_TOKEN_SIZE] )
+{
+
+    // error check
+    if ( NULL == p_value || PROTOCOL_JSON_STRING != p_value->type ) return 0;
+    if ( 2 * SESSION_TOKEN_SIZE != p_value->len ) return 0;
+
+    // convert hex string into the token
+    return protocol_hex_decode(p_value->p_string, 2 * SESSION_TOKEN_SIZE, token);
+}
+
+size_t identity_json_status_serialize ( unsigned char status, char *p_buffer )
+{
+
+    // okay
+    if ( PROTOCOL_STATUS_OKAY == status ) return memcpy(p_buffer, "\"okay\"", 6), 6;
+
+    // try again later
+    if ( PROTOCOL_STATUS_BUSY == status ) return memcpy(p_buffer, "\"busy\"", 6), 6;
+
+    // the server can not do it, like sign a token with ids that do not fit
+    if ( PROTOCOL_STATUS_UNSUPPORTED == status ) return memcpy(p_buffer, "\"unsupported\"", 13), 13;
+
+    // not okay
+    return memcpy(p_buffer, "\"not okay\"", 10), 10;
+}
+
+size_t identity_json_replication_serialize ( identity *p_identity, char *p_buffer )
+{
 
-        // receive the rest of the message
-        socket_tcp_receive(_socket_tcp, p_buffer, len);
+    // initialized data
+    replication_status _statuses[REPLICATION_REPLICAS_MAX] = { 0 };
+    size_t             quantity                            = identity_replication_status(p_identity, _statuses, REPLICATION_REPLICAS_MAX);
+    uint64_t           lag                                 = 0,
+                       sequence                            = 0;
+    int                len                                 = 0;
+
+    // a replica reports on itself
+    if ( p_identity->p_replica )
+        len = snprintf(p_buffer, IDENTITY_RESPONSE_MAX - PROTOCOL_HEADER_SIZE,
+            "{\"role\":\"replica\",\"sequence\":%llu,\"primary\":%llu,\"lag\":%llu,\"connected\":%s,\"contact_ms\":%zu}",
+            (unsigned long long) _statuses[0].applied, (unsigned long long) _statuses[0].primary, (unsigned long long) _statuses[0].lag,
+            ( _statuses[0].connected ) ? "true" : "false", _statuses[0].contact_ms
+        );
+
+    // a primary reports its slowest replica
+    else if ( p_identity->p_primary )
+    {
 
-        // parse the request
-        json_value_parse(p_buffer, 0, &p_value);
+        // find the slowest replica
+        for (size_t i = 0; i < quantity; i++)
+            if ( _statuses[i].lag > lag ) lag = _statuses[i].lag;
 
-        // print the parsed JSON value
-        json_value_print(p_value);
-        fflush(stdout);
+        // get the last sequence
+        mutex_lock(&p_identity->_write_lock);
+        sequence = ( p_identity->p_wal ) ? wal_sequence(p_identity->p_wal) : p_identity->sequence;
+        mutex_unlock(&p_identity->_write_lock);
+
+        // serialize
+        len = snprintf(p_buffer, IDENTITY_RESPONSE_MAX - PROTOCOL_HEADER_SIZE,
+            "{\"role\":\"primary\",\"sequence\":%llu,\"replicas\":%zu,\"lag\":%llu}",
+            (unsigned long long) sequence, quantity, (unsigned long long) lag
+        );
     }
 
+    // neither
+    else len = snprintf(p_buffer, IDENTITY_RESPONSE_MAX - PROTOCOL_HEADER_SIZE, "{\"role\":\"standalone\"}");
+
+    // done
+    return ( len > 0 ) ? (size_t) len : 0;
+}
+
+int identity_json_process ( identity *p_identity, char *p_frame, size_t frame_len, char *p_response )
+{
+
+    // initialized data
+    protocol_json       *p_value                          = NULL;
+    protocol_credential  _credentials[PROTOCOL_BATCH_MAX] = { 0 };
+    unsigned char        _statuses[PROTOCOL_BATCH_MAX]    = { 0 };
+    unsigned char        _token[TOKEN_SIZE_MAX]           = { 0 };
+    size_t               token_len                        = SESSION_TOKEN_SIZE;
+    protocol_json       *p_type                           = NULL;
+    size_t               count                            = 0;
+    bool                 batch                            = false,
+                         authorize                        = false,
+                         issue                            = false,
+                         validate                         = false,
+                         revoke                           = false,
+                         sign                             = false,
+                         status                           = false;
+    size_t               len                              = 0;
+
+    // construct this worker's arena on first use
+    if ( NULL == p_request_arena && 0 == arena_construct(&p_request_arena, IDENTITY_ARENA_SIZE) ) goto parse_error;
+
+    // release the previous request
+    arena_reset(p_request_arena);
+
+    // parse the request in place
+    if ( 0 == protocol_json_parse(p_request_arena, &p_frame[PROTOCOL_HEADER_SIZE], frame_len - PROTOCOL_HEADER_SIZE, &p_value) ) goto parse_error;
+
     // process the request
     {
         
-        // initialized data
-        dict *p_dict = p_value->object;
-        json_value *p_user = dict_get(p_dict, "user"),
-                   *p_pass = dict_get(p_dict, "pass");
-        char       *p_pass16 = p_pass->string;
-        sha256_hash _pass = { 0 };
-
-        // convert hex string p_pass16 into binary sha256_hash _pass
+        // type check
+        if ( PROTOCOL_JSON_OBJECT != p_value->type ) goto parse_error;
+
+        // get the request type. Untyped requests authenticate
+        p_type    = protocol_json_get(p_value, "type"),
+        batch     = protocol_json_string_equals(p_type, "batch"),
+        authorize = protocol_json_string_equals(p_type, "authorize"),
+        issue     = protocol_json_string_equals(p_type, "issue"),
+        validate  = protocol_json_string_equals(p_type, "validate"),
+        revoke    = protocol_json_string_equals(p_type, "revoke"),
+        sign      = protocol_json_string_equals(p_type, "sign"),
+        status    = protocol_json_string_equals(p_type, "status");
+
+        // batch
+        if ( batch )
         {
-            unsigned char *dst = (unsigned char *)&_pass;
 
-            for (size_t i = 0; i < sizeof(sha256_hash); i++)
+            // initialized data
+            protocol_json *p_requests = protocol_json_get(p_value, "requests");
+
+            // error check
+            if ( NULL == p_requests || PROTOCOL_JSON_ARRAY != p_requests->type ) goto parse_error;
+
+            // get the quantity of requests
+            count = p_requests->len;
+
+            // error check
+            if ( 0 == count || PROTOCOL_BATCH_MAX < count ) goto parse_error;
+
+            // parse each credential. Malformed entries are denied
             {
-            char c1 = p_pass16[2 * i];
-            char c2 = p_pass16[2 * i + 1];
+                size_t i = 0;
+                for (protocol_json *p_i = p_requests->p_first; p_i; p_i = p_i->p_next, i++)
+                    if ( 0 == identity_json_credential(p_i, &_credentials[i]) )
+                        _credentials[i] = (protocol_credential) { .p_name = "", .name_len = 0 };
+            }
+        }
+
+        // authorize
+        else if ( authorize )
+        {
 
-            int hi = (c1 >= '0' && c1 <= '9') ? (c1 - '0') :
-                 (c1 >= 'a' && c1 <= 'f') ? (c1 - 'a' + 10) :
-                 (c1 >= 'A' && c1 <= 'F') ? (c1 - 'A' + 10) : -1;
+            // initialized data
+            char *p_action   = identity_json_string(p_request_arena, protocol_json_get(p_value, "action")),
+                 *p_resource = identity_json_string(p_request_arena, protocol_json_get(p_value, "resource"));
+            user *p_user     = NULL;
 
-            int lo = (c2 >= '0' && c2 <= '9') ? (c2 - '0') :
-                 (c2 >= 'a' && c2 <= 'f') ? (c2 - 'a' + 10) :
-                 (c2 >= 'A' && c2 <= 'F') ? (c2 - 'A' + 10) : -1;
+            // parse the credential, the action and the resource
+            if ( 0 == identity_json_credential(p_value, &_credentials[0]) ) goto parse_error;
+            if ( NULL == p_action || NULL == p_resource ) goto parse_error;
 
-            if (hi < 0 || lo < 0) { log_error("[identity] Non-hex character in SHA-256 hex"); goto parse_error; }
+            // one result
+            count = 1;
 
-            dst[i] = (unsigned char)((hi << 4) | lo);
+            // authenticate, then authorize
+            _statuses[0] = ( identity_authenticate(p_identity, &_credentials[0], &p_user) && identity_authorize(p_identity, p_user, p_action, p_resource) ) ? PROTOCOL_STATUS_OKAY : PROTOCOL_STATUS_DENIED;
+
+            // done
+            goto serialize;
+        }
+
+        // issue a session token
+        else if ( issue )
+        {
+
+            // parse the credential
+            if ( 0 == identity_json_credential(p_value, &_credentials[0]) ) goto parse_error;
+
+            // one result
+            count = 1;
+
+            // authenticate, then issue
+            _statuses[0] = ( identity_session_issue(p_identity, &_credentials[0], _token) ) ? PROTOCOL_STATUS_OKAY : PROTOCOL_STATUS_DENIED;
+
+            // done
+            goto serialize;
+        }
+
+        // sign a token
+        else if ( sign )
+        {
+
+            // parse the credential
+            if ( 0 == identity_json_credential(p_value, &_credentials[0]) ) goto parse_error;
+
+            // one result
+            count = 1;
+
+            // authenticate, then sign
+            (void) identity_token_sign(p_identity, &_credentials[0], _token, &token_len, &_statuses[0]);
+
+            // done
+            goto serialize;
+        }
+
+        // report replication
+        else if ( status ) goto serialize;
+
+        // validate or revoke a session token
+        else if ( validate || revoke )
+        {
+
+            // parse the token
+            if ( 0 == identity_json_token(protocol_json_get(p_value, "token"), _token) ) goto parse_error;
+
+            // one result
+            count = 1;
+
+            // check the token, or revoke it
+            _statuses[0] = ( ( validate ) ? identity_session_validate(p_identity, _token, NULL) : identity_session_revoke(p_identity, _token) ) ? PROTOCOL_STATUS_OKAY : PROTOCOL_STATUS_DENIED;
+
+            // done
+            goto serialize;
+        }
+
+        // authenticate
+        else
+        {
+
+            // parse the credential
+            if ( 0 == identity_json_credential(p_value, &_credentials[0]) ) goto parse_error;
+
+            // one credential
+            count = 1;
+        }
+
+        // authenticate every credential
+        identity_authenticate_batch(p_identity, _credentials, count, _statuses);
+    }
+
+    // done
+    goto serialize;
+
+    // parse errors fall through to a negative response
+    parse_error:
+        #ifndef NDEBUG
+            log_error("[identity] Failed to parse request\n");
+        #endif
+        count = 1, batch = false, issue = false, sign = false, status = false, _statuses[0] = PROTOCOL_STATUS_MALFORMED;
+
+    // serialize the response
+    serialize:
+    {
+
+        // initialized data
+        char *p_offset = &p_response[PROTOCOL_HEADER_SIZE];
+
+        // the replication status
+        if ( status ) p_offset += identity_json_replication_serialize(p_identity, p_offset);
+
+        // an issued or signed token
+        else if ( ( issue || sign ) && PROTOCOL_STATUS_OKAY == _statuses[0] )
+            *p_offset++ = '"',
+            p_offset   += protocol_hex_encode(_token, token_len, p_offset),
+            *p_offset++ = '"';
+
+        // one result
+        else if ( false == batch ) p_offset += identity_json_status_serialize(_statuses[0], p_offset);
+
+        // an array of results
+        else
+        {
+            *p_offset++ = '[';
+            for (size_t i = 0; i < count; i++)
+            {
+                if ( i ) *p_offset++ = ',';
+                p_offset += identity_json_status_serialize(_statuses[i], p_offset);
             }
+            *p_offset++ = ']';
         }
-        
-        // reverse lookup
-        binary_tree_search(p_identity->p_reverse_users, &_pass, (void **)&p_maybe_user);
 
-        // get username
-        char _name[64+1] = { 0 };
-        user_name_get(p_maybe_user, _name);
+        // compute the length
+        len = (size_t)(p_offset - &p_response[PROTOCOL_HEADER_SIZE]);
+
+        // set the length
+        memcpy(p_response, &len, sizeof(size_t));
+    }
+
+    // success
+    return PROTOCOL_HEADER_SIZE + len;
+}
+
+int identity_binary_reply ( identity *p_identity, const protocol_binary_header *p_header, const char *p_body, size_t body_len, char *p_response )
+{
+
+    // initialized data
+    protocol_credential _credentials[PROTOCOL_BATCH_MAX] = { 0 };
+    size_t              count                            = 0;
+    size_t              token_len                        = 0;
+
+    // a newer client falls back to an older version when it sees this
+    if ( PROTOCOL_BINARY_VERSION != p_header->version ) goto unsupported;
+
+    // process the request
+    switch ( p_header->type )
+    {
+        case PROTOCOL_BINARY_AUTHENTICATE:
+
+            // parse the body
+            if ( 0 == protocol_binary_authenticate_parse(p_body, body_len, &_credentials[0]) ) goto malformed;
+
+            // authenticate. A busy pool says so, instead of denying
+            identity_authenticate_batch(p_identity, _credentials, 1, (unsigned char *) p_response);
+
+            // success
+            return 1;
+
+        case PROTOCOL_BINARY_BATCH:
+
+            // parse the body
+            if ( 0 == protocol_binary_batch_parse(p_body, body_len, _credentials, &count) ) goto malformed;
+
+            // authenticate every credential, one status byte each
+            identity_authenticate_batch(p_identity, _credentials, count, (unsigned char *) p_response);
+
+            // success
+            return (int) count;
+
+        case PROTOCOL_BINARY_ISSUE:
+
+            // error check
+            if ( NULL == p_identity->p_sessions ) goto unsupported;
+
+            // parse the body
+            if ( 0 == protocol_binary_authenticate_parse(p_body, body_len, &_credentials[0]) ) goto malformed;
+
+            // authenticate, then issue. The token follows the status
+            if ( 0 == identity_session_issue(p_identity, &_credentials[0], (unsigned char *) &p_response[1]) ) return ( *p_response = PROTOCOL_STATUS_DENIED, 1 );
+
+            // reply
+            *p_response = PROTOCOL_STATUS_OKAY;
+
+            // success
+            return 1 + PROTOCOL_TOKEN_SIZE;
+
+        case PROTOCOL_BINARY_SIGN:
+
+            // parse the body
+            if ( 0 == protocol_binary_authenticate_parse(p_body, body_len, &_credentials[0]) ) goto malformed;
+
+            // authenticate, then sign. The length and the token follow the status
+            if ( 0 == identity_token_sign(p_identity, &_credentials[0], (unsigned char *) &p_response[2], &token_len, (unsigned char *) p_response) ) return 1;
+
+            // reply
+            p_response[0] = PROTOCOL_STATUS_OKAY,
+            p_response[1] = (char) token_len;
+
+            // success
+            return (int) ( 2 + token_len );
+
+        case PROTOCOL_BINARY_VALIDATE:
+        case PROTOCOL_BINARY_REVOKE:
+
+            // error check
+            if ( NULL == p_identity->p_sessions ) goto unsupported;
+
+            // the body is the token
+            if ( PROTOCOL_TOKEN_SIZE != body_len ) goto malformed;
+
+            // check the token, or revoke it
+            if ( PROTOCOL_BINARY_VALIDATE == p_header->type ) *p_response = ( identity_session_validate(p_identity, (const unsigned char *) p_body, NULL) ) ? PROTOCOL_STATUS_OKAY : PROTOCOL_STATUS_DENIED;
+            else                                            *p_response = ( identity_session_revoke  (p_identity, (const unsigned char *) p_body      ) ) ? PROTOCOL_STATUS_OKAY : PROTOCOL_STATUS_DENIED;
+
+            // success
+            return 1;
+
+        default:
+            goto unsupported;
+    }
+
+    // error handling
+    {
+
+        // protocol errors
+        {
+            malformed:
+
+                // reply
+                *p_response = PROTOCOL_STATUS_MALFORMED;
+
+                // done
+                return 1;
+
+            unsupported:
+
+                // reply
+                *p_response = PROTOCOL_STATUS_UNSUPPORTED;
+
+                // done
+                return 1;
+        }
+    }
+}
+
+int identity_binary_process ( identity *p_identity, char *p_frame, size_t frame_len, char *p_response )
+{
+
+    // initialized data
+    protocol_binary_header  _header  = { 0 };
+    protocol_binary_reply   _reply   = { 0 };
+    const char             *p_body   = &p_frame[PROTOCOL_HEADER_SIZE];
+    size_t                  body_len = frame_len - PROTOCOL_HEADER_SIZE;
+    int                     len      = 0;
+
+    // get the header
+    memcpy(&_header, p_frame, sizeof(_header));
+
+    // fast exit
+    if ( 0 == ( _header.flags & PROTOCOL_BINARY_FLAG_TAGGED ) ) return identity_binary_reply(p_identity, &_header, p_body, body_len, p_response);
+
+    // error check
+    if ( sizeof(_reply.id) > body_len ) goto malformed;
+
+    // the request id leads the body
+    memcpy(&_reply.id, p_body, sizeof(_reply.id));
+
+    // reply after the header
+    len = identity_binary_reply(p_identity, &_header, p_body + sizeof(_reply.id), body_len - sizeof(_reply.id), &p_response[PROTOCOL_REPLY_HEADER_SIZE]);
+
+    // frame the reply with the request id
+    _reply.length = (uint16_t) len;
+    memcpy(p_response, &_reply, sizeof(_reply));
+
+    // success
+    return PROTOCOL_REPLY_HEADER_SIZE + len;
+
+    // error handling
+    {
+
+        // protocol errors
+        {
+            malformed:
+
+                // reply with id 0, so the client stays in step though it can not match it
+                _reply.length = 1;
+                memcpy(p_response, &_reply, sizeof(_reply));
+                p_response[PROTOCOL_REPLY_HEADER_SIZE] = PROTOCOL_STATUS_MALFORMED;
+
+                // done
+                return PROTOCOL_REPLY_HEADER_SIZE + 1;
+        }
+    }
+}
+
+int identity_request_process ( identity *p_identity, char *p_frame, size_t frame_len, char *p_response )
+{
+
+    // initialized data
+    int result = 0;
+
+    // read the store without locks
+    epoch_enter();
+
+    // binary frames carry a magic instead of a length, and everything else is JSON
+    result = ( protocol_frame_is_binary(p_frame) ) ? identity_binary_process(p_identity, p_frame, frame_len, p_response)
+                                                    : identity_json_process  (p_identity, p_frame, frame_len, p_response);
+
+    // done reading
+    epoch_exit();
+
+    // done
+    return result;
+}
+
+int identity_connection_flush ( struct identity_connection_s *p_connection )
+{
+
+    // fast exit
+    if ( 0 == p_connection->write_len ) return 1;
+
+    // send every buffered response in one call
+    if ( 0 == socket_tcp_send(p_connection->_socket, p_connection->_write, p_connection->write_len) ) goto failed_to_send;
+
+    // reset the write buffer
+    p_connection->write_len = 0;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // socket errors
+        {
+            failed_to_send:
+                #ifndef NDEBUG
+                    log_error("[identity] Failed to send response in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int identity_connection_serve ( identity *p_identity, struct identity_connection_s *p_connection )
+{
+
+    // serve requests until the client hangs up
+    while ( p_identity->running )
+    {
+
+        // initialized data
+        size_t offset   = 0;
+        int    received = socket_tcp_receive(
+            p_connection->_socket,
+            &p_connection->_read[p_connection->read_len],
+            sizeof(p_connection->_read) - p_connection->read_len
+        );
+
+        // the client hung up
+        if ( 0 >= received ) break;
+
+        // accumulate
+        p_connection->read_len += (size_t) received;
+
+        // serve every complete request in the buffer
+        while ( offset < p_connection->read_len )
+        {
+
+            // initialized data
+            size_t frame_len = 0;
+
+            // measure the request
+            if ( 0 == identity_frame_length(p_identity, &p_connection->_read[offset], p_connection->read_len - offset, &frame_len) ) goto bad_frame;
+
+            // wait for the rest of a partial request
+            if ( 0 == frame_len || p_connection->read_len - offset < frame_len ) break;
+
+            // make room for the response
+            if ( sizeof(p_connection->_write) - p_connection->write_len < IDENTITY_RESPONSE_MAX )
+                if ( 0 == identity_connection_flush(p_connection) ) goto failed_to_send;
+
+            // process the request
+            p_connection->write_len += identity_request_process(
+                p_identity,
+                &p_connection->_read[offset],
+                frame_len,
+                &p_connection->_write[p_connection->write_len]
+            );
+
+            // next request
+            offset += frame_len;
+        }
+
+        // shift the partial request to the front of the buffer
+        memmove(p_connection->_read, &p_connection->_read[offset], p_connection->read_len - offset);
+        p_connection->read_len -= offset;
+
+        // send every response for this batch of pipelined requests
+        if ( 0 == identity_connection_flush(p_connection) ) goto failed_to_send;
+    }
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // protocol errors
+        {
+            bad_frame:
+
+                // error
+                return 0;
+        }
+
+        // socket errors
+        {
+            failed_to_send:
+
+                // error
+                return 0;
+        }
+    }
+}
+
+void *identity_connection_task ( struct identity_connection_s *p_connection )
+{
+
+    // initialized data
+    identity *p_identity = p_connection->p_identity;
+
+    // serve pipelined requests on this connection until it closes
+    (void) identity_connection_serve(p_identity, p_connection);
+
+    // release the connection
+    socket_tcp_destroy(&p_connection->_socket);
+    p_connection = default_allocator(p_connection, 0);
+
+    // free a queue slot for the listener
+    semaphore_signal(&p_identity->_queue_slots);
+
+    // done
+    return NULL;
+}
+
+int identity_server_accept( socket_tcp _socket_tcp, socket_ip_address ip_address, socket_port port_number, identity *p_identity )
+{
+
+    // initialized data
+    struct identity_connection_s *p_connection = NULL;
+
+    // log the connection
+    log_info("[identity] Accepted incoming connection from %hhu.%hhu.%hhu.%hhu:%hu\n", 
+            (ip_address >> 24) & 0xFF, 
+            (ip_address >> 16) & 0xFF, 
+            (ip_address >>  8) & 0xFF, 
+            (ip_address >>  0) & 0xFF, 
+            
+            port_number
+    );
+
+    // wait for a queue slot. This blocks the listener while every worker
+    // is busy and the queue is full, so excess connections wait in the
+    // kernel's accept backlog instead of piling up in memory
+    semaphore_wait(&p_identity->_queue_slots);
+
+    // allocate a connection
+    p_connection = default_allocator(0, sizeof(struct identity_connection_s));
+
+    // error check
+    if ( NULL == p_connection ) goto no_mem;
+
+    // populate the connection
+    p_connection->p_identity = p_identity;
+    p_connection->_socket    = _socket_tcp;
+    p_connection->read_len   = 0;
+    p_connection->write_len  = 0;
+
+    // hand the connection to a worker
+    if ( 0 == thread_pool_execute(p_identity->p_thread_pool, (fn_thread_pool_task *)identity_connection_task, p_connection) ) goto failed_to_dispatch;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // thread pool errors
+        {
+            failed_to_dispatch:
+                #ifndef NDEBUG
+                    log_error("[identity] Failed to dispatch connection in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // release the connection
+                p_connection = default_allocator(p_connection, 0);
+
+                // fall through
+                goto release;
+        }
+
+        // standard library errors
+        {
+            no_mem:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+            release:
+
+                // release the socket and the queue slot
+                socket_tcp_destroy(&_socket_tcp);
+                semaphore_signal(&p_identity->_queue_slots);
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int identity_listener ( identity *p_identity )
+{
+
+    // log a message
+    log_info("[identity] Listening for incoming connections...\n");
+
+    // listen for incoming connections
+    while ( p_identity->running )
+        socket_tcp_listen(p_identity->_socket, (fn_socket_tcp_accept *)identity_server_accept, p_identity);
+
+    return 0;
+}
+
+int identity_construct
+(
+    identity              **pp_identity,
+    const identity_config  *p_config
+
+    // const char *p_users_path,
+    // const char *p_orgs_path,
+    // const char *p_roles_path,
+    // const char *p_groups_path
+)
+{
+
+    // argument check
+    if ( NULL == pp_identity ) goto no_identity;
+
+    // initialized data
+    identity *p_identity = default_allocator(0, sizeof(identity));
+
+    // error check
+    if ( NULL == p_identity ) goto no_mem;
+
+    // start empty
+    memset(p_identity, 0, sizeof(identity));
+
+    // store the configuration
+    p_identity->_config = ( p_config ) ? *p_config : (identity_config) IDENTITY_CONFIG_DEFAULT;
+
+    // error check
+    if ( 0 == p_identity->_config.worker_quantity ) goto bad_config;
+    if ( 0 == p_identity->_config.acceptor_quantity || IDENTITY_ACCEPTOR_MAX < p_identity->_config.acceptor_quantity ) goto bad_config;
+
+    // construct the write lock
+    if ( 0 == mutex_create(&p_identity->_write_lock) ) goto failed_to_construct_mutex;
+
+    // construct sets
+    {
+
+        // construct organizations
+        if ( 0 == hash_index_construct(&p_identity->p_orgs  , (fn_key_accessor *) org_key_accessor  , NULL, IDENTITY_INDEX_QUANTITY) ) goto failed_to_construct_index;
+
+        // construct roles
+        if ( 0 == hash_index_construct(&p_identity->p_roles , (fn_key_accessor *) role_key_accessor , NULL, IDENTITY_INDEX_QUANTITY) ) goto failed_to_construct_index;
+
+        // construct groups
+        if ( 0 == hash_index_construct(&p_identity->p_groups, (fn_key_accessor *) group_key_accessor, NULL, IDENTITY_INDEX_QUANTITY) ) goto failed_to_construct_index;
+
+        // construct users
+        if ( 0 == hash_index_construct(&p_identity->p_users , (fn_key_accessor *) user_key_accessor , NULL, IDENTITY_INDEX_QUANTITY) ) goto failed_to_construct_index;
+
+        // construct usernames
+        if ( 0 == hash_index_construct(&p_identity->p_user_names    , (fn_key_accessor *) user_name_key_accessor    , (fn_hash_index_match *) identity_user_name_match    , IDENTITY_INDEX_QUANTITY) ) goto failed_to_construct_index;
+
+        // construct tenants
+        if ( 0 == hash_index_construct(&p_identity->p_tenants, (fn_key_accessor *) tenant_key_accessor, NULL, IDENTITY_INDEX_QUANTITY) ) goto failed_to_construct_index;
+
+        // construct effective permissions
+        if ( 0 == effective_construct(&p_identity->p_effective, p_identity->p_users, p_identity->p_groups) ) goto failed_to_construct_index;
+
+        // construct the authentication cache
+        if ( p_identity->_config.auth_cache_entries )
+            if ( 0 == auth_cache_construct(&p_identity->p_auth_cache, p_identity->_config.auth_cache_entries, p_identity->_config.auth_cache_ttl_ms, p_identity->_config.auth_cache_negative_ttl_ms) ) goto failed_to_construct_index;
+
+        // construct the session table
+        if ( p_identity->_config.sessions_max )
+            if ( 0 == session_table_construct(&p_identity->p_sessions, p_identity->_config.sessions_max, p_identity->_config.session_ttl_ms) ) goto failed_to_construct_index;
+
+        // construct the keyring. Tokens are signed once a key is added
+        if ( 0 == token_keyring_construct(&p_identity->p_keyring) ) goto failed_to_construct_index;
+
+        // construct the password pool
+        if ( p_identity->_config.verify_threads )
+            if ( 0 == password_pool_construct(&p_identity->p_password_pool, p_identity->_config.verify_threads, ( p_identity->_config.verify_in_flight ) ? p_identity->_config.verify_in_flight : p_identity->_config.verify_threads) ) goto failed_to_construct_index;
+    }
+
+    // construct networking stuff
+    {
+        
+        // construct a thread pool
+        if ( 0 == thread_pool_construct(&p_identity->p_thread_pool, p_identity->_config.worker_quantity) ) goto failed_to_construct_thread_pool;
+
+        // one slot per worker, plus one per queued connection
+        if ( 0 == semaphore_create(&p_identity->_queue_slots, (unsigned int)(p_identity->_config.worker_quantity + p_identity->_config.queue_depth)) ) goto failed_to_construct_semaphore;
+
+        // set the running flag
+        p_identity->running = true;
+
+        // construct one event loop per acceptor
+        if ( IDENTITY_LISTENER_EVENT_LOOP == p_identity->_config.listener )
+        {
+
+            // initialized data
+            size_t acceptors     = p_identity->_config.acceptor_quantity;
+            size_t in_flight_max = ( p_identity->_config.worker_quantity + p_identity->_config.queue_depth + acceptors - 1 ) / acceptors;
+            long   cpus          = sysconf(_SC_NPROCESSORS_ONLN);
+
+            for (size_t i = 0; i < acceptors; i++)
+            {
+
+                // construct the event loop. Each one owns a socket on the
+                // same port, and workers only ever see complete frames
+                if ( 0 == event_loop_construct(
+                    &p_identity->_p_event_loops[i],
+                    p_identity->_config.port,
+                    1 < acceptors,
+                    ( 1 < acceptors && 0 < cpus ) ? (int) ( i % (size_t) cpus ) : -1,
+                    p_identity->p_thread_pool,
+                    in_flight_max,
+                    (fn_event_loop_frame *)   identity_frame_length,
+                    (fn_event_loop_request *) identity_request_process,
+                    p_identity
+                ) ) goto failed_to_construct_event_loop;
+
+                // construct an event loop thread
+                if ( 0 == parallel_thread_start(&p_identity->_p_acceptor_threads[i], (fn_parallel_task *)event_loop_run, p_identity->_p_event_loops[i]) ) goto failed_to_start_event_loop;
+            }
+        }
+
+        // construct a blocking listener
+        else
+        {
+
+            // construct a socket
+            if ( 0 == socket_tcp_create(&p_identity->_socket, socket_address_family_ipv4, p_identity->_config.port) ) goto failed_to_construct_socket;
+
+            // construct a listener thread
+            if ( 0 == parallel_thread_start(&p_identity->p_listener_thread, (fn_parallel_task *)identity_listener, p_identity) ) goto failed_to_start_listener;
+        }
+    }
+
+    // return a pointer to the caller 
+    *pp_identity = p_identity;
+    
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_identity:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"pp_identity\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            bad_config:
+                #ifndef NDEBUG
+                    log_error("[identity] Parameter \"p_config\" must specify at least one worker and between 1 and %d acceptors in call to function \"%s\"", IDENTITY_ACCEPTOR_MAX, __FUNCTION__);
+                #endif
+
+                // release the identity
+                p_identity = default_allocator(p_identity, 0);
+
+                // error
+                return 0;
+           }
+    
+        // standard library errors
+        {
+            no_mem:
+                #ifndef NDEBUG
+                    log_error("[identity] Failed to allocate memory in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // performance errors
+        {
+            failed_to_construct_event_loop:
+                #ifndef NDEBUG
+                    log_error("[identity] Failed to construct event loop in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // stop the event loops that started
+                goto stop_event_loops;
+
+            failed_to_start_event_loop:
+                #ifndef NDEBUG
+                    log_error("[identity] Failed to start event loop thread in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+            stop_event_loops:
+
+                // stop every running event loop, and wait for its thread
+                for (size_t i = 0; i < IDENTITY_ACCEPTOR_MAX; i++)
+                    if ( p_identity->_p_acceptor_threads[i] ) (void) event_loop_stop(p_identity->_p_event_loops[i]);
+                for (size_t i = 0; i < IDENTITY_ACCEPTOR_MAX; i++)
+                    if ( p_identity->_p_acceptor_threads[i] ) (void) parallel_thread_join(&p_identity->_p_acceptor_threads[i]);
+
+                // release the queue slots
+                goto destroy_semaphore;
+
+            failed_to_start_listener:
+                #ifndef NDEBUG
+                    log_error("[identity] Failed to start listener thread in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // release the socket
+                (void) socket_tcp_destroy(&p_identity->_socket);
+
+                // release the queue slots
+                goto destroy_semaphore;
+
+            failed_to_construct_socket:
+                #ifndef NDEBUG
+                    log_error("[identity] Failed to construct socket in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+            destroy_semaphore:
+
+                // clear the running flag
+                p_identity->running = false;
+
+                // release the queue slots
+                (void) semaphore_destroy(&p_identity->_queue_slots);
+
+                // release the thread pool
+                goto destroy_thread_pool;
+
+            failed_to_construct_semaphore:
+                #ifndef NDEBUG
+                    log_error("[identity] Failed to construct queue semaphore in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+            destroy_thread_pool:
+
+                // release the thread pool, then the event loops its tasks point to
+                (void) thread_pool_destroy(&p_identity->p_thread_pool);
+                for (size_t i = 0; i < IDENTITY_ACCEPTOR_MAX; i++)
+                    (void) event_loop_destroy(&p_identity->_p_event_loops[i]);
+
+                // release the sets
+                goto destroy_sets;
+
+            failed_to_construct_thread_pool:
+                #ifndef NDEBUG
+                    log_error("[identity] Failed to construct thread pool in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // release the sets
+                goto destroy_sets;
+        }
+
+        // data errors
+        {
+            failed_to_construct_index:
+                #ifndef NDEBUG
+                    log_error("[identity] Failed to construct index in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+            destroy_sets:
+
+                // release the sets, in reverse order
+                (void) password_pool_destroy(&p_identity->p_password_pool);
+                (void) token_keyring_destroy(&p_identity->p_keyring);
+                (void) session_table_destroy(&p_identity->p_sessions);
+                (void) auth_cache_destroy(&p_identity->p_auth_cache);
+                (void) effective_destroy(&p_identity->p_effective);
+                (void) hash_index_destroy(&p_identity->p_tenants);
+                (void) hash_index_destroy(&p_identity->p_user_names);
+                (void) hash_index_destroy(&p_identity->p_users);
+                (void) hash_index_destroy(&p_identity->p_groups);
+                (void) hash_index_destroy(&p_identity->p_roles);
+                (void) hash_index_destroy(&p_identity->p_orgs);
+
+                // release the write lock
+                (void) mutex_destroy(&p_identity->_write_lock);
+
+                // release the identity
+                goto destroy_identity;
+        }
+
+        // sync errors
+        {
+            failed_to_construct_mutex:
+                #ifndef NDEBUG
+                    log_error("[identity] Failed to construct write lock in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+            destroy_identity:
+
+                // release the identity
+                p_identity = default_allocator(p_identity, 0);
+
+                // error
+                return 0;
+        }
+    }
+}
+
+// if ( NULL ==  p_users_path ) goto no_users_path;
+// if ( NULL ==   p_orgs_path ) goto no_orgs_path;
+// if ( NULL ==  p_roles_path ) goto no_roles_path;
+// if ( NULL == p_groups_path ) goto no_groups_path;
+
+// no_users_path:
+//     #ifndef NDEBUG
+//         log_error("[identity] Null pointer provided for parameter \"p_users_path\" in call to function \"%s\"", __FUNCTION__);
+//     #endif
+
+//     // error
+//     return 0;
+
+// no_orgs_path:
+//     #ifndef NDEBUG
+//         log_error("[identity] Null pointer provided for parameter \"p_orgs_path\" in call to function \"%s\"", __FUNCTION__);
+//     #endif
+
+//     // error
+//     return 0;
+
+// no_roles_path:
+//     #ifndef NDEBUG
+//         log_error("[identity] Null pointer provided for parameter \"p_roles_path\" in call to function \"%s\"", __FUNCTION__);
+//     #endif
+
+//     // error
+//     return 0;
+
+// no_groups_path:
+//     #ifndef NDEBUG
+//         log_error("[identity] Null pointer provided for parameter \"p_groups_path\" in call to function \"%s\"", __FUNCTION__);
+//     #endif
+
+//     // error
+//     return 0;
+
+int identity_user_lookup ( identity *p_identity, size_t id, user **pp_user )
+{
+
+    // argument check
+    if ( NULL == p_identity ) goto no_identity;
+    if ( NULL == pp_user ) goto no_user;
+
+    // lookup user
+    return hash_index_search(p_identity->p_users, id, (void **)pp_user);
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_identity:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"p_identity\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_user:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"pp_user\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int identity_user_lookup_name ( identity *p_identity, const char *p_name, size_t name_len, user **pp_user )
+{
+
+    // argument check
+    if ( NULL == p_identity ) goto no_identity;
+    if ( NULL ==     p_name ) goto no_name;
+    if ( NULL ==    pp_user ) goto no_user;
+
+    // initialized data
+    protocol_credential _name = { .p_name = p_name, .name_len = name_len };
+
+    // lookup user
+    return hash_index_match(p_identity->p_user_names, user_name_hash(p_name, name_len), &_name, (void **)pp_user);
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_identity:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"p_identity\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_name:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"p_name\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_user:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"pp_user\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int identity_user_lookup_org_name ( identity *p_identity, size_t org_id, const char *p_name, size_t name_len, user **pp_user )
+{
+
+    // argument check
+    if ( NULL == p_identity ) goto no_identity;
+    if ( NULL ==     p_name ) goto no_name;
+    if ( NULL ==    pp_user ) goto no_user;
+
+    // initialized data
+    tenant *p_tenant = NULL;
+
+    // find the org
+    if ( 0 == hash_index_search(p_identity->p_tenants, org_id, (void **) &p_tenant) ) return 0;
+
+    // lookup user
+    return tenant_user_lookup_name(p_tenant, p_name, name_len, pp_user);
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_identity:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"p_identity\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_name:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"p_name\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_user:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"pp_user\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int identity_org_user_lookup ( identity *p_identity, size_t org_id, size_t id, user **pp_user )
+{
+
+    // argument check
+    if ( NULL == p_identity ) goto no_identity;
+    if ( NULL ==    pp_user ) goto no_user;
+
+    // initialized data
+    tenant *p_tenant = NULL;
+
+    // find the org
+    if ( 0 == hash_index_search(p_identity->p_tenants, org_id, (void **) &p_tenant) ) return 0;
+
+    // lookup user. Users of other orgs are not found
+    return tenant_user_lookup(p_tenant, id, pp_user);
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_identity:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"p_identity\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_user:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"pp_user\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int identity_org_role_lookup ( identity *p_identity, size_t org_id, size_t id, role **pp_role )
+{
+
+    // argument check
+    if ( NULL == p_identity ) goto no_identity;
+    if ( NULL ==    pp_role ) goto no_role;
+
+    // initialized data
+    tenant *p_tenant = NULL;
+
+    // find the org
+    if ( 0 == hash_index_search(p_identity->p_tenants, org_id, (void **) &p_tenant) ) return 0;
+
+    // lookup role
+    return tenant_role_lookup(p_tenant, id, pp_role);
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_identity:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"p_identity\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_role:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"pp_role\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int identity_org_group_lookup ( identity *p_identity, size_t org_id, size_t id, group **pp_group )
+{
+
+    // argument check
+    if ( NULL == p_identity ) goto no_identity;
+    if ( NULL ==   pp_group ) goto no_group;
+
+    // initialized data
+    tenant *p_tenant = NULL;
+
+    // find the org
+    if ( 0 == hash_index_search(p_identity->p_tenants, org_id, (void **) &p_tenant) ) return 0;
+
+    // lookup group
+    return tenant_group_lookup(p_tenant, id, pp_group);
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_identity:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"p_identity\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_group:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"pp_group\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int identity_org_size ( identity *p_identity, size_t org_id, size_t *p_users_len, size_t *p_roles_len, size_t *p_groups_len )
+{
+
+    // argument check
+    if ( NULL == p_identity ) goto no_identity;
+
+    // initialized data
+    tenant *p_tenant = NULL;
+
+    // find the org
+    if ( 0 == hash_index_search(p_identity->p_tenants, org_id, (void **) &p_tenant) ) return 0;
+
+    // done
+    return tenant_size(p_tenant, p_users_len, p_roles_len, p_groups_len);
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_identity:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"p_identity\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+void identity_permissions_free ( permission_matcher *p_permissions )
+{
+
+    // done
+    (void) permission_matcher_destroy(&p_permissions);
+}
+
+int identity_permissions_compile ( identity *p_identity )
+{
+
+    // initialized data
+    permission_matcher  *p_permissions = NULL;
+    role               **pp_roles      = NULL;
+    size_t               roles_len     = 0;
+
+    // lock
+    mutex_lock(&p_identity->_write_lock);
+
+    // allocate room for every role
+    pp_roles = default_allocator(NULL, ( hash_index_size(p_identity->p_roles) + 1 ) * sizeof(role *));
+
+    // error check
+    if ( NULL == pp_roles ) goto no_mem;
+
+    // collect every role
+    roles_len = hash_index_values(p_identity->p_roles, (void **) pp_roles);
+
+    // compile their permissions
+    if ( 0 == permission_matcher_construct(&p_permissions, pp_roles, roles_len) ) goto failed_to_compile;
+
+    // permission ids are renumbered, so recompute every user's set, and publish them with the new matcher
+    if ( 0 == effective_rebuild(p_identity->p_effective, p_permissions) ) goto failed_to_rebuild;
+
+    // readers may still match against the old matcher, so free it once they exit
+    if ( p_identity->p_permissions ) epoch_retire(p_identity->p_permissions, (fn_epoch_free *) identity_permissions_free);
+    p_identity->p_permissions = p_permissions;
+
+    // unlock
+    mutex_unlock(&p_identity->_write_lock);
+
+    // release the roles
+    pp_roles = default_allocator(pp_roles, 0);
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // permission errors
+        {
+            failed_to_rebuild:
+
+                // no reader has seen the new matcher
+                (void) permission_matcher_destroy(&p_permissions);
+
+                // fall through
+                goto failed_to_compile;
+
+            failed_to_compile:
+                #ifndef NDEBUG
+                    log_error("[identity] Failed to compile permissions in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // clean up
+                mutex_unlock(&p_identity->_write_lock);
+                pp_roles = default_allocator(pp_roles, 0);
+
+                // error
+                return 0;
+        }
+
+        // standard library errors
+        {
+            no_mem:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // unlock
+                mutex_unlock(&p_identity->_write_lock);
+
+                // error
+                return 0;
+        }
+    }
+}
+
+bool identity_authorize ( identity *p_identity, const user *p_user, const char *p_action, const char *p_resource )
+{
+
+    // argument check
+    if ( NULL == p_identity ) goto no_identity;
+    if ( NULL ==     p_user ) goto no_user;
+    if ( NULL ==   p_action ) goto no_action;
+    if ( NULL == p_resource ) goto no_resource;
+
+    // initialized data
+    const permission_matcher *p_permissions = NULL;
+    const uint64_t           *_set          = NULL;
+
+    // get the user's effective permissions, and the matcher they were computed with
+    if ( 0 == effective_get(p_identity->p_effective, (size_t) user_key_accessor((user *) p_user), &p_permissions, &_set) ) return false;
+
+    // done. Test every permission that grants the action on the resource
+    return permission_matcher_any(p_permissions, p_action, p_resource, _set);
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_identity:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"p_identity\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return false;
+
+            no_user:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"p_user\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return false;
+
+            no_action:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"p_action\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return false;
+
+            no_resource:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"p_resource\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return false;
+        }
+    }
+}
+
+int identity_session_issue ( identity *p_identity, const protocol_credential *p_credential, unsigned char token[SESSION_TOKEN_SIZE] )
+{
+
+    // initialized data
+    user *p_user = NULL;
+
+    // fast exit
+    if ( NULL == p_identity->p_sessions ) return 0;
+
+    // authenticate
+    if ( 0 == identity_authenticate(p_identity, p_credential, &p_user) ) return 0;
+
+    // done
+    return session_issue(p_identity->p_sessions, (size_t) user_key_accessor(p_user), token);
+}
+
+bool identity_session_validate ( identity *p_identity, const unsigned char token[SESSION_TOKEN_SIZE], size_t *p_user_id )
+{
+
+    // fast exit
+    if ( NULL == p_identity->p_sessions ) return false;
+
+    // done
+    return session_validate(p_identity->p_sessions, token, p_user_id);
+}
+
+int identity_session_revoke ( identity *p_identity, const unsigned char token[SESSION_TOKEN_SIZE] )
+{
+
+    // fast exit
+    if ( NULL == p_identity->p_sessions ) return 0;
+
+    // done
+    return session_revoke(p_identity->p_sessions, token);
+}
+
+int identity_token_key_add ( identity *p_identity, uint8_t key_id, const void *p_secret, size_t len )
+{
+
+    // done
+    return token_keyring_key_add(p_identity->p_keyring, key_id, p_secret, len);
+}
+
+int identity_token_key_remove ( identity *p_identity, uint8_t key_id )
+{
+
+    // done
+    return token_keyring_key_remove(p_identity->p_keyring, key_id);
+}
+
+int identity_token_keys_load ( identity *p_identity, const char *p_path )
+{
+
+    // argument check
+    if ( NULL == p_identity ) goto no_identity;
+    if ( NULL ==     p_path ) goto no_path;
+
+    // initialized data
+    FILE          *p_file                  = fopen(p_path, "r");
+    char           _line[512]              = { 0 };
+    char           _hex[256]               = { 0 };
+    unsigned char  _secret[sizeof(_hex)/2] = { 0 };
+    unsigned int   key_id                  = 0;
+    size_t         keys                    = 0;
+
+    // error check
+    if ( NULL == p_file ) goto failed_to_open_file;
+
+    // add each key, in order
+    while ( fgets(_line, sizeof(_line), p_file) )
+    {
+
+        // skip blank lines and comments
+        if ( '\n' == _line[0] || '#' == _line[0] ) continue;
+
+        // parse the line
+        if ( 2 != sscanf(_line, "%u %255s", &key_id, _hex) || UINT8_MAX < key_id ) goto malformed;
+
+        // decode the secret
+        if ( 0 == protocol_hex_decode(_hex, strlen(_hex), _secret) ) goto malformed;
+
+        // add the key
+        if ( 0 == token_keyring_key_add(p_identity->p_keyring, (uint8_t) key_id, _secret, strlen(_hex) / 2) ) goto malformed;
+
+        // count
+        keys++;
+    }
+
+    // forget the secrets
+    memset(_line, 0, sizeof(_line)),
+    memset(_hex, 0, sizeof(_hex)),
+    memset(_secret, 0, sizeof(_secret));
+
+    // close the file
+    fclose(p_file);
+
+    // log
+    log_info("[identity] Loaded %zu signing keys from \"%s\"\n", keys, p_path);
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_identity:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"p_identity\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_path:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"p_path\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // identity errors
+        {
+            malformed:
+                #ifndef NDEBUG
+                    log_error("[identity] Malformed key on line %zu of \"%s\" in call to function \"%s\"\n", keys + 1, p_path, __FUNCTION__);
+                #endif
+
+                // forget the secrets
+                memset(_line, 0, sizeof(_line)),
+                memset(_hex, 0, sizeof(_hex)),
+                memset(_secret, 0, sizeof(_secret));
+
+                // close the file
+                fclose(p_file);
+
+                // error
+                return 0;
+        }
+
+        // standard library errors
+        {
+            failed_to_open_file:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to open \"%s\" in call to function \"%s\"\n", p_path, __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int identity_token_sign ( identity *p_identity, const protocol_credential *p_credential, unsigned char *p_token, size_t *p_len, unsigned char *p_status )
+{
+
+    // initialized data
+    user           *p_user      = NULL;
+    token_claims    _claims     = { 0 };
+    const uint64_t *_groups     = NULL,
+                   *_roles      = NULL;
+    size_t          groups_len  = 0,
+                    roles_len   = 0;
+    size_t          id          = 0;
+
+    // authenticate
+    if ( 0 == identity_authenticate(p_identity, p_credential, &p_user) ) return ( *p_status = PROTOCOL_STATUS_DENIED, 0 );
+
+    // the user
+    _claims.user_id = (uint64_t) (size_t) user_key_accessor(p_user),
+    _claims.org_id  = (uint64_t) user_org_id_get(p_user),
+    _claims.expires = (int64_t) time(NULL) + (int64_t) p_identity->_config.token_ttl_s;
+
+    // the user's own roles
+    (void) user_roles_get(p_user, &_roles, &roles_len);
+    for (size_t i = 0; i < roles_len; i++)
+        if ( 0 == token_claims_role_add(&_claims, id = (size_t) _roles[i]) ) goto id_too_large;
+
+    // the user's groups, and their roles
+    (void) user_groups_get(p_user, &_groups, &groups_len);
+    for (size_t i = 0; i < groups_len; i++)
+    {
+
+        // initialized data
+        group          *p_group         = NULL;
+        const uint64_t *_group_roles    = NULL;
+        size_t          group_roles_len = 0;
+
+        // the group
+        if ( 0 == token_claims_group_add(&_claims, id = (size_t) _groups[i]) ) goto id_too_large;
+
+        // its roles
+        if ( 0 == hash_index_search(p_identity->p_groups, (size_t) _groups[i], (void **) &p_group) ) continue;
+        (void) group_roles_get(p_group, &_group_roles, &group_roles_len);
+        for (size_t j = 0; j < group_roles_len; j++)
+            if ( 0 == token_claims_role_add(&_claims, id = (size_t) _group_roles[j]) ) goto id_too_large;
+    }
+
+    // sign
+    if ( 0 == token_sign(p_identity->p_keyring, &_claims, p_token, p_len) ) goto failed_to_sign;
+
+    // success
+    return ( *p_status = PROTOCOL_STATUS_OKAY, 1 );
+
+    // error handling
+    {
+
+        // token errors
+        {
+            id_too_large:
+                #ifndef NDEBUG
+                    log_error("[identity] [token] User %zu has role or group %zu, and a token only holds ids under %d, in call to function \"%s\"\n", (size_t) _claims.user_id, id, TOKEN_ID_MAX, __FUNCTION__);
+                #endif
+
+                // error
+                return ( *p_status = PROTOCOL_STATUS_UNSUPPORTED, 0 );
+
+            failed_to_sign:
+                #ifndef NDEBUG
+                    log_error("[identity] [token] Failed to sign a token in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return ( *p_status = PROTOCOL_STATUS_UNSUPPORTED, 0 );
+        }
+    }
+}
+
+int identity_log ( identity *p_identity, enum wal_record_e type, const void *p_value, uint64_t *p_sequence )
+{
+
+    // log the value. The log ships it to the replicas once it is durable
+    if ( p_identity->p_wal ) return wal_append(p_identity->p_wal, type, p_value, p_sequence);
+
+    // nothing to log before the log is open, like while loading or replaying
+    if ( NULL == p_identity->p_primary ) return ( *p_sequence = 0, 1 );
+
+    // without a log, replicas still need a sequence, and get the value now
+    *p_sequence = ++p_identity->sequence;
+    (void) replication_primary_append(p_identity->p_primary, type, p_value, *p_sequence);
+
+    // success
+    return 1;
+}
+
+int identity_commit ( identity *p_identity, uint64_t sequence )
+{
+
+    // nothing was logged
+    if ( NULL == p_identity->p_wal || 0 == sequence ) return 1;
+
+    // done
+    return wal_commit(p_identity->p_wal, sequence);
+}
+
+int identity_tenant_get ( identity *p_identity, size_t org_id, tenant **pp_tenant )
+{
+
+    // initialized data
+    tenant *p_tenant = NULL;
+
+    // the org already has a tenant
+    if ( hash_index_search(p_identity->p_tenants, org_id, (void **) pp_tenant) ) return 1;
+
+    // records may arrive before their org, so the first one makes the tenant
+    if ( 0 == tenant_construct(&p_tenant, org_id) ) return 0;
+
+    // index the tenant
+    if ( 0 == hash_index_insert(p_identity->p_tenants, p_tenant) ) goto failed_to_index;
+
+    // return a pointer to the caller
+    *pp_tenant = p_tenant;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // data errors
+        {
+            failed_to_index:
+                #ifndef NDEBUG
+                    log_error("[identity] Failed to index org %zu in call to function \"%s\"", org_id, __FUNCTION__);
+                #endif
+
+                // no reader has seen the tenant
+                (void) tenant_destroy(&p_tenant);
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int identity_tenant_insert ( identity *p_identity, enum wal_record_e type, void *p_value )
+{
+
+    // initialized data
+    tenant *p_tenant = NULL;
+
+    // index the value in its org
+    switch ( type )
+    {
+        case WAL_RECORD_ORG:   return identity_tenant_get(p_identity, (size_t) org_key_accessor(p_value), &p_tenant);
+        case WAL_RECORD_ROLE:  return identity_tenant_get(p_identity, role_org_id_get(p_value) , &p_tenant) && tenant_role_insert (p_tenant, p_value);
+        case WAL_RECORD_GROUP: return identity_tenant_get(p_identity, group_org_id_get(p_value), &p_tenant) && tenant_group_insert(p_tenant, p_value);
+        case WAL_RECORD_USER:  return identity_tenant_get(p_identity, user_org_id_get(p_value) , &p_tenant) && tenant_user_insert (p_tenant, p_value);
+        default:               return 0;
+    }
+}
+
+void identity_tenant_remove ( identity *p_identity, enum wal_record_e type, void *p_value )
+{
+
+    // initialized data
+    tenant *p_tenant = NULL;
+
+    // remove the value from its org. An emptied tenant stays, for the next record
+    switch ( type )
+    {
+        case WAL_RECORD_ROLE:  if ( hash_index_search(p_identity->p_tenants, role_org_id_get(p_value) , (void **) &p_tenant) ) (void) tenant_role_remove (p_tenant, p_value); break;
+        case WAL_RECORD_GROUP: if ( hash_index_search(p_identity->p_tenants, group_org_id_get(p_value), (void **) &p_tenant) ) (void) tenant_group_remove(p_tenant, p_value); break;
+        case WAL_RECORD_USER:  if ( hash_index_search(p_identity->p_tenants, user_org_id_get(p_value) , (void **) &p_tenant) ) (void) tenant_user_remove (p_tenant, p_value); break;
+        default:               break;
+    }
+}
+
+int identity_index_add ( identity *p_identity, hash_index *p_index, enum wal_record_e type, void *p_value )
+{
+
+    // initialized data
+    uint64_t sequence = 0;
+
+    // lock
+    mutex_lock(&p_identity->_write_lock);
+
+    // index the value
+    if ( 0 == hash_index_insert(p_index, p_value) ) goto failed_to_index;
+
+    // and index it in its org
+    if ( 0 == identity_tenant_insert(p_identity, type, p_value) ) goto failed_to_index_tenant;
+
+    // log the value
+    if ( 0 == identity_log(p_identity, type, p_value, &sequence) ) goto failed_to_log;
+
+    // unlock
+    mutex_unlock(&p_identity->_write_lock);
+
+    // wait for the log, without the lock, so concurrent writers share an fsync
+    if ( 0 == identity_commit(p_identity, sequence) ) goto failed_to_commit;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // data errors
+        {
+            failed_to_index_tenant:
+                (void) hash_index_remove(p_index, p_value);
+
+                // unlock
+                mutex_unlock(&p_identity->_write_lock);
+
+                // the caller may free the value once no reader can see it
+                epoch_synchronize();
+
+                // error
+                return 0;
+
+            failed_to_index:
+
+                // unlock
+                mutex_unlock(&p_identity->_write_lock);
+
+                // error
+                return 0;
+        }
+
+        // wal errors
+        {
+            failed_to_log:
+                identity_tenant_remove(p_identity, type, p_value);
+                (void) hash_index_remove(p_index, p_value);
+
+                // unlock
+                mutex_unlock(&p_identity->_write_lock);
+
+                // the caller may free the value once no reader can see it
+                epoch_synchronize();
+
+                // error
+                return 0;
+
+            failed_to_commit:
+                #ifndef NDEBUG
+                    log_error("[identity] Failed to commit record %llu in call to function \"%s\"", (unsigned long long) sequence, __FUNCTION__);
+                #endif
+
+                // the change is not durable, so undo it
+                mutex_lock(&p_identity->_write_lock);
+                identity_tenant_remove(p_identity, type, p_value);
+                (void) hash_index_remove(p_index, p_value);
+                mutex_unlock(&p_identity->_write_lock);
+
+                // the caller may free the value once no reader can see it
+                epoch_synchronize();
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int identity_org_add ( identity *p_identity, org *p_org )
+{
+    
+    // argument check
+    if ( NULL == p_identity ) goto no_identity;
+    if ( NULL ==      p_org ) goto no_org;
+
+    // done
+    return identity_index_add(p_identity, p_identity->p_orgs, WAL_RECORD_ORG, p_org);
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_identity:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"p_identity\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_org:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"p_org\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int identity_role_add ( identity *p_identity, role *p_role )
+{
+    
+    // argument check
+    if ( NULL == p_identity ) goto no_identity;
+    if ( NULL ==     p_role ) goto no_role;
+
+    // add the role
+    if ( 0 == identity_index_add(p_identity, p_identity->p_roles, WAL_RECORD_ROLE, p_role) ) return 0;
+
+    // recompile permissions, unless a bulk load will
+    if ( false == p_identity->loading ) (void) identity_permissions_compile(p_identity);
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_identity:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"p_identity\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_role:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"p_role\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int identity_group_add ( identity *p_identity, group *p_group )
+{
+    
+    // argument check
+    if ( NULL == p_identity ) goto no_identity;
+    if ( NULL ==    p_group ) goto no_group;
+
+    // add the group
+    if ( 0 == identity_index_add(p_identity, p_identity->p_groups, WAL_RECORD_GROUP, p_group) ) return 0;
+
+    // members added before the group now gain its roles
+    if ( false == p_identity->loading && p_identity->p_permissions )
+    {
+        mutex_lock(&p_identity->_write_lock);
+        (void) effective_group_update(p_identity->p_effective, p_identity->p_permissions, (size_t) group_key_accessor(p_group));
+        mutex_unlock(&p_identity->_write_lock);
+    }
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_identity:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"p_identity\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_group:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"p_group\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+void identity_user_invalidate ( identity *p_identity, user *p_user )
+{
+
+    // initialized data
+    char _name[PROTOCOL_NAME_MAX + 1] = { 0 };
+
+    // fast exit
+    if ( NULL == p_identity->p_auth_cache ) return;
+
+    // forget every verdict for the username
+    if ( user_name_get(p_user, _name) ) (void) auth_cache_invalidate(p_identity->p_auth_cache, _name, strlen(_name));
+}
+
+void identity_user_remove ( identity *p_identity, user *p_user )
+{
+
+    // remove the user from every index
+    (void) effective_user_remove(p_identity->p_effective, p_user),
+    identity_tenant_remove(p_identity, WAL_RECORD_USER, p_user),
+    (void) hash_index_remove(p_identity->p_user_names, p_user),
+    (void) hash_index_remove(p_identity->p_users     , p_user);
+
+    // verdicts that allowed the user are stale
+    identity_user_invalidate(p_identity, p_user);
+
+    // and so are the user's sessions
+    if ( p_identity->p_sessions ) (void) session_revoke_user(p_identity->p_sessions, (size_t) user_key_accessor(p_user));
+}
+
+int identity_user_insert ( identity *p_identity, user *p_user, uint64_t *p_sequence )
+{
+
+    // initialized data
+    user   *p_duplicate = NULL;
+    char    _name[PROTOCOL_NAME_MAX + 1] = { 0 };
+    size_t  name_len    = 0;
+
+    // get the username
+    if ( 0 == user_name_get(p_user, _name) ) return 0;
+    name_len = strlen(_name);
+
+    // error check. Usernames sign in without an organization, so they are unique
+    if ( identity_user_lookup_name(p_identity, _name, name_len, &p_duplicate) ) goto duplicate_name;
+
+    // index the user by id
+    if ( 0 == hash_index_insert(p_identity->p_users, p_user) ) return 0;
+
+    // index the user by name, and in its organization
+    if ( 0 == hash_index_insert(p_identity->p_user_names, p_user) ) goto failed_to_index_name;
+    if ( 0 == identity_tenant_insert(p_identity, WAL_RECORD_USER, p_user) ) goto failed_to_index_org_name;
+
+    // compute the user's permissions, unless a bulk load will
+    if ( false == p_identity->loading && p_identity->p_permissions )
+        if ( 0 == effective_user_update(p_identity->p_effective, p_identity->p_permissions, p_user) ) goto failed_to_update_permissions;
+
+    // log the user
+    if ( 0 == identity_log(p_identity, WAL_RECORD_USER, p_user, p_sequence) ) goto failed_to_log;
+
+    // verdicts that denied the username are stale
+    identity_user_invalidate(p_identity, p_user);
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // identity errors
+        {
+            duplicate_name:
+                #ifndef NDEBUG
+                    log_error("[identity] Username \"%s\" is already taken in call to function \"%s\"", _name, __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // data errors
+        {
+            failed_to_log:
+                (void) effective_user_remove(p_identity->p_effective, p_user);
+
+                // fall through
+                goto failed_to_update_permissions;
+
+            failed_to_update_permissions:
+                identity_tenant_remove(p_identity, WAL_RECORD_USER, p_user);
+
+                // fall through
+                goto failed_to_index_org_name;
+
+            failed_to_index_org_name:
+                (void) hash_index_remove(p_identity->p_user_names, p_user);
+
+                // fall through
+                goto failed_to_index_name;
+
+            failed_to_index_name:
+                (void) hash_index_remove(p_identity->p_users, p_user);
+
+                // the caller may free the user once no reader can see it
+                epoch_synchronize();
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int identity_user_add ( identity *p_identity, user *p_user )
+{
+    
+    // argument check
+    if ( NULL == p_identity ) goto no_identity;
+    if ( NULL ==     p_user ) goto no_user;
+
+    // initialized data
+    uint64_t sequence = 0;
+    int      result   = 0;
+
+    // index and log the user
+    mutex_lock(&p_identity->_write_lock);
+    result = identity_user_insert(p_identity, p_user, &sequence);
+    mutex_unlock(&p_identity->_write_lock);
+
+    // error check
+    if ( 0 == result ) return 0;
+
+    // wait for the log
+    if ( 0 == identity_commit(p_identity, sequence) ) goto failed_to_commit;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_identity:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"p_identity\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_user:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"p_user\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // wal errors
+        {
+            failed_to_commit:
+                #ifndef NDEBUG
+                    log_error("[identity] Failed to commit record %llu in call to function \"%s\"", (unsigned long long) sequence, __FUNCTION__);
+                #endif
+
+                // the user is not durable, so undo it
+                mutex_lock(&p_identity->_write_lock);
+                identity_user_remove(p_identity, p_user);
+                mutex_unlock(&p_identity->_write_lock);
+
+                // the caller may free the user once no reader can see it
+                epoch_synchronize();
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int identity_users_add ( identity *p_identity, user **pp_users, size_t quantity )
+{
+    
+    // argument check
+    if ( NULL == p_identity ) goto no_identity;
+    if ( NULL ==   pp_users && quantity ) goto no_users;
+
+    // initialized data
+    uint64_t sequence = 0;
+    size_t   added    = 0;
+
+    // lock
+    mutex_lock(&p_identity->_write_lock);
+
+    // size every index once
+    if ( 0 == hash_index_reserve(p_identity->p_users     , hash_index_size(p_identity->p_users) + quantity) ) goto failed_to_reserve;
+    if ( 0 == hash_index_reserve(p_identity->p_user_names, hash_index_size(p_identity->p_users) + quantity) ) goto failed_to_reserve;
+
+    // add each user. Inserting never rehashes from here
+    for (; added < quantity; added++)
+        if ( 0 == identity_user_insert(p_identity, pp_users[added], &sequence) ) goto failed_to_insert;
+
+    // unlock
+    mutex_unlock(&p_identity->_write_lock);
+
+    // wait for the log once, for every user
+    if ( 0 == identity_commit(p_identity, sequence) ) goto failed_to_commit;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_identity:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"p_identity\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_users:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"pp_users\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // data errors
+        {
+            failed_to_reserve:
+
+                // unlock
+                mutex_unlock(&p_identity->_write_lock);
+
+                // error
+                return 0;
+
+            failed_to_insert:
+
+                // undo the users added so far
+                while ( added-- ) identity_user_remove(p_identity, pp_users[added]);
+
+                // unlock
+                mutex_unlock(&p_identity->_write_lock);
+
+                // the caller may free the users once no reader can see them
+                epoch_synchronize();
+
+                // error
+                return 0;
+        }
+
+        // wal errors
+        {
+            failed_to_commit:
+                #ifndef NDEBUG
+                    log_error("[identity] Failed to commit record %llu in call to function \"%s\"", (unsigned long long) sequence, __FUNCTION__);
+                #endif
+
+                // the users are not durable, so undo them
+                mutex_lock(&p_identity->_write_lock);
+                while ( added-- ) identity_user_remove(p_identity, pp_users[added]);
+                mutex_unlock(&p_identity->_write_lock);
+
+                // the caller may free the users once no reader can see them
+                epoch_synchronize();
+
+                // error
+                return 0;
+        }
+    }
+}
+
+bool identity_record_mapped ( identity *p_identity, const void *p_value )
+{
+
+    // initialized data
+    const char *p_map = p_identity->_snapshot.p_map;
+
+    // done. values in the mapped snapshot live as long as the map
+    return p_map && (const char *) p_value >= p_map && (const char *) p_value < p_map + p_identity->_snapshot.size;
+}
+
+void identity_record_release ( identity *p_identity, void *p_value )
+{
+
+    // release the value, unless it lives in the mapped snapshot
+    if ( false == identity_record_mapped(p_identity, p_value) ) p_value = default_allocator(p_value, 0);
+}
+
+int identity_org_drop ( identity *p_identity, size_t org_id, bool release )
+{
+
+    // argument check
+    if ( NULL == p_identity ) goto no_identity;
+
+    // initialized data
+    tenant   *p_tenant   = NULL;
+    org      *p_org      = NULL;
+    user    **pp_users   = NULL;
+    role    **pp_roles   = NULL;
+    group   **pp_groups  = NULL;
+    size_t    users_len  = 0,
+              roles_len  = 0,
+              groups_len = 0;
+    uint64_t  id         = org_id,
+              sequence   = 0;
+
+    // lock
+    mutex_lock(&p_identity->_write_lock);
+
+    // find the org
+    if ( 0 == hash_index_search(p_identity->p_tenants, org_id, (void **) &p_tenant) ) goto no_org;
+
+    // collect its records
+    (void) tenant_size(p_tenant, &users_len, &roles_len, &groups_len);
+    pp_users  = default_allocator(NULL, ( users_len  + 1 ) * sizeof(user  *)),
+    pp_roles  = default_allocator(NULL, ( roles_len  + 1 ) * sizeof(role  *)),
+    pp_groups = default_allocator(NULL, ( groups_len + 1 ) * sizeof(group *));
+
+    // error check
+    if ( NULL == pp_users || NULL == pp_roles || NULL == pp_groups ) goto no_mem;
+
+    // copy them out
+    (void) tenant_values(p_tenant, pp_users, pp_roles, pp_groups);
+
+    // log the unload, and ship it to replicas
+    if ( 0 == identity_log(p_identity, WAL_RECORD_ORG_UNLOAD, &id, &sequence) ) goto failed_to_log;
+
+    // org scoped lookups stop here
+    (void) hash_index_remove(p_identity->p_tenants, p_tenant);
+
+    // then drop every record from the shared indices
+    for (size_t i = 0; i < users_len; i++)
+        identity_user_remove(p_identity, pp_users[i]);
+    for (size_t i = 0; i < groups_len; i++)
+        (void) hash_index_remove(p_identity->p_groups, pp_groups[i]);
+    for (size_t i = 0; i < roles_len; i++)
+        (void) hash_index_remove(p_identity->p_roles, pp_roles[i]);
+    if ( hash_index_search(p_identity->p_orgs, org_id, (void **) &p_org) )
+        (void) hash_index_remove(p_identity->p_orgs, p_org);
+
+    // unlock
+    mutex_unlock(&p_identity->_write_lock);
+
+    // wait for the log, without the lock
+    if ( 0 == identity_commit(p_identity, sequence) ) log_warning("[identity] Failed to commit the unload of org %zu, so it may come back on restart\n", org_id);
+
+    // the org's roles no longer grant anything
+    if ( roles_len && false == p_identity->loading ) (void) identity_permissions_compile(p_identity);
+
+    // wait out the readers, so the caller may free the records
+    epoch_synchronize();
+
+    // or free them here, when nobody else owns them
+    if ( release )
+    {
+        for (size_t i = 0; i < users_len; i++)
+            identity_record_release(p_identity, pp_users[i]);
+        for (size_t i = 0; i < groups_len; i++)
+            identity_record_release(p_identity, pp_groups[i]);
+        for (size_t i = 0; i < roles_len; i++)
+            identity_record_release(p_identity, pp_roles[i]);
+        if ( p_org ) identity_record_release(p_identity, p_org);
+    }
+
+    // release the tenant
+    (void) tenant_destroy(&p_tenant);
+
+    // release the lists
+    pp_users  = default_allocator(pp_users , 0),
+    pp_roles  = default_allocator(pp_roles , 0),
+    pp_groups = default_allocator(pp_groups, 0);
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_identity:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"p_identity\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // identity errors
+        {
+            no_org:
+                #ifndef NDEBUG
+                    log_error("[identity] No org with id %zu in call to function \"%s\"", org_id, __FUNCTION__);
+                #endif
+
+                // unlock
+                mutex_unlock(&p_identity->_write_lock);
+
+                // error
+                return 0;
+        }
+
+        // wal errors
+        {
+            failed_to_log:
+                #ifndef NDEBUG
+                    log_error("[identity] Failed to log the unload of org %zu in call to function \"%s\"\n", org_id, __FUNCTION__);
+                #endif
+
+                // unlock. The org stays loaded
+                mutex_unlock(&p_identity->_write_lock);
+
+                // release the lists
+                pp_users  = default_allocator(pp_users , 0),
+                pp_roles  = default_allocator(pp_roles , 0),
+                pp_groups = default_allocator(pp_groups, 0);
+
+                // error
+                return 0;
+        }
+
+        // standard library errors
+        {
+            no_mem:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // unlock
+                mutex_unlock(&p_identity->_write_lock);
+
+                // release the lists
+                pp_users  = default_allocator(pp_users , 0),
+                pp_roles  = default_allocator(pp_roles , 0),
+                pp_groups = default_allocator(pp_groups, 0);
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int identity_org_unload ( identity *p_identity, size_t org_id )
+{
+
+    // done. the caller owns the records
+    return identity_org_drop(p_identity, org_id, false);
+}
+
+int identity_load ( identity *p_identity, const char *p_path )
+{
+
+    // argument check
+    if ( NULL == p_identity ) goto no_identity;
+    if ( NULL ==     p_path ) goto no_path;
+
+    // initialized data
+    loader_result _result  = { 0 };
+    timestamp     start    = timer_high_precision();
+    double        seconds  = 0;
+
+    // read and parse every file in parallel
+    if ( 0 == loader_load(p_path, p_identity->p_thread_pool, p_identity->_config.worker_quantity, &_result) ) goto failed_to_load;
+
+    // add the organization, its roles and its groups
+    p_identity->loading = true;
+    if ( 0 == identity_org_add(p_identity, _result.p_org) ) goto failed_to_add;
+    for (size_t i = 0; i < _result.roles_len; i++)
+        if ( 0 == identity_role_add(p_identity, _result.pp_roles[i]) ) goto failed_to_add;
+    for (size_t i = 0; i < _result.groups_len; i++)
+        if ( 0 == identity_group_add(p_identity, _result.pp_groups[i]) ) goto failed_to_add;
+
+    // index every user in one pass
+    if ( 0 == identity_users_add(p_identity, _result.pp_users, _result.users_len) ) goto failed_to_add;
+    p_identity->loading = false;
+
+    // compile every role permission, and every user's set, at once
+    if ( 0 == identity_permissions_compile(p_identity) ) goto failed_to_add;
+
+    // measure the load
+    seconds = (double)( timer_high_precision() - start ) / (double) timer_seconds_divisor();
+
+    // report the throughput
+    log_info
+    (
+        "[identity] Loaded %zu users, %zu roles and %zu groups from \"%s\" in %.3f s (%.0f users/s, %.1f MB/s, %zu failed)\n",
+        _result.users_len, _result.roles_len, _result.groups_len, p_path,
+        seconds,
+        ( seconds > 0 ) ? (double) _result.users_len / seconds : 0.0,
+        ( seconds > 0 ) ? (double) _result.bytes / seconds / 1e6 : 0.0,
+        _result.failures
+    );
+
+    // release the result
+    (void) loader_result_release(&_result);
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_identity:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"p_identity\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_path:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"p_path\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // loader errors
+        {
+            failed_to_load:
+                #ifndef NDEBUG
+                    log_error("[identity] Failed to load \"%s\" in call to function \"%s\"", p_path, __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            failed_to_add:
+                p_identity->loading = false;
+                #ifndef NDEBUG
+                    log_error("[identity] Failed to index \"%s\" in call to function \"%s\"", p_path, __FUNCTION__);
+                #endif
+
+                // release the result
+                (void) loader_result_release(&_result);
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int identity_snapshot_save ( identity *p_identity, const char *p_path )
+{
+
+    // argument check
+    if ( NULL == p_identity ) goto no_identity;
+    if ( NULL ==     p_path ) goto no_path;
+
+    // initialized data
+    snapshot  _snapshot = { 0 };
+    timestamp start     = timer_high_precision();
+    int       result    = 0;
+
+    // hold off writers, so the values and the sequence agree
+    mutex_lock(&p_identity->_write_lock);
+
+    // wait for every logged record. A record that fails to commit is undone,
+    // so it must not reach the snapshot, nor the log be cut past it
+    _snapshot.sequence = ( p_identity->p_wal ) ? wal_sequence(p_identity->p_wal) : p_identity->sequence;
+    if ( 0 == identity_commit(p_identity, _snapshot.sequence) ) goto failed_to_commit;
+
+    // allocate the arrays
+    _snapshot.pp_orgs   = default_allocator(NULL, ( hash_index_size(p_identity->p_orgs  ) + 1 ) * sizeof(org   *)),
+    _snapshot.pp_roles  = default_allocator(NULL, ( hash_index_size(p_identity->p_roles ) + 1 ) * sizeof(role  *)),
+    _snapshot.pp_groups = default_allocator(NULL, ( hash_index_size(p_identity->p_groups) + 1 ) * sizeof(group *)),
+    _snapshot.pp_users  = default_allocator(NULL, ( hash_index_size(p_identity->p_users ) + 1 ) * sizeof(user  *));
+
+    // error check
+    if ( NULL == _snapshot.pp_orgs || NULL == _snapshot.pp_roles || NULL == _snapshot.pp_groups || NULL == _snapshot.pp_users ) goto no_mem;
+
+    // collect every value
+    _snapshot.orgs_len   = hash_index_values(p_identity->p_orgs  , (void **) _snapshot.pp_orgs),
+    _snapshot.roles_len  = hash_index_values(p_identity->p_roles , (void **) _snapshot.pp_roles),
+    _snapshot.groups_len = hash_index_values(p_identity->p_groups, (void **) _snapshot.pp_groups),
+    _snapshot.users_len  = hash_index_values(p_identity->p_users , (void **) _snapshot.pp_users);
+
+    // writers may continue. records are never changed in place
+    mutex_unlock(&p_identity->_write_lock);
+
+    // write the snapshot
+    result = snapshot_save(p_path, &_snapshot);
+
+    // the log is redundant up to the snapshot, once the snapshot is durable
+    if ( result && p_identity->p_wal ) (void) wal_checkpoint(p_identity->p_wal, _snapshot.sequence);
+
+    // log
+    if ( result ) log_info("[identity] Saved %zu users to \"%s\" in %.3f s\n", _snapshot.users_len, p_path, (double)( timer_high_precision() - start ) / (double) timer_seconds_divisor());
+
+    // release the arrays
+    (void) snapshot_release(&_snapshot);
+
+    // done
+    return result;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_identity:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"p_identity\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_path:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"p_path\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // wal errors
+        {
+            failed_to_commit:
+                #ifndef NDEBUG
+                    log_error("[identity] Failed to commit record %llu in call to function \"%s\"\n", (unsigned long long) _snapshot.sequence, __FUNCTION__);
+                #endif
+
+                // unlock
+                mutex_unlock(&p_identity->_write_lock);
+
+                // error
+                return 0;
+        }
+
+        // standard library errors
+        {
+            no_mem:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // unlock
+                mutex_unlock(&p_identity->_write_lock);
+
+                // release the arrays
+                (void) snapshot_release(&_snapshot);
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int identity_snapshot_load ( identity *p_identity, const char *p_path )
+{
+
+    // argument check
+    if ( NULL == p_identity ) goto no_identity;
+    if ( NULL ==     p_path ) goto no_path;
+
+    // initialized data
+    snapshot  _snapshot = { 0 };
+    timestamp start     = timer_high_precision();
+    double    seconds   = 0;
+
+    // error check
+    if ( p_identity->_snapshot.p_map ) goto already_loaded;
+
+    // map the snapshot
+    if ( 0 == snapshot_load(p_path, &_snapshot) ) goto failed_to_load;
+
+    // add the organizations, roles and groups
+    p_identity->loading = true;
+    for (size_t i = 0; i < _snapshot.orgs_len; i++)
+        if ( 0 == identity_org_add(p_identity, _snapshot.pp_orgs[i]) ) goto failed_to_add;
+    for (size_t i = 0; i < _snapshot.roles_len; i++)
+        if ( 0 == identity_role_add(p_identity, _snapshot.pp_roles[i]) ) goto failed_to_add;
+    for (size_t i = 0; i < _snapshot.groups_len; i++)
+        if ( 0 == identity_group_add(p_identity, _snapshot.pp_groups[i]) ) goto failed_to_add;
+
+    // index every user in one pass
+    if ( 0 == identity_users_add(p_identity, _snapshot.pp_users, _snapshot.users_len) ) goto failed_to_add;
+    p_identity->loading = false;
+
+    // compile every role permission, and every user's set, at once
+    if ( 0 == identity_permissions_compile(p_identity) ) goto failed_to_add;
+
+    // measure the load
+    seconds = (double)( timer_high_precision() - start ) / (double) timer_seconds_divisor();
+
+    // report the throughput
+    log_info
+    (
+        "[identity] Mapped %zu users, %zu roles and %zu groups from \"%s\" in %.3f s (%.0f users/s, %.1f MB)\n",
+        _snapshot.users_len, _snapshot.roles_len, _snapshot.groups_len, p_path,
+        seconds,
+        ( seconds > 0 ) ? (double) _snapshot.users_len / seconds : 0.0,
+        (double) _snapshot.size / 1e6
+    );
+
+    // the records live in the mapping, so keep it
+    (void) snapshot_release(&_snapshot);
+    p_identity->_snapshot = _snapshot,
+    p_identity->sequence  = _snapshot.sequence;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_identity:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"p_identity\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_path:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"p_path\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // snapshot errors
+        {
+            already_loaded:
+                #ifndef NDEBUG
+                    log_error("[identity] A snapshot is already loaded in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            failed_to_load:
+                #ifndef NDEBUG
+                    log_error("[identity] Failed to load \"%s\" in call to function \"%s\"", p_path, __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            failed_to_add:
+                p_identity->loading = false;
+                #ifndef NDEBUG
+                    log_error("[identity] Failed to index \"%s\" in call to function \"%s\"", p_path, __FUNCTION__);
+                #endif
+
+                // records from the snapshot may already be indexed, so keep the mapping
+                (void) snapshot_release(&_snapshot);
+                p_identity->_snapshot = _snapshot;
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int identity_wal_replay ( identity *p_identity, enum wal_record_e type, void *p_value )
+{
+
+    // initialized data
+    int result = 0;
+
+    // apply the record. the log is not open yet, so nothing is logged again
+    switch ( type )
+    {
+        case WAL_RECORD_ORG:   result = identity_org_add(p_identity, p_value);   break;
+        case WAL_RECORD_ROLE:  result = identity_role_add(p_identity, p_value);  break;
+        case WAL_RECORD_GROUP: result = identity_group_add(p_identity, p_value); break;
+        case WAL_RECORD_USER:  result = identity_user_add(p_identity, p_value);  break;
+
+        case WAL_RECORD_ORG_UNLOAD:
+
+            // the value is only the id, so it is never indexed. The org's
+            // records were replayed or loaded here, so they are released too
+            result  = identity_org_drop(p_identity, (size_t) *(const uint64_t *) p_value, true),
+            p_value = default_allocator(p_value, 0);
+
+            // done
+            return result;
+
+        default: break;
+    }
+
+    // the value is ours to release if it was not indexed
+    if ( 0 == result ) p_value = default_allocator(p_value, 0);
+
+    // done
+    return result;
+}
+
+int identity_wal_open ( identity *p_identity, const char *p_path )
+{
+
+    // argument check
+    if ( NULL == p_identity ) goto no_identity;
+    if ( NULL ==     p_path ) goto no_path;
+
+    // initialized data
+    uint64_t sequence = 0;
+
+    // error check
+    if ( p_identity->p_wal ) goto already_open;
+
+    // apply every record the loaded state does not hold
+    p_identity->loading = true;
+    if ( 0 == wal_replay(p_path, p_identity->sequence, (fn_wal_replay *) identity_wal_replay, p_identity, &sequence) ) goto failed_to_replay;
+    p_identity->loading = false;
+
+    // compile the permissions of every replayed role
+    if ( 0 == identity_permissions_compile(p_identity) ) goto failed_to_replay;
+
+    // open the log for appending
+    if ( 0 == wal_construct(&p_identity->p_wal, p_path, sequence) ) goto failed_to_open;
+
+    // ship records to replicas once they are durable
+    if ( p_identity->p_primary ) wal_durable_set(p_identity->p_wal, (fn_wal_durable *) replication_primary_append_records, p_identity->p_primary);
+
+    // store the sequence
+    p_identity->sequence = sequence;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_identity:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"p_identity\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_path:
+                #ifndef NDEBUG
+                    log_error("[identity] Null pointer provided for parameter \"p_path\" in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // wal errors
+        {
+            already_open:
+                #ifndef NDEBUG
+                    log_error("[identity] A write ahead log is already open in call to function \"%s\"", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            failed_to_replay:
+                p_identity->loading = false;
+                #ifndef NDEBUG
+                    log_error("[identity] Failed to replay \"%s\" in call to function \"%s\"", p_path, __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            failed_to_open:
+                #ifndef NDEBUG
+                    log_error("[identity] Failed to open \"%s\" in call to function \"%s\"", p_path, __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+size_t identity_replication_pack ( char *p_buffer, enum wal_record_e type, void **pp_values, size_t quantity )
+{
+
+    // initialized data
+    size_t len = 0;
+
+    // pack each value after the last. A null buffer measures them
+    for (size_t i = 0; i < quantity; i++)
+        len += wal_record_pack(( p_buffer ) ? p_buffer + len : NULL, type, pp_values[i], 0);
+
+    // done
+    return len;
+}
+
+int identity_replication_dump ( identity *p_identity, char **pp_records, size_t *p_len, uint64_t *p_sequence )
+{
+
+    // initialized data
+    snapshot  _snapshot = { 0 };
+    char     *p_records = NULL,
+             *p_offset  = NULL;
+    size_t    len       = 0;
+    uint64_t  sequence  = 0;
+
+    // hold off writers, so the records and the sequence agree
+    mutex_lock(&p_identity->_write_lock);
+
+    // wait for every logged record, so the records hold nothing a failed commit could undo
+    sequence = ( p_identity->p_wal ) ? wal_sequence(p_identity->p_wal) : p_identity->sequence;
+    if ( 0 == identity_commit(p_identity, sequence) ) goto failed_to_commit;
+
+    // allocate the arrays
+    _snapshot.pp_orgs   = default_allocator(NULL, ( hash_index_size(p_identity->p_orgs  ) + 1 ) * sizeof(org   *)),
+    _snapshot.pp_roles  = default_allocator(NULL, ( hash_index_size(p_identity->p_roles ) + 1 ) * sizeof(role  *)),
+    _snapshot.pp_groups = default_allocator(NULL, ( hash_index_size(p_identity->p_groups) + 1 ) * sizeof(group *)),
+    _snapshot.pp_users  = default_allocator(NULL, ( hash_index_size(p_identity->p_users ) + 1 ) * sizeof(user  *));
 
-        p_maybe_user = ( strcmp(_name, p_user->string) ) ? log_error("[identity] Error!"), NULL : p_maybe_user;
+    // error check
+    if ( NULL == _snapshot.pp_orgs || NULL == _snapshot.pp_roles || NULL == _snapshot.pp_groups || NULL == _snapshot.pp_users ) goto no_mem;
 
-        if (p_maybe_user) user_print(p_maybe_user);
-        else log_error("[identity] User not found");
+    // collect every value
+    _snapshot.orgs_len   = hash_index_values(p_identity->p_orgs  , (void **) _snapshot.pp_orgs),
+    _snapshot.roles_len  = hash_index_values(p_identity->p_roles , (void **) _snapshot.pp_roles),
+    _snapshot.groups_len = hash_index_values(p_identity->p_groups, (void **) _snapshot.pp_groups),
+    _snapshot.users_len  = hash_index_values(p_identity->p_users , (void **) _snapshot.pp_users);
 
-    }
+    // measure every value
+    len = identity_replication_pack(NULL, WAL_RECORD_ORG  , (void **) _snapshot.pp_orgs  , _snapshot.orgs_len)
+        + identity_replication_pack(NULL, WAL_RECORD_ROLE , (void **) _snapshot.pp_roles , _snapshot.roles_len)
+        + identity_replication_pack(NULL, WAL_RECORD_GROUP, (void **) _snapshot.pp_groups, _snapshot.groups_len)
+        + identity_replication_pack(NULL, WAL_RECORD_USER , (void **) _snapshot.pp_users , _snapshot.users_len);
 
-    // serialize the response
-    {
+    // allocate the records
+    p_records = default_allocator(NULL, len + 1);
 
-        // initialized data
-        char _buf[1024] = { 0 };
-        json_value _val = 
-        { 
-            .type = JSON_VALUE_STRING,
-            .string = (p_maybe_user) ? "okay" : "not okay"
-        };
-        size_t len = json_value_serialize(&_val, &_buf[8]);
+    // error check
+    if ( NULL == p_records ) goto no_mem;
 
-        // set the length
-        *(size_t *)_buf = len;
+    // pack every value, in the order a replica applies them
+    p_offset  = p_records;
+    p_offset += identity_replication_pack(p_offset, WAL_RECORD_ORG  , (void **) _snapshot.pp_orgs  , _snapshot.orgs_len);
+    p_offset += identity_replication_pack(p_offset, WAL_RECORD_ROLE , (void **) _snapshot.pp_roles , _snapshot.roles_len);
+    p_offset += identity_replication_pack(p_offset, WAL_RECORD_GROUP, (void **) _snapshot.pp_groups, _snapshot.groups_len);
+    p_offset += identity_replication_pack(p_offset, WAL_RECORD_USER , (void **) _snapshot.pp_users , _snapshot.users_len);
 
-        // send the result
-        socket_tcp_send(_socket_tcp, _buf, 8 + len);
-    }
+    // unlock
+    mutex_unlock(&p_identity->_write_lock);
+
+    // release the arrays
+    (void) snapshot_release(&_snapshot);
+
+    // return the records to the caller. They hold every logged record
+    *pp_records = p_records,
+    *p_len      = len,
+    *p_sequence = sequence;
 
     // success
     return 1;
@@ -140,135 +3201,142 @@ int identity_server_accept( socket_tcp _socket_tcp, socket_ip_address ip_address
     // error handling
     {
 
-        // socket errors
+        // wal errors
+        {
+            failed_to_commit:
+                #ifndef NDEBUG
+                    log_error("[identity] Failed to commit record %llu in call to function \"%s\"\n", (unsigned long long) sequence, __FUNCTION__);
+                #endif
+
+                // unlock
+                mutex_unlock(&p_identity->_write_lock);
+
+                // error
+                return 0;
+        }
+
+        // standard library errors
         {
-            too_long:
             no_mem:
-            parse_error:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // unlock
+                mutex_unlock(&p_identity->_write_lock);
+
+                // release the arrays
+                (void) snapshot_release(&_snapshot);
+
+                // error
                 return 0;
         }
     }
 }
 
-int identity_listener ( identity *p_identity )
+void identity_record_free ( void *p_value )
 {
 
-    // log a message
-    log_info("[identity] Listening for incoming connections...\n");
-
-    // listen for incoming connections
-    while ( p_identity->running )
-        socket_tcp_listen(p_identity->_socket, (fn_socket_tcp_accept *)identity_server_accept, p_identity);
-
-    return 0;
+    // release the value
+    p_value = default_allocator(p_value, 0);
 }
 
-int identity_construct
-(
-    identity **pp_identity
-
-    // const char *p_users_path,
-    // const char *p_orgs_path,
-    // const char *p_roles_path,
-    // const char *p_groups_path
-)
+bool identity_record_equals ( enum wal_record_e type, const void *p_a, const void *p_b )
 {
 
-    // argument check
-    if ( NULL == pp_identity ) goto no_identity;
-
     // initialized data
-    identity *p_identity = default_allocator(0, sizeof(identity));
+    size_t size = wal_record_pack(NULL, type, p_a, 0);
 
-    // error check
-    if ( NULL == p_identity ) goto no_mem;
+    // every record is already packed, so equal records have equal bytes
+    return 0 != size && size == wal_record_pack(NULL, type, p_b, 0) && 0 == memcmp(p_a, p_b, size - WAL_HEADER_SIZE);
+}
 
-    // construct sets
+void identity_record_remove ( identity *p_identity, enum wal_record_e type, void *p_value )
+{
+
+    // remove the value from every index
+    switch ( type )
     {
+        case WAL_RECORD_ORG:   (void) hash_index_remove(p_identity->p_orgs, p_value); break;
+        case WAL_RECORD_ROLE:  identity_tenant_remove(p_identity, type, p_value), (void) hash_index_remove(p_identity->p_roles , p_value); break;
+        case WAL_RECORD_GROUP: identity_tenant_remove(p_identity, type, p_value), (void) hash_index_remove(p_identity->p_groups, p_value); break;
+        case WAL_RECORD_USER:  identity_user_remove(p_identity, p_value); break;
+        default:               return;
+    }
 
-        // construct organizations
-        binary_tree_construct(
-            &p_identity->p_orgs,
-            (fn_comparator *)   org_comparator, // comparator
-            (fn_key_accessor *) org_key_accessor, // key accessor
-            2048
-        );
+    // values in the mapped snapshot live as long as the map
+    if ( identity_record_mapped(p_identity, p_value) ) return;
 
-        // construct roles
-        binary_tree_construct(
-            &p_identity->p_roles,
-            (fn_comparator *)   role_comparator, // comparator
-            (fn_key_accessor *) role_key_accessor, // key accessor
-            2048
-        );
+    // release the value once no reader can see it
+    epoch_retire(p_value, identity_record_free);
+}
 
-        // construct groups
-        binary_tree_construct(
-            &p_identity->p_groups,
-            (fn_comparator *)   group_comparator, // comparator
-            (fn_key_accessor *) group_key_accessor, // key accessor
-            2048
-        );
+int identity_replication_stale ( identity *p_identity )
+{
 
-        // construct users
-        binary_tree_construct(
-            &p_identity->p_users,
-            (fn_comparator *)   user_comparator, // comparator
-            (fn_key_accessor *) user_key_accessor, // key accessor
-            2048
-        );
+    // initialized data
+    hash_index *_p_indices[WAL_RECORD_QUANTITY] = { [WAL_RECORD_ORG] = p_identity->p_orgs, [WAL_RECORD_ROLE] = p_identity->p_roles, [WAL_RECORD_GROUP] = p_identity->p_groups, [WAL_RECORD_USER] = p_identity->p_users };
+    fn_key_accessor *_pfn_keys[WAL_RECORD_QUANTITY] = { [WAL_RECORD_ORG] = (fn_key_accessor *) org_key_accessor, [WAL_RECORD_ROLE] = (fn_key_accessor *) role_key_accessor, [WAL_RECORD_GROUP] = (fn_key_accessor *) group_key_accessor, [WAL_RECORD_USER] = (fn_key_accessor *) user_key_accessor };
+    void **pp_values = NULL;
+    size_t len       = 0;
 
-        // reverse lookup 
-        binary_tree_construct(
-            &p_identity->p_reverse_users,
-            (fn_comparator *)   user_password_comparator, // comparator
-            (fn_key_accessor *) user_password_key_accessor, // key accessor
-            2048
-        );
-    }
+    // lock
+    mutex_lock(&p_identity->_write_lock);
 
-    // construct networking stuff
+    // copy every held record of each type into an index of its own
+    for (enum wal_record_e type = WAL_RECORD_ORG; type <= WAL_RECORD_USER; type++)
     {
-        
-        // construct a thread pool
-        thread_pool_construct(&p_identity->p_thread_pool, 4);
 
-        // construct a socket
-        socket_tcp_create(&p_identity->_socket, socket_address_family_ipv4, 6708);
+        // allocate the values
+        pp_values = default_allocator(NULL, ( hash_index_size(_p_indices[type]) + 1 ) * sizeof(void *));
 
-        // set the running flag
-        p_identity->running = true;
+        // error check
+        if ( NULL == pp_values ) goto no_mem;
+
+        // collect the values
+        len = hash_index_values(_p_indices[type], pp_values);
+
+        // index them
+        if ( 0 == hash_index_construct(&p_identity->_p_stale[type], _pfn_keys[type], NULL, len) ) goto failed_to_index;
+        if ( 0 == hash_index_build(p_identity->_p_stale[type], pp_values, len) ) goto failed_to_index;
 
-        // construct a listener thread
-        parallel_thread_start(&p_identity->p_listener_thread, (fn_parallel_task *)identity_listener, p_identity);
+        // release the values
+        pp_values = default_allocator(pp_values, 0);
     }
 
-    // return a pointer to the caller 
-    *pp_identity = p_identity;
-    
+    // unlock
+    mutex_unlock(&p_identity->_write_lock);
+
     // success
     return 1;
 
     // error handling
     {
 
-        // argument errors
+        // data errors
         {
-            no_identity:
+            failed_to_index:
                 #ifndef NDEBUG
-                    log_error("[identity] Null pointer provided for parameter \"pp_identity\" in call to function \"%s\"", __FUNCTION__);
+                    log_error("[identity] Failed to index held records in call to function \"%s\"\n", __FUNCTION__);
                 #endif
 
-                // error
-                return 0;
-           }
-    
+                // release the values
+                pp_values = default_allocator(pp_values, 0);
+
+                // fall through
+                goto no_mem;
+        }
+
         // standard library errors
         {
             no_mem:
-                #ifndef NDEBUG
-                    log_error("[identity] Failed to allocate memory in call to function \"%s\"", __FUNCTION__);
-                #endif
+
+                // unlock
+                mutex_unlock(&p_identity->_write_lock);
+
+                // release every stale index
+                for (enum wal_record_e type = WAL_RECORD_ORG; type <= WAL_RECORD_USER; type++)
+                    if ( p_identity->_p_stale[type] ) (void) hash_index_destroy(&p_identity->_p_stale[type]);
 
                 // error
                 return 0;
@@ -276,70 +3344,57 @@ int identity_construct
     }
 }
 
-// if ( NULL ==  p_users_path ) goto no_users_path;
-// if ( NULL ==   p_orgs_path ) goto no_orgs_path;
-// if ( NULL ==  p_roles_path ) goto no_roles_path;
-// if ( NULL == p_groups_path ) goto no_groups_path;
-
-// no_users_path:
-//     #ifndef NDEBUG
-//         log_error("[identity] Null pointer provided for parameter \"p_users_path\" in call to function \"%s\"", __FUNCTION__);
-//     #endif
+int identity_replication_sweep ( identity *p_identity )
+{
 
-//     // error
-//     return 0;
+    // initialized data
+    void   **pp_values = NULL;
+    size_t   len       = 0;
 
-// no_orgs_path:
-//     #ifndef NDEBUG
-//         log_error("[identity] Null pointer provided for parameter \"p_orgs_path\" in call to function \"%s\"", __FUNCTION__);
-//     #endif
+    // lock
+    mutex_lock(&p_identity->_write_lock);
 
-//     // error
-//     return 0;
+    // drop the records the snapshot did not hold, users first, since they
+    // name the rest
+    for (enum wal_record_e type = WAL_RECORD_USER; type >= WAL_RECORD_ORG; type--)
+    {
 
-// no_roles_path:
-//     #ifndef NDEBUG
-//         log_error("[identity] Null pointer provided for parameter \"p_roles_path\" in call to function \"%s\"", __FUNCTION__);
-//     #endif
+        // allocate the values
+        pp_values = default_allocator(NULL, ( hash_index_size(p_identity->_p_stale[type]) + 1 ) * sizeof(void *));
 
-//     // error
-//     return 0;
+        // error check
+        if ( NULL == pp_values ) goto no_mem;
 
-// no_groups_path:
-//     #ifndef NDEBUG
-//         log_error("[identity] Null pointer provided for parameter \"p_groups_path\" in call to function \"%s\"", __FUNCTION__);
-//     #endif
+        // drop each one
+        len = hash_index_values(p_identity->_p_stale[type], pp_values);
+        for (size_t i = 0; i < len; i++)
+            identity_record_remove(p_identity, type, pp_values[i]);
 
-//     // error
-//     return 0;
+        // log
+        if ( len ) log_info("[identity] Dropped %zu records of type %d the snapshot did not hold\n", len, (int) type);
 
-int identity_user_lookup ( identity *p_identity, size_t id, user **pp_user )
-{
+        // release the values
+        pp_values = default_allocator(pp_values, 0);
+    }
 
-    // argument check
-    if ( NULL == p_identity ) goto no_identity;
-    if ( NULL == pp_user ) goto no_user;
+    // unlock
+    mutex_unlock(&p_identity->_write_lock);
 
-    // lookup user
-    return binary_tree_search(p_identity->p_users, (void *)id, (void **)pp_user);
+    // success
+    return 1;
 
     // error handling
     {
 
-        // argument errors
+        // standard library errors
         {
-            no_identity:
+            no_mem:
                 #ifndef NDEBUG
-                    log_error("[identity] Null pointer provided for parameter \"p_identity\" in call to function \"%s\"", __FUNCTION__);
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
                 #endif
 
-                // error
-                return 0;
-
-            no_user:
-                #ifndef NDEBUG
-                    log_error("[identity] Null pointer provided for parameter \"pp_user\" in call to function \"%s\"", __FUNCTION__);
-                #endif
+                // unlock
+                mutex_unlock(&p_identity->_write_lock);
 
                 // error
                 return 0;
@@ -347,49 +3402,114 @@ int identity_user_lookup ( identity *p_identity, size_t id, user **pp_user )
     }
 }
 
-int identity_user_reverse_lookup ( identity *p_identity, size_t id, user **pp_user )
+int identity_replication_apply ( identity *p_identity, enum wal_record_e type, void *p_value )
 {
 
-    // argument check
-    if ( NULL == p_identity ) goto no_identity;
-    if ( NULL == pp_user ) goto no_user;
+    // initialized data
+    hash_index *p_index = NULL;
+    void       *p_held  = NULL;
+    size_t      key     = 0;
 
-    // lookup user
-    return binary_tree_search(p_identity->p_reverse_users, (void *)id, (void **)pp_user);
+    // find the index of the type
+    switch ( type )
+    {
+        case WAL_RECORD_ORG:   p_index = p_identity->p_orgs  , key = (size_t) org_key_accessor(p_value)  ; break;
+        case WAL_RECORD_ROLE:  p_index = p_identity->p_roles , key = (size_t) role_key_accessor(p_value) ; break;
+        case WAL_RECORD_GROUP: p_index = p_identity->p_groups, key = (size_t) group_key_accessor(p_value); break;
+        case WAL_RECORD_USER:  p_index = p_identity->p_users , key = (size_t) user_key_accessor(p_value) ; break;
+        case WAL_RECORD_ORG_UNLOAD: return identity_wal_replay(p_identity, type, p_value);
+        default:               return ( p_value = default_allocator(p_value, 0), 0 );
+    }
 
-    // error handling
+    // the snapshot holds the record, so it is not stale
+    if ( p_identity->_p_stale[type] && hash_index_search(p_identity->_p_stale[type], key, &p_held) )
+        (void) hash_index_remove(p_identity->_p_stale[type], p_held);
+
+    // the replica holds a record with the same id
+    if ( hash_index_search(p_index, key, &p_held) )
     {
 
-        // argument errors
-        {
-            no_identity:
-                #ifndef NDEBUG
-                    log_error("[identity] Null pointer provided for parameter \"p_identity\" in call to function \"%s\"", __FUNCTION__);
-                #endif
+        // the held record is current
+        if ( identity_record_equals(type, p_held, p_value) ) return ( p_value = default_allocator(p_value, 0), 1 );
 
-                // error
-                return 0;
+        // the primary changed it, so drop the held record. Readers miss it,
+        // and deny it, until the new one is added
+        mutex_lock(&p_identity->_write_lock);
+        identity_record_remove(p_identity, type, p_held);
+        mutex_unlock(&p_identity->_write_lock);
+    }
 
-            no_user:
-                #ifndef NDEBUG
-                    log_error("[identity] Null pointer provided for parameter \"pp_user\" in call to function \"%s\"", __FUNCTION__);
-                #endif
+    // apply the record as if it were replayed
+    return identity_wal_replay(p_identity, type, p_value);
+}
 
-                // error
-                return 0;
-        }
+int identity_replication_snapshot ( identity *p_identity, enum replication_snapshot_e stage )
+{
+
+    // initialized data
+    int result = 1;
+
+    // start a snapshot
+    if ( REPLICATION_SNAPSHOT_BEGIN == stage )
+    {
+
+        // compile permissions once, at the end
+        p_identity->loading = true;
+
+        // every held record is stale, until the snapshot holds it
+        if ( identity_replication_stale(p_identity) ) return 1;
+
+        // error
+        p_identity->loading = false;
+        return 0;
     }
+
+    // a finished snapshot is the primary's whole state. A cancelled one drops nothing
+    if ( REPLICATION_SNAPSHOT_FINISH == stage ) result = identity_replication_sweep(p_identity);
+
+    // release every stale index
+    for (enum wal_record_e type = WAL_RECORD_ORG; type <= WAL_RECORD_USER; type++)
+        if ( p_identity->_p_stale[type] ) (void) hash_index_destroy(&p_identity->_p_stale[type]);
+
+    // compile permissions
+    p_identity->loading = false;
+
+    // done
+    return identity_permissions_compile(p_identity) && result;
 }
 
-int identity_org_add ( identity *p_identity, org *p_org )
+int identity_replication_serve ( identity *p_identity, uint16_t port )
 {
-    
+
     // argument check
     if ( NULL == p_identity ) goto no_identity;
-    if ( NULL ==      p_org ) goto no_org;
 
-    // done
-    return binary_tree_insert(p_identity->p_orgs, p_org);
+    // error check
+    if ( p_identity->p_primary ) goto already_serving;
+
+    // initialized data
+    replication_primary *p_primary = NULL;
+    uint64_t             sequence  = 0;
+
+    // lock, so no record is logged between the sequence and the first append
+    mutex_lock(&p_identity->_write_lock);
+
+    // the last sequence logged, once every logged record is durable
+    sequence = ( p_identity->p_wal ) ? wal_sequence(p_identity->p_wal) : p_identity->sequence;
+    if ( 0 == identity_commit(p_identity, sequence) ) goto failed_to_serve;
+
+    // serve replicas
+    if ( 0 == replication_primary_construct(&p_primary, port, sequence, (fn_replication_dump *) identity_replication_dump, p_identity) ) goto failed_to_serve;
+
+    // ship every later record, once it is durable
+    p_identity->p_primary = p_primary;
+    if ( p_identity->p_wal ) wal_durable_set(p_identity->p_wal, (fn_wal_durable *) replication_primary_append_records, p_primary);
+
+    // unlock
+    mutex_unlock(&p_identity->_write_lock);
+
+    // success
+    return 1;
 
     // error handling
     {
@@ -403,27 +3523,47 @@ int identity_org_add ( identity *p_identity, org *p_org )
 
                 // error
                 return 0;
+        }
 
-            no_org:
+        // replication errors
+        {
+            already_serving:
                 #ifndef NDEBUG
-                    log_error("[identity] Null pointer provided for parameter \"p_org\" in call to function \"%s\"", __FUNCTION__);
+                    log_error("[identity] Replicas are already served in call to function \"%s\"", __FUNCTION__);
                 #endif
 
+                // error
+                return 0;
+
+            failed_to_serve:
+                #ifndef NDEBUG
+                    log_error("[identity] Failed to serve replicas on port %hu in call to function \"%s\"", port, __FUNCTION__);
+                #endif
+
+                // unlock
+                mutex_unlock(&p_identity->_write_lock);
+
                 // error
                 return 0;
         }
     }
 }
 
-int identity_role_add ( identity *p_identity, role *p_role )
+int identity_replication_follow ( identity *p_identity, const char *p_host, uint16_t port )
 {
-    
+
     // argument check
     if ( NULL == p_identity ) goto no_identity;
-    if ( NULL ==     p_role ) goto no_role;
+    if ( NULL ==     p_host ) goto no_host;
 
-    // done
-    return binary_tree_insert(p_identity->p_roles, p_role);
+    // error check
+    if ( p_identity->p_replica ) goto already_following;
+
+    // follow the primary
+    if ( 0 == replication_replica_construct(&p_identity->p_replica, p_host, port, (fn_wal_replay *) identity_replication_apply, (fn_replication_snapshot *) identity_replication_snapshot, p_identity) ) goto failed_to_follow;
+
+    // success
+    return 1;
 
     // error handling
     {
@@ -438,43 +3578,28 @@ int identity_role_add ( identity *p_identity, role *p_role )
                 // error
                 return 0;
 
-            no_role:
+            no_host:
                 #ifndef NDEBUG
-                    log_error("[identity] Null pointer provided for parameter \"p_role\" in call to function \"%s\"", __FUNCTION__);
+                    log_error("[identity] Null pointer provided for parameter \"p_host\" in call to function \"%s\"", __FUNCTION__);
                 #endif
 
                 // error
                 return 0;
         }
-    }
-}
-
-int identity_group_add ( identity *p_identity, group *p_group )
-{
-    
-    // argument check
-    if ( NULL == p_identity ) goto no_identity;
-    if ( NULL ==    p_group ) goto no_group;
-
-    // done
-    return binary_tree_insert(p_identity->p_groups, p_group);
-
-    // error handling
-    {
 
-        // argument errors
+        // replication errors
         {
-            no_identity:
+            already_following:
                 #ifndef NDEBUG
-                    log_error("[identity] Null pointer provided for parameter \"p_identity\" in call to function \"%s\"", __FUNCTION__);
+                    log_error("[identity] A primary is already followed in call to function \"%s\"", __FUNCTION__);
                 #endif
 
                 // error
                 return 0;
 
-            no_group:
+            failed_to_follow:
                 #ifndef NDEBUG
-                    log_error("[identity] Null pointer provided for parameter \"p_group\" in call to function \"%s\"", __FUNCTION__);
+                    log_error("[identity] Failed to follow %s:%hu in call to function \"%s\"", p_host, port, __FUNCTION__);
                 #endif
 
                 // error
@@ -483,16 +3608,21 @@ int identity_group_add ( identity *p_identity, group *p_group )
     }
 }
 
-int identity_user_add ( identity *p_identity, user *p_user )
+size_t identity_replication_status ( identity *p_identity, replication_status *_statuses, size_t max )
 {
-    
+
     // argument check
     if ( NULL == p_identity ) goto no_identity;
-    if ( NULL ==     p_user ) goto no_user;
+    if ( NULL ==  _statuses ) goto no_statuses;
 
-    // done
-    return binary_tree_insert(p_identity->p_users        , p_user) && 
-           binary_tree_insert(p_identity->p_reverse_users, p_user);
+    // a replica reports on itself
+    if ( p_identity->p_replica ) return ( max && replication_replica_status(p_identity->p_replica, &_statuses[0]) ) ? 1 : 0;
+
+    // a primary reports on its replicas
+    if ( p_identity->p_primary ) return replication_primary_status(p_identity->p_primary, _statuses, max);
+
+    // neither
+    return 0;
 
     // error handling
     {
@@ -507,9 +3637,9 @@ int identity_user_add ( identity *p_identity, user *p_user )
                 // error
                 return 0;
 
-            no_user:
+            no_statuses:
                 #ifndef NDEBUG
-                    log_error("[identity] Null pointer provided for parameter \"p_user\" in call to function \"%s\"", __FUNCTION__);
+                    log_error("[identity] Null pointer provided for parameter \"_statuses\" in call to function \"%s\"", __FUNCTION__);
                 #endif
 
                 // error
@@ -527,13 +3657,13 @@ int identity_print ( identity *p_identity )
     // initialized data
     //
 
-    binary_tree_traverse_inorder(p_identity->p_orgs, (fn_binary_tree_traverse *) org_print);
+    hash_index_traverse(p_identity->p_orgs, (fn_hash_index_traverse *) org_print);
 
-    binary_tree_traverse_inorder(p_identity->p_roles, (fn_binary_tree_traverse *) role_print);
+    hash_index_traverse(p_identity->p_roles, (fn_hash_index_traverse *) role_print);
 
-    binary_tree_traverse_inorder(p_identity->p_groups, (fn_binary_tree_traverse *) group_print);
+    hash_index_traverse(p_identity->p_groups, (fn_hash_index_traverse *) group_print);
 
-    binary_tree_traverse_inorder(p_identity->p_users, (fn_binary_tree_traverse *) user_print);
+    hash_index_traverse(p_identity->p_users, (fn_hash_index_traverse *) user_print);
 
     // success
     return 1;
@@ -0,0 +1,372 @@
+/** !
+ * Intern
+ *
+ * @file src/intern.c
+ *
+ * @author Jacob Smith
+ */
+
+// header
+#include <identity/intern.h>
+
+// structure definitions
+struct intern_entry_s
+{
+    const char *p_string;
+    uint32_t    len;
+    uint32_t    hash;  // the low bits of the string's hash, to skip most compares
+};
+
+struct intern_s
+{
+    mutex                   _lock;
+    size_t                  size;
+    struct intern_entry_s  *_pages[INTERN_PAGES_MAX]; // id -> entry, INTERN_PAGE_QUANTITY entries per page
+    uint32_t               *_table;                   // id + 1, or 0 when empty
+    size_t                  mask;                     // capacity - 1. The capacity is a power of two
+    arena                 **pp_arenas;
+    size_t                  arenas_len;
+};
+
+// data
+static struct intern_s _intern      = { 0 };
+static once_flag       _constructed = ONCE_FLAG_INIT;
+
+// function declarations
+void intern_construct ( void );
+uint32_t intern_find ( const char *p_string, size_t len, uint64_t hash );
+int intern_table_grow ( void );
+char *intern_copy ( const char *p_string, size_t len );
+
+void intern_construct ( void )
+{
+
+    // construct the lock. Strings are added while organizations load in parallel
+    (void) mutex_create(&_intern._lock);
+}
+
+uint32_t intern_find ( const char *p_string, size_t len, uint64_t hash )
+{
+
+    // fast exit
+    if ( NULL == _intern._table ) return INTERN_NONE;
+
+    // probe
+    for (size_t i = (size_t) hash & _intern.mask; _intern._table[i]; i = ( i + 1 ) & _intern.mask)
+    {
+
+        // initialized data
+        uint32_t                     id      = _intern._table[i] - 1;
+        const struct intern_entry_s *p_entry = &_intern._pages[id / INTERN_PAGE_QUANTITY][id % INTERN_PAGE_QUANTITY];
+
+        // match
+        if ( p_entry->hash == (uint32_t) hash && p_entry->len == len && 0 == memcmp(p_entry->p_string, p_string, len) ) return id;
+    }
+
+    // not found
+    return INTERN_NONE;
+}
+
+int intern_table_grow ( void )
+{
+
+    // initialized data
+    size_t    capacity = ( _intern._table ) ? ( _intern.mask + 1 ) * 2 : 64;
+    uint32_t *_table   = default_allocator(NULL, capacity * sizeof(uint32_t));
+
+    // error check
+    if ( NULL == _table ) return 0;
+
+    // start empty
+    memset(_table, 0, capacity * sizeof(uint32_t));
+
+    // rehash every id
+    for (size_t id = 0; id < _intern.size; id++)
+    {
+
+        // initialized data
+        const struct intern_entry_s *p_entry = &_intern._pages[id / INTERN_PAGE_QUANTITY][id % INTERN_PAGE_QUANTITY];
+        size_t                       i       = p_entry->hash & ( capacity - 1 );
+
+        // probe for an empty slot
+        while ( _table[i] ) i = ( i + 1 ) & ( capacity - 1 );
+
+        // store the id
+        _table[i] = (uint32_t) id + 1;
+    }
+
+    // swap in the new table
+    _intern._table = default_allocator(_intern._table, 0),
+    _intern._table = _table,
+    _intern.mask   = capacity - 1;
+
+    // success
+    return 1;
+}
+
+char *intern_copy ( const char *p_string, size_t len )
+{
+
+    // initialized data
+    char *p_copy = ( _intern.arenas_len ) ? arena_alloc(_intern.pp_arenas[_intern.arenas_len - 1], len + 1) : NULL;
+
+    // the last arena is full, so start another. strings never move
+    if ( NULL == p_copy )
+    {
+
+        // initialized data
+        arena **pp_arenas = default_allocator(_intern.pp_arenas, ( _intern.arenas_len + 1 ) * sizeof(arena *));
+
+        // error check
+        if ( NULL == pp_arenas ) return NULL;
+
+        // store the arenas
+        _intern.pp_arenas = pp_arenas;
+
+        // construct an arena, with room for at least the string
+        if ( 0 == arena_construct(&_intern.pp_arenas[_intern.arenas_len], ( len + 1 > INTERN_ARENA_SIZE ) ? len + 1 : INTERN_ARENA_SIZE) ) return NULL;
+
+        // store the arena
+        _intern.arenas_len++;
+
+        // allocate the string
+        p_copy = arena_alloc(_intern.pp_arenas[_intern.arenas_len - 1], len + 1);
+
+        // error check
+        if ( NULL == p_copy ) return NULL;
+    }
+
+    // copy the string
+    memcpy(p_copy, p_string, len);
+    p_copy[len] = '\0';
+
+    // done
+    return p_copy;
+}
+
+int intern_string_add ( const char *p_string, size_t len, uint32_t *p_id )
+{
+
+    // argument check
+    if ( NULL == p_string ) goto no_string;
+    if ( NULL ==     p_id ) goto no_id;
+
+    // initialized data
+    uint64_t                hash    = hash_fnv64(p_string, len);
+    uint32_t                id      = INTERN_NONE;
+    struct intern_entry_s  *p_page  = NULL;
+    char                   *p_copy  = NULL;
+
+    // construct the table once
+    call_once(&_constructed, intern_construct);
+
+    // error check
+    if ( UINT32_MAX < len ) goto too_long;
+
+    // lock
+    mutex_lock(&_intern._lock);
+
+    // the string is already interned
+    id = intern_find(p_string, len, hash);
+    if ( INTERN_NONE != id ) return ( mutex_unlock(&_intern._lock), *p_id = id, 1 );
+
+    // error check
+    if ( (size_t) INTERN_PAGES_MAX * INTERN_PAGE_QUANTITY == _intern.size ) goto table_full;
+
+    // keep the load factor under 1/2
+    if ( NULL == _intern._table || ( _intern.size + 1 ) * 2 > _intern.mask + 1 )
+        if ( 0 == intern_table_grow() ) goto no_mem;
+
+    // allocate a directory page
+    p_page = _intern._pages[_intern.size / INTERN_PAGE_QUANTITY];
+    if ( NULL == p_page )
+    {
+
+        // allocate the page
+        p_page = default_allocator(NULL, INTERN_PAGE_QUANTITY * sizeof(struct intern_entry_s));
+
+        // error check
+        if ( NULL == p_page ) goto no_mem;
+
+        // store the page
+        _intern._pages[_intern.size / INTERN_PAGE_QUANTITY] = p_page;
+    }
+
+    // copy the string into an arena
+    p_copy = intern_copy(p_string, len);
+
+    // error check
+    if ( NULL == p_copy ) goto no_mem;
+
+    // store the entry
+    id = (uint32_t) _intern.size;
+    p_page[id % INTERN_PAGE_QUANTITY] = (struct intern_entry_s)
+    {
+        .p_string = p_copy,
+        .len      = (uint32_t) len,
+        .hash     = (uint32_t) hash
+    };
+
+    // index the id
+    {
+
+        // initialized data
+        size_t i = (size_t) hash & _intern.mask;
+
+        // probe for an empty slot
+        while ( _intern._table[i] ) i = ( i + 1 ) & _intern.mask;
+
+        // store the id
+        _intern._table[i] = id + 1;
+    }
+
+    // the id is in use
+    _intern.size++;
+
+    // unlock
+    mutex_unlock(&_intern._lock);
+
+    // return the id to the caller
+    *p_id = id;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_string:
+                #ifndef NDEBUG
+                    log_error("[identity] [intern] Null pointer provided for parameter \"p_string\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_id:
+                #ifndef NDEBUG
+                    log_error("[identity] [intern] Null pointer provided for parameter \"p_id\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            too_long:
+                #ifndef NDEBUG
+                    log_error("[identity] [intern] Parameter \"len\" is too long in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // intern errors
+        {
+            table_full:
+                #ifndef NDEBUG
+                    log_error("[identity] [intern] Intern table is full in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // unlock
+                mutex_unlock(&_intern._lock);
+
+                // error
+                return 0;
+        }
+
+        // standard library errors
+        {
+            no_mem:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // unlock
+                mutex_unlock(&_intern._lock);
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int intern_string_find ( const char *p_string, size_t len, uint32_t *p_id )
+{
+
+    // argument check
+    if ( NULL == p_string ) goto no_string;
+    if ( NULL ==     p_id ) goto no_id;
+
+    // initialized data
+    uint64_t hash = hash_fnv64(p_string, len);
+    uint32_t id   = INTERN_NONE;
+
+    // construct the table once
+    call_once(&_constructed, intern_construct);
+
+    // find the string
+    mutex_lock(&_intern._lock);
+    id = intern_find(p_string, len, hash);
+    mutex_unlock(&_intern._lock);
+
+    // not found
+    if ( INTERN_NONE == id ) return 0;
+
+    // return the id to the caller
+    *p_id = id;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_string:
+                #ifndef NDEBUG
+                    log_error("[identity] [intern] Null pointer provided for parameter \"p_string\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_id:
+                #ifndef NDEBUG
+                    log_error("[identity] [intern] Null pointer provided for parameter \"p_id\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+const char *intern_string_get ( uint32_t id )
+{
+
+    // error check
+    if ( id >= _intern.size ) return NULL;
+
+    // done
+    return _intern._pages[id / INTERN_PAGE_QUANTITY][id % INTERN_PAGE_QUANTITY].p_string;
+}
+
+size_t intern_string_len ( uint32_t id )
+{
+
+    // error check
+    if ( id >= _intern.size ) return 0;
+
+    // done
+    return _intern._pages[id / INTERN_PAGE_QUANTITY][id % INTERN_PAGE_QUANTITY].len;
+}
+
+size_t intern_size ( void )
+{
+
+    // done
+    return _intern.size;
+}
@@ -0,0 +1,496 @@
+/** !
+ * Loader
+ *
+ * @file src/loader.c
+ *
+ * @author Jacob Smith
+ */
+
+// header
+#include <identity/loader.h>
+
+// standard library
+#include <dirent.h>
+
+// gsdk
+/// reflection
+#include <reflection/json.h>
+
+// enumeration definitions
+enum loader_kind_e
+{
+    LOADER_KIND_ORG   = 0,
+    LOADER_KIND_ROLE  = 1,
+    LOADER_KIND_GROUP = 2,
+    LOADER_KIND_USER  = 3
+};
+
+// structure definitions
+struct loader_job_s
+{
+    enum loader_kind_e  kind;
+    char               *p_path;
+    void               *p_value; // null until parsed
+};
+
+struct loader_s
+{
+    struct loader_job_s *_jobs;
+    size_t               jobs_len;
+    size_t               jobs_max;
+    semaphore            _done;
+};
+
+struct loader_task_s
+{
+    struct loader_s *p_loader;
+    size_t           begin;
+    size_t           end;
+    size_t           failures;
+    size_t           bytes;
+};
+
+// function declarations
+int loader_job_add ( struct loader_s *p_loader, enum loader_kind_e kind, const char *p_directory, const char *p_name );
+int loader_directory_add ( struct loader_s *p_loader, enum loader_kind_e kind, const char *p_path, const char *p_directory );
+int loader_file_read ( const char *p_path, char **pp_buffer, size_t *p_buffer_max, size_t *p_len );
+void *loader_task ( struct loader_task_s *p_task );
+
+int loader_job_add ( struct loader_s *p_loader, enum loader_kind_e kind, const char *p_directory, const char *p_name )
+{
+
+    // initialized data
+    char _path[LOADER_PATH_MAX] = { 0 };
+    int  len                    = snprintf(_path, sizeof(_path), "%s/%s", p_directory, p_name);
+
+    // error check
+    if ( 0 > len || sizeof(_path) <= (size_t) len ) return 0;
+
+    // grow the job list
+    if ( p_loader->jobs_len == p_loader->jobs_max )
+    {
+
+        // initialized data
+        size_t               jobs_max = ( p_loader->jobs_max ) ? p_loader->jobs_max * 2 : 1024;
+        struct loader_job_s *_jobs    = default_allocator(p_loader->_jobs, jobs_max * sizeof(struct loader_job_s));
+
+        // error check
+        if ( NULL == _jobs ) return 0;
+
+        // store the job list
+        p_loader->_jobs    = _jobs,
+        p_loader->jobs_max = jobs_max;
+    }
+
+    // add the job
+    p_loader->_jobs[p_loader->jobs_len] = (struct loader_job_s)
+    {
+        .kind    = kind,
+        .p_path  = strdup(_path),
+        .p_value = NULL
+    };
+
+    // error check
+    if ( NULL == p_loader->_jobs[p_loader->jobs_len].p_path ) return 0;
+
+    // increment the quantity of jobs
+    p_loader->jobs_len++;
+
+    // success
+    return 1;
+}
+
+int loader_directory_add ( struct loader_s *p_loader, enum loader_kind_e kind, const char *p_path, const char *p_directory )
+{
+
+    // initialized data
+    char           _directory[LOADER_PATH_MAX] = { 0 };
+    DIR           *p_dir                       = NULL;
+    struct dirent *p_entry                     = NULL;
+    int            len                         = snprintf(_directory, sizeof(_directory), "%s/%s", p_path, p_directory);
+
+    // error check
+    if ( 0 > len || sizeof(_directory) <= (size_t) len ) return 0;
+
+    // open the directory. A missing directory holds nothing
+    p_dir = opendir(_directory);
+    if ( NULL == p_dir ) return 1;
+
+    // add every JSON file
+    while ( ( p_entry = readdir(p_dir) ) )
+    {
+
+        // initialized data
+        size_t name_len = strlen(p_entry->d_name);
+
+        // skip everything else
+        if ( name_len < 6 || 0 != strcmp(&p_entry->d_name[name_len - 5], ".json") ) continue;
+
+        // add the file
+        if ( 0 == loader_job_add(p_loader, kind, _directory, p_entry->d_name) ) goto failed;
+    }
+
+    // close the directory
+    closedir(p_dir);
+
+    // success
+    return 1;
+
+    // close the directory
+    failed:
+        closedir(p_dir);
+
+    // error
+    return 0;
+}
+
+int loader_file_read ( const char *p_path, char **pp_buffer, size_t *p_buffer_max, size_t *p_len )
+{
+
+    // initialized data
+    FILE *p_file = fopen(p_path, "rb");
+    long  len    = 0;
+
+    // error check
+    if ( NULL == p_file ) return 0;
+
+    // measure the file
+    if ( fseek(p_file, 0, SEEK_END) || 0 > ( len = ftell(p_file) ) || fseek(p_file, 0, SEEK_SET) ) goto failed;
+
+    // grow the buffer. Each task reuses one buffer for all of its files
+    if ( *p_buffer_max < (size_t) len + 1 )
+    {
+
+        // initialized data
+        char *p_buffer = default_allocator(*pp_buffer, (size_t) len + 1);
+
+        // error check
+        if ( NULL == p_buffer ) goto failed;
+
+        // store the buffer
+        *pp_buffer    = p_buffer,
+        *p_buffer_max = (size_t) len + 1;
+    }
+
+    // read the file
+    if ( (size_t) len != fread(*pp_buffer, 1, (size_t) len, p_file) ) goto failed;
+
+    // null terminate
+    (*pp_buffer)[len] = '\0';
+
+    // return the length to the caller
+    *p_len = (size_t) len;
+
+    // close the file
+    fclose(p_file);
+
+    // success
+    return 1;
+
+    // close the file
+    failed:
+        fclose(p_file);
+
+    // error
+    return 0;
+}
+
+void *loader_task ( struct loader_task_s *p_task )
+{
+
+    // initialized data
+    struct loader_s *p_loader   = p_task->p_loader;
+    char            *p_buffer   = NULL;
+    size_t           buffer_max = 0;
+
+    // parse each file
+    for (size_t i = p_task->begin; i < p_task->end; i++)
+    {
+
+        // initialized data
+        struct loader_job_s *p_job   = &p_loader->_jobs[i];
+        json_value          *p_value = NULL;
+        size_t               len     = 0;
+        int                  parsed  = 0;
+
+        // read the file
+        if ( 0 == loader_file_read(p_job->p_path, &p_buffer, &buffer_max, &len) ) goto failed;
+
+        // count the bytes
+        p_task->bytes += len;
+
+        // parse the file
+        if ( 0 == json_value_parse(p_buffer, NULL, &p_value) ) goto failed;
+
+        // construct the value
+        switch ( p_job->kind )
+        {
+            case LOADER_KIND_ORG  : parsed = org_from_json  ((org   **) &p_job->p_value, p_value); break;
+            case LOADER_KIND_ROLE : parsed = role_from_json ((role  **) &p_job->p_value, p_value); break;
+            case LOADER_KIND_GROUP: parsed = group_from_json((group **) &p_job->p_value, p_value); break;
+            case LOADER_KIND_USER : parsed = user_from_json ((user  **) &p_job->p_value, p_value); break;
+        }
+
+        // release the parsed file
+        json_value_free(p_value);
+
+        // error check
+        if ( 0 == parsed ) goto failed;
+
+        // next file
+        continue;
+
+        // count the failure
+        failed:
+            #ifndef NDEBUG
+                log_error("[identity] [loader] Failed to load \"%s\"\n", p_job->p_path);
+            #endif
+
+            p_job->p_value = NULL;
+            p_task->failures++;
+    }
+
+    // release the buffer
+    p_buffer = default_allocator(p_buffer, 0);
+
+    // this task is done
+    semaphore_signal(&p_loader->_done);
+
+    // done
+    return NULL;
+}
+
+int loader_load ( const char *p_path, thread_pool *p_thread_pool, size_t worker_quantity, loader_result *p_result )
+{
+
+    // argument check
+    if ( NULL ==        p_path ) goto no_path;
+    if ( NULL == p_thread_pool ) goto no_thread_pool;
+    if ( NULL ==      p_result ) goto no_result;
+
+    // initialized data
+    struct loader_s       _loader     = { 0 };
+    struct loader_task_s *_tasks      = NULL;
+    size_t                tasks_len   = 0,
+                          dispatched  = 0;
+
+    // clear the result
+    *p_result = (loader_result) { 0 };
+
+    // list every file
+    if ( 0 == loader_job_add(&_loader, LOADER_KIND_ORG, p_path, "org.json") ) goto failed_to_list;
+    if ( 0 == loader_directory_add(&_loader, LOADER_KIND_ROLE , p_path, "roles" ) ) goto failed_to_list;
+    if ( 0 == loader_directory_add(&_loader, LOADER_KIND_GROUP, p_path, "groups") ) goto failed_to_list;
+    if ( 0 == loader_directory_add(&_loader, LOADER_KIND_USER , p_path, "users" ) ) goto failed_to_list;
+
+    // split the files into a few tasks per worker, so a slow disk or a
+    // large file doesn't stall the whole load
+    tasks_len = ( worker_quantity ? worker_quantity : 1 ) * LOADER_TASKS_PER_WORKER;
+    if ( tasks_len > _loader.jobs_len ) tasks_len = _loader.jobs_len;
+
+    // allocate the tasks
+    _tasks = default_allocator(0, tasks_len * sizeof(struct loader_task_s));
+    if ( NULL == _tasks ) goto no_mem;
+
+    // construct a semaphore to wait on
+    if ( 0 == semaphore_create(&_loader._done, 0) ) goto failed_to_construct_semaphore;
+
+    // dispatch the tasks
+    for (size_t i = 0; i < tasks_len; i++)
+    {
+
+        // populate the task
+        _tasks[i] = (struct loader_task_s)
+        {
+            .p_loader = &_loader,
+            .begin    = _loader.jobs_len * i / tasks_len,
+            .end      = _loader.jobs_len * ( i + 1 ) / tasks_len,
+            .failures = 0,
+            .bytes    = 0
+        };
+
+        // dispatch the task. If the pool refuses, run it here
+        if ( 0 == thread_pool_execute(p_thread_pool, (fn_thread_pool_task *) loader_task, &_tasks[i]) )
+            (void) loader_task(&_tasks[i]);
+
+        // count the task
+        dispatched++;
+    }
+
+    // wait for every task
+    for (size_t i = 0; i < dispatched; i++)
+        semaphore_wait(&_loader._done);
+
+    // destroy the semaphore
+    semaphore_destroy(&_loader._done);
+
+    // sum the counters
+    for (size_t i = 0; i < tasks_len; i++)
+        p_result->failures += _tasks[i].failures,
+        p_result->bytes    += _tasks[i].bytes;
+
+    // release the tasks
+    _tasks = default_allocator(_tasks, 0);
+
+    // allocate the result arrays
+    p_result->pp_roles  = default_allocator(0, ( _loader.jobs_len + 1 ) * sizeof(role *));
+    p_result->pp_groups = default_allocator(0, ( _loader.jobs_len + 1 ) * sizeof(group *));
+    p_result->pp_users  = default_allocator(0, ( _loader.jobs_len + 1 ) * sizeof(user *));
+
+    // error check
+    if ( NULL == p_result->pp_roles || NULL == p_result->pp_groups || NULL == p_result->pp_users ) goto no_mem_result;
+
+    // sort the values by kind
+    for (size_t i = 0; i < _loader.jobs_len; i++)
+    {
+
+        // initialized data
+        struct loader_job_s *p_job = &_loader._jobs[i];
+
+        // release the path
+        p_job->p_path = default_allocator(p_job->p_path, 0);
+
+        // skip failures
+        if ( NULL == p_job->p_value ) continue;
+
+        // store the value
+        switch ( p_job->kind )
+        {
+            case LOADER_KIND_ORG  : p_result->p_org                             = p_job->p_value; break;
+            case LOADER_KIND_ROLE : p_result->pp_roles [p_result->roles_len++ ] = p_job->p_value; break;
+            case LOADER_KIND_GROUP: p_result->pp_groups[p_result->groups_len++] = p_job->p_value; break;
+            case LOADER_KIND_USER : p_result->pp_users [p_result->users_len++ ] = p_job->p_value; break;
+        }
+    }
+
+    // release the job list
+    _loader._jobs = default_allocator(_loader._jobs, 0);
+
+    // error check
+    if ( NULL == p_result->p_org ) goto no_org;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_path:
+                #ifndef NDEBUG
+                    log_error("[identity] [loader] Null pointer provided for parameter \"p_path\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_thread_pool:
+                #ifndef NDEBUG
+                    log_error("[identity] [loader] Null pointer provided for parameter \"p_thread_pool\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_result:
+                #ifndef NDEBUG
+                    log_error("[identity] [loader] Null pointer provided for parameter \"p_result\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // loader errors
+        {
+            failed_to_list:
+                #ifndef NDEBUG
+                    log_error("[identity] [loader] Failed to list the files of \"%s\" in call to function \"%s\"\n", p_path, __FUNCTION__);
+                #endif
+
+                // release the job list
+                goto release_jobs;
+
+            no_org:
+                #ifndef NDEBUG
+                    log_error("[identity] [loader] Failed to load \"%s/org.json\" in call to function \"%s\"\n", p_path, __FUNCTION__);
+                #endif
+
+                // release the result
+                (void) loader_result_release(p_result);
+
+                // error
+                return 0;
+        }
+
+        // sync errors
+        {
+            failed_to_construct_semaphore:
+                #ifndef NDEBUG
+                    log_error("[identity] [loader] Failed to construct semaphore in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // release the tasks
+                _tasks = default_allocator(_tasks, 0);
+
+                // release the job list
+                goto release_jobs;
+        }
+
+        // standard library errors
+        {
+            no_mem_result:
+                (void) loader_result_release(p_result);
+
+                // fall through
+                goto no_mem;
+
+            no_mem:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // fall through
+                goto release_jobs;
+
+            release_jobs:
+                for (size_t i = 0; i < _loader.jobs_len; i++)
+                    _loader._jobs[i].p_path = default_allocator(_loader._jobs[i].p_path, 0);
+                _loader._jobs = default_allocator(_loader._jobs, 0);
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int loader_result_release ( loader_result *p_result )
+{
+
+    // argument check
+    if ( NULL == p_result ) goto no_result;
+
+    // release the arrays
+    p_result->pp_roles  = default_allocator(p_result->pp_roles , 0),
+    p_result->pp_groups = default_allocator(p_result->pp_groups, 0),
+    p_result->pp_users  = default_allocator(p_result->pp_users , 0);
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_result:
+                #ifndef NDEBUG
+                    log_error("[identity] [loader] Null pointer provided for parameter \"p_result\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
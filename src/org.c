@@ -10,10 +10,13 @@
 #include <identity/org.h>
 
 // structure definitions
+//
+// An org is a fixed size record, so a record means the same thing on the heap
+// and in a mapped snapshot
 struct org_s
 {
-    size_t id;
-    char   _name[64+1];
+    uint64_t id;
+    char     _name[64+1];
 };
 
 int org_construct
@@ -35,6 +38,9 @@ int org_construct
     // error check
     if ( NULL == p_org ) goto no_mem;
 
+    // zero the record, so packed records have no stray bytes
+    memset(p_org, 0, sizeof(org));
+
     // populate the org struct
     *p_org = (org)
     {
@@ -44,7 +50,6 @@ int org_construct
 
     // copy the name
     strncpy(p_org->_name, p_name, sizeof(p_org->_name) - 1);
-    p_org->_name[strlen(p_name)] = '\0';
 
     // return a pointer to the caller
     *pp_org = p_org;
@@ -140,7 +145,7 @@ int org_from_json
 
     // get the name
     p_name = dict_get(p_dict, "name");
-    p_org_id = dict_get(p_dict, "org_id");
+    p_org_id = dict_get(p_dict, "id");
 
     // error check
     if ( NULL ==   p_name ) goto no_name;
@@ -150,6 +155,9 @@ int org_from_json
     if (  JSON_VALUE_STRING !=   p_name->type ) goto name_wrong_type;
     if ( JSON_VALUE_INTEGER != p_org_id->type ) goto org_id_wrong_type;
 
+    // zero the record, so packed records have no stray bytes
+    memset(p_org, 0, sizeof(org));
+
     // populate the org struct
     *p_org = (org)
     {
@@ -159,7 +167,6 @@ int org_from_json
 
     // copy the name
     strncpy(p_org->_name, p_name->string, sizeof(p_org->_name) - 1);
-    p_org->_name[strlen(p_name->string)] = '\0';
 
     // return a pointer to the caller
     *pp_org = p_org;
@@ -209,7 +216,7 @@ int org_from_json
 
             no_org_id:
                 #ifndef NDEBUG
-                    log_error("[identity] [org] Parameter \"p_value\" missing property \"org_id\" in call to function \"%s\"\n", __FUNCTION__);
+                    log_error("[identity] [org] Parameter \"p_value\" missing property \"id\" in call to function \"%s\"\n", __FUNCTION__);
                 #endif
 
                 // error
@@ -225,7 +232,7 @@ int org_from_json
             
             org_id_wrong_type:
                 #ifndef NDEBUG
-                    log_error("[identity] [org] Property \"org_id\" of parameter \"p_value\" must be of type [ integer ] in call to function \"%s\"\n", __FUNCTION__);
+                    log_error("[identity] [org] Property \"id\" of parameter \"p_value\" must be of type [ integer ] in call to function \"%s\"\n", __FUNCTION__);
                 #endif
 
                 // error
@@ -279,37 +286,97 @@ int org_comparator ( org *p_a, org *p_b )
 {
 
     // success
-    return p_b->id - p_a->id;
+    return ( p_b->id > p_a->id ) - ( p_b->id < p_a->id );
 }
 
 void *org_key_accessor ( org *p_org )
 {
 
     // success
-    return (void *)p_org->id;
+    return (void *)(size_t) p_org->id;
 }
 
 int org_pack ( void *p_buffer, const org *const p_org )
 {
 
-    // initialized data
-    char *p_offset = (char *) p_buffer;
-
-    // pack org id
-    p_offset += pack_pack(p_offset, "%i64", p_org->id),
+    // argument check
+    if ( NULL == p_org ) goto no_org;
 
-    // pack the name
-    p_offset += pack_pack(p_offset, "%s", p_org->_name);
+    // the record is already packed. A null buffer asks for the size
+    if ( p_buffer ) memcpy(p_buffer, p_org, sizeof(org));
 
     // done
-    return (void *)p_offset - (void *)p_buffer;
+    return (int) sizeof(org);
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_org:
+                #ifndef NDEBUG
+                    log_error("[identity] [org] Null pointer provided for parameter \"p_org\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
 }
 
-int org_unpack ( void *const p_value, void *p_buffer )
+int org_unpack ( org **pp_org, void *p_buffer, size_t size )
 {
 
-    // 
+    // argument check
+    if ( NULL == pp_org ) goto no_org;
+    if ( NULL == p_buffer ) goto no_buffer;
+
+    // initialized data
+    org *p_org = p_buffer;
+
+    // check the record
+    if ( 0 != ( (size_t) p_buffer & 7 ) ) goto bad_record;
+    if ( size < sizeof(org) ) goto bad_record;
+    if ( NULL == memchr(p_org->_name, '\0', sizeof(p_org->_name)) ) goto bad_record;
+
+
+    // bind the record in place
+    *pp_org = p_org;
 
     // done
-    return 0;
+    return (int) sizeof(org);
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_org:
+                #ifndef NDEBUG
+                    log_error("[identity] [org] Null pointer provided for parameter \"pp_org\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_buffer:
+                #ifndef NDEBUG
+                    log_error("[identity] [org] Null pointer provided for parameter \"p_buffer\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // org errors
+        {
+            bad_record:
+                #ifndef NDEBUG
+                    log_error("[identity] [org] Malformed org record in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
 }
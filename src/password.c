@@ -0,0 +1,289 @@
+/** !
+ * Password
+ *
+ * @file src/password.c
+ *
+ * @author Jacob Smith
+ */
+
+// header
+#include <identity/password.h>
+
+// structure definitions
+struct password_pool_s
+{
+    thread_pool *p_thread_pool;
+    mutex        _lock;
+    size_t       in_flight;
+    size_t       in_flight_max;
+};
+
+struct password_job_s
+{
+    const user          *p_user;
+    const unsigned char *p_digest;
+    bool                 match;
+    semaphore           *p_done;
+};
+
+void *password_task ( struct password_job_s *p_job )
+{
+
+    // stretch, and compare
+    p_job->match = user_password_verify(p_job->p_user, p_job->p_digest);
+
+    // this job is done
+    semaphore_signal(p_job->p_done);
+
+    // done
+    return NULL;
+}
+
+int password_pool_construct ( password_pool **pp_password_pool, size_t threads, size_t in_flight_max )
+{
+
+    // argument check
+    if ( NULL == pp_password_pool ) goto no_password_pool;
+    if ( 0 == threads || 0 == in_flight_max ) goto no_capacity;
+
+    // initialized data
+    password_pool *p_password_pool = default_allocator(NULL, sizeof(password_pool));
+
+    // error check
+    if ( NULL == p_password_pool ) goto no_mem;
+
+    // populate the pool
+    *p_password_pool = (password_pool)
+    {
+        .p_thread_pool = NULL,
+        .in_flight     = 0,
+        .in_flight_max = in_flight_max
+    };
+
+    // construct the lock
+    if ( 0 == mutex_create(&p_password_pool->_lock) ) goto failed_to_construct_mutex;
+
+    // construct the threads
+    if ( 0 == thread_pool_construct(&p_password_pool->p_thread_pool, threads) ) goto failed_to_construct_thread_pool;
+
+    // return a pointer to the caller
+    *pp_password_pool = p_password_pool;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_password_pool:
+                #ifndef NDEBUG
+                    log_error("[identity] [password] Null pointer provided for parameter \"pp_password_pool\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_capacity:
+                #ifndef NDEBUG
+                    log_error("[identity] [password] Parameters \"threads\" and \"in_flight_max\" must be positive in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // sync errors
+        {
+            failed_to_construct_thread_pool:
+                #ifndef NDEBUG
+                    log_error("[identity] [password] Failed to construct thread pool in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // release the lock
+                mutex_destroy(&p_password_pool->_lock);
+
+                // fall through
+                goto release_pool;
+
+            failed_to_construct_mutex:
+                #ifndef NDEBUG
+                    log_error("[identity] [password] Failed to construct mutex in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // fall through
+                goto release_pool;
+
+            release_pool:
+                p_password_pool = default_allocator(p_password_pool, 0);
+
+                // error
+                return 0;
+        }
+
+        // standard library errors
+        {
+            no_mem:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+size_t password_pool_verify ( password_pool *p_password_pool, const user *const *_p_users, const unsigned char *const *_digests, size_t count, enum password_verdict_e *_verdicts )
+{
+
+    // argument check
+    if ( NULL == p_password_pool ) goto no_password_pool;
+    if ( 0 == count ) return 0;
+
+    // initialized data
+    struct password_job_s  _jobs[PASSWORD_BATCH_MAX];
+    semaphore              _done;
+    size_t                 admitted   = 0,
+                           dispatched = 0;
+
+    // admit what fits, and no more
+    mutex_lock(&p_password_pool->_lock);
+    admitted = p_password_pool->in_flight_max - p_password_pool->in_flight;
+    if ( admitted > count ) admitted = count;
+    if ( admitted > PASSWORD_BATCH_MAX ) admitted = PASSWORD_BATCH_MAX;
+    p_password_pool->in_flight += admitted;
+    mutex_unlock(&p_password_pool->_lock);
+
+    // the rest are busy
+    for (size_t i = admitted; i < count; i++)
+        _verdicts[i] = PASSWORD_BUSY;
+
+    // fast exit
+    if ( 0 == admitted ) return 0;
+
+    // construct a semaphore to wait on
+    if ( 0 == semaphore_create(&_done, 0) ) goto failed_to_construct_semaphore;
+
+    // dispatch the jobs
+    for (size_t i = 0; i < admitted; i++)
+    {
+
+        // populate the job
+        _jobs[i] = (struct password_job_s)
+        {
+            .p_user   = _p_users[i],
+            .p_digest = _digests[i],
+            .match    = false,
+            .p_done   = &_done
+        };
+
+        // dispatch the job. A refused job is busy, it never runs here
+        if ( 0 == thread_pool_execute(p_password_pool->p_thread_pool, (fn_thread_pool_task *) password_task, &_jobs[i]) )
+        {
+            _verdicts[i] = PASSWORD_BUSY;
+            _jobs[i].p_done = NULL;
+            continue;
+        }
+
+        // count the job
+        dispatched++;
+    }
+
+    // wait for every job
+    for (size_t i = 0; i < dispatched; i++)
+        semaphore_wait(&_done);
+
+    // destroy the semaphore
+    semaphore_destroy(&_done);
+
+    // store the verdicts
+    for (size_t i = 0; i < admitted; i++)
+        if ( _jobs[i].p_done )
+            _verdicts[i] = ( _jobs[i].match ) ? PASSWORD_MATCH : PASSWORD_MISMATCH;
+
+    // make room for others
+    mutex_lock(&p_password_pool->_lock);
+    p_password_pool->in_flight -= admitted;
+    mutex_unlock(&p_password_pool->_lock);
+
+    // done
+    return dispatched;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_password_pool:
+                #ifndef NDEBUG
+                    log_error("[identity] [password] Null pointer provided for parameter \"p_password_pool\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // sync errors
+        {
+            failed_to_construct_semaphore:
+                #ifndef NDEBUG
+                    log_error("[identity] [password] Failed to construct semaphore in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // every admitted password is busy
+                for (size_t i = 0; i < admitted; i++)
+                    _verdicts[i] = PASSWORD_BUSY;
+
+                // make room for others
+                mutex_lock(&p_password_pool->_lock);
+                p_password_pool->in_flight -= admitted;
+                mutex_unlock(&p_password_pool->_lock);
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int password_pool_destroy ( password_pool **pp_password_pool )
+{
+
+    // argument check
+    if ( NULL == pp_password_pool ) goto no_password_pool;
+
+    // initialized data
+    password_pool *p_password_pool = *pp_password_pool;
+
+    // fast exit
+    if ( NULL == p_password_pool ) return 1;
+
+    // no more pointer for caller
+    *pp_password_pool = NULL;
+
+    // release the threads, then the lock
+    thread_pool_destroy(&p_password_pool->p_thread_pool);
+    mutex_destroy(&p_password_pool->_lock);
+
+    // release the pool
+    p_password_pool = default_allocator(p_password_pool, 0);
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_password_pool:
+                #ifndef NDEBUG
+                    log_error("[identity] [password] Null pointer provided for parameter \"pp_password_pool\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
@@ -0,0 +1,1036 @@
+/** !
+ * Permission matcher
+ *
+ * @file src/permission.c
+ *
+ * @author Jacob Smith
+ */
+
+// header
+#include <identity/permission.h>
+
+// preprocessor definitions
+#define PERMISSION_NONE       UINT32_MAX
+#define PERMISSION_STATES_MAX ( 1 << 20 )
+
+// structure definitions
+//
+// An edge from a state on one literal segment. The segment bytes live in the
+// pool of the edge table, and edges from the same state form a list
+struct permission_edge_s
+{
+    uint64_t hash;
+    uint32_t from;
+    uint32_t to;
+    uint32_t offset;
+    uint32_t len;
+    uint32_t next;
+};
+
+struct permission_edges_s
+{
+    struct permission_edge_s *_edges;
+    size_t                    len;
+    size_t                    max;
+    uint32_t                 *_table;    // edge index + 1, or 0 when empty
+    size_t                    mask;
+    char                     *p_pool;
+    size_t                    pool_len;
+    size_t                    pool_max;
+};
+
+// A node of the permission trie, before it is made deterministic
+struct permission_node_s
+{
+    uint32_t first;   // the first literal edge, or PERMISSION_NONE
+    uint32_t star;    // the node after a '*' segment, or 0
+    uint32_t end_id;  // the permission that ends here, or PERMISSION_NONE
+    uint32_t rest_id; // the permission whose trailing '*' starts here, or PERMISSION_NONE
+};
+
+// A state of the automaton. The ids of the permissions it accepts are rest
+// ids, then end ids
+struct permission_state_s
+{
+    uint32_t star;      // the state after any other segment, or PERMISSION_NONE
+    uint32_t ids_offset;
+    uint32_t rest_len;  // accepted with one or more segments left
+    uint32_t end_len;   // accepted with no segments left
+};
+
+struct permission_role_s
+{
+    size_t   id;
+    uint32_t ids_offset;
+    uint32_t ids_len;
+};
+
+struct permission_matcher_s
+{
+    struct permission_edges_s  _edges;
+    struct permission_state_s *_states;
+    size_t                     states_len;
+    uint32_t                  *_ids;
+    size_t                     ids_len;
+    struct permission_role_s  *_roles;     // ascending by id
+    size_t                     roles_len;
+    uint32_t                  *_role_ids;
+    size_t                     permissions_len;
+};
+
+// the subset construction
+struct permission_compiler_s
+{
+    struct permission_edges_s  _edges;         // trie edges
+    struct permission_node_s  *_nodes;
+    size_t                     nodes_len;
+    size_t                     nodes_max;
+    uint32_t                  *_sets;          // the trie nodes of every state, back to back
+    size_t                     sets_len;
+    size_t                     sets_max;
+    uint32_t                  *_set_offsets;   // per state
+    uint32_t                  *_set_lens;      // per state
+    size_t                     states_max;
+    size_t                     ids_max;
+    uint32_t                  *_set_table;     // state + 1, or 0 when empty
+    size_t                     set_mask;
+    uint32_t                  *_interned;      // interned id -> permission id, so repeats skip the trie
+    size_t                     interned_len;
+};
+
+// A run of matching permission ids. Return true to stop the walk
+typedef bool (fn_permission_visit) ( void *p_context, const uint32_t *_ids, size_t ids_len );
+
+// the ids a match has room for
+struct permission_match_s
+{
+    uint32_t *_ids;
+    size_t    len;
+    size_t    max;
+};
+
+// the pool the edge comparator reads segments from
+static _Thread_local const struct permission_edges_s *p_sort_edges = NULL;
+
+// function declarations
+int permission_grow ( void **pp_array, size_t *p_max, size_t need, size_t size );
+uint64_t permission_segment_hash ( uint32_t from, const char *p_segment, size_t len );
+uint32_t permission_edges_find ( const struct permission_edges_s *p_edges, uint32_t from, const char *p_segment, size_t len );
+uint32_t permission_edges_add ( struct permission_edges_s *p_edges, uint32_t from, const char *p_segment, size_t len, uint32_t to, uint32_t next );
+void permission_edges_release ( struct permission_edges_s *p_edges );
+uint32_t permission_node_add ( struct permission_compiler_s *p_compiler );
+uint32_t permission_insert ( struct permission_compiler_s *p_compiler, const char *p_permission, uint32_t *p_permissions_len );
+int permission_edge_comparator ( const void *p_a, const void *p_b );
+int permission_id_comparator ( const void *p_a, const void *p_b );
+uint32_t permission_state_get ( struct permission_compiler_s *p_compiler, permission_matcher *p_matcher, uint32_t *_set, size_t set_len );
+int permission_state_compile ( struct permission_compiler_s *p_compiler, permission_matcher *p_matcher, uint32_t state );
+bool permission_matcher_walk ( const permission_matcher *p_permission_matcher, const char *p_action, const char *p_resource, fn_permission_visit *pfn_visit, void *p_context );
+bool permission_match_visit ( void *p_context, const uint32_t *_ids, size_t ids_len );
+bool permission_set_visit ( void *p_context, const uint32_t *_ids, size_t ids_len );
+
+int permission_grow ( void **pp_array, size_t *p_max, size_t need, size_t size )
+{
+
+    // initialized data
+    size_t  max     = ( *p_max ) ? *p_max : 16;
+    void   *p_array = NULL;
+
+    // fast exit
+    if ( need <= *p_max ) return 1;
+
+    // double until it fits
+    while ( max < need ) max *= 2;
+
+    // grow
+    p_array = default_allocator(*pp_array, max * size);
+
+    // error check
+    if ( NULL == p_array ) return 0;
+
+    // store the array
+    *pp_array = p_array,
+    *p_max    = max;
+
+    // success
+    return 1;
+}
+
+uint64_t permission_segment_hash ( uint32_t from, const char *p_segment, size_t len )
+{
+
+    // done
+    return hash_fnv64(p_segment, len) ^ ( (uint64_t) from * 0x9e3779b97f4a7c15ULL );
+}
+
+uint32_t permission_edges_find ( const struct permission_edges_s *p_edges, uint32_t from, const char *p_segment, size_t len )
+{
+
+    // initialized data
+    uint64_t hash = permission_segment_hash(from, p_segment, len);
+
+    // fast exit
+    if ( NULL == p_edges->_table ) return PERMISSION_NONE;
+
+    // probe
+    for (size_t i = hash & p_edges->mask; p_edges->_table[i]; i = ( i + 1 ) & p_edges->mask)
+    {
+
+        // initialized data
+        const struct permission_edge_s *p_edge = &p_edges->_edges[p_edges->_table[i] - 1];
+
+        // match
+        if ( p_edge->hash == hash && p_edge->from == from && p_edge->len == len && 0 == memcmp(p_edges->p_pool + p_edge->offset, p_segment, len) )
+            return p_edges->_table[i] - 1;
+    }
+
+    // not found
+    return PERMISSION_NONE;
+}
+
+uint32_t permission_edges_add ( struct permission_edges_s *p_edges, uint32_t from, const char *p_segment, size_t len, uint32_t to, uint32_t next )
+{
+
+    // initialized data
+    uint32_t index = (uint32_t) p_edges->len;
+
+    // grow the edges and the pool
+    if ( 0 == permission_grow((void **) &p_edges->_edges, &p_edges->max, p_edges->len + 1, sizeof(struct permission_edge_s)) ) return PERMISSION_NONE;
+    if ( 0 == permission_grow((void **) &p_edges->p_pool, &p_edges->pool_max, p_edges->pool_len + len + 1, 1) ) return PERMISSION_NONE;
+
+    // grow the table past twice the edges
+    if ( 2 * ( p_edges->len + 1 ) > ( p_edges->_table ? p_edges->mask + 1 : 0 ) )
+    {
+
+        // initialized data
+        size_t    capacity = ( p_edges->_table ) ? ( p_edges->mask + 1 ) * 2 : 64;
+        uint32_t *_table   = default_allocator(NULL, capacity * sizeof(uint32_t));
+
+        // error check
+        if ( NULL == _table ) return PERMISSION_NONE;
+
+        // every slot starts empty
+        memset(_table, 0, capacity * sizeof(uint32_t));
+
+        // place every edge
+        for (size_t i = 0; i < p_edges->len; i++)
+        {
+            size_t j = p_edges->_edges[i].hash & ( capacity - 1 );
+            while ( _table[j] ) j = ( j + 1 ) & ( capacity - 1 );
+            _table[j] = (uint32_t) i + 1;
+        }
+
+        // swap in the new table
+        p_edges->_table = default_allocator(p_edges->_table, 0);
+        p_edges->_table = _table,
+        p_edges->mask   = capacity - 1;
+    }
+
+    // store the segment
+    memcpy(p_edges->p_pool + p_edges->pool_len, p_segment, len);
+    p_edges->p_pool[p_edges->pool_len + len] = '\0';
+
+    // store the edge
+    p_edges->_edges[index] = (struct permission_edge_s)
+    {
+        .hash   = permission_segment_hash(from, p_segment, len),
+        .from   = from,
+        .to     = to,
+        .offset = (uint32_t) p_edges->pool_len,
+        .len    = (uint32_t) len,
+        .next   = next
+    };
+    p_edges->pool_len += len + 1,
+    p_edges->len++;
+
+    // place the edge
+    {
+        size_t j = p_edges->_edges[index].hash & p_edges->mask;
+        while ( p_edges->_table[j] ) j = ( j + 1 ) & p_edges->mask;
+        p_edges->_table[j] = index + 1;
+    }
+
+    // done
+    return index;
+}
+
+void permission_edges_release ( struct permission_edges_s *p_edges )
+{
+
+    // release everything
+    p_edges->_edges = default_allocator(p_edges->_edges, 0),
+    p_edges->_table = default_allocator(p_edges->_table, 0),
+    p_edges->p_pool = default_allocator(p_edges->p_pool, 0);
+}
+
+uint32_t permission_node_add ( struct permission_compiler_s *p_compiler )
+{
+
+    // grow the nodes
+    if ( 0 == permission_grow((void **) &p_compiler->_nodes, &p_compiler->nodes_max, p_compiler->nodes_len + 1, sizeof(struct permission_node_s)) ) return PERMISSION_NONE;
+
+    // store an empty node
+    p_compiler->_nodes[p_compiler->nodes_len] = (struct permission_node_s)
+    {
+        .first   = PERMISSION_NONE,
+        .star    = 0,
+        .end_id  = PERMISSION_NONE,
+        .rest_id = PERMISSION_NONE
+    };
+
+    // done
+    return (uint32_t) p_compiler->nodes_len++;
+}
+
+uint32_t permission_insert ( struct permission_compiler_s *p_compiler, const char *p_permission, uint32_t *p_permissions_len )
+{
+
+    // initialized data
+    const char *p_colon   = strchr(p_permission, ':');
+    const char *p_segment = p_permission;
+    uint32_t    node      = 0;
+    uint32_t   *p_id      = NULL;
+
+    // error check
+    if ( NULL == p_colon ) return PERMISSION_NONE;
+
+    // walk each segment. the action ends at the colon, and resource segments end at slashes
+    for (;;)
+    {
+
+        // initialized data
+        const char *p_end  = ( p_segment < p_colon ) ? p_colon : p_segment + strcspn(p_segment, "/");
+        size_t      len    = (size_t)( p_end - p_segment );
+        bool        last   = ( p_end > p_colon && '\0' == *p_end );
+
+        // a trailing '*' accepts the rest of the path
+        if ( last && 1 == len && '*' == *p_segment ) { p_id = &p_compiler->_nodes[node].rest_id; break; }
+
+        // a '*' accepts any one segment
+        if ( 1 == len && '*' == *p_segment )
+        {
+
+            // add the node
+            if ( 0 == p_compiler->_nodes[node].star )
+            {
+
+                // initialized data
+                uint32_t star = permission_node_add(p_compiler);
+
+                // error check
+                if ( PERMISSION_NONE == star ) return PERMISSION_NONE;
+
+                // store the node
+                p_compiler->_nodes[node].star = star;
+            }
+
+            // next node
+            node = p_compiler->_nodes[node].star;
+        }
+
+        // a literal accepts itself
+        else
+        {
+
+            // initialized data
+            uint32_t edge = permission_edges_find(&p_compiler->_edges, node, p_segment, len);
+
+            // add the edge
+            if ( PERMISSION_NONE == edge )
+            {
+
+                // initialized data
+                uint32_t child = permission_node_add(p_compiler);
+
+                // error check
+                if ( PERMISSION_NONE == child ) return PERMISSION_NONE;
+
+                // link the edge in front of the node's other edges
+                edge = permission_edges_add(&p_compiler->_edges, node, p_segment, len, child, p_compiler->_nodes[node].first);
+
+                // error check
+                if ( PERMISSION_NONE == edge ) return PERMISSION_NONE;
+
+                // store the edge
+                p_compiler->_nodes[node].first = edge;
+            }
+
+            // next node
+            node = p_compiler->_edges._edges[edge].to;
+        }
+
+        // the path ends here
+        if ( last ) { p_id = &p_compiler->_nodes[node].end_id; break; }
+
+        // next segment
+        p_segment = p_end + 1;
+    }
+
+    // equal permissions end at the same place, and share an id
+    if ( PERMISSION_NONE == *p_id ) *p_id = (*p_permissions_len)++;
+
+    // done
+    return *p_id;
+}
+
+int permission_edge_comparator ( const void *p_a, const void *p_b )
+{
+
+    // initialized data
+    const struct permission_edge_s *p_edge_a = &p_sort_edges->_edges[*(const uint32_t *) p_a],
+                                   *p_edge_b = &p_sort_edges->_edges[*(const uint32_t *) p_b];
+    int                             result   = 0;
+
+    // order by length, then by bytes
+    if ( p_edge_a->len != p_edge_b->len ) return ( p_edge_a->len > p_edge_b->len ) - ( p_edge_a->len < p_edge_b->len );
+    result = memcmp(p_sort_edges->p_pool + p_edge_a->offset, p_sort_edges->p_pool + p_edge_b->offset, p_edge_a->len);
+
+    // done
+    return result;
+}
+
+int permission_id_comparator ( const void *p_a, const void *p_b )
+{
+
+    // initialized data
+    uint32_t a = *(const uint32_t *) p_a,
+             b = *(const uint32_t *) p_b;
+
+    // done
+    return ( a > b ) - ( a < b );
+}
+
+uint32_t permission_state_get ( struct permission_compiler_s *p_compiler, permission_matcher *p_matcher, uint32_t *_set, size_t set_len )
+{
+
+    // initialized data
+    uint64_t hash  = 0;
+    uint32_t state = 0;
+    size_t   len   = 0;
+
+    // sort and deduplicate the set
+    qsort(_set, set_len, sizeof(uint32_t), permission_id_comparator);
+    for (size_t i = 0; i < set_len; i++)
+        if ( 0 == len || _set[len - 1] != _set[i] )
+            _set[len++] = _set[i];
+
+    // hash the set
+    hash = hash_fnv64(_set, len * sizeof(uint32_t));
+
+    // find the state
+    for (size_t i = hash & p_compiler->set_mask; p_compiler->_set_table[i]; i = ( i + 1 ) & p_compiler->set_mask)
+    {
+
+        // initialized data
+        uint32_t candidate = p_compiler->_set_table[i] - 1;
+
+        // match
+        if ( p_compiler->_set_lens[candidate] == len && 0 == memcmp(&p_compiler->_sets[p_compiler->_set_offsets[candidate]], _set, len * sizeof(uint32_t)) )
+            return candidate;
+    }
+
+    // error check
+    if ( PERMISSION_STATES_MAX <= p_matcher->states_len ) return PERMISSION_NONE;
+
+    // add a state
+    state = (uint32_t) p_matcher->states_len;
+
+    // grow the states, and the sets of each state
+    if ( state == p_compiler->states_max )
+    {
+
+        // initialized data
+        size_t                     states_max    = ( p_compiler->states_max ) ? p_compiler->states_max * 2 : 16;
+        struct permission_state_s *_states       = default_allocator(p_matcher->_states, states_max * sizeof(struct permission_state_s));
+        uint32_t                  *_set_offsets  = NULL,
+                                  *_set_lens     = NULL;
+
+        // error check
+        if ( NULL == _states ) return PERMISSION_NONE;
+        p_matcher->_states = _states;
+
+        // grow the set offsets
+        _set_offsets = default_allocator(p_compiler->_set_offsets, states_max * sizeof(uint32_t));
+        if ( NULL == _set_offsets ) return PERMISSION_NONE;
+        p_compiler->_set_offsets = _set_offsets;
+
+        // grow the set lengths
+        _set_lens = default_allocator(p_compiler->_set_lens, states_max * sizeof(uint32_t));
+        if ( NULL == _set_lens ) return PERMISSION_NONE;
+        p_compiler->_set_lens = _set_lens;
+
+        // store the new capacity
+        p_compiler->states_max = states_max;
+    }
+
+    // store the set
+    if ( 0 == permission_grow((void **) &p_compiler->_sets, &p_compiler->sets_max, p_compiler->sets_len + len, sizeof(uint32_t)) ) return PERMISSION_NONE;
+    memcpy(&p_compiler->_sets[p_compiler->sets_len], _set, len * sizeof(uint32_t));
+    p_compiler->_set_offsets[state] = (uint32_t) p_compiler->sets_len,
+    p_compiler->_set_lens[state]    = (uint32_t) len,
+    p_compiler->sets_len           += len;
+
+    // the state is compiled later
+    p_matcher->_states[state] = (struct permission_state_s) { .star = PERMISSION_NONE };
+    p_matcher->states_len++;
+
+    // grow the set table past twice the states
+    if ( 2 * p_matcher->states_len > p_compiler->set_mask + 1 )
+    {
+
+        // initialized data
+        size_t    capacity = ( p_compiler->set_mask + 1 ) * 2;
+        uint32_t *_table   = default_allocator(NULL, capacity * sizeof(uint32_t));
+
+        // error check
+        if ( NULL == _table ) return PERMISSION_NONE;
+
+        // every slot starts empty
+        memset(_table, 0, capacity * sizeof(uint32_t));
+
+        // place every state
+        for (uint32_t i = 0; i < p_matcher->states_len; i++)
+        {
+            size_t j = hash_fnv64(&p_compiler->_sets[p_compiler->_set_offsets[i]], p_compiler->_set_lens[i] * sizeof(uint32_t)) & ( capacity - 1 );
+            while ( _table[j] ) j = ( j + 1 ) & ( capacity - 1 );
+            _table[j] = i + 1;
+        }
+
+        // swap in the new table
+        p_compiler->_set_table = default_allocator(p_compiler->_set_table, 0);
+        p_compiler->_set_table = _table,
+        p_compiler->set_mask   = capacity - 1;
+    }
+
+    // place the state
+    else
+    {
+        size_t j = hash & p_compiler->set_mask;
+        while ( p_compiler->_set_table[j] ) j = ( j + 1 ) & p_compiler->set_mask;
+        p_compiler->_set_table[j] = state + 1;
+    }
+
+    // done
+    return state;
+}
+
+int permission_state_compile ( struct permission_compiler_s *p_compiler, permission_matcher *p_matcher, uint32_t state )
+{
+
+    // initialized data
+    size_t    set_len   = p_compiler->_set_lens[state];
+    uint32_t *_set      = default_allocator(NULL, ( set_len + 1 ) * sizeof(uint32_t));
+    uint32_t *_stars    = default_allocator(NULL, ( set_len + 1 ) * sizeof(uint32_t));
+    uint32_t *_edges    = NULL,
+             *_target   = NULL;
+    size_t    edges_len = 0,
+              edges_max = 0,
+              stars_len = 0,
+              ids_start = p_matcher->ids_len;
+    int       result    = 0;
+
+    // error check
+    if ( NULL == _set || NULL == _stars ) goto done;
+
+    // copy the set. compiling may grow the set pool
+    memcpy(_set, &p_compiler->_sets[p_compiler->_set_offsets[state]], set_len * sizeof(uint32_t));
+
+    // gather the literal edges and the '*' nodes of every member
+    for (size_t i = 0; i < set_len; i++)
+    {
+
+        // initialized data
+        const struct permission_node_s *p_node = &p_compiler->_nodes[_set[i]];
+
+        // literal edges
+        for (uint32_t e = p_node->first; PERMISSION_NONE != e; e = p_compiler->_edges._edges[e].next)
+        {
+            if ( 0 == permission_grow((void **) &_edges, &edges_max, edges_len + 1, sizeof(uint32_t)) ) goto done;
+            _edges[edges_len++] = e;
+        }
+
+        // the '*' node
+        if ( p_node->star ) _stars[stars_len++] = p_node->star;
+    }
+
+    // accepted permissions. rest ids first, then end ids
+    for (size_t pass = 0; pass < 2; pass++)
+        for (size_t i = 0; i < set_len; i++)
+        {
+
+            // initialized data
+            uint32_t id = ( 0 == pass ) ? p_compiler->_nodes[_set[i]].rest_id : p_compiler->_nodes[_set[i]].end_id;
+
+            // skip nodes that accept nothing
+            if ( PERMISSION_NONE == id ) continue;
+
+            // store the id
+            if ( 0 == permission_grow((void **) &p_matcher->_ids, &p_compiler->ids_max, p_matcher->ids_len + 1, sizeof(uint32_t)) ) goto done;
+            p_matcher->_ids[p_matcher->ids_len++] = id;
+
+            // count the id
+            if ( 0 == pass ) p_matcher->_states[state].rest_len++;
+            else             p_matcher->_states[state].end_len++;
+        }
+    p_matcher->_states[state].ids_offset = (uint32_t) ids_start;
+
+    // any other segment goes to the union of the '*' nodes
+    if ( stars_len )
+    {
+
+        // initialized data
+        uint32_t star = permission_state_get(p_compiler, p_matcher, _stars, stars_len);
+
+        // error check
+        if ( PERMISSION_NONE == star ) goto done;
+
+        // store the transition
+        p_matcher->_states[state].star = star;
+
+        // the state get sorted and deduplicated the '*' nodes, so count them again
+        stars_len = p_compiler->_set_lens[star];
+    }
+
+    // group the literal edges by segment
+    p_sort_edges = &p_compiler->_edges;
+    if ( edges_len ) qsort(_edges, edges_len, sizeof(uint32_t), permission_edge_comparator);
+
+    // room for the largest target
+    _target = default_allocator(NULL, ( edges_len + stars_len + 1 ) * sizeof(uint32_t));
+
+    // error check
+    if ( NULL == _target ) goto done;
+
+    // each segment goes to its nodes and the '*' nodes
+    for (size_t i = 0; i < edges_len; )
+    {
+
+        // initialized data
+        const struct permission_edge_s *p_edge     = &p_compiler->_edges._edges[_edges[i]];
+        size_t                          first      = i,
+                                        target_len = 0;
+        uint32_t                        target     = 0;
+
+        // the nodes after this segment
+        for (; i < edges_len && 0 == permission_edge_comparator(&_edges[i], &_edges[first]); i++)
+            _target[target_len++] = p_compiler->_edges._edges[_edges[i]].to;
+
+        // the '*' nodes
+        if ( PERMISSION_NONE != p_matcher->_states[state].star )
+        {
+            memcpy(&_target[target_len], &p_compiler->_sets[p_compiler->_set_offsets[p_matcher->_states[state].star]], stars_len * sizeof(uint32_t));
+            target_len += stars_len;
+        }
+
+        // get the state
+        target = permission_state_get(p_compiler, p_matcher, _target, target_len);
+
+        // error check
+        if ( PERMISSION_NONE == target ) goto done;
+
+        // store the transition
+        if ( PERMISSION_NONE == permission_edges_add(&p_matcher->_edges, state, p_compiler->_edges.p_pool + p_edge->offset, p_edge->len, target, PERMISSION_NONE) ) goto done;
+    }
+
+    // success
+    result = 1;
+
+    done:
+
+    // release the scratch arrays
+    _set    = default_allocator(_set   , 0),
+    _stars  = default_allocator(_stars , 0),
+    _edges  = default_allocator(_edges , 0),
+    _target = default_allocator(_target, 0);
+
+    // done
+    return result;
+}
+
+int permission_matcher_construct ( permission_matcher **pp_permission_matcher, role **pp_roles, size_t roles_len )
+{
+
+    // argument check
+    if ( NULL == pp_permission_matcher ) goto no_permission_matcher;
+    if ( NULL == pp_roles && roles_len ) goto no_roles;
+
+    // initialized data
+    struct permission_compiler_s  _compiler   = { 0 };
+    permission_matcher           *p_matcher   = default_allocator(NULL, sizeof(permission_matcher));
+    uint32_t                      permissions = 0,
+                                  root        = 0;
+    size_t                        role_ids    = 0,
+                                  ids_len     = 0;
+
+    // error check
+    if ( NULL == p_matcher ) goto no_mem;
+
+    // start empty
+    memset(p_matcher, 0, sizeof(permission_matcher));
+
+    // count every role permission
+    for (size_t i = 0; i < roles_len; i++) role_ids += role_permissions_len(pp_roles[i]);
+
+    // allocate the roles
+    p_matcher->_roles    = default_allocator(NULL, ( roles_len + 1 ) * sizeof(struct permission_role_s)),
+    p_matcher->_role_ids = default_allocator(NULL, ( role_ids  + 1 ) * sizeof(uint32_t));
+
+    // error check
+    if ( NULL == p_matcher->_roles || NULL == p_matcher->_role_ids ) goto no_mem_1;
+
+    // one permission id per interned string, none yet
+    _compiler.interned_len = intern_size(),
+    _compiler._interned    = default_allocator(NULL, ( _compiler.interned_len + 1 ) * sizeof(uint32_t));
+
+    // error check
+    if ( NULL == _compiler._interned ) goto no_mem_1;
+
+    // every string starts without an id
+    memset(_compiler._interned, 0xff, ( _compiler.interned_len + 1 ) * sizeof(uint32_t));
+
+    // the root of the trie
+    if ( PERMISSION_NONE == permission_node_add(&_compiler) ) goto no_mem_1;
+
+    // insert every permission of every role
+    for (size_t i = 0; i < roles_len; i++)
+    {
+
+        // initialized data
+        struct permission_role_s *p_role = &p_matcher->_roles[p_matcher->roles_len++];
+
+        // store the role
+        *p_role = (struct permission_role_s)
+        {
+            .id         = (size_t) role_key_accessor(pp_roles[i]),
+            .ids_offset = (uint32_t) ids_len,
+            .ids_len    = 0
+        };
+
+        // insert each permission
+        for (size_t j = 0; j < role_permissions_len(pp_roles[i]); j++)
+        {
+
+            // initialized data
+            const char *p_permission = role_permission_get(pp_roles[i], j);
+            uint32_t    interned     = role_permission_id_get(pp_roles[i], j),
+                        id           = ( interned < _compiler.interned_len ) ? _compiler._interned[interned] : PERMISSION_NONE;
+
+            // a new permission string walks the trie, and a repeat reuses its id
+            if ( PERMISSION_NONE == id )
+            {
+                id = permission_insert(&_compiler, p_permission, &permissions);
+                if ( interned < _compiler.interned_len ) _compiler._interned[interned] = id;
+            }
+
+            // skip malformed permissions
+            if ( PERMISSION_NONE == id )
+            {
+                log_warning("[identity] [permission] Skipping malformed permission \"%s\"\n", p_permission);
+                continue;
+            }
+
+            // store the id
+            p_matcher->_role_ids[p_role->ids_offset + p_role->ids_len++] = id;
+        }
+
+        // sort and deduplicate the role's ids
+        qsort(&p_matcher->_role_ids[p_role->ids_offset], p_role->ids_len, sizeof(uint32_t), permission_id_comparator);
+        {
+            size_t len = 0;
+            for (size_t j = 0; j < p_role->ids_len; j++)
+                if ( 0 == len || p_matcher->_role_ids[p_role->ids_offset + len - 1] != p_matcher->_role_ids[p_role->ids_offset + j] )
+                    p_matcher->_role_ids[p_role->ids_offset + len++] = p_matcher->_role_ids[p_role->ids_offset + j];
+            p_role->ids_len = (uint32_t) len;
+        }
+
+        // the next role's ids follow
+        ids_len += p_role->ids_len;
+    }
+
+    // store the quantity of distinct permissions
+    p_matcher->permissions_len = permissions;
+
+    // sort the roles by id
+    for (size_t i = 1; i < p_matcher->roles_len; i++)
+    {
+        struct permission_role_s _role = p_matcher->_roles[i];
+        size_t j = i;
+        for (; j > 0 && p_matcher->_roles[j - 1].id > _role.id; j--) p_matcher->_roles[j] = p_matcher->_roles[j - 1];
+        p_matcher->_roles[j] = _role;
+    }
+
+    // the set table
+    _compiler.set_mask   = 63,
+    _compiler._set_table = default_allocator(NULL, 64 * sizeof(uint32_t));
+
+    // error check
+    if ( NULL == _compiler._set_table ) goto no_mem_2;
+
+    // every slot starts empty
+    memset(_compiler._set_table, 0, 64 * sizeof(uint32_t));
+
+    // the first state is the root of the trie
+    if ( 0 != permission_state_get(&_compiler, p_matcher, &root, 1) ) goto no_mem_2;
+
+    // compile every state. compiling a state may add states
+    for (uint32_t state = 0; state < p_matcher->states_len; state++)
+        if ( 0 == permission_state_compile(&_compiler, p_matcher, state) ) goto no_mem_2;
+
+    // release the compiler
+    permission_edges_release(&_compiler._edges);
+    _compiler._nodes       = default_allocator(_compiler._nodes      , 0),
+    _compiler._sets        = default_allocator(_compiler._sets       , 0),
+    _compiler._set_offsets = default_allocator(_compiler._set_offsets, 0),
+    _compiler._set_lens    = default_allocator(_compiler._set_lens   , 0),
+    _compiler._set_table   = default_allocator(_compiler._set_table  , 0),
+    _compiler._interned    = default_allocator(_compiler._interned   , 0);
+
+    // return a pointer to the caller
+    *pp_permission_matcher = p_matcher;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_permission_matcher:
+                #ifndef NDEBUG
+                    log_error("[identity] [permission] Null pointer provided for parameter \"pp_permission_matcher\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_roles:
+                #ifndef NDEBUG
+                    log_error("[identity] [permission] Null pointer provided for parameter \"pp_roles\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // standard library errors
+        {
+            no_mem_2:
+                permission_edges_release(&_compiler._edges);
+                _compiler._nodes       = default_allocator(_compiler._nodes      , 0),
+                _compiler._sets        = default_allocator(_compiler._sets       , 0),
+                _compiler._set_offsets = default_allocator(_compiler._set_offsets, 0),
+                _compiler._set_lens    = default_allocator(_compiler._set_lens   , 0),
+                _compiler._set_table   = default_allocator(_compiler._set_table  , 0);
+
+                // fall through
+                goto no_mem_1;
+
+            no_mem_1:
+                _compiler._interned = default_allocator(_compiler._interned, 0);
+                (void) permission_matcher_destroy(&p_matcher);
+
+                // fall through
+                goto no_mem;
+
+            no_mem:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+size_t permission_matcher_size ( const permission_matcher *p_permission_matcher )
+{
+
+    // done
+    return p_permission_matcher->permissions_len;
+}
+
+int permission_matcher_role_get ( const permission_matcher *p_permission_matcher, size_t role_id, const uint32_t **pp_ids, size_t *p_ids_len )
+{
+
+    // initialized data
+    size_t lo = 0,
+           hi = p_permission_matcher->roles_len;
+
+    // binary search the roles
+    while ( lo < hi )
+    {
+
+        // initialized data
+        size_t                          mid    = lo + ( hi - lo ) / 2;
+        const struct permission_role_s *p_role = &p_permission_matcher->_roles[mid];
+
+        // found
+        if ( p_role->id == role_id )
+        {
+            *pp_ids    = &p_permission_matcher->_role_ids[p_role->ids_offset],
+            *p_ids_len = p_role->ids_len;
+            return 1;
+        }
+
+        // narrow
+        if ( p_role->id < role_id ) lo = mid + 1;
+        else                        hi = mid;
+    }
+
+    // not found
+    return 0;
+}
+
+bool permission_matcher_walk ( const permission_matcher *p_permission_matcher, const char *p_action, const char *p_resource, fn_permission_visit *pfn_visit, void *p_context )
+{
+
+    // initialized data
+    const struct permission_state_s *p_state   = &p_permission_matcher->_states[0];
+    const char                      *p_segment = p_action;
+    size_t                           len       = strlen(p_action);
+    bool                             action    = true;
+
+    // walk one state per segment
+    for (;;)
+    {
+
+        // initialized data
+        uint32_t edge = permission_edges_find(&p_permission_matcher->_edges, (uint32_t)( p_state - p_permission_matcher->_states ), p_segment, len);
+        uint32_t next = ( PERMISSION_NONE != edge ) ? p_permission_matcher->_edges._edges[edge].to : p_state->star;
+
+        // this segment is left, so trailing wildcards here match
+        if ( p_state->rest_len )
+            if ( pfn_visit(p_context, &p_permission_matcher->_ids[p_state->ids_offset], p_state->rest_len) ) return true;
+
+        // no permission continues with this segment
+        if ( PERMISSION_NONE == next ) return false;
+
+        // next state
+        p_state = &p_permission_matcher->_states[next];
+
+        // next segment
+        if ( action )
+            p_segment = p_resource,
+            action    = false;
+        else if ( '\0' != p_segment[len] )
+            p_segment += len + 1;
+        else
+            break;
+
+        // the length of the segment
+        len = strcspn(p_segment, "/");
+    }
+
+    // the path ends here
+    if ( p_state->end_len )
+        return pfn_visit(p_context, &p_permission_matcher->_ids[p_state->ids_offset + p_state->rest_len], p_state->end_len);
+
+    // done
+    return false;
+}
+
+bool permission_match_visit ( void *p_context, const uint32_t *_ids, size_t ids_len )
+{
+
+    // initialized data
+    struct permission_match_s *p_match = p_context;
+
+    // copy what fits
+    for (size_t i = 0; i < ids_len && p_match->len < p_match->max; i++)
+        p_match->_ids[p_match->len++] = _ids[i];
+
+    // stop once full
+    return p_match->len == p_match->max;
+}
+
+bool permission_set_visit ( void *p_context, const uint32_t *_ids, size_t ids_len )
+{
+
+    // initialized data
+    const uint64_t *_set = p_context;
+
+    // stop at the first id in the set
+    for (size_t i = 0; i < ids_len; i++)
+        if ( _set[_ids[i] >> 6] & ( 1ULL << ( _ids[i] & 63 ) ) )
+            return true;
+
+    // keep walking
+    return false;
+}
+
+size_t permission_matcher_match ( const permission_matcher *p_permission_matcher, const char *p_action, const char *p_resource, uint32_t *_ids, size_t ids_max )
+{
+
+    // argument check
+    if ( NULL == p_permission_matcher ) return 0;
+    if ( NULL ==             p_action ) return 0;
+    if ( NULL ==           p_resource ) return 0;
+
+    // initialized data
+    struct permission_match_s _match = { ._ids = _ids, .len = 0, .max = ids_max };
+
+    // fast exit
+    if ( 0 == ids_max ) return 0;
+
+    // collect the matches
+    (void) permission_matcher_walk(p_permission_matcher, p_action, p_resource, permission_match_visit, &_match);
+
+    // done
+    return _match.len;
+}
+
+bool permission_matcher_any ( const permission_matcher *p_permission_matcher, const char *p_action, const char *p_resource, const uint64_t *_set )
+{
+
+    // argument check
+    if ( NULL == p_permission_matcher ) return false;
+    if ( NULL ==             p_action ) return false;
+    if ( NULL ==           p_resource ) return false;
+    if ( NULL ==                 _set ) return false;
+
+    // done
+    return permission_matcher_walk(p_permission_matcher, p_action, p_resource, permission_set_visit, (void *) _set);
+}
+
+int permission_matcher_destroy ( permission_matcher **pp_permission_matcher )
+{
+
+    // argument check
+    if ( NULL == pp_permission_matcher ) goto no_permission_matcher;
+
+    // initialized data
+    permission_matcher *p_matcher = *pp_permission_matcher;
+
+    // no more pointer for caller
+    *pp_permission_matcher = NULL;
+
+    // fast exit
+    if ( NULL == p_matcher ) return 1;
+
+    // release everything
+    permission_edges_release(&p_matcher->_edges);
+    p_matcher->_states   = default_allocator(p_matcher->_states  , 0),
+    p_matcher->_ids      = default_allocator(p_matcher->_ids     , 0),
+    p_matcher->_roles    = default_allocator(p_matcher->_roles   , 0),
+    p_matcher->_role_ids = default_allocator(p_matcher->_role_ids, 0),
+    p_matcher            = default_allocator(p_matcher           , 0);
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_permission_matcher:
+                #ifndef NDEBUG
+                    log_error("[identity] [permission] Null pointer provided for parameter \"pp_permission_matcher\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
@@ -0,0 +1,702 @@
+/** !
+ * Protocol
+ *
+ * @file src/protocol.c
+ *
+ * @author Jacob Smith
+ */
+
+// header
+#include <identity/protocol.h>
+
+// identity
+#include <identity/hex.h>
+
+bool protocol_frame_is_binary ( const char *p_frame )
+{
+
+    // done
+    return 0 == memcmp(p_frame, PROTOCOL_BINARY_MAGIC, 3);
+}
+
+int protocol_frame_length ( const char *p_buffer, size_t len, size_t *p_frame_len )
+{
+
+    // argument check
+    if ( NULL ==    p_buffer ) goto no_buffer;
+    if ( NULL == p_frame_len ) goto no_frame_len;
+
+    // wait for the header
+    if ( PROTOCOL_HEADER_SIZE > len ) return *p_frame_len = 0, 1;
+
+    // binary frame
+    if ( protocol_frame_is_binary(p_buffer) )
+    {
+
+        // initialized data
+        protocol_binary_header _header = { 0 };
+
+        // get the header
+        memcpy(&_header, p_buffer, sizeof(_header));
+
+        // error check
+        if ( PROTOCOL_REQUEST_MAX < _header.length ) goto too_long;
+
+        // the frame is the header followed by the body
+        *p_frame_len = PROTOCOL_HEADER_SIZE + _header.length;
+    }
+
+    // JSON frame
+    else
+    {
+
+        // initialized data
+        uint64_t request_len = 0;
+
+        // get the length of the request
+        memcpy(&request_len, p_buffer, sizeof(request_len));
+
+        // error check
+        if ( PROTOCOL_REQUEST_MAX < request_len ) goto too_long;
+
+        // the frame is the length followed by the request
+        *p_frame_len = PROTOCOL_HEADER_SIZE + (size_t) request_len;
+    }
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_buffer:
+                #ifndef NDEBUG
+                    log_error("[identity] [protocol] Null pointer provided for parameter \"p_buffer\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_frame_len:
+                #ifndef NDEBUG
+                    log_error("[identity] [protocol] Null pointer provided for parameter \"p_frame_len\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // protocol errors
+        {
+            too_long:
+                #ifndef NDEBUG
+                    log_error("[identity] [protocol] Request exceeds %d bytes in call to function \"%s\"\n", PROTOCOL_REQUEST_MAX, __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+size_t protocol_binary_credential_parse ( const char *p_body, size_t body_len, protocol_credential *p_credential )
+{
+
+    // initialized data
+    size_t name_len = 0;
+
+    // error check
+    if ( 1 > body_len ) return 0;
+
+    // get the length of the username
+    name_len = (unsigned char) p_body[0];
+
+    // error check
+    if ( 0 == name_len || PROTOCOL_NAME_MAX < name_len ) return 0;
+    if ( 1 + name_len + sizeof(sha256_hash) > body_len ) return 0;
+
+    // store the username
+    p_credential->p_name   = &p_body[1],
+    p_credential->name_len = name_len;
+
+    // store the digest
+    memcpy(p_credential->_digest, &p_body[1 + name_len], sizeof(sha256_hash));
+
+    // done
+    return 1 + name_len + sizeof(sha256_hash);
+}
+
+int protocol_binary_authenticate_parse ( const char *p_body, size_t body_len, protocol_credential *p_credential )
+{
+
+    // argument check
+    if ( NULL ==       p_body ) goto no_body;
+    if ( NULL == p_credential ) goto no_credential;
+
+    // parse the only credential
+    if ( body_len != protocol_binary_credential_parse(p_body, body_len, p_credential) ) goto malformed;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_body:
+                #ifndef NDEBUG
+                    log_error("[identity] [protocol] Null pointer provided for parameter \"p_body\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_credential:
+                #ifndef NDEBUG
+                    log_error("[identity] [protocol] Null pointer provided for parameter \"p_credential\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // protocol errors
+        {
+            malformed:
+                #ifndef NDEBUG
+                    log_error("[identity] [protocol] Malformed authenticate body in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int protocol_binary_batch_parse ( const char *p_body, size_t body_len, protocol_credential *_credentials, size_t *p_count )
+{
+
+    // argument check
+    if ( NULL ==      p_body ) goto no_body;
+    if ( NULL == _credentials ) goto no_credentials;
+    if ( NULL ==     p_count ) goto no_count;
+
+    // initialized data
+    size_t count  = 0,
+           offset = 1;
+
+    // error check
+    if ( 1 > body_len ) goto malformed;
+
+    // get the quantity of credentials
+    count = (unsigned char) p_body[0];
+
+    // error check
+    if ( 0 == count || PROTOCOL_BATCH_MAX < count ) goto malformed;
+
+    // parse each credential
+    for (size_t i = 0; i < count; i++)
+    {
+
+        // initialized data
+        size_t len = protocol_binary_credential_parse(&p_body[offset], body_len - offset, &_credentials[i]);
+
+        // error check
+        if ( 0 == len ) goto malformed;
+
+        // next credential
+        offset += len;
+    }
+
+    // error check
+    if ( offset != body_len ) goto malformed;
+
+    // return the quantity of credentials to the caller
+    *p_count = count;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_body:
+                #ifndef NDEBUG
+                    log_error("[identity] [protocol] Null pointer provided for parameter \"p_body\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_credentials:
+                #ifndef NDEBUG
+                    log_error("[identity] [protocol] Null pointer provided for parameter \"_credentials\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_count:
+                #ifndef NDEBUG
+                    log_error("[identity] [protocol] Null pointer provided for parameter \"p_count\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // protocol errors
+        {
+            malformed:
+                #ifndef NDEBUG
+                    log_error("[identity] [protocol] Malformed batch body in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int protocol_hex_decode ( const char *p_hex, size_t hex_len, unsigned char *p_bytes )
+{
+
+    // error check
+    if ( hex_len % 2 ) goto odd_length;
+
+    // convert each pair of characters into a byte
+    if ( 0 == hex_decode(p_hex, hex_len, p_bytes) ) goto non_hex;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // protocol errors
+        {
+            odd_length:
+                #ifndef NDEBUG
+                    log_error("[identity] [protocol] Odd length hex string in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            non_hex:
+                #ifndef NDEBUG
+                    log_error("[identity] [protocol] Non-hex character in SHA-256 hex in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+size_t protocol_hex_encode ( const unsigned char *p_bytes, size_t len, char *p_hex )
+{
+
+    // convert each byte into a pair of characters
+    return hex_encode(p_bytes, len, p_hex);
+}
+
+// A small recursive descent parser for the request grammar. It allocates
+// only from the caller's arena, and shares unescaped strings with the text
+struct protocol_json_parser_s
+{
+    arena      *p_arena;
+    const char *p_text;
+    const char *p_end;
+};
+
+void protocol_json_whitespace ( struct protocol_json_parser_s *p_parser )
+{
+
+    // skip whitespace
+    while ( p_parser->p_text < p_parser->p_end && ( ' ' == *p_parser->p_text || '\t' == *p_parser->p_text || '\n' == *p_parser->p_text || '\r' == *p_parser->p_text ) )
+        p_parser->p_text++;
+}
+
+int protocol_json_string_parse ( struct protocol_json_parser_s *p_parser, const char **pp_string, size_t *p_len )
+{
+
+    // initialized data
+    const char *p_start  = ++p_parser->p_text;
+    const char *p_i      = p_start;
+    bool        escaped  = false;
+    char       *p_out    = NULL;
+    size_t      len      = 0;
+
+    // find the closing quote
+    while ( p_i < p_parser->p_end && '"' != *p_i )
+    {
+        if ( '\\' == *p_i ) escaped = true, p_i++;
+        p_i++;
+    }
+
+    // error check
+    if ( p_i >= p_parser->p_end ) return 0;
+
+    // fast path. share the text
+    if ( false == escaped )
+    {
+        *pp_string = p_start,
+        *p_len     = (size_t)(p_i - p_start);
+        p_parser->p_text = p_i + 1;
+        return 1;
+    }
+
+    // slow path. unescape into the arena. The result is never longer than the source
+    p_out = arena_alloc(p_parser->p_arena, (size_t)(p_i - p_start));
+    if ( NULL == p_out ) return 0;
+
+    for (const char *p_c = p_start; p_c < p_i; p_c++)
+    {
+
+        // plain character
+        if ( '\\' != *p_c ) { p_out[len++] = *p_c; continue; }
+
+        // escape sequence
+        switch ( *++p_c )
+        {
+            case '"' : p_out[len++] = '"' ; break;
+            case '\\': p_out[len++] = '\\'; break;
+            case '/' : p_out[len++] = '/' ; break;
+            case 'b' : p_out[len++] = '\b'; break;
+            case 'f' : p_out[len++] = '\f'; break;
+            case 'n' : p_out[len++] = '\n'; break;
+            case 'r' : p_out[len++] = '\r'; break;
+            case 't' : p_out[len++] = '\t'; break;
+            case 'u' :
+            {
+
+                // initialized data
+                unsigned char _code[2]  = { 0 };
+                unsigned int  codepoint = 0;
+
+                // error check
+                if ( p_i - p_c < 5 || 0 == protocol_hex_decode(p_c + 1, 4, _code) ) return 0;
+
+                // basic multilingual plane to UTF-8
+                codepoint = ( (unsigned int) _code[0] << 8 ) | _code[1];
+                if      ( codepoint < 0x80  ) p_out[len++] = (char) codepoint;
+                else if ( codepoint < 0x800 ) p_out[len++] = (char)( 0xC0 | ( codepoint >> 6 ) ),
+                                              p_out[len++] = (char)( 0x80 | ( codepoint & 0x3F ) );
+                else                          p_out[len++] = (char)( 0xE0 | ( codepoint >> 12 ) ),
+                                              p_out[len++] = (char)( 0x80 | ( ( codepoint >> 6 ) & 0x3F ) ),
+                                              p_out[len++] = (char)( 0x80 | ( codepoint & 0x3F ) );
+
+                // skip the code
+                p_c += 4;
+                break;
+            }
+            default:
+                return 0;
+        }
+    }
+
+    // return the string to the caller
+    *pp_string = p_out,
+    *p_len     = len;
+
+    // skip the closing quote
+    p_parser->p_text = p_i + 1;
+
+    // success
+    return 1;
+}
+
+int protocol_json_value_parse ( struct protocol_json_parser_s *p_parser, size_t depth, protocol_json **pp_value )
+{
+
+    // initialized data
+    protocol_json *p_value = NULL;
+
+    // error check
+    if ( PROTOCOL_JSON_DEPTH_MAX < depth ) return 0;
+
+    // skip whitespace
+    protocol_json_whitespace(p_parser);
+
+    // error check
+    if ( p_parser->p_text >= p_parser->p_end ) return 0;
+
+    // allocate a value
+    p_value = arena_alloc(p_parser->p_arena, sizeof(protocol_json));
+    if ( NULL == p_value ) return 0;
+
+    // initialize the value
+    *p_value = (protocol_json) { 0 };
+
+    // parse the value
+    switch ( *p_parser->p_text )
+    {
+
+        // object
+        case '{':
+        {
+
+            // initialized data
+            protocol_json **pp_next = &p_value->p_first;
+
+            // store the type
+            p_value->type = PROTOCOL_JSON_OBJECT;
+
+            // skip the brace
+            p_parser->p_text++;
+            protocol_json_whitespace(p_parser);
+
+            // empty object
+            if ( p_parser->p_text < p_parser->p_end && '}' == *p_parser->p_text ) { p_parser->p_text++; break; }
+
+            // parse each member
+            for (;;)
+            {
+
+                // initialized data
+                const char *p_key   = NULL;
+                size_t      key_len = 0;
+
+                // parse the key
+                protocol_json_whitespace(p_parser);
+                if ( p_parser->p_text >= p_parser->p_end || '"' != *p_parser->p_text ) return 0;
+                if ( 0 == protocol_json_string_parse(p_parser, &p_key, &key_len) ) return 0;
+
+                // parse the colon
+                protocol_json_whitespace(p_parser);
+                if ( p_parser->p_text >= p_parser->p_end || ':' != *p_parser->p_text ) return 0;
+                p_parser->p_text++;
+
+                // parse the value
+                if ( 0 == protocol_json_value_parse(p_parser, depth + 1, pp_next) ) return 0;
+
+                // store the key
+                (*pp_next)->p_key   = p_key,
+                (*pp_next)->key_len = key_len;
+
+                // next member
+                pp_next = &(*pp_next)->p_next;
+                p_value->len++;
+
+                // parse the separator
+                protocol_json_whitespace(p_parser);
+                if ( p_parser->p_text >= p_parser->p_end ) return 0;
+                if ( ',' == *p_parser->p_text ) { p_parser->p_text++; continue; }
+                if ( '}' == *p_parser->p_text ) { p_parser->p_text++; break; }
+
+                // error
+                return 0;
+            }
+
+            // done
+            break;
+        }
+
+        // array
+        case '[':
+        {
+
+            // initialized data
+            protocol_json **pp_next = &p_value->p_first;
+
+            // store the type
+            p_value->type = PROTOCOL_JSON_ARRAY;
+
+            // skip the bracket
+            p_parser->p_text++;
+            protocol_json_whitespace(p_parser);
+
+            // empty array
+            if ( p_parser->p_text < p_parser->p_end && ']' == *p_parser->p_text ) { p_parser->p_text++; break; }
+
+            // parse each element
+            for (;;)
+            {
+
+                // parse the element
+                if ( 0 == protocol_json_value_parse(p_parser, depth + 1, pp_next) ) return 0;
+
+                // next element
+                pp_next = &(*pp_next)->p_next;
+                p_value->len++;
+
+                // parse the separator
+                protocol_json_whitespace(p_parser);
+                if ( p_parser->p_text >= p_parser->p_end ) return 0;
+                if ( ',' == *p_parser->p_text ) { p_parser->p_text++; continue; }
+                if ( ']' == *p_parser->p_text ) { p_parser->p_text++; break; }
+
+                // error
+                return 0;
+            }
+
+            // done
+            break;
+        }
+
+        // string
+        case '"':
+            p_value->type = PROTOCOL_JSON_STRING;
+            if ( 0 == protocol_json_string_parse(p_parser, &p_value->p_string, &p_value->len) ) return 0;
+            break;
+
+        // literals
+        case 't':
+        case 'f':
+        case 'n':
+        {
+
+            // initialized data
+            size_t remaining = (size_t)(p_parser->p_end - p_parser->p_text);
+
+            if      ( remaining >= 4 && 0 == memcmp(p_parser->p_text, "true" , 4) ) p_value->type = PROTOCOL_JSON_BOOLEAN, p_value->boolean = true , p_parser->p_text += 4;
+            else if ( remaining >= 5 && 0 == memcmp(p_parser->p_text, "false", 5) ) p_value->type = PROTOCOL_JSON_BOOLEAN, p_value->boolean = false, p_parser->p_text += 5;
+            else if ( remaining >= 4 && 0 == memcmp(p_parser->p_text, "null" , 4) ) p_value->type = PROTOCOL_JSON_NULL   , p_parser->p_text += 4;
+            else return 0;
+
+            // done
+            break;
+        }
+
+        // numbers
+        default:
+        {
+
+            // initialized data
+            const char *p_start  = p_parser->p_text;
+            char        _number[32] = { 0 };
+            size_t      len      = 0;
+            bool        fraction = false;
+
+            // find the end of the number
+            while ( p_parser->p_text < p_parser->p_end && strchr("+-0123456789.eE", *p_parser->p_text) )
+            {
+                if ( strchr(".eE", *p_parser->p_text) ) fraction = true;
+                p_parser->p_text++;
+            }
+
+            // error check
+            len = (size_t)(p_parser->p_text - p_start);
+            if ( 0 == len || sizeof(_number) <= len ) return 0;
+
+            // copy the number into a null terminated buffer
+            memcpy(_number, p_start, len);
+
+            // parse the number
+            if ( fraction ) p_value->type = PROTOCOL_JSON_NUMBER , p_value->number  = strtod(_number, NULL);
+            else            p_value->type = PROTOCOL_JSON_INTEGER, p_value->integer = strtoll(_number, NULL, 10);
+
+            // done
+            break;
+        }
+    }
+
+    // return the value to the caller
+    *pp_value = p_value;
+
+    // success
+    return 1;
+}
+
+int protocol_json_parse ( arena *p_arena, const char *p_text, size_t len, protocol_json **pp_value )
+{
+
+    // argument check
+    if ( NULL ==  p_arena ) goto no_arena;
+    if ( NULL ==   p_text ) goto no_text;
+    if ( NULL == pp_value ) goto no_value;
+
+    // initialized data
+    struct protocol_json_parser_s _parser =
+    {
+        .p_arena = p_arena,
+        .p_text  = p_text,
+        .p_end   = p_text + len
+    };
+
+    // parse the value
+    if ( 0 == protocol_json_value_parse(&_parser, 0, pp_value) ) goto malformed;
+
+    // only whitespace may follow
+    protocol_json_whitespace(&_parser);
+    if ( _parser.p_text != _parser.p_end ) goto malformed;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_arena:
+                #ifndef NDEBUG
+                    log_error("[identity] [protocol] Null pointer provided for parameter \"p_arena\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_text:
+                #ifndef NDEBUG
+                    log_error("[identity] [protocol] Null pointer provided for parameter \"p_text\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_value:
+                #ifndef NDEBUG
+                    log_error("[identity] [protocol] Null pointer provided for parameter \"pp_value\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // protocol errors
+        {
+            malformed:
+                #ifndef NDEBUG
+                    log_error("[identity] [protocol] Malformed JSON in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+protocol_json *protocol_json_get ( const protocol_json *p_object, const char *p_key )
+{
+
+    // initialized data
+    size_t key_len = strlen(p_key);
+
+    // error check
+    if ( NULL == p_object || PROTOCOL_JSON_OBJECT != p_object->type ) return NULL;
+
+    // search the members
+    for (protocol_json *p_i = p_object->p_first; p_i; p_i = p_i->p_next)
+        if ( p_i->key_len == key_len && 0 == memcmp(p_i->p_key, p_key, key_len) )
+            return p_i;
+
+    // not found
+    return NULL;
+}
+
+bool protocol_json_string_equals ( const protocol_json *p_value, const char *p_string )
+{
+
+    // initialized data
+    size_t len = strlen(p_string);
+
+    // done
+    return p_value && PROTOCOL_JSON_STRING == p_value->type && p_value->len == len && 0 == memcmp(p_value->p_string, p_string, len);
+}
@@ -0,0 +1,1838 @@
+/** !
+ * Replication
+ *
+ * @file src/replication.c
+ *
+ * @author Jacob Smith
+ */
+
+// feature test macros
+#define _GNU_SOURCE
+
+// header
+#include <identity/replication.h>
+
+#ifdef __linux__
+
+// standard library
+#include <assert.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/eventfd.h>
+#include <sys/random.h>
+#include <sys/socket.h>
+
+// preprocessor definitions
+#define REPLICATION_TIMEOUT_MS ( 3 * REPLICATION_HEARTBEAT_MS )
+
+// enumeration definitions
+enum replication_slot_e
+{
+    REPLICATION_SLOT_FREE = 0,
+    REPLICATION_SLOT_LIVE = 1,
+    REPLICATION_SLOT_DONE = 2  // the thread has finished, and waits to be joined
+};
+
+// structure definitions
+struct replication_header_s
+{
+    uint32_t kind;
+    uint32_t size;
+    uint64_t sequence;
+};
+
+struct replication_slot_s
+{
+    replication_primary     *p_primary;
+    enum replication_slot_e  state;    // guarded by the lock of the primary
+    int                      fd;
+    int                      wake_fd;  // written each time a record is appended
+    uint32_t                 address;
+    uint16_t                 port;
+    size_t                   position; // the backlog offset of the next record to send
+    uint64_t                 acked;    // guarded by the lock of the primary
+    timestamp                contact;  // guarded by the lock of the primary
+    parallel_thread         *p_thread;
+};
+
+struct replication_primary_s
+{
+    atomic_bool                running;
+    int                        listen_fd;
+    uint64_t                   generation;
+    mutex                      _lock;
+    char                      *p_backlog;
+    size_t                     backlog_len, backlog_max;
+    size_t                     base;       // bytes ever dropped from the front of the backlog
+    uint64_t                   after;      // the backlog holds every record after this sequence
+    uint64_t                   sequence;   // the last sequence appended
+    fn_replication_dump       *pfn_dump;
+    void                      *p_context;
+    parallel_thread           *p_listener;
+    struct replication_slot_s  _slots[REPLICATION_REPLICAS_MAX];
+};
+
+struct replication_replica_s
+{
+    atomic_bool              running;
+    char                    *p_host;
+    uint16_t                 port;
+    mutex                    _lock;       // guards everything below
+    int                      fd;          // -1 while disconnected
+    bool                     connected;
+    uint32_t                 address;
+    uint64_t                 generation;
+    uint64_t                 applied;
+    uint64_t                 primary;
+    timestamp                contact;
+    fn_wal_replay           *pfn_apply;
+    fn_replication_snapshot *pfn_snapshot;
+    void                    *p_context;
+    parallel_thread         *p_thread;
+};
+
+static_assert(sizeof(struct replication_header_s) == REPLICATION_HEADER_SIZE, "REPLICATION_HEADER_SIZE is the size of a message header");
+
+// function declarations
+/// shared
+int replication_send ( int fd, uint32_t kind, uint64_t sequence, const void *p_payload, size_t size );
+int replication_receive ( int fd, void *p_buffer, size_t len, int timeout_ms );
+size_t replication_elapsed_ms ( timestamp since );
+
+/// primary
+void *replication_primary_listen ( replication_primary *p_primary );
+void *replication_primary_serve ( struct replication_slot_s *p_slot );
+int replication_primary_accept ( replication_primary *p_primary, int fd, struct sockaddr_in *p_address );
+int replication_primary_snapshot ( struct replication_slot_s *p_slot );
+int replication_primary_acks ( struct replication_slot_s *p_slot );
+size_t replication_backlog_find ( replication_primary *p_primary, uint64_t sequence );
+char *replication_backlog_reserve ( replication_primary *p_primary, size_t size );
+void replication_primary_wake ( replication_primary *p_primary );
+
+/// replica
+void *replication_replica_run ( replication_replica *p_replica );
+int replication_replica_connect ( replication_replica *p_replica );
+int replication_replica_follow ( replication_replica *p_replica, int fd );
+int replication_replica_apply ( replication_replica *p_replica, const char *p_records, size_t len );
+
+int replication_send ( int fd, uint32_t kind, uint64_t sequence, const void *p_payload, size_t size )
+{
+
+    // initialized data
+    struct replication_header_s  _header = { .kind = kind, .size = (uint32_t) size, .sequence = sequence };
+    const char                  *p_next  = (const char *) &_header;
+    size_t                       left    = sizeof(_header);
+
+    // send the header, then the payload
+    for (int part = 0; part < 2; part++)
+    {
+
+        // send every byte of this part
+        while ( left )
+        {
+
+            // initialized data
+            ssize_t sent = send(fd, p_next, left, MSG_NOSIGNAL | ( ( 0 == part && size ) ? MSG_MORE : 0 ));
+
+            // retry on signals
+            if ( -1 == sent && EINTR == errno ) continue;
+
+            // error check
+            if ( 0 >= sent ) return 0;
+
+            // advance
+            p_next += sent,
+            left   -= (size_t) sent;
+        }
+
+        // the payload
+        p_next = p_payload,
+        left   = size;
+    }
+
+    // success
+    return 1;
+}
+
+int replication_receive ( int fd, void *p_buffer, size_t len, int timeout_ms )
+{
+
+    // initialized data
+    char   *p_next = p_buffer;
+    size_t  left   = len;
+
+    // receive every byte
+    while ( left )
+    {
+
+        // initialized data
+        struct pollfd _poll = { .fd = fd, .events = POLLIN };
+        int           ready = poll(&_poll, 1, timeout_ms);
+        ssize_t       got   = 0;
+
+        // retry on signals
+        if ( -1 == ready && EINTR == errno ) continue;
+
+        // error check
+        if ( 0 >= ready ) return 0;
+
+        // read what is there
+        got = recv(fd, p_next, left, 0);
+
+        // retry on signals
+        if ( -1 == got && EINTR == errno ) continue;
+
+        // error check. 0 is an orderly shutdown
+        if ( 0 >= got ) return 0;
+
+        // advance
+        p_next += got,
+        left   -= (size_t) got;
+    }
+
+    // success
+    return 1;
+}
+
+size_t replication_elapsed_ms ( timestamp since )
+{
+
+    // done
+    return (size_t) ( ( timer_high_precision() - since ) * 1000 / timer_seconds_divisor() );
+}
+
+int replication_primary_construct ( replication_primary **pp_primary, uint16_t port, uint64_t sequence, fn_replication_dump *pfn_dump, void *p_context )
+{
+
+    // argument check
+    if ( NULL == pp_primary ) goto no_primary;
+    if ( NULL == pfn_dump   ) goto no_dump;
+
+    // initialized data
+    replication_primary *p_primary = default_allocator(NULL, sizeof(replication_primary));
+    int                  _one      = 1;
+    struct sockaddr_in   _address  =
+    {
+        .sin_family      = AF_INET,
+        .sin_port        = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_ANY)
+    };
+
+    // error check
+    if ( NULL == p_primary ) goto no_mem;
+
+    // populate the primary
+    *p_primary = (replication_primary)
+    {
+        .running     = true,
+        .listen_fd   = -1,
+        .p_backlog   = default_allocator(NULL, REPLICATION_CHUNK_MAX),
+        .backlog_max = REPLICATION_CHUNK_MAX,
+        .after       = sequence,
+        .sequence    = sequence,
+        .pfn_dump    = pfn_dump,
+        .p_context   = p_context
+    };
+
+    // error check
+    if ( NULL == p_primary->p_backlog ) goto no_backlog;
+
+    // each start of the primary is a new generation
+    if ( -1 == getentropy(&p_primary->generation, sizeof(p_primary->generation)) ) goto failed_to_get_entropy;
+    p_primary->generation |= 1;
+
+    // bind the slots to the primary
+    for (size_t i = 0; i < REPLICATION_REPLICAS_MAX; i++)
+        p_primary->_slots[i] = (struct replication_slot_s) { .p_primary = p_primary, .fd = -1, .wake_fd = -1 };
+
+    // open the socket
+    p_primary->listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    // error check
+    if ( -1 == p_primary->listen_fd ) goto failed_to_socket;
+
+    // allow quick restarts
+    (void) setsockopt(p_primary->listen_fd, SOL_SOCKET, SO_REUSEADDR, &_one, sizeof(_one));
+
+    // bind and listen
+    if ( -1 == bind(p_primary->listen_fd, (struct sockaddr *) &_address, sizeof(_address)) ) goto failed_to_bind;
+    if ( -1 == listen(p_primary->listen_fd, REPLICATION_REPLICAS_MAX) ) goto failed_to_bind;
+
+    // construct the lock
+    mutex_create(&p_primary->_lock);
+
+    // accept replicas
+    if ( 0 == parallel_thread_start(&p_primary->p_listener, (fn_parallel_task *) replication_primary_listen, p_primary) ) goto failed_to_start;
+
+    // log
+    log_info("[identity] [replication] Serving replicas on port %hu after sequence %llu\n", port, (unsigned long long) sequence);
+
+    // return a pointer to the caller
+    *pp_primary = p_primary;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_primary:
+                #ifndef NDEBUG
+                    log_error("[identity] [replication] Null pointer provided for parameter \"pp_primary\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_dump:
+                #ifndef NDEBUG
+                    log_error("[identity] [replication] Null pointer provided for parameter \"pfn_dump\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // gsdk errors
+        {
+            failed_to_start:
+                #ifndef NDEBUG
+                    log_error("[gsdk] [parallel] Failed to start thread in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // release the lock
+                mutex_destroy(&p_primary->_lock);
+
+                // release the socket
+                goto failed_to_bind_clean_up;
+        }
+
+        // linux errors
+        {
+            failed_to_socket:
+                #ifndef NDEBUG
+                    log_error("[linux] Failed to open socket in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // release the primary
+                goto failed_to_get_entropy_clean_up;
+
+            failed_to_bind:
+                #ifndef NDEBUG
+                    log_error("[linux] Failed to listen on port %hu in call to function \"%s\"\n", port, __FUNCTION__);
+                #endif
+
+                failed_to_bind_clean_up:
+
+                // release the socket
+                close(p_primary->listen_fd);
+
+                // release the primary
+                goto failed_to_get_entropy_clean_up;
+        }
+
+        // standard library errors
+        {
+            no_mem:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_backlog:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // release the primary
+                p_primary = default_allocator(p_primary, 0);
+
+                // error
+                return 0;
+
+            failed_to_get_entropy:
+                #ifndef NDEBUG
+                    log_error("[standard library] Call to function \"getentropy\" failed in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                failed_to_get_entropy_clean_up:
+
+                // release the backlog
+                p_primary->p_backlog = default_allocator(p_primary->p_backlog, 0);
+
+                // release the primary
+                p_primary = default_allocator(p_primary, 0);
+
+                // error
+                return 0;
+        }
+    }
+}
+
+void *replication_primary_listen ( replication_primary *p_primary )
+{
+
+    // accept replicas until the primary is destroyed
+    while ( atomic_load(&p_primary->running) )
+    {
+
+        // initialized data
+        struct pollfd      _poll        = { .fd = p_primary->listen_fd, .events = POLLIN };
+        struct sockaddr_in _address     = { 0 };
+        socklen_t          address_len  = sizeof(_address);
+        int                fd           = -1;
+
+        // wait for a replica, and check in on the primary every so often
+        if ( 1 != poll(&_poll, 1, REPLICATION_HEARTBEAT_MS) ) continue;
+
+        // accept the connection
+        fd = accept4(p_primary->listen_fd, (struct sockaddr *) &_address, &address_len, SOCK_CLOEXEC);
+
+        // error check
+        if ( -1 == fd ) continue;
+
+        // serve the replica
+        if ( 0 == replication_primary_accept(p_primary, fd, &_address) ) close(fd);
+    }
+
+    // done
+    return NULL;
+}
+
+int replication_primary_accept ( replication_primary *p_primary, int fd, struct sockaddr_in *p_address )
+{
+
+    // initialized data
+    struct replication_slot_s *p_slot   = NULL;
+    int                        _one     = 1;
+    int                        wake_fd  = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+    // error check
+    if ( -1 == wake_fd ) goto failed_to_eventfd;
+
+    // records are small, and should leave as soon as they are logged
+    (void) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &_one, sizeof(_one));
+
+    // lock
+    mutex_lock(&p_primary->_lock);
+
+    // find a slot
+    for (size_t i = 0; i < REPLICATION_REPLICAS_MAX; i++)
+    {
+
+        // skip live slots
+        if ( REPLICATION_SLOT_LIVE == p_primary->_slots[i].state ) continue;
+
+        // store the slot
+        p_slot = &p_primary->_slots[i];
+
+        // join the thread that finished with the slot
+        if ( REPLICATION_SLOT_DONE == p_slot->state ) (void) parallel_thread_join(&p_slot->p_thread);
+
+        // done
+        break;
+    }
+
+    // error check
+    if ( NULL == p_slot ) goto no_slot;
+
+    // populate the slot
+    p_slot->state    = REPLICATION_SLOT_LIVE,
+    p_slot->fd       = fd,
+    p_slot->wake_fd  = wake_fd,
+    p_slot->address  = ntohl(p_address->sin_addr.s_addr),
+    p_slot->port     = ntohs(p_address->sin_port),
+    p_slot->position = 0,
+    p_slot->acked    = 0,
+    p_slot->contact  = timer_high_precision();
+
+    // unlock
+    mutex_unlock(&p_primary->_lock);
+
+    // serve the replica
+    if ( 0 == parallel_thread_start(&p_slot->p_thread, (fn_parallel_task *) replication_primary_serve, p_slot) ) goto failed_to_start;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // data errors
+        {
+            no_slot:
+                #ifndef NDEBUG
+                    log_error("[identity] [replication] Too many replicas in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // unlock
+                mutex_unlock(&p_primary->_lock);
+
+                // release the eventfd
+                close(wake_fd);
+
+                // error
+                return 0;
+        }
+
+        // gsdk errors
+        {
+            failed_to_start:
+                #ifndef NDEBUG
+                    log_error("[gsdk] [parallel] Failed to start thread in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // free the slot
+                mutex_lock(&p_primary->_lock);
+                p_slot->state   = REPLICATION_SLOT_FREE,
+                p_slot->fd      = -1,
+                p_slot->wake_fd = -1;
+                mutex_unlock(&p_primary->_lock);
+
+                // release the eventfd
+                close(wake_fd);
+
+                // error
+                return 0;
+        }
+
+        // linux errors
+        {
+            failed_to_eventfd:
+                #ifndef NDEBUG
+                    log_error("[linux] Failed to construct eventfd in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+size_t replication_backlog_find ( replication_primary *p_primary, uint64_t sequence )
+{
+
+    // initialized data
+    size_t offset = 0;
+
+    // walk the records. Each was checked when it was packed
+    while ( offset < p_primary->backlog_len )
+    {
+
+        // stop at the first record after the sequence
+        if ( wal_record_sequence(p_primary->p_backlog + offset) > sequence ) break;
+
+        // next
+        offset += wal_record_size(p_primary->p_backlog + offset);
+    }
+
+    // done
+    return p_primary->base + offset;
+}
+
+int replication_primary_snapshot ( struct replication_slot_s *p_slot )
+{
+
+    // initialized data
+    replication_primary *p_primary = p_slot->p_primary;
+    char                *p_records = NULL;
+    size_t               len       = 0,
+                         offset    = 0;
+    uint64_t             sequence  = 0;
+
+    // dump the records, until the backlog holds every record after the dump
+    for (;;)
+    {
+
+        // dump the records
+        if ( 0 == p_primary->pfn_dump(p_primary->p_context, &p_records, &len, &sequence) ) goto failed_to_dump;
+
+        // lock
+        mutex_lock(&p_primary->_lock);
+
+        // the backlog holds every record after the dump
+        if ( sequence >= p_primary->after )
+        {
+
+            // stream from the first record after the dump
+            p_slot->position = replication_backlog_find(p_primary, sequence);
+
+            // unlock
+            mutex_unlock(&p_primary->_lock);
+
+            // done
+            break;
+        }
+
+        // unlock
+        mutex_unlock(&p_primary->_lock);
+
+        // the backlog moved past the dump. Try again
+        p_records = default_allocator(p_records, 0);
+    }
+
+    // send the records in chunks, split between records. An empty snapshot
+    // still sends one chunk, so the replica clears what it holds
+    do
+    {
+
+        // initialized data
+        size_t chunk_len = 0;
+
+        // take whole records, at least one
+        while ( offset + chunk_len < len )
+        {
+
+            // initialized data
+            size_t size = wal_record_size(p_records + offset + chunk_len);
+
+            // error check
+            if ( 0 == size ) goto bad_dump;
+
+            // stop when the chunk is full
+            if ( chunk_len && chunk_len + size > REPLICATION_CHUNK_MAX ) break;
+
+            // take the record
+            chunk_len += size;
+        }
+
+        // send the chunk
+        if ( 0 == replication_send(p_slot->fd, REPLICATION_SNAPSHOT, 0, p_records + offset, chunk_len) ) goto failed_to_send;
+
+        // next
+        offset += chunk_len;
+
+    } while ( offset < len );
+
+    // finish the snapshot
+    if ( 0 == replication_send(p_slot->fd, REPLICATION_SNAPSHOT_END, sequence, &p_primary->generation, sizeof(p_primary->generation)) ) goto failed_to_send;
+
+    // release the records
+    p_records = default_allocator(p_records, 0);
+
+    // log
+    log_info("[identity] [replication] Sent a snapshot of %zu bytes at sequence %llu to %hhu.%hhu.%hhu.%hhu:%hu\n",
+        len, (unsigned long long) sequence,
+        (unsigned char) ( p_slot->address >> 24 ), (unsigned char) ( p_slot->address >> 16 ),
+        (unsigned char) ( p_slot->address >> 8  ), (unsigned char) ( p_slot->address ),
+        p_slot->port
+    );
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // data errors
+        {
+            failed_to_dump:
+                #ifndef NDEBUG
+                    log_error("[identity] [replication] Failed to dump records in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            bad_dump:
+                #ifndef NDEBUG
+                    log_error("[identity] [replication] Malformed record in dump in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // release the records
+                p_records = default_allocator(p_records, 0);
+
+                // error
+                return 0;
+        }
+
+        // linux errors
+        {
+            failed_to_send:
+
+                // release the records
+                p_records = default_allocator(p_records, 0);
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int replication_primary_acks ( struct replication_slot_s *p_slot )
+{
+
+    // initialized data
+    replication_primary         *p_primary = p_slot->p_primary;
+    struct replication_header_s  _header   = { 0 };
+
+    // read one message. It is in flight already
+    if ( 0 == replication_receive(p_slot->fd, &_header, sizeof(_header), REPLICATION_TIMEOUT_MS) ) return 0;
+
+    // error check
+    if ( REPLICATION_ACK != _header.kind || 0 != _header.size ) return 0;
+
+    // store the acknowledgement
+    mutex_lock(&p_primary->_lock);
+    p_slot->acked   = _header.sequence,
+    p_slot->contact = timer_high_precision();
+    mutex_unlock(&p_primary->_lock);
+
+    // success
+    return 1;
+}
+
+void *replication_primary_serve ( struct replication_slot_s *p_slot )
+{
+
+    // initialized data
+    replication_primary         *p_primary = p_slot->p_primary;
+    struct replication_header_s  _header   = { 0 };
+    struct replication_hello_s   _hello    = { 0 };
+    char                        *p_chunk   = NULL;
+    size_t                       chunk_max = REPLICATION_CHUNK_MAX;
+    bool                         snapshot  = true;
+
+    // read the hello
+    if ( 0 == replication_receive(p_slot->fd, &_header, sizeof(_header), REPLICATION_TIMEOUT_MS) ) goto done;
+    if ( REPLICATION_HELLO != _header.kind || sizeof(_hello) != _header.size ) goto done;
+    if ( 0 == replication_receive(p_slot->fd, &_hello, sizeof(_hello), REPLICATION_TIMEOUT_MS) ) goto done;
+
+    // error check
+    if ( REPLICATION_MAGIC != _hello.magic || REPLICATION_VERSION != _hello.version ) goto done;
+
+    // log
+    log_info("[identity] [replication] Replica %hhu.%hhu.%hhu.%hhu:%hu connected at sequence %llu\n",
+        (unsigned char) ( p_slot->address >> 24 ), (unsigned char) ( p_slot->address >> 16 ),
+        (unsigned char) ( p_slot->address >> 8  ), (unsigned char) ( p_slot->address ),
+        p_slot->port, (unsigned long long) _header.sequence
+    );
+
+    // lock
+    mutex_lock(&p_primary->_lock);
+
+    // catch up from the backlog, if it holds every record the replica lacks
+    if ( _hello.generation == p_primary->generation && _header.sequence >= p_primary->after && _header.sequence <= p_primary->sequence )
+        snapshot         = false,
+        p_slot->position = replication_backlog_find(p_primary, _header.sequence),
+        p_slot->acked    = _header.sequence;
+
+    // unlock
+    mutex_unlock(&p_primary->_lock);
+
+    // else send a snapshot
+    if ( snapshot )
+        if ( 0 == replication_primary_snapshot(p_slot) ) goto done;
+
+    // allocate a chunk
+    p_chunk = default_allocator(NULL, chunk_max);
+
+    // error check
+    if ( NULL == p_chunk ) goto done;
+
+    // stream records until the primary is destroyed or the replica leaves
+    while ( atomic_load(&p_primary->running) )
+    {
+
+        // initialized data
+        struct pollfd _polls[2] =
+        {
+            { .fd = p_slot->fd     , .events = POLLIN },
+            { .fd = p_slot->wake_fd, .events = POLLIN }
+        };
+        size_t   chunk_len = 0;
+        uint64_t last      = 0;
+        uint64_t heartbeat = 0;
+        int      ready     = 0;
+
+        // lock
+        mutex_lock(&p_primary->_lock);
+
+        // the replica fell behind the backlog
+        if ( p_slot->position < p_primary->base ) goto fell_behind;
+
+        // copy whole records, at least one
+        for (size_t offset = p_slot->position - p_primary->base; offset + chunk_len < p_primary->backlog_len; )
+        {
+
+            // initialized data
+            const char *p_record = p_primary->p_backlog + offset + chunk_len;
+            size_t      size     = wal_record_size(p_record);
+
+            // stop when the chunk is full
+            if ( chunk_len && chunk_len + size > REPLICATION_CHUNK_MAX ) break;
+
+            // grow the chunk for a large record
+            if ( chunk_len + size > chunk_max )
+            {
+
+                // initialized data
+                char *p_larger = default_allocator(p_chunk, chunk_len + size);
+
+                // error check
+                if ( NULL == p_larger ) goto no_mem;
+
+                // store the chunk
+                p_chunk   = p_larger,
+                chunk_max = chunk_len + size;
+            }
+
+            // copy the record
+            memcpy(p_chunk + chunk_len, p_record, size);
+            last = wal_record_sequence(p_record);
+
+            // next
+            chunk_len += size;
+        }
+
+        // store the sequence for a heartbeat
+        heartbeat = p_primary->sequence;
+
+        // unlock
+        mutex_unlock(&p_primary->_lock);
+
+        // send the records
+        if ( chunk_len )
+        {
+
+            // send the chunk
+            if ( 0 == replication_send(p_slot->fd, REPLICATION_RECORDS, last, p_chunk, chunk_len) ) goto done;
+
+            // advance
+            p_slot->position += chunk_len;
+
+            // drain acknowledgements without waiting
+            _polls[1].fd = -1;
+            while ( 1 == poll(_polls, 1, 0) )
+                if ( 0 == replication_primary_acks(p_slot) ) goto done;
+
+            // next
+            continue;
+        }
+
+        // wait for a record, an acknowledgement, or the heartbeat
+        ready = poll(_polls, 2, REPLICATION_HEARTBEAT_MS);
+
+        // retry on signals
+        if ( -1 == ready && EINTR == errno ) continue;
+
+        // error check
+        if ( -1 == ready ) goto done;
+
+        // quiet. Tell the replica where the primary is
+        if ( 0 == ready )
+        {
+            if ( 0 == replication_send(p_slot->fd, REPLICATION_HEARTBEAT, heartbeat, NULL, 0) ) goto done;
+            continue;
+        }
+
+        // records were appended
+        if ( _polls[1].revents & POLLIN )
+        {
+
+            // initialized data
+            uint64_t count = 0;
+
+            // reset the eventfd
+            (void) !read(p_slot->wake_fd, &count, sizeof(count));
+        }
+
+        // the replica acknowledged, or left
+        if ( _polls[0].revents )
+            if ( 0 == replication_primary_acks(p_slot) ) goto done;
+    }
+
+    done:
+
+    // log
+    log_info("[identity] [replication] Replica %hhu.%hhu.%hhu.%hhu:%hu disconnected\n",
+        (unsigned char) ( p_slot->address >> 24 ), (unsigned char) ( p_slot->address >> 16 ),
+        (unsigned char) ( p_slot->address >> 8  ), (unsigned char) ( p_slot->address ),
+        p_slot->port
+    );
+
+    // release the chunk
+    p_chunk = default_allocator(p_chunk, 0);
+
+    // lock
+    mutex_lock(&p_primary->_lock);
+
+    // release the sockets, and hand the slot back
+    close(p_slot->fd),
+    close(p_slot->wake_fd);
+    p_slot->fd      = -1,
+    p_slot->wake_fd = -1,
+    p_slot->state   = REPLICATION_SLOT_DONE;
+
+    // unlock
+    mutex_unlock(&p_primary->_lock);
+
+    // done
+    return NULL;
+
+    // error handling
+    {
+
+        // data errors
+        {
+            fell_behind:
+                log_warning("[identity] [replication] Replica %hhu.%hhu.%hhu.%hhu:%hu fell behind the backlog\n",
+                    (unsigned char) ( p_slot->address >> 24 ), (unsigned char) ( p_slot->address >> 16 ),
+                    (unsigned char) ( p_slot->address >> 8  ), (unsigned char) ( p_slot->address ),
+                    p_slot->port
+                );
+
+                // unlock
+                mutex_unlock(&p_primary->_lock);
+
+                // disconnect. The replica comes back for a snapshot
+                goto done;
+        }
+
+        // standard library errors
+        {
+            no_mem:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // unlock
+                mutex_unlock(&p_primary->_lock);
+
+                // disconnect
+                goto done;
+        }
+    }
+}
+
+size_t replication_primary_status ( replication_primary *p_primary, replication_status *_statuses, size_t max )
+{
+
+    // argument check
+    if ( NULL == p_primary ) goto no_primary;
+    if ( NULL == _statuses ) goto no_statuses;
+
+    // initialized data
+    size_t quantity = 0;
+
+    // lock
+    mutex_lock(&p_primary->_lock);
+
+    // report each live replica
+    for (size_t i = 0; i < REPLICATION_REPLICAS_MAX && quantity < max; i++)
+    {
+
+        // initialized data
+        struct replication_slot_s *p_slot = &p_primary->_slots[i];
+
+        // skip free slots
+        if ( REPLICATION_SLOT_LIVE != p_slot->state ) continue;
+
+        // store the status
+        _statuses[quantity++] = (replication_status)
+        {
+            .connected  = true,
+            .address    = p_slot->address,
+            .port       = p_slot->port,
+            .applied    = p_slot->acked,
+            .primary    = p_primary->sequence,
+            .lag        = p_primary->sequence > p_slot->acked ? p_primary->sequence - p_slot->acked : 0,
+            .contact_ms = replication_elapsed_ms(p_slot->contact)
+        };
+    }
+
+    // unlock
+    mutex_unlock(&p_primary->_lock);
+
+    // done
+    return quantity;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_primary:
+                #ifndef NDEBUG
+                    log_error("[identity] [replication] Null pointer provided for parameter \"p_primary\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_statuses:
+                #ifndef NDEBUG
+                    log_error("[identity] [replication] Null pointer provided for parameter \"_statuses\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+char *replication_backlog_reserve ( replication_primary *p_primary, size_t size )
+{
+
+    // the backlog is full. Drop the oldest records, down to half
+    if ( p_primary->backlog_len + size > REPLICATION_BACKLOG_MAX )
+    {
+
+        // initialized data
+        size_t dropped = 0;
+
+        // drop whole records
+        while ( dropped < p_primary->backlog_len && p_primary->backlog_len - dropped + size > REPLICATION_BACKLOG_MAX / 2 )
+        {
+
+            // the backlog now holds every record after this one
+            p_primary->after = wal_record_sequence(p_primary->p_backlog + dropped);
+
+            // next
+            dropped += wal_record_size(p_primary->p_backlog + dropped);
+        }
+
+        // move the rest to the front
+        memmove(p_primary->p_backlog, p_primary->p_backlog + dropped, p_primary->backlog_len - dropped);
+        p_primary->backlog_len -= dropped,
+        p_primary->base        += dropped;
+    }
+
+    // grow the backlog
+    if ( p_primary->backlog_len + size > p_primary->backlog_max )
+    {
+
+        // initialized data
+        size_t  backlog_max = p_primary->backlog_max;
+        char   *p_backlog   = NULL;
+
+        // double until the records fit
+        while ( p_primary->backlog_len + size > backlog_max ) backlog_max *= 2;
+
+        // grow
+        p_backlog = default_allocator(p_primary->p_backlog, backlog_max);
+
+        // error check
+        if ( NULL == p_backlog ) return NULL;
+
+        // store the backlog
+        p_primary->p_backlog   = p_backlog,
+        p_primary->backlog_max = backlog_max;
+    }
+
+    // done
+    return p_primary->p_backlog + p_primary->backlog_len;
+}
+
+void replication_primary_wake ( replication_primary *p_primary )
+{
+
+    // wake each replica
+    for (size_t i = 0; i < REPLICATION_REPLICAS_MAX; i++)
+    {
+
+        // initialized data
+        uint64_t one = 1;
+
+        // skip free slots
+        if ( REPLICATION_SLOT_LIVE != p_primary->_slots[i].state ) continue;
+
+        // wake the replica
+        (void) !write(p_primary->_slots[i].wake_fd, &one, sizeof(one));
+    }
+}
+
+int replication_primary_append ( replication_primary *p_primary, enum wal_record_e type, const void *p_value, uint64_t sequence )
+{
+
+    // argument check
+    if ( NULL == p_primary ) goto no_primary;
+    if ( NULL == p_value   ) goto no_value;
+
+    // initialized data
+    size_t  size     = wal_record_pack(NULL, type, p_value, sequence);
+    char   *p_record = NULL;
+
+    // error check
+    if ( 0 == size ) goto failed_to_pack;
+
+    // lock
+    mutex_lock(&p_primary->_lock);
+
+    // make room for the record
+    p_record = replication_backlog_reserve(p_primary, size);
+
+    // error check
+    if ( NULL == p_record ) goto no_mem;
+
+    // pack the record
+    (void) wal_record_pack(p_record, type, p_value, sequence);
+    p_primary->backlog_len += size,
+    p_primary->sequence     = sequence;
+
+    // wake each replica
+    replication_primary_wake(p_primary);
+
+    // unlock
+    mutex_unlock(&p_primary->_lock);
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_primary:
+                #ifndef NDEBUG
+                    log_error("[identity] [replication] Null pointer provided for parameter \"p_primary\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_value:
+                #ifndef NDEBUG
+                    log_error("[identity] [replication] Null pointer provided for parameter \"p_value\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // data errors
+        {
+            failed_to_pack:
+                #ifndef NDEBUG
+                    log_error("[identity] [replication] Failed to pack record in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // standard library errors
+        {
+            no_mem:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // unlock
+                mutex_unlock(&p_primary->_lock);
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int replication_primary_append_records ( replication_primary *p_primary, const void *p_records, size_t len )
+{
+
+    // argument check
+    if ( NULL == p_primary ) goto no_primary;
+    if ( NULL == p_records && len ) goto no_records;
+
+    // initialized data
+    char     *p_backlog = NULL;
+    uint64_t  sequence  = 0;
+
+    // nothing to ship
+    if ( 0 == len ) return 1;
+
+    // the sequence of the last record
+    for (size_t offset = 0; offset < len; offset += wal_record_size((const char *) p_records + offset))
+        sequence = wal_record_sequence((const char *) p_records + offset);
+
+    // lock
+    mutex_lock(&p_primary->_lock);
+
+    // make room for the records
+    p_backlog = replication_backlog_reserve(p_primary, len);
+
+    // error check
+    if ( NULL == p_backlog ) goto no_mem;
+
+    // copy the records. They are already packed
+    memcpy(p_backlog, p_records, len);
+    p_primary->backlog_len += len,
+    p_primary->sequence     = sequence;
+
+    // wake each replica
+    replication_primary_wake(p_primary);
+
+    // unlock
+    mutex_unlock(&p_primary->_lock);
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_primary:
+                #ifndef NDEBUG
+                    log_error("[identity] [replication] Null pointer provided for parameter \"p_primary\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_records:
+                #ifndef NDEBUG
+                    log_error("[identity] [replication] Null pointer provided for parameter \"p_records\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // standard library errors
+        {
+            no_mem:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // unlock
+                mutex_unlock(&p_primary->_lock);
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int replication_primary_destroy ( replication_primary **pp_primary )
+{
+
+    // argument check
+    if ( NULL == pp_primary ) goto no_primary;
+
+    // initialized data
+    replication_primary *p_primary = *pp_primary;
+
+    // no more pointer for caller
+    *pp_primary = NULL;
+
+    // fast exit
+    if ( NULL == p_primary ) return 1;
+
+    // stop accepting replicas
+    atomic_store(&p_primary->running, false);
+    (void) parallel_thread_join(&p_primary->p_listener);
+
+    // lock
+    mutex_lock(&p_primary->_lock);
+
+    // wake each replica thread
+    for (size_t i = 0; i < REPLICATION_REPLICAS_MAX; i++)
+        if ( REPLICATION_SLOT_LIVE == p_primary->_slots[i].state )
+            (void) shutdown(p_primary->_slots[i].fd, SHUT_RDWR);
+
+    // unlock
+    mutex_unlock(&p_primary->_lock);
+
+    // join each replica thread
+    for (size_t i = 0; i < REPLICATION_REPLICAS_MAX; i++)
+        if ( REPLICATION_SLOT_FREE != p_primary->_slots[i].state )
+            (void) parallel_thread_join(&p_primary->_slots[i].p_thread);
+
+    // release the socket
+    close(p_primary->listen_fd);
+
+    // release the lock
+    mutex_destroy(&p_primary->_lock);
+
+    // release the backlog
+    p_primary->p_backlog = default_allocator(p_primary->p_backlog, 0);
+
+    // release the primary
+    p_primary = default_allocator(p_primary, 0);
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_primary:
+                #ifndef NDEBUG
+                    log_error("[identity] [replication] Null pointer provided for parameter \"pp_primary\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int replication_replica_construct ( replication_replica **pp_replica, const char *p_host, uint16_t port, fn_wal_replay *pfn_apply, fn_replication_snapshot *pfn_snapshot, void *p_context )
+{
+
+    // argument check
+    if ( NULL == pp_replica   ) goto no_replica;
+    if ( NULL == p_host       ) goto no_host;
+    if ( NULL == pfn_apply    ) goto no_apply;
+    if ( NULL == pfn_snapshot ) goto no_snapshot;
+
+    // initialized data
+    replication_replica *p_replica = default_allocator(NULL, sizeof(replication_replica));
+    size_t               host_len  = strlen(p_host);
+
+    // error check
+    if ( NULL == p_replica ) goto no_mem;
+
+    // populate the replica
+    *p_replica = (replication_replica)
+    {
+        .running      = true,
+        .p_host       = default_allocator(NULL, host_len + 1),
+        .port         = port,
+        .fd           = -1,
+        .contact      = timer_high_precision(),
+        .pfn_apply    = pfn_apply,
+        .pfn_snapshot = pfn_snapshot,
+        .p_context    = p_context
+    };
+
+    // error check
+    if ( NULL == p_replica->p_host ) goto no_host_mem;
+
+    // copy the host
+    memcpy(p_replica->p_host, p_host, host_len + 1);
+
+    // construct the lock
+    mutex_create(&p_replica->_lock);
+
+    // follow the primary
+    if ( 0 == parallel_thread_start(&p_replica->p_thread, (fn_parallel_task *) replication_replica_run, p_replica) ) goto failed_to_start;
+
+    // return a pointer to the caller
+    *pp_replica = p_replica;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_replica:
+                #ifndef NDEBUG
+                    log_error("[identity] [replication] Null pointer provided for parameter \"pp_replica\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_host:
+                #ifndef NDEBUG
+                    log_error("[identity] [replication] Null pointer provided for parameter \"p_host\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_apply:
+                #ifndef NDEBUG
+                    log_error("[identity] [replication] Null pointer provided for parameter \"pfn_apply\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_snapshot:
+                #ifndef NDEBUG
+                    log_error("[identity] [replication] Null pointer provided for parameter \"pfn_snapshot\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // gsdk errors
+        {
+            failed_to_start:
+                #ifndef NDEBUG
+                    log_error("[gsdk] [parallel] Failed to start thread in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // release the lock
+                mutex_destroy(&p_replica->_lock);
+
+                // release the host
+                p_replica->p_host = default_allocator(p_replica->p_host, 0);
+
+                // release the replica
+                p_replica = default_allocator(p_replica, 0);
+
+                // error
+                return 0;
+        }
+
+        // standard library errors
+        {
+            no_mem:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_host_mem:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // release the replica
+                p_replica = default_allocator(p_replica, 0);
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int replication_replica_connect ( replication_replica *p_replica )
+{
+
+    // initialized data
+    struct addrinfo  _hints      = { .ai_family = AF_INET, .ai_socktype = SOCK_STREAM };
+    struct addrinfo *p_addresses = NULL;
+    char             _port[8]    = { 0 };
+    int              fd          = -1;
+    int              _one        = 1;
+
+    // resolve the primary each time, since its address may move
+    snprintf(_port, sizeof(_port), "%hu", p_replica->port);
+    if ( 0 != getaddrinfo(p_replica->p_host, _port, &_hints, &p_addresses) ) return -1;
+
+    // open the socket
+    fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    // error check
+    if ( -1 == fd ) goto done;
+
+    // connect
+    if ( -1 == connect(fd, p_addresses->ai_addr, p_addresses->ai_addrlen) )
+    {
+        close(fd);
+        fd = -1;
+        goto done;
+    }
+
+    // acknowledgements are small, and should leave as soon as they are due
+    (void) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &_one, sizeof(_one));
+
+    // store the address
+    mutex_lock(&p_replica->_lock);
+    p_replica->address = ntohl(( (struct sockaddr_in *) p_addresses->ai_addr )->sin_addr.s_addr);
+    mutex_unlock(&p_replica->_lock);
+
+    done:
+
+    // release the addresses
+    freeaddrinfo(p_addresses);
+
+    // done
+    return fd;
+}
+
+int replication_replica_apply ( replication_replica *p_replica, const char *p_records, size_t len )
+{
+
+    // initialized data
+    size_t offset = 0;
+
+    // apply each record
+    while ( offset < len )
+    {
+
+        // initialized data
+        uint64_t           sequence = 0;
+        enum wal_record_e  type     = 0;
+        void              *p_value  = NULL;
+        size_t             size     = wal_record_unpack(p_records + offset, len - offset, &sequence, &type, &p_value);
+
+        // error check
+        if ( 0 == size ) goto bad_record;
+
+        // apply the record. A record that does not apply is logged by the
+        // callback, and skipped, as on replay
+        (void) p_replica->pfn_apply(p_replica->p_context, type, p_value);
+
+        // next
+        offset += size;
+    }
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // data errors
+        {
+            bad_record:
+                #ifndef NDEBUG
+                    log_error("[identity] [replication] Torn or corrupt record from primary in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int replication_replica_follow ( replication_replica *p_replica, int fd )
+{
+
+    // initialized data
+    struct replication_header_s  _header    = { 0 };
+    char                        *p_payload  = NULL;
+    size_t                       max        = 0;
+    bool                         snapshot   = false;
+    int                          result     = 0;
+
+    // read messages until the connection drops
+    while ( atomic_load(&p_replica->running) )
+    {
+
+        // read a header. The primary sends a heartbeat when it is quiet, so
+        // silence means the primary is gone
+        if ( 0 == replication_receive(fd, &_header, sizeof(_header), REPLICATION_TIMEOUT_MS) ) break;
+
+        // error check
+        if ( _header.size > REPLICATION_BACKLOG_MAX ) break;
+
+        // grow the payload
+        if ( _header.size > max )
+        {
+
+            // initialized data
+            char *p_larger = default_allocator(p_payload, _header.size);
+
+            // error check
+            if ( NULL == p_larger ) break;
+
+            // store the payload
+            p_payload = p_larger,
+            max       = _header.size;
+        }
+
+        // read the payload
+        if ( _header.size )
+            if ( 0 == replication_receive(fd, p_payload, _header.size, REPLICATION_TIMEOUT_MS) ) break;
+
+        // heard from the primary
+        mutex_lock(&p_replica->_lock);
+        p_replica->contact = timer_high_precision();
+        mutex_unlock(&p_replica->_lock);
+
+        // strategy
+        switch ( _header.kind )
+        {
+            case REPLICATION_SNAPSHOT:
+
+                // the first chunk starts the snapshot
+                if ( false == snapshot )
+                {
+                    if ( 0 == p_replica->pfn_snapshot(p_replica->p_context, REPLICATION_SNAPSHOT_BEGIN) ) goto done;
+                    snapshot = true;
+                }
+
+                // apply the records
+                if ( 0 == replication_replica_apply(p_replica, p_payload, _header.size) ) goto done;
+
+                // next
+                continue;
+
+            case REPLICATION_SNAPSHOT_END:
+
+                // error check
+                if ( false == snapshot || sizeof(p_replica->generation) != _header.size ) goto done;
+
+                // finish the snapshot
+                snapshot = false;
+                (void) p_replica->pfn_snapshot(p_replica->p_context, REPLICATION_SNAPSHOT_FINISH);
+
+                // store the position
+                mutex_lock(&p_replica->_lock);
+                memcpy(&p_replica->generation, p_payload, sizeof(p_replica->generation));
+                p_replica->applied = _header.sequence;
+                if ( p_replica->primary < _header.sequence ) p_replica->primary = _header.sequence;
+                mutex_unlock(&p_replica->_lock);
+
+                // log
+                log_info("[identity] [replication] Loaded a snapshot at sequence %llu\n", (unsigned long long) _header.sequence);
+
+                // done
+                break;
+
+            case REPLICATION_RECORDS:
+
+                // error check
+                if ( snapshot ) goto done;
+
+                // apply the records
+                if ( 0 == replication_replica_apply(p_replica, p_payload, _header.size) ) goto done;
+
+                // store the position
+                mutex_lock(&p_replica->_lock);
+                p_replica->applied = _header.sequence;
+                if ( p_replica->primary < _header.sequence ) p_replica->primary = _header.sequence;
+                mutex_unlock(&p_replica->_lock);
+
+                // done
+                break;
+
+            case REPLICATION_HEARTBEAT:
+
+                // store the position of the primary
+                mutex_lock(&p_replica->_lock);
+                p_replica->primary = _header.sequence;
+                mutex_unlock(&p_replica->_lock);
+
+                // done
+                break;
+
+            default:
+
+                // error
+                goto done;
+        }
+
+        // acknowledge what has been applied
+        if ( 0 == replication_send(fd, REPLICATION_ACK, p_replica->applied, NULL, 0) ) break;
+    }
+
+    // success
+    result = 1;
+
+    done:
+
+    // cancel a snapshot the connection cut short, so the replica serves
+    // what it has
+    if ( snapshot ) (void) p_replica->pfn_snapshot(p_replica->p_context, REPLICATION_SNAPSHOT_CANCEL);
+
+    // release the payload
+    p_payload = default_allocator(p_payload, 0);
+
+    // done
+    return result;
+}
+
+void *replication_replica_run ( replication_replica *p_replica )
+{
+
+    // follow the primary until the replica is destroyed
+    while ( atomic_load(&p_replica->running) )
+    {
+
+        // initialized data
+        struct replication_hello_s _hello = { .magic = REPLICATION_MAGIC, .version = REPLICATION_VERSION };
+        uint64_t                   applied = 0;
+        int                        fd      = replication_replica_connect(p_replica);
+
+        // retry later
+        if ( -1 == fd )
+        {
+            (void) poll(NULL, 0, REPLICATION_RETRY_MS);
+            continue;
+        }
+
+        // publish the connection
+        mutex_lock(&p_replica->_lock);
+        p_replica->fd        = fd,
+        p_replica->connected = true,
+        p_replica->contact   = timer_high_precision(),
+        applied              = p_replica->applied,
+        _hello.generation    = p_replica->generation;
+        mutex_unlock(&p_replica->_lock);
+
+        // log
+        log_info("[identity] [replication] Following %s:%hu from sequence %llu\n", p_replica->p_host, p_replica->port, (unsigned long long) applied);
+
+        // say hello, and follow
+        if ( replication_send(fd, REPLICATION_HELLO, applied, &_hello, sizeof(_hello)) )
+            (void) replication_replica_follow(p_replica, fd);
+
+        // withdraw the connection
+        mutex_lock(&p_replica->_lock);
+        close(fd);
+        p_replica->fd        = -1,
+        p_replica->connected = false;
+        mutex_unlock(&p_replica->_lock);
+
+        // log
+        if ( atomic_load(&p_replica->running) )
+            log_warning("[identity] [replication] Lost %s:%hu. Reconnecting\n", p_replica->p_host, p_replica->port),
+            (void) poll(NULL, 0, REPLICATION_RETRY_MS);
+    }
+
+    // done
+    return NULL;
+}
+
+int replication_replica_status ( replication_replica *p_replica, replication_status *p_status )
+{
+
+    // argument check
+    if ( NULL == p_replica ) goto no_replica;
+    if ( NULL == p_status  ) goto no_status;
+
+    // lock
+    mutex_lock(&p_replica->_lock);
+
+    // store the status
+    *p_status = (replication_status)
+    {
+        .connected  = p_replica->connected,
+        .address    = p_replica->address,
+        .port       = p_replica->port,
+        .applied    = p_replica->applied,
+        .primary    = p_replica->primary,
+        .lag        = p_replica->primary > p_replica->applied ? p_replica->primary - p_replica->applied : 0,
+        .contact_ms = replication_elapsed_ms(p_replica->contact)
+    };
+
+    // unlock
+    mutex_unlock(&p_replica->_lock);
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_replica:
+                #ifndef NDEBUG
+                    log_error("[identity] [replication] Null pointer provided for parameter \"p_replica\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_status:
+                #ifndef NDEBUG
+                    log_error("[identity] [replication] Null pointer provided for parameter \"p_status\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int replication_replica_destroy ( replication_replica **pp_replica )
+{
+
+    // argument check
+    if ( NULL == pp_replica ) goto no_replica;
+
+    // initialized data
+    replication_replica *p_replica = *pp_replica;
+
+    // no more pointer for caller
+    *pp_replica = NULL;
+
+    // fast exit
+    if ( NULL == p_replica ) return 1;
+
+    // stop following
+    atomic_store(&p_replica->running, false);
+
+    // wake the thread
+    mutex_lock(&p_replica->_lock);
+    if ( -1 != p_replica->fd ) (void) shutdown(p_replica->fd, SHUT_RDWR);
+    mutex_unlock(&p_replica->_lock);
+
+    // join the thread
+    (void) parallel_thread_join(&p_replica->p_thread);
+
+    // release the lock
+    mutex_destroy(&p_replica->_lock);
+
+    // release the host
+    p_replica->p_host = default_allocator(p_replica->p_host, 0);
+
+    // release the replica
+    p_replica = default_allocator(p_replica, 0);
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_replica:
+                #ifndef NDEBUG
+                    log_error("[identity] [replication] Null pointer provided for parameter \"pp_replica\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+#else
+
+// replication requires sockets and eventfd
+int replication_primary_construct ( replication_primary **pp_primary, uint16_t port, uint64_t sequence, fn_replication_dump *pfn_dump, void *p_context )
+{
+
+    // unused
+    (void) pp_primary, (void) port, (void) sequence, (void) pfn_dump, (void) p_context;
+
+    // log
+    log_error("[identity] [replication] Replication requires linux\n");
+
+    // error
+    return 0;
+}
+
+int replication_replica_construct ( replication_replica **pp_replica, const char *p_host, uint16_t port, fn_wal_replay *pfn_apply, fn_replication_snapshot *pfn_snapshot, void *p_context )
+{
+
+    // unused
+    (void) pp_replica, (void) p_host, (void) port, (void) pfn_apply, (void) pfn_snapshot, (void) p_context;
+
+    // log
+    log_error("[identity] [replication] Replication requires linux\n");
+
+    // error
+    return 0;
+}
+
+size_t replication_primary_status ( replication_primary *p_primary, replication_status *_statuses, size_t max ) { (void) p_primary, (void) _statuses, (void) max; return 0; }
+int replication_replica_status ( replication_replica *p_replica, replication_status *p_status ) { (void) p_replica, (void) p_status; return 0; }
+int replication_primary_append ( replication_primary *p_primary, enum wal_record_e type, const void *p_value, uint64_t sequence ) { (void) p_primary, (void) type, (void) p_value, (void) sequence; return 0; }
+int replication_primary_append_records ( replication_primary *p_primary, const void *p_records, size_t len ) { (void) p_primary, (void) p_records, (void) len; return 0; }
+int replication_primary_destroy ( replication_primary **pp_primary ) { (void) pp_primary; return 1; }
+int replication_replica_destroy ( replication_replica **pp_replica ) { (void) pp_replica; return 1; }
+
+#endif
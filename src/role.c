@@ -10,14 +10,54 @@
 #include <identity/role.h>
 
 // structure definitions
+//
+// A role is one contiguous record. A table of permission offsets follows the
+// fixed fields, then a table of interned permission ids, then the name and
+// the permissions themselves, so a record means the same thing on the heap
+// and in a mapped snapshot. Ids are interned again whenever a record is
+// bound, so a stored id is never trusted
 struct role_s
 {
-    size_t id;
-    char   _name[64+1];
-    size_t org_id;
-    array *p_permissions;
+    uint64_t id;
+    uint64_t org_id;
+    uint64_t size;                  // bytes in the whole record
+    uint32_t name_id;               // interned
+    uint32_t name_offset;
+    uint32_t permissions_len;
+    uint32_t permissions_offset;    // offset of the permission offset table
+    uint32_t permission_ids_offset; // offset of the interned permission ids
+    uint32_t _reserved;
 };
 
+// function declarations
+int role_intern ( role *p_role );
+
+int role_intern ( role *p_role )
+{
+
+    // initialized data
+    const uint32_t *p_offsets = (const uint32_t *)( (const char *) p_role + p_role->permissions_offset );
+    uint32_t       *p_ids     = (uint32_t *)( (char *) p_role + p_role->permission_ids_offset );
+    const char     *p_name    = (const char *) p_role + p_role->name_offset;
+
+    // intern the name
+    if ( 0 == intern_string_add(p_name, strlen(p_name), &p_role->name_id) ) return 0;
+
+    // intern each permission
+    for (size_t i = 0; i < p_role->permissions_len; ++i)
+    {
+
+        // initialized data
+        const char *p_permission = (const char *) p_role + p_offsets[i];
+
+        // intern the permission
+        if ( 0 == intern_string_add(p_permission, strlen(p_permission), &p_ids[i]) ) return 0;
+    }
+
+    // success
+    return 1;
+}
+
 int role_construct
 (
     role **pp_role,
@@ -35,21 +75,75 @@ int role_construct
     if ( NULL ==  p_name ) goto no_name;
 
     // initialized data
-    role *p_role = default_allocator(NULL, sizeof(role));
+    role       *p_role                = NULL;
+    uint32_t   *p_offsets             = NULL;
+    const char *p_end                 = memchr(p_name, '\0', ROLE_NAME_MAX);
+    size_t      name_len              = ( p_end ) ? (size_t)( p_end - p_name ) : ROLE_NAME_MAX,
+                permissions_offset    = sizeof(role),
+                permission_ids_offset = permissions_offset + permissions_length * sizeof(uint32_t),
+                name_offset           = permission_ids_offset + permissions_length * sizeof(uint32_t),
+                size                  = name_offset + name_len + 1,
+                offset                = size;
+
+    // error check
+    if ( ROLE_PERMISSIONS_MAX < permissions_length ) goto too_many_permissions;
+
+    // measure the permissions
+    for (size_t i = 0; i < permissions_length; ++i)
+    {
+
+        // error check
+        if ( NULL == _p_permissions[i] ) goto no_permissions;
+
+        // accumulate
+        size += strlen(_p_permissions[i]) + 1;
+    }
+
+    // round up to a whole record
+    size = ( size + 7 ) & ~(size_t) 7;
+
+    // allocate the record
+    p_role = default_allocator(NULL, size);
 
     // error check
     if ( NULL == p_role ) goto no_mem;
 
+    // zero the record, so packed records have no stray bytes
+    memset(p_role, 0, size);
+
     // populate the role struct
     *p_role = (role)
     {
-        .id    = id,
-        ._name = { 0 }
+        .id                 = id,
+        .org_id             = org_id,
+        .size               = size,
+        .name_id               = INTERN_NONE,
+        .name_offset           = (uint32_t) name_offset,
+        .permissions_len       = (uint32_t) permissions_length,
+        .permissions_offset    = (uint32_t) permissions_offset,
+        .permission_ids_offset = (uint32_t) permission_ids_offset
     };
 
     // copy the name
-    strncpy(p_role->_name, p_name, sizeof(p_role->_name) - 1);
-    p_role->_name[strlen(p_name)] = '\0';
+    memcpy((char *) p_role + name_offset, p_name, name_len);
+
+    // store the permissions
+    p_offsets = (uint32_t *)( (char *) p_role + permissions_offset );
+    for (size_t i = 0; i < permissions_length; ++i)
+    {
+
+        // initialized data
+        size_t len = strlen(_p_permissions[i]) + 1;
+
+        // store the permission
+        memcpy((char *) p_role + offset, _p_permissions[i], len);
+
+        // store the offset
+        p_offsets[i] = (uint32_t) offset, offset += len;
+    }
+
+    // intern the name and the permissions
+    if ( 0 == role_intern(p_role) ) goto failed_to_intern;
 
     // return a pointer to the caller
     *pp_role = p_role;
@@ -86,26 +180,39 @@ int role_construct
                 // error
                 return 0;
 
-            no_groups:
+            no_permissions:
+                #ifndef NDEBUG
+                    log_error("[identity] [role] Null pointer provided for parameter \"_p_permissions\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // role errors
+        {
+            too_many_permissions:
                 #ifndef NDEBUG
-                    log_error("[identity] [role] Null pointer provided for parameter \"p_groups\" in call to function \"%s\"\n", __FUNCTION__);
+                    log_error("[identity] [role] Parameter \"permissions_length\" is greater than %d in call to function \"%s\"\n", ROLE_PERMISSIONS_MAX, __FUNCTION__);
                 #endif
 
                 // error
                 return 0;
 
-            no_roles:
+            failed_to_intern:
                 #ifndef NDEBUG
-                    log_error("[identity] [role] Null pointer provided for parameter \"p_roles\" in call to function \"%s\"\n", __FUNCTION__);
+                    log_error("[identity] [role] Failed to intern role strings in call to function \"%s\"\n", __FUNCTION__);
                 #endif
 
+                // clean up
+                p_role = default_allocator(p_role, 0);
+
                 // error
                 return 0;
         }
     
         // standard library errors
         {
-            no_mem_1: p_role = default_allocator(p_role, 0);
             no_mem:
                 #ifndef NDEBUG
                     log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
@@ -129,13 +236,13 @@ int role_from_json
     if ( NULL == p_value ) goto no_value;
 
     // initialized data
-    role        *p_role    = default_allocator(NULL, sizeof(role));
-    dict       *p_dict   = NULL;
-    json_value *p_name   = NULL,
-               *p_role_id = NULL;
-
-    // error check
-    if ( NULL == p_role ) goto no_mem;
+    dict       *p_dict          = NULL;
+    json_value *p_name          = NULL,
+               *p_role_id       = NULL,
+               *p_org_id        = NULL,
+               *p_permissions   = NULL;
+    char       *_p_permissions[ROLE_PERMISSIONS_MAX] = { 0 };
+    size_t      permissions_len = 0;
 
     // type check
     if ( JSON_VALUE_OBJECT != p_value->type ) goto wrong_type;
@@ -143,9 +250,11 @@ int role_from_json
     // store the object
     p_dict = p_value->object;
 
-    // get the name
-    p_name = dict_get(p_dict, "name");
-    p_role_id = dict_get(p_dict, "role_id");
+    // get the properties
+    p_name        = dict_get(p_dict, "name");
+    p_role_id     = dict_get(p_dict, "id");
+    p_org_id      = dict_get(p_dict, "org_id");
+    p_permissions = dict_get(p_dict, "permissions");
 
     // error check
     if ( NULL ==   p_name ) goto no_name;
@@ -154,23 +263,41 @@ int role_from_json
     // type check
     if (  JSON_VALUE_STRING !=   p_name->type ) goto name_wrong_type;
     if ( JSON_VALUE_INTEGER != p_role_id->type ) goto role_id_wrong_type;
+    if ( p_org_id      && JSON_VALUE_INTEGER != p_org_id->type      ) goto org_id_wrong_type;
+    if ( p_permissions && JSON_VALUE_ARRAY   != p_permissions->type ) goto permissions_wrong_type;
 
-    // populate the role struct
-    *p_role = (role)
+    // get the permissions
+    if ( p_permissions )
     {
-        .id    = p_role_id->integer,
-        ._name = { 0 }
-    };
 
-    // copy the name
-    strncpy(p_role->_name, p_name->string, sizeof(p_role->_name) - 1);
-    p_role->_name[strlen(p_name->string)] = '\0';
+        // initialized data
+        json_value *_p_values[ROLE_PERMISSIONS_MAX] = { 0 };
 
-    // return a pointer to the caller
-    *pp_role = p_role;
+        // error check
+        permissions_len = array_size(p_permissions->list);
+        if ( ROLE_PERMISSIONS_MAX < permissions_len ) goto too_many_permissions;
 
-    // success
-    return 1;
+        // get the values
+        array_get(p_permissions->list, (void **) _p_values, NULL);
+
+        // type check
+        for (size_t i = 0; i < permissions_len; i++)
+        {
+            if ( JSON_VALUE_STRING != _p_values[i]->type ) goto permissions_wrong_type;
+            _p_permissions[i] = _p_values[i]->string;
+        }
+    }
+
+    // construct the role
+    return role_construct
+    (
+        pp_role,
+        (size_t) p_role_id->integer,
+        p_name->string,
+        ( p_org_id ) ? (size_t) p_org_id->integer : 0,
+        _p_permissions,
+        permissions_len
+    );
 
     // error handling
     {
@@ -214,7 +341,7 @@ int role_from_json
 
             no_role_id:
                 #ifndef NDEBUG
-                    log_error("[identity] [role] Parameter \"p_value\" missing property \"role_id\" in call to function \"%s\"\n", __FUNCTION__);
+                    log_error("[identity] [role] Parameter \"p_value\" missing property \"id\" in call to function \"%s\"\n", __FUNCTION__);
                 #endif
 
                 // error
@@ -230,18 +357,31 @@ int role_from_json
             
             role_id_wrong_type:
                 #ifndef NDEBUG
-                    log_error("[identity] [role] Property \"role_id\" of parameter \"p_value\" must be of type [ integer ] in call to function \"%s\"\n", __FUNCTION__);
+                    log_error("[identity] [role] Property \"id\" of parameter \"p_value\" must be of type [ integer ] in call to function \"%s\"\n", __FUNCTION__);
                 #endif
 
                 // error
                 return 0;
-        }
 
-        // standard library errors
-        {
-            no_mem:
+            org_id_wrong_type:
                 #ifndef NDEBUG
-                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                    log_error("[identity] [role] Property \"org_id\" of parameter \"p_value\" must be of type [ integer ] in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            permissions_wrong_type:
+                #ifndef NDEBUG
+                    log_error("[identity] [role] Property \"permissions\" of parameter \"p_value\" must be of type [ array ] of [ string ] in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            too_many_permissions:
+                #ifndef NDEBUG
+                    log_error("[identity] [role] Property \"permissions\" of parameter \"p_value\" has more than %d elements in call to function \"%s\"\n", ROLE_PERMISSIONS_MAX, __FUNCTION__);
                 #endif
 
                 // error
@@ -259,7 +399,12 @@ int role_print ( role *p_role )
     // formatting
     log_info("role @%p\n", (void *)p_role);
     printf(" - ID   : %lld\n", p_role->id);
-    printf(" - Name : %s\n", p_role->_name);
+    printf(" - Name : %s\n", role_name_get(p_role));
+    printf(" - Permissions[%u]: \n", p_role->permissions_len);
+
+    // print each permission
+    for (size_t i = 0; i < p_role->permissions_len; ++i)
+        printf("   - %s\n", role_permission_get(p_role, i));
 
     // success
     return 1;
@@ -284,37 +429,177 @@ int role_comparator ( size_t id_a, size_t id_b )
 {
 
     // success
-    return id_b - id_a;
+    return ( id_b > id_a ) - ( id_b < id_a );
 }
 
 void *role_key_accessor ( role *p_role )
 {
 
     // success
-    return (void *)p_role->id;
+    return (void *)(size_t) p_role->id;
 }
 
-int role_pack ( void *p_buffer, const role *const p_role )
+const char *role_name_get ( const role *p_role )
+{
+
+    // done
+    return intern_string_get(p_role->name_id);
+}
+
+uint32_t role_name_id ( const role *p_role )
+{
+
+    // done
+    return p_role->name_id;
+}
+
+size_t role_org_id_get ( const role *p_role )
+{
+
+    // done
+    return (size_t) p_role->org_id;
+}
+
+size_t role_permissions_len ( const role *p_role )
+{
+
+    // done
+    return p_role->permissions_len;
+}
+
+const char *role_permission_get ( const role *p_role, size_t index )
 {
 
     // initialized data
-    char *p_offset = (char *) p_buffer;
+    const uint32_t *p_offsets = (const uint32_t *)( (const char *) p_role + p_role->permissions_offset );
+
+    // error check
+    if ( index >= p_role->permissions_len ) return NULL;
 
-    // pack role id
-    p_offset += pack_pack(p_offset, "%i64", p_role->id),
+    // done
+    return (const char *) p_role + p_offsets[index];
+}
 
-    // pack the name
-    p_offset += pack_pack(p_offset, "%s", p_role->_name);
+uint32_t role_permission_id_get ( const role *p_role, size_t index )
+{
+
+    // error check
+    if ( index >= p_role->permissions_len ) return INTERN_NONE;
 
     // done
-    return (void *)p_offset - (void *)p_buffer;
+    return ( (const uint32_t *)( (const char *) p_role + p_role->permission_ids_offset ) )[index];
 }
 
-int role_unpack ( void *const p_value, void *p_buffer )
+int role_pack ( void *p_buffer, const role *const p_role )
 {
 
-    // 
+    // argument check
+    if ( NULL == p_role ) goto no_role;
+
+    // the record is already packed. A null buffer asks for the size
+    if ( p_buffer ) memcpy(p_buffer, p_role, p_role->size);
 
     // done
-    return 0;
+    return (int) p_role->size;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_role:
+                #ifndef NDEBUG
+                    log_error("[identity] [role] Null pointer provided for parameter \"p_role\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int role_unpack ( role **pp_role, void *p_buffer, size_t size )
+{
+
+    // argument check
+    if ( NULL == pp_role ) goto no_role;
+    if ( NULL == p_buffer ) goto no_buffer;
+
+    // initialized data
+    role *p_role = p_buffer;
+
+    // check the fixed fields
+    if ( 0 != ( (size_t) p_buffer & 7 ) ) goto bad_record;
+    if ( size < sizeof(role) || p_role->size < sizeof(role) || p_role->size > size || 0 != ( p_role->size & 7 ) ) goto bad_record;
+
+    // check the name
+    if ( p_role->name_offset < sizeof(role) || p_role->name_offset >= p_role->size ) goto bad_record;
+    if ( NULL == memchr((const char *) p_role + p_role->name_offset, '\0', p_role->size - p_role->name_offset) ) goto bad_record;
+
+    // check the permission offset table, and the permission id table
+    if ( p_role->permissions_offset < sizeof(role) || 0 != ( p_role->permissions_offset & 3 ) || (uint64_t) p_role->permissions_offset + (uint64_t) p_role->permissions_len * sizeof(uint32_t) > p_role->size ) goto bad_record;
+    if ( p_role->permission_ids_offset < sizeof(role) || 0 != ( p_role->permission_ids_offset & 3 ) || (uint64_t) p_role->permission_ids_offset + (uint64_t) p_role->permissions_len * sizeof(uint32_t) > p_role->size ) goto bad_record;
+
+    // check each permission
+    for (size_t i = 0; i < p_role->permissions_len; ++i)
+    {
+
+        // initialized data
+        uint32_t offset = ( (const uint32_t *)( (const char *) p_role + p_role->permissions_offset ) )[i];
+
+        // error check
+        if ( offset < sizeof(role) || offset >= p_role->size ) goto bad_record;
+        if ( NULL == memchr((const char *) p_role + offset, '\0', p_role->size - offset) ) goto bad_record;
+    }
+
+    // intern the name and the permissions of this process
+    if ( 0 == role_intern(p_role) ) goto failed_to_intern;
+
+    // bind the record in place
+    *pp_role = p_role;
+
+    // done
+    return (int) p_role->size;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_role:
+                #ifndef NDEBUG
+                    log_error("[identity] [role] Null pointer provided for parameter \"pp_role\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_buffer:
+                #ifndef NDEBUG
+                    log_error("[identity] [role] Null pointer provided for parameter \"p_buffer\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // role errors
+        {
+            bad_record:
+                #ifndef NDEBUG
+                    log_error("[identity] [role] Malformed role record in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            failed_to_intern:
+                #ifndef NDEBUG
+                    log_error("[identity] [role] Failed to intern role strings in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
 }
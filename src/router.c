@@ -0,0 +1,511 @@
+/** !
+ * Router
+ *
+ * @file src/router.c
+ *
+ * @author Jacob Smith
+ */
+
+// header
+#include <identity/router.h>
+
+// standard library
+#include <ctype.h>
+#include <stdatomic.h>
+
+// structure definitions
+struct router_point_s
+{
+    uint64_t hash;
+    size_t   node;
+};
+
+struct router_node_s
+{
+    char                _address[ROUTER_ADDRESS_MAX];
+    atomic_uint         failures; // in a row
+    _Atomic(timestamp)  ejected;  // when the last failure ejected the node
+};
+
+struct router_s
+{
+    size_t                 nodes_len;
+    size_t                 points_len;
+    struct router_point_s *p_points;   // sorted by hash, then by node
+    timestamp              eject_time; // ROUTER_EJECT_MS, in timer ticks
+    struct router_node_s   _nodes[ROUTER_NODES_MAX];
+};
+
+// function declarations
+int router_point_compare ( const void *p_a, const void *p_b );
+size_t router_find ( router *p_router, uint64_t hash );
+
+uint64_t router_hash ( const void *p_key, size_t len )
+{
+
+    // initialized data
+    const unsigned char *p_bytes = p_key;
+    uint64_t             hash    = 0xcbf29ce484222325ULL;
+
+    // FNV-1a
+    for (size_t i = 0; i < len; i++)
+        hash ^= p_bytes[i],
+        hash *= 0x100000001b3ULL;
+
+    // FNV-1a spreads short, similar keys poorly across the high bits, so
+    // finish like murmur3
+    hash ^= hash >> 33,
+    hash *= 0xff51afd7ed558ccdULL,
+    hash ^= hash >> 33,
+    hash *= 0xc4ceb9fe1a85ec53ULL,
+    hash ^= hash >> 33;
+
+    // done
+    return hash;
+}
+
+int router_point_compare ( const void *p_a, const void *p_b )
+{
+
+    // initialized data
+    const struct router_point_s *p_left  = p_a,
+                                *p_right = p_b;
+
+    // order by hash, then by node, so every client builds the same ring
+    if ( p_left->hash != p_right->hash ) return ( p_left->hash < p_right->hash ) ? -1 : 1;
+    if ( p_left->node != p_right->node ) return ( p_left->node < p_right->node ) ? -1 : 1;
+
+    // done
+    return 0;
+}
+
+int router_construct ( router **pp_router, const char *const *pp_addresses, size_t quantity, size_t vnodes )
+{
+
+    // argument check
+    if ( NULL == pp_router    ) goto no_router;
+    if ( NULL == pp_addresses ) goto no_addresses;
+    if ( 0 == quantity || ROUTER_NODES_MAX < quantity ) goto bad_quantity;
+
+    // default
+    if ( 0 == vnodes ) vnodes = ROUTER_VNODES;
+
+    // initialized data
+    router *p_router = default_allocator(NULL, sizeof(router));
+
+    // error check
+    if ( NULL == p_router ) goto no_mem;
+
+    // populate the router
+    *p_router = (router)
+    {
+        .nodes_len  = quantity,
+        .points_len = quantity * vnodes,
+        .p_points   = default_allocator(NULL, quantity * vnodes * sizeof(struct router_point_s)),
+        .eject_time = (timestamp) ROUTER_EJECT_MS * timer_seconds_divisor() / 1000
+    };
+
+    // error check
+    if ( NULL == p_router->p_points ) goto no_points;
+
+    // store each node
+    for (size_t i = 0; i < quantity; i++)
+    {
+
+        // initialized data
+        size_t len = strlen(pp_addresses[i]);
+
+        // error check
+        if ( 0 == len || ROUTER_ADDRESS_MAX <= len ) goto bad_address;
+
+        // error check
+        for (size_t j = 0; j < i; j++)
+            if ( 0 == strcmp(p_router->_nodes[j]._address, pp_addresses[i]) ) goto duplicate_address;
+
+        // store the address
+        memcpy(p_router->_nodes[i]._address, pp_addresses[i], len + 1);
+    }
+
+    // hash each virtual node onto the ring, as "<address>#<index>"
+    for (size_t i = 0; i < quantity; i++)
+        for (size_t j = 0; j < vnodes; j++)
+        {
+
+            // initialized data
+            char _key[ROUTER_ADDRESS_MAX + 24] = { 0 };
+            int  len                           = snprintf(_key, sizeof(_key), "%s#%zu", p_router->_nodes[i]._address, j);
+
+            // store the point
+            p_router->p_points[i * vnodes + j] = (struct router_point_s)
+            {
+                .hash = router_hash(_key, (size_t) len),
+                .node = i
+            };
+        }
+
+    // sort the ring
+    qsort(p_router->p_points, p_router->points_len, sizeof(struct router_point_s), router_point_compare);
+
+    // return a pointer to the caller
+    *pp_router = p_router;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_router:
+                #ifndef NDEBUG
+                    log_error("[identity] [router] Null pointer provided for parameter \"pp_router\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_addresses:
+                #ifndef NDEBUG
+                    log_error("[identity] [router] Null pointer provided for parameter \"pp_addresses\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            bad_quantity:
+                #ifndef NDEBUG
+                    log_error("[identity] [router] Parameter \"quantity\" must be 1 to %d in call to function \"%s\"\n", ROUTER_NODES_MAX, __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // data errors
+        {
+            bad_address:
+                #ifndef NDEBUG
+                    log_error("[identity] [router] Addresses must be 1 to %d bytes in call to function \"%s\"\n", ROUTER_ADDRESS_MAX - 1, __FUNCTION__);
+                #endif
+
+                // release the router
+                (void) router_destroy(&p_router);
+
+                // error
+                return 0;
+
+            duplicate_address:
+                #ifndef NDEBUG
+                    log_error("[identity] [router] An address is listed twice in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // release the router
+                (void) router_destroy(&p_router);
+
+                // error
+                return 0;
+        }
+
+        // standard library errors
+        {
+            no_mem:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_points:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // release the router
+                p_router = default_allocator(p_router, 0);
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int router_load ( router **pp_router, const char *p_path, size_t vnodes )
+{
+
+    // argument check
+    if ( NULL == pp_router ) goto no_router;
+    if ( NULL ==    p_path ) goto no_path;
+
+    // initialized data
+    FILE       *p_file                                        = fopen(p_path, "r");
+    char        _lines[ROUTER_NODES_MAX][ROUTER_ADDRESS_MAX]  = { 0 };
+    const char *_p_addresses[ROUTER_NODES_MAX]                = { 0 };
+    char        _line[ROUTER_ADDRESS_MAX]                     = { 0 };
+    size_t      quantity                                      = 0;
+    int         result                                        = 0;
+
+    // error check
+    if ( NULL == p_file ) goto failed_to_open;
+
+    // read each address
+    while ( fgets(_line, sizeof(_line), p_file) )
+    {
+
+        // initialized data
+        char   *p_start = _line;
+        size_t  len     = 0;
+
+        // trim the line
+        while ( isspace((unsigned char) *p_start) ) p_start++;
+        len = strlen(p_start);
+        while ( len && isspace((unsigned char) p_start[len - 1]) ) len--;
+
+        // skip blank lines
+        if ( 0 == len ) continue;
+
+        // error check
+        if ( ROUTER_NODES_MAX == quantity ) goto too_many_nodes;
+
+        // store the address
+        memcpy(_lines[quantity], p_start, len);
+        _p_addresses[quantity] = _lines[quantity];
+        quantity++;
+    }
+
+    // release the file
+    fclose(p_file);
+
+    // construct the router
+    result = router_construct(pp_router, _p_addresses, quantity, vnodes);
+
+    // done
+    return result;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_router:
+                #ifndef NDEBUG
+                    log_error("[identity] [router] Null pointer provided for parameter \"pp_router\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_path:
+                #ifndef NDEBUG
+                    log_error("[identity] [router] Null pointer provided for parameter \"p_path\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // data errors
+        {
+            too_many_nodes:
+                #ifndef NDEBUG
+                    log_error("[identity] [router] \"%s\" lists more than %d nodes in call to function \"%s\"\n", p_path, ROUTER_NODES_MAX, __FUNCTION__);
+                #endif
+
+                // release the file
+                fclose(p_file);
+
+                // error
+                return 0;
+        }
+
+        // standard library errors
+        {
+            failed_to_open:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to open \"%s\" in call to function \"%s\"\n", p_path, __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+size_t router_size ( router *p_router )
+{
+
+    // done
+    return p_router->nodes_len;
+}
+
+const char *router_address ( router *p_router, size_t node )
+{
+
+    // done
+    return ( node < p_router->nodes_len ) ? p_router->_nodes[node]._address : NULL;
+}
+
+bool router_ejected ( router *p_router, size_t node )
+{
+
+    // initialized data
+    struct router_node_s *p_node = &p_router->_nodes[node];
+
+    // healthy
+    if ( atomic_load_explicit(&p_node->failures, memory_order_relaxed) < ROUTER_FAILURES_MAX ) return false;
+
+    // ejected, until the time is up
+    return timer_high_precision() - atomic_load_explicit(&p_node->ejected, memory_order_relaxed) < p_router->eject_time;
+}
+
+size_t router_find ( router *p_router, uint64_t hash )
+{
+
+    // initialized data
+    size_t low  = 0,
+           high = p_router->points_len;
+
+    // find the first point at or after the hash
+    while ( low < high )
+    {
+
+        // initialized data
+        size_t middle = low + ( high - low ) / 2;
+
+        // narrow
+        if ( p_router->p_points[middle].hash < hash ) low  = middle + 1;
+        else                                          high = middle;
+    }
+
+    // wrap around the ring
+    return ( low == p_router->points_len ) ? 0 : low;
+}
+
+size_t router_owner ( router *p_router, const char *p_name, size_t name_len )
+{
+
+    // done
+    return p_router->p_points[router_find(p_router, router_hash(p_name, name_len))].node;
+}
+
+int router_route ( router *p_router, const char *p_name, size_t name_len, size_t *p_node )
+{
+
+    // argument check
+    if ( NULL == p_router ) goto no_router;
+    if ( NULL ==   p_name ) goto no_name;
+    if ( NULL ==   p_node ) goto no_node;
+
+    // initialized data
+    size_t start = router_find(p_router, router_hash(p_name, name_len));
+
+    // walk the ring to the first node that is not ejected
+    for (size_t i = 0; i < p_router->points_len; i++)
+    {
+
+        // initialized data
+        size_t node = p_router->p_points[( start + i ) % p_router->points_len].node;
+
+        // skip ejected nodes
+        if ( router_ejected(p_router, node) ) continue;
+
+        // return the node to the caller
+        *p_node = node;
+
+        // success
+        return 1;
+    }
+
+    // every node is ejected
+    return 0;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_router:
+                #ifndef NDEBUG
+                    log_error("[identity] [router] Null pointer provided for parameter \"p_router\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_name:
+                #ifndef NDEBUG
+                    log_error("[identity] [router] Null pointer provided for parameter \"p_name\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_node:
+                #ifndef NDEBUG
+                    log_error("[identity] [router] Null pointer provided for parameter \"p_node\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+void router_report ( router *p_router, size_t node, bool healthy )
+{
+
+    // initialized data
+    struct router_node_s *p_node = &p_router->_nodes[node];
+
+    // a success restores the node
+    if ( healthy )
+    {
+        atomic_store_explicit(&p_node->failures, 0, memory_order_relaxed);
+        return;
+    }
+
+    // enough failures in a row eject it, and each later one extends the ejection
+    if ( atomic_fetch_add_explicit(&p_node->failures, 1, memory_order_relaxed) + 1 >= ROUTER_FAILURES_MAX )
+        atomic_store_explicit(&p_node->ejected, timer_high_precision(), memory_order_relaxed);
+}
+
+int router_destroy ( router **pp_router )
+{
+
+    // argument check
+    if ( NULL == pp_router ) goto no_router;
+
+    // initialized data
+    router *p_router = *pp_router;
+
+    // no more pointer for caller
+    *pp_router = NULL;
+
+    // fast exit
+    if ( NULL == p_router ) return 1;
+
+    // release the ring
+    p_router->p_points = default_allocator(p_router->p_points, 0);
+
+    // release the router
+    p_router = default_allocator(p_router, 0);
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_router:
+                #ifndef NDEBUG
+                    log_error("[identity] [router] Null pointer provided for parameter \"pp_router\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
@@ -0,0 +1,532 @@
+/** !
+ * Session
+ *
+ * @file src/session.c
+ *
+ * @author Jacob Smith
+ */
+
+// header
+#include <identity/session.h>
+
+// standard library
+#include <sys/random.h>
+
+// preprocessor definitions
+#define SESSION_SHARD_CAPACITY 64  // smallest table of a shard
+#define SESSION_RANDOM_POOL    256 // bytes of entropy fetched at a time
+#define SESSION_REVOKED        1   // expiry of a revoked token, long past
+
+// structure definitions
+struct session_entry_s
+{
+    unsigned char _token[SESSION_TOKEN_SIZE];
+    size_t        user_id;
+    timestamp     expires;                    // 0 when empty
+};
+
+struct session_shard_s
+{
+    mutex                   _lock;
+    size_t                  used;     // occupied slots, live or not
+    size_t                  mask;     // capacity - 1. The capacity is a power of two
+    struct session_entry_s *_entries;
+};
+
+struct session_table_s
+{
+    size_t                 shard_max; // live sessions per shard
+    timestamp              ttl;       // in timer ticks
+    struct session_shard_s _shards[SESSION_SHARDS];
+};
+
+// data
+static _Thread_local unsigned char _random[SESSION_RANDOM_POOL];
+static _Thread_local size_t        random_offset = SESSION_RANDOM_POOL;
+
+// function declarations
+int session_random ( unsigned char *p_bytes, size_t len );
+struct session_shard_s *session_shard ( session_table *p_session_table, const unsigned char token[SESSION_TOKEN_SIZE], size_t *p_slot );
+bool session_token_equals ( const unsigned char a[SESSION_TOKEN_SIZE], const unsigned char b[SESSION_TOKEN_SIZE] );
+struct session_entry_s *session_find ( struct session_shard_s *p_shard, size_t slot, const unsigned char token[SESSION_TOKEN_SIZE], timestamp now );
+int session_shard_rehash ( struct session_shard_s *p_shard, timestamp now );
+
+int session_random ( unsigned char *p_bytes, size_t len )
+{
+
+    // refill this thread's pool, one system call per SESSION_RANDOM_POOL bytes
+    if ( SESSION_RANDOM_POOL - random_offset < len )
+    {
+        if ( getentropy(_random, SESSION_RANDOM_POOL) ) return 0;
+        random_offset = 0;
+    }
+
+    // take the bytes, and forget them
+    memcpy(p_bytes, &_random[random_offset], len);
+    memset(&_random[random_offset], 0, len);
+    random_offset += len;
+
+    // success
+    return 1;
+}
+
+struct session_shard_s *session_shard ( session_table *p_session_table, const unsigned char token[SESSION_TOKEN_SIZE], size_t *p_slot )
+{
+
+    // initialized data
+    uint64_t                hash    = 0;
+    struct session_shard_s *p_shard = NULL;
+
+    // tokens are random, so their first bytes are already a hash
+    memcpy(&hash, token, sizeof(hash));
+
+    // the low bits pick the shard, and the next bits pick the slot
+    p_shard = &p_session_table->_shards[hash & ( SESSION_SHARDS - 1 )];
+    *p_slot = (size_t) ( hash / SESSION_SHARDS );
+
+    // done
+    return p_shard;
+}
+
+bool session_token_equals ( const unsigned char a[SESSION_TOKEN_SIZE], const unsigned char b[SESSION_TOKEN_SIZE] )
+{
+
+    // initialized data
+    unsigned char difference = 0;
+
+    // compare every byte, so the time taken says nothing about where they differ
+    for (size_t i = 0; i < SESSION_TOKEN_SIZE; i++)
+        difference |= a[i] ^ b[i];
+
+    // done
+    return 0 == difference;
+}
+
+struct session_entry_s *session_find ( struct session_shard_s *p_shard, size_t slot, const unsigned char token[SESSION_TOKEN_SIZE], timestamp now )
+{
+
+    // probe
+    for (size_t i = slot & p_shard->mask; p_shard->_entries[i].expires; i = ( i + 1 ) & p_shard->mask)
+    {
+
+        // initialized data
+        struct session_entry_s *p_entry = &p_shard->_entries[i];
+
+        // match
+        if ( session_token_equals(p_entry->_token, token) ) return ( p_entry->expires > now ) ? p_entry : NULL;
+    }
+
+    // not found
+    return NULL;
+}
+
+int session_shard_rehash ( struct session_shard_s *p_shard, timestamp now )
+{
+
+    // initialized data
+    struct session_entry_s *_entries = NULL;
+    size_t                  live     = 0,
+                            capacity = SESSION_SHARD_CAPACITY;
+
+    // count the live sessions
+    for (size_t i = 0; i <= p_shard->mask; i++)
+        if ( p_shard->_entries[i].expires > now ) live++;
+
+    // keep the load factor under 1/4, so the next rehash is as far off as this one
+    while ( capacity < ( live + 1 ) * 4 ) capacity <<= 1;
+
+    // allocate the table
+    _entries = default_allocator(NULL, capacity * sizeof(struct session_entry_s));
+
+    // error check
+    if ( NULL == _entries ) return 0;
+
+    // start empty
+    memset(_entries, 0, capacity * sizeof(struct session_entry_s));
+
+    // move every live session, and drop the rest
+    for (size_t i = 0; i <= p_shard->mask; i++)
+    {
+
+        // initialized data
+        struct session_entry_s *p_entry = &p_shard->_entries[i];
+        uint64_t                hash    = 0;
+        size_t                  j       = 0;
+
+        // skip expired and revoked sessions
+        if ( p_entry->expires <= now ) continue;
+
+        // find the slot
+        memcpy(&hash, p_entry->_token, sizeof(hash));
+        j = (size_t) ( hash / SESSION_SHARDS ) & ( capacity - 1 );
+
+        // probe for an empty slot
+        while ( _entries[j].expires ) j = ( j + 1 ) & ( capacity - 1 );
+
+        // store the session
+        _entries[j] = *p_entry;
+    }
+
+    // swap in the new table
+    p_shard->_entries = default_allocator(p_shard->_entries, 0),
+    p_shard->_entries = _entries,
+    p_shard->mask     = capacity - 1,
+    p_shard->used     = live;
+
+    // success
+    return 1;
+}
+
+int session_table_construct ( session_table **pp_session_table, size_t sessions_max, size_t ttl_ms )
+{
+
+    // argument check
+    if ( NULL == pp_session_table ) goto no_session_table;
+    if ( 0    ==     sessions_max ) goto no_sessions;
+    if ( 0    ==           ttl_ms ) goto no_ttl;
+
+    // initialized data
+    session_table *p_session_table = default_allocator(NULL, sizeof(session_table));
+    size_t         constructed     = 0;
+
+    // error check
+    if ( NULL == p_session_table ) goto no_mem;
+
+    // start empty
+    memset(p_session_table, 0, sizeof(session_table));
+
+    // populate the session table struct
+    p_session_table->shard_max = ( sessions_max + SESSION_SHARDS - 1 ) / SESSION_SHARDS,
+    p_session_table->ttl       = (timestamp) ttl_ms * timer_seconds_divisor() / 1000;
+
+    // construct each shard
+    for (; constructed < SESSION_SHARDS; constructed++)
+    {
+
+        // initialized data
+        struct session_shard_s *p_shard = &p_session_table->_shards[constructed];
+
+        // allocate the entries
+        p_shard->_entries = default_allocator(NULL, SESSION_SHARD_CAPACITY * sizeof(struct session_entry_s));
+
+        // error check
+        if ( NULL == p_shard->_entries ) goto no_mem_1;
+
+        // every entry starts empty
+        memset(p_shard->_entries, 0, SESSION_SHARD_CAPACITY * sizeof(struct session_entry_s));
+        p_shard->mask = SESSION_SHARD_CAPACITY - 1;
+
+        // construct the lock
+        if ( 0 == mutex_create(&p_shard->_lock) ) goto failed_to_construct_mutex;
+    }
+
+    // return a pointer to the caller
+    *pp_session_table = p_session_table;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_session_table:
+                #ifndef NDEBUG
+                    log_error("[identity] [session] Null pointer provided for parameter \"pp_session_table\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_sessions:
+                #ifndef NDEBUG
+                    log_error("[identity] [session] Parameter \"sessions_max\" must be greater than zero in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_ttl:
+                #ifndef NDEBUG
+                    log_error("[identity] [session] Parameter \"ttl_ms\" must be greater than zero in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // sync errors
+        {
+            failed_to_construct_mutex:
+                #ifndef NDEBUG
+                    log_error("[identity] [session] Failed to construct mutex in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // clean up
+                p_session_table->_shards[constructed]._entries = default_allocator(p_session_table->_shards[constructed]._entries, 0);
+                while ( constructed-- )
+                    mutex_destroy(&p_session_table->_shards[constructed]._lock),
+                    p_session_table->_shards[constructed]._entries = default_allocator(p_session_table->_shards[constructed]._entries, 0);
+                p_session_table = default_allocator(p_session_table, 0);
+
+                // error
+                return 0;
+        }
+
+        // standard library errors
+        {
+            no_mem_1:
+
+                // clean up
+                while ( constructed-- )
+                    mutex_destroy(&p_session_table->_shards[constructed]._lock),
+                    p_session_table->_shards[constructed]._entries = default_allocator(p_session_table->_shards[constructed]._entries, 0);
+                p_session_table = default_allocator(p_session_table, 0);
+
+                // fall through
+                goto no_mem;
+
+            no_mem:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+bool session_validate ( session_table *p_session_table, const unsigned char token[SESSION_TOKEN_SIZE], size_t *p_user_id )
+{
+
+    // initialized data
+    size_t                  slot    = 0;
+    struct session_shard_s *p_shard = session_shard(p_session_table, token, &slot);
+    struct session_entry_s *p_entry = NULL;
+    timestamp               now     = timer_high_precision();
+
+    // lock
+    mutex_lock(&p_shard->_lock);
+
+    // find the session
+    p_entry = session_find(p_shard, slot, token, now);
+
+    // return the user to the caller
+    if ( p_entry && p_user_id ) *p_user_id = p_entry->user_id;
+
+    // unlock
+    mutex_unlock(&p_shard->_lock);
+
+    // done
+    return NULL != p_entry;
+}
+
+int session_issue ( session_table *p_session_table, size_t user_id, unsigned char token[SESSION_TOKEN_SIZE] )
+{
+
+    // argument check
+    if ( NULL == p_session_table ) goto no_session_table;
+    if ( NULL ==           token ) goto no_token;
+
+    // initialized data
+    size_t                  slot    = 0;
+    struct session_shard_s *p_shard = NULL;
+    timestamp               now     = timer_high_precision();
+
+    // make a token
+    if ( 0 == session_random(token, SESSION_TOKEN_SIZE) ) goto no_entropy;
+
+    // find the shard
+    p_shard = session_shard(p_session_table, token, &slot);
+
+    // lock
+    mutex_lock(&p_shard->_lock);
+
+    // drop expired sessions, and grow, when the shard fills up
+    if ( p_shard->used >= p_session_table->shard_max || ( p_shard->used + 1 ) * 2 > p_shard->mask + 1 )
+        if ( 0 == session_shard_rehash(p_shard, now) ) goto no_mem;
+
+    // error check
+    if ( p_shard->used >= p_session_table->shard_max ) goto shard_full;
+
+    // store the session
+    {
+
+        // initialized data
+        size_t i = slot & p_shard->mask;
+
+        // probe for an empty slot
+        while ( p_shard->_entries[i].expires ) i = ( i + 1 ) & p_shard->mask;
+
+        // store the session
+        memcpy(p_shard->_entries[i]._token, token, SESSION_TOKEN_SIZE);
+        p_shard->_entries[i].user_id = user_id,
+        p_shard->_entries[i].expires = now + p_session_table->ttl;
+    }
+
+    // the slot is in use
+    p_shard->used++;
+
+    // unlock
+    mutex_unlock(&p_shard->_lock);
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_session_table:
+                #ifndef NDEBUG
+                    log_error("[identity] [session] Null pointer provided for parameter \"p_session_table\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_token:
+                #ifndef NDEBUG
+                    log_error("[identity] [session] Null pointer provided for parameter \"token\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // session errors
+        {
+            shard_full:
+                #ifndef NDEBUG
+                    log_error("[identity] [session] Too many live sessions in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // unlock
+                mutex_unlock(&p_shard->_lock);
+
+                // error
+                return 0;
+        }
+
+        // standard library errors
+        {
+            no_entropy:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to get entropy in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_mem:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // unlock
+                mutex_unlock(&p_shard->_lock);
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int session_revoke ( session_table *p_session_table, const unsigned char token[SESSION_TOKEN_SIZE] )
+{
+
+    // initialized data
+    size_t                  slot    = 0;
+    struct session_shard_s *p_shard = session_shard(p_session_table, token, &slot);
+    struct session_entry_s *p_entry = NULL;
+
+    // lock
+    mutex_lock(&p_shard->_lock);
+
+    // find the session
+    p_entry = session_find(p_shard, slot, token, timer_high_precision());
+
+    // expire it. the slot is reclaimed at the next rehash
+    if ( p_entry ) p_entry->expires = SESSION_REVOKED;
+
+    // unlock
+    mutex_unlock(&p_shard->_lock);
+
+    // done
+    return NULL != p_entry;
+}
+
+size_t session_revoke_user ( session_table *p_session_table, size_t user_id )
+{
+
+    // initialized data
+    size_t    revoked = 0;
+    timestamp now     = timer_high_precision();
+
+    // expire every live session of the user
+    for (size_t i = 0; i < SESSION_SHARDS; i++)
+    {
+
+        // initialized data
+        struct session_shard_s *p_shard = &p_session_table->_shards[i];
+
+        // lock
+        mutex_lock(&p_shard->_lock);
+
+        // scan the shard
+        for (size_t j = 0; j <= p_shard->mask; j++)
+            if ( user_id == p_shard->_entries[j].user_id && p_shard->_entries[j].expires > now )
+                p_shard->_entries[j].expires = SESSION_REVOKED, revoked++;
+
+        // unlock
+        mutex_unlock(&p_shard->_lock);
+    }
+
+    // done
+    return revoked;
+}
+
+int session_table_destroy ( session_table **pp_session_table )
+{
+
+    // argument check
+    if ( NULL == pp_session_table ) goto no_session_table;
+
+    // initialized data
+    session_table *p_session_table = *pp_session_table;
+
+    // no more pointer for caller
+    *pp_session_table = NULL;
+
+    // fast exit
+    if ( NULL == p_session_table ) return 1;
+
+    // release each shard
+    for (size_t i = 0; i < SESSION_SHARDS; i++)
+        mutex_destroy(&p_session_table->_shards[i]._lock),
+        p_session_table->_shards[i]._entries = default_allocator(p_session_table->_shards[i]._entries, 0);
+
+    // release the table
+    p_session_table = default_allocator(p_session_table, 0);
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_session_table:
+                #ifndef NDEBUG
+                    log_error("[identity] [session] Null pointer provided for parameter \"pp_session_table\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
@@ -0,0 +1,629 @@
+/** !
+ * Snapshot
+ *
+ * @file src/snapshot.c
+ *
+ * @author Jacob Smith
+ */
+
+// feature test macros
+#define _GNU_SOURCE
+
+// header
+#include <identity/snapshot.h>
+
+// standard library
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// preprocessor definitions
+#define SNAPSHOT_SECTION_QUANTITY 4
+
+// enumeration definitions
+enum snapshot_section_e
+{
+    SNAPSHOT_SECTION_ORGS   = 0,
+    SNAPSHOT_SECTION_ROLES  = 1,
+    SNAPSHOT_SECTION_GROUPS = 2,
+    SNAPSHOT_SECTION_USERS  = 3
+};
+
+// type definitions
+typedef int (fn_snapshot_pack)   ( void *p_buffer, const void *const p_value );
+typedef int (fn_snapshot_unpack) ( void **pp_value, void *p_buffer, size_t size );
+
+// structure definitions
+struct snapshot_section_s
+{
+    uint64_t quantity; // records in the section
+    uint64_t offset;   // from the start of the file
+    uint64_t size;     // bytes in the section
+};
+
+struct snapshot_header_s
+{
+    char                      _magic[8];
+    uint32_t                  version;
+    uint32_t                  endian;   // SNAPSHOT_ENDIAN, as the writer stored it
+    uint64_t                  size;     // bytes in the whole file
+    uint64_t                  sequence; // the last write ahead log record the snapshot holds
+    struct snapshot_section_s _sections[SNAPSHOT_SECTION_QUANTITY];
+};
+
+// the pack and unpack functions of each section
+static fn_snapshot_pack *const _pfn_pack[SNAPSHOT_SECTION_QUANTITY] =
+{
+    [SNAPSHOT_SECTION_ORGS]   = (fn_snapshot_pack *) org_pack,
+    [SNAPSHOT_SECTION_ROLES]  = (fn_snapshot_pack *) role_pack,
+    [SNAPSHOT_SECTION_GROUPS] = (fn_snapshot_pack *) group_pack,
+    [SNAPSHOT_SECTION_USERS]  = (fn_snapshot_pack *) user_pack
+};
+
+static fn_snapshot_unpack *const _pfn_unpack[SNAPSHOT_SECTION_QUANTITY] =
+{
+    [SNAPSHOT_SECTION_ORGS]   = (fn_snapshot_unpack *) org_unpack,
+    [SNAPSHOT_SECTION_ROLES]  = (fn_snapshot_unpack *) role_unpack,
+    [SNAPSHOT_SECTION_GROUPS] = (fn_snapshot_unpack *) group_unpack,
+    [SNAPSHOT_SECTION_USERS]  = (fn_snapshot_unpack *) user_unpack
+};
+
+// function declarations
+void ***snapshot_section_values ( snapshot *p_snapshot, enum snapshot_section_e section, size_t **pp_len );
+int snapshot_section_write ( FILE *p_file, enum snapshot_section_e section, void **pp_values, size_t len, void **pp_buffer, size_t *p_buffer_max );
+int snapshot_section_read ( snapshot *p_snapshot, enum snapshot_section_e section, const struct snapshot_section_s *p_section );
+int snapshot_directory_sync ( const char *p_path );
+
+void ***snapshot_section_values ( snapshot *p_snapshot, enum snapshot_section_e section, size_t **pp_len )
+{
+
+    // strategy
+    switch ( section )
+    {
+        case SNAPSHOT_SECTION_ORGS:   *pp_len = &p_snapshot->orgs_len;   return (void ***) &p_snapshot->pp_orgs;
+        case SNAPSHOT_SECTION_ROLES:  *pp_len = &p_snapshot->roles_len;  return (void ***) &p_snapshot->pp_roles;
+        case SNAPSHOT_SECTION_GROUPS: *pp_len = &p_snapshot->groups_len; return (void ***) &p_snapshot->pp_groups;
+        case SNAPSHOT_SECTION_USERS:  *pp_len = &p_snapshot->users_len;  return (void ***) &p_snapshot->pp_users;
+    }
+
+    // error
+    return NULL;
+}
+
+int snapshot_section_write ( FILE *p_file, enum snapshot_section_e section, void **pp_values, size_t len, void **pp_buffer, size_t *p_buffer_max )
+{
+
+    // write each record
+    for (size_t i = 0; i < len; i++)
+    {
+
+        // initialized data
+        int size = _pfn_pack[section](NULL, pp_values[i]);
+
+        // error check
+        if ( 0 >= size ) return 0;
+
+        // grow the buffer
+        if ( (size_t) size > *p_buffer_max )
+        {
+
+            // initialized data
+            void *p_buffer = default_allocator(*pp_buffer, (size_t) size);
+
+            // error check
+            if ( NULL == p_buffer ) return 0;
+
+            // store the buffer
+            *pp_buffer    = p_buffer,
+            *p_buffer_max = (size_t) size;
+        }
+
+        // pack the record
+        if ( size != _pfn_pack[section](*pp_buffer, pp_values[i]) ) return 0;
+
+        // write the record
+        if ( 1 != fwrite(*pp_buffer, (size_t) size, 1, p_file) ) return 0;
+    }
+
+    // success
+    return 1;
+}
+
+int snapshot_section_read ( snapshot *p_snapshot, enum snapshot_section_e section, const struct snapshot_section_s *p_section )
+{
+
+    // initialized data
+    size_t   *p_len      = NULL;
+    void   ***ppp_values = snapshot_section_values(p_snapshot, section, &p_len);
+    char     *p_cursor   = (char *) p_snapshot->p_map + p_section->offset,
+             *p_end      = p_cursor + p_section->size;
+
+    // error check. every record is at least 8 bytes, so the quantity is bounded by the size
+    if ( p_section->offset < sizeof(struct snapshot_header_s) ) return 0;
+    if ( p_section->offset > p_snapshot->size || p_section->size > p_snapshot->size - p_section->offset ) return 0;
+    if ( p_section->quantity > p_section->size / 8 ) return 0;
+
+    // allocate the array
+    *ppp_values = default_allocator(NULL, ( p_section->quantity + 1 ) * sizeof(void *));
+
+    // error check
+    if ( NULL == *ppp_values ) return 0;
+
+    // bind each record in place
+    for (size_t i = 0; i < p_section->quantity; i++)
+    {
+
+        // initialized data
+        int size = _pfn_unpack[section](&(*ppp_values)[i], p_cursor, (size_t)( p_end - p_cursor ));
+
+        // error check
+        if ( 0 >= size ) return 0;
+
+        // next record
+        p_cursor += size;
+    }
+
+    // store the quantity
+    *p_len = p_section->quantity;
+
+    // success
+    return 1;
+}
+
+int snapshot_directory_sync ( const char *p_path )
+{
+
+    // initialized data
+    char        _directory[SNAPSHOT_PATH_MAX] = { 0 };
+    const char *p_slash = strrchr(p_path, '/');
+    int         fd      = -1,
+                result  = 0;
+
+    // the directory that holds the file
+    if      ( NULL == p_slash    ) strcpy(_directory, ".");
+    else if ( p_slash == p_path  ) strcpy(_directory, "/");
+    else                           memcpy(_directory, p_path, (size_t) ( p_slash - p_path ));
+
+    // open the directory
+    fd = open(_directory, O_RDONLY | O_DIRECTORY);
+
+    // error check
+    if ( -1 == fd ) goto failed_to_open;
+
+    // sync its entries, so a rename survives a crash
+    result = ( 0 == fsync(fd) );
+
+    // close the directory
+    (void) close(fd);
+
+    // done
+    return result;
+
+    // error handling
+    {
+
+        // standard library errors
+        {
+            failed_to_open:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to open directory \"%s\" in call to function \"%s\"\n", _directory, __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int snapshot_save ( const char *p_path, const snapshot *p_snapshot )
+{
+
+    // argument check
+    if ( NULL ==     p_path ) goto no_path;
+    if ( NULL == p_snapshot ) goto no_snapshot;
+
+    // initialized data
+    struct snapshot_header_s  _header                  = { ._magic = SNAPSHOT_MAGIC, .version = SNAPSHOT_VERSION, .endian = SNAPSHOT_ENDIAN };
+    char                      _path[SNAPSHOT_PATH_MAX] = { 0 };
+    snapshot                  _values                  = *p_snapshot;
+    FILE                     *p_file                   = NULL;
+    void                     *p_buffer                 = NULL;
+    size_t                    buffer_max               = 0;
+    uint64_t                  offset                   = sizeof(struct snapshot_header_s);
+    int                       len                      = snprintf(_path, sizeof(_path), "%s.tmp", p_path);
+
+    // error check
+    if ( 0 > len || sizeof(_path) <= (size_t) len ) goto path_too_long;
+
+    // lay out each section
+    for (size_t i = 0; i < SNAPSHOT_SECTION_QUANTITY; i++)
+    {
+
+        // initialized data
+        size_t   *p_len      = NULL;
+        void   ***ppp_values = snapshot_section_values(&_values, i, &p_len);
+        uint64_t  size       = 0;
+
+        // measure every record
+        for (size_t j = 0; j < *p_len; j++)
+        {
+
+            // initialized data
+            int record_size = _pfn_pack[i](NULL, (*ppp_values)[j]);
+
+            // error check
+            if ( 0 >= record_size ) goto failed_to_pack;
+
+            // accumulate
+            size += (uint64_t) record_size;
+        }
+
+        // store the section
+        _header._sections[i] = (struct snapshot_section_s)
+        {
+            .quantity = *p_len,
+            .offset   = offset,
+            .size     = size
+        };
+
+        // next section
+        offset += size;
+    }
+
+    // store the size of the file, and the sequence
+    _header.size     = offset,
+    _header.sequence = p_snapshot->sequence;
+
+    // open the temporary file
+    p_file = fopen(_path, "wb");
+
+    // error check
+    if ( NULL == p_file ) goto failed_to_open;
+
+    // write the header
+    if ( 1 != fwrite(&_header, sizeof(_header), 1, p_file) ) goto failed_to_write;
+
+    // write each section
+    for (size_t i = 0; i < SNAPSHOT_SECTION_QUANTITY; i++)
+    {
+
+        // initialized data
+        size_t   *p_len      = NULL;
+        void   ***ppp_values = snapshot_section_values(&_values, i, &p_len);
+
+        // write the section
+        if ( 0 == snapshot_section_write(p_file, i, *ppp_values, *p_len, &p_buffer, &buffer_max) ) goto failed_to_write;
+    }
+
+    // flush the file to disk
+    if ( 0 != fflush(p_file) || 0 != fsync(fileno(p_file)) ) goto failed_to_write;
+
+    // close the file
+    if ( 0 != fclose(p_file) ) { p_file = NULL; goto failed_to_write; }
+
+    // release the buffer
+    p_buffer = default_allocator(p_buffer, 0);
+
+    // replace the old snapshot
+    if ( 0 != rename(_path, p_path) ) goto failed_to_rename;
+
+    // make the rename durable, before the caller cuts the log
+    if ( 0 == snapshot_directory_sync(p_path) ) goto failed_to_sync;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_path:
+                #ifndef NDEBUG
+                    log_error("[identity] [snapshot] Null pointer provided for parameter \"p_path\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_snapshot:
+                #ifndef NDEBUG
+                    log_error("[identity] [snapshot] Null pointer provided for parameter \"p_snapshot\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            path_too_long:
+                #ifndef NDEBUG
+                    log_error("[identity] [snapshot] Parameter \"p_path\" is too long in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // snapshot errors
+        {
+            failed_to_pack:
+                #ifndef NDEBUG
+                    log_error("[identity] [snapshot] Failed to pack a record in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // standard library errors
+        {
+            failed_to_open:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to open \"%s\" in call to function \"%s\"\n", _path, __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            failed_to_write:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to write \"%s\" in call to function \"%s\"\n", _path, __FUNCTION__);
+                #endif
+
+                // clean up
+                if ( p_file ) fclose(p_file);
+                p_buffer = default_allocator(p_buffer, 0);
+                (void) remove(_path);
+
+                // error
+                return 0;
+
+            failed_to_rename:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to rename \"%s\" to \"%s\" in call to function \"%s\"\n", _path, p_path, __FUNCTION__);
+                #endif
+
+                // clean up
+                (void) remove(_path);
+
+                // error
+                return 0;
+
+            failed_to_sync:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to sync the directory of \"%s\" in call to function \"%s\"\n", p_path, __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int snapshot_load ( const char *p_path, snapshot *p_snapshot )
+{
+
+    // argument check
+    if ( NULL ==     p_path ) goto no_path;
+    if ( NULL == p_snapshot ) goto no_snapshot;
+
+    // initialized data
+    struct snapshot_header_s *p_header = NULL;
+    struct stat               _stat    = { 0 };
+    int                       fd       = open(p_path, O_RDONLY);
+
+    // error check
+    if ( -1 == fd ) goto failed_to_open;
+
+    // start empty
+    *p_snapshot = (snapshot) { 0 };
+
+    // get the size of the file
+    if ( -1 == fstat(fd, &_stat) ) goto failed_to_stat;
+
+    // error check
+    if ( (size_t) _stat.st_size < sizeof(struct snapshot_header_s) ) goto bad_header;
+
+    // map the file. private and writable, so records may be written without touching the file
+    p_snapshot->p_map = mmap(NULL, (size_t) _stat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0),
+    p_snapshot->size  = (size_t) _stat.st_size;
+
+    // the mapping outlives the descriptor
+    close(fd);
+
+    // error check
+    if ( MAP_FAILED == p_snapshot->p_map ) { p_snapshot->p_map = NULL; goto failed_to_map; }
+
+    // every page will be touched
+    (void) madvise(p_snapshot->p_map, p_snapshot->size, MADV_WILLNEED);
+
+    // check the header
+    p_header = p_snapshot->p_map;
+    if ( 0 != memcmp(p_header->_magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) ) goto bad_header;
+    if ( SNAPSHOT_VERSION != p_header->version ) goto wrong_version;
+    if ( SNAPSHOT_ENDIAN  != p_header->endian  ) goto wrong_endian;
+    if ( p_snapshot->size != p_header->size    ) goto bad_header;
+
+    // store the sequence
+    p_snapshot->sequence = p_header->sequence;
+
+    // bind each section
+    for (size_t i = 0; i < SNAPSHOT_SECTION_QUANTITY; i++)
+        if ( 0 == snapshot_section_read(p_snapshot, i, &p_header->_sections[i]) ) goto bad_section;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_path:
+                #ifndef NDEBUG
+                    log_error("[identity] [snapshot] Null pointer provided for parameter \"p_path\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_snapshot:
+                #ifndef NDEBUG
+                    log_error("[identity] [snapshot] Null pointer provided for parameter \"p_snapshot\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // snapshot errors
+        {
+            bad_header:
+                #ifndef NDEBUG
+                    log_error("[identity] [snapshot] \"%s\" is not a snapshot in call to function \"%s\"\n", p_path, __FUNCTION__);
+                #endif
+
+                // clean up
+                if ( NULL == p_snapshot->p_map ) close(fd);
+                (void) snapshot_destroy(p_snapshot);
+
+                // error
+                return 0;
+
+            wrong_version:
+                #ifndef NDEBUG
+                    log_error("[identity] [snapshot] \"%s\" is version %u, expected %u in call to function \"%s\"\n", p_path, p_header->version, SNAPSHOT_VERSION, __FUNCTION__);
+                #endif
+
+                // clean up
+                (void) snapshot_destroy(p_snapshot);
+
+                // error
+                return 0;
+
+            wrong_endian:
+                #ifndef NDEBUG
+                    log_error("[identity] [snapshot] \"%s\" was written with another byte order in call to function \"%s\"\n", p_path, __FUNCTION__);
+                #endif
+
+                // clean up
+                (void) snapshot_destroy(p_snapshot);
+
+                // error
+                return 0;
+
+            bad_section:
+                #ifndef NDEBUG
+                    log_error("[identity] [snapshot] \"%s\" has a malformed section in call to function \"%s\"\n", p_path, __FUNCTION__);
+                #endif
+
+                // clean up
+                (void) snapshot_destroy(p_snapshot);
+
+                // error
+                return 0;
+        }
+
+        // standard library errors
+        {
+            failed_to_open:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to open \"%s\" in call to function \"%s\"\n", p_path, __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            failed_to_stat:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to stat \"%s\" in call to function \"%s\"\n", p_path, __FUNCTION__);
+                #endif
+
+                // clean up
+                close(fd);
+
+                // error
+                return 0;
+
+            failed_to_map:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to map \"%s\" in call to function \"%s\"\n", p_path, __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int snapshot_release ( snapshot *p_snapshot )
+{
+
+    // argument check
+    if ( NULL == p_snapshot ) goto no_snapshot;
+
+    // release the arrays
+    p_snapshot->pp_orgs   = default_allocator(p_snapshot->pp_orgs  , 0),
+    p_snapshot->pp_roles  = default_allocator(p_snapshot->pp_roles , 0),
+    p_snapshot->pp_groups = default_allocator(p_snapshot->pp_groups, 0),
+    p_snapshot->pp_users  = default_allocator(p_snapshot->pp_users , 0);
+
+    // no more values
+    p_snapshot->orgs_len   = 0,
+    p_snapshot->roles_len  = 0,
+    p_snapshot->groups_len = 0,
+    p_snapshot->users_len  = 0;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_snapshot:
+                #ifndef NDEBUG
+                    log_error("[identity] [snapshot] Null pointer provided for parameter \"p_snapshot\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int snapshot_destroy ( snapshot *p_snapshot )
+{
+
+    // argument check
+    if ( NULL == p_snapshot ) goto no_snapshot;
+
+    // release the arrays
+    (void) snapshot_release(p_snapshot);
+
+    // unmap the file
+    if ( p_snapshot->p_map ) munmap(p_snapshot->p_map, p_snapshot->size);
+
+    // no more mapping
+    p_snapshot->p_map = NULL,
+    p_snapshot->size  = 0;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_snapshot:
+                #ifndef NDEBUG
+                    log_error("[identity] [snapshot] Null pointer provided for parameter \"p_snapshot\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
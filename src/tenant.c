@@ -0,0 +1,314 @@
+/** !
+ * Tenant
+ *
+ * @file src/tenant.c
+ *
+ * @author Jacob Smith
+ */
+
+// header
+#include <identity/tenant.h>
+
+// structure definitions
+struct tenant_s
+{
+    size_t      org_id;
+    hash_index *p_users;      // user id -> user
+    hash_index *p_user_names; // username -> user
+    hash_index *p_roles;      // role id -> role
+    hash_index *p_groups;     // group id -> group
+};
+
+// a username, within the tenant
+struct tenant_name_s
+{
+    const char *p_name;
+    size_t      name_len;
+};
+
+// function declarations
+bool tenant_user_name_match ( const user *p_user, const struct tenant_name_s *p_name );
+
+bool tenant_user_name_match ( const user *p_user, const struct tenant_name_s *p_name )
+{
+
+    // done
+    return user_name_equals(p_user, p_name->p_name, p_name->name_len);
+}
+
+int tenant_construct ( tenant **pp_tenant, size_t org_id )
+{
+
+    // argument check
+    if ( NULL == pp_tenant ) goto no_tenant;
+
+    // initialized data
+    tenant *p_tenant = default_allocator(NULL, sizeof(tenant));
+
+    // error check
+    if ( NULL == p_tenant ) goto no_mem;
+
+    // populate the tenant
+    *p_tenant = (tenant)
+    {
+        .org_id = org_id
+    };
+
+    // construct the indices
+    if ( 0 == hash_index_construct(&p_tenant->p_users     , (fn_key_accessor *) user_key_accessor     , NULL                                          , HASH_INDEX_CAPACITY_MIN) ) goto failed_to_construct_index;
+    if ( 0 == hash_index_construct(&p_tenant->p_user_names, (fn_key_accessor *) user_name_key_accessor, (fn_hash_index_match *) tenant_user_name_match, HASH_INDEX_CAPACITY_MIN) ) goto failed_to_construct_index;
+    if ( 0 == hash_index_construct(&p_tenant->p_roles     , (fn_key_accessor *) role_key_accessor     , NULL                                          , HASH_INDEX_CAPACITY_MIN) ) goto failed_to_construct_index;
+    if ( 0 == hash_index_construct(&p_tenant->p_groups    , (fn_key_accessor *) group_key_accessor    , NULL                                          , HASH_INDEX_CAPACITY_MIN) ) goto failed_to_construct_index;
+
+    // return a pointer to the caller
+    *pp_tenant = p_tenant;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_tenant:
+                #ifndef NDEBUG
+                    log_error("[identity] [tenant] Null pointer provided for parameter \"pp_tenant\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // data errors
+        {
+            failed_to_construct_index:
+                #ifndef NDEBUG
+                    log_error("[identity] [tenant] Failed to construct index in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // clean up
+                (void) tenant_destroy(&p_tenant);
+
+                // error
+                return 0;
+        }
+
+        // standard library errors
+        {
+            no_mem:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+void *tenant_key_accessor ( tenant *p_tenant )
+{
+
+    // done
+    return (void *) p_tenant->org_id;
+}
+
+int tenant_size ( tenant *p_tenant, size_t *p_users_len, size_t *p_roles_len, size_t *p_groups_len )
+{
+
+    // argument check
+    if ( NULL == p_tenant ) goto no_tenant;
+
+    // count each kind of record
+    if ( p_users_len  ) *p_users_len  = hash_index_size(p_tenant->p_users);
+    if ( p_roles_len  ) *p_roles_len  = hash_index_size(p_tenant->p_roles);
+    if ( p_groups_len ) *p_groups_len = hash_index_size(p_tenant->p_groups);
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_tenant:
+                #ifndef NDEBUG
+                    log_error("[identity] [tenant] Null pointer provided for parameter \"p_tenant\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int tenant_user_lookup ( tenant *p_tenant, size_t id, user **pp_user )
+{
+
+    // done
+    return hash_index_search(p_tenant->p_users, id, (void **) pp_user);
+}
+
+int tenant_user_lookup_name ( tenant *p_tenant, const char *p_name, size_t name_len, user **pp_user )
+{
+
+    // initialized data
+    struct tenant_name_s _name = { .p_name = p_name, .name_len = name_len };
+
+    // done
+    return hash_index_match(p_tenant->p_user_names, user_name_hash(p_name, name_len), &_name, (void **) pp_user);
+}
+
+int tenant_role_lookup ( tenant *p_tenant, size_t id, role **pp_role )
+{
+
+    // done
+    return hash_index_search(p_tenant->p_roles, id, (void **) pp_role);
+}
+
+int tenant_group_lookup ( tenant *p_tenant, size_t id, group **pp_group )
+{
+
+    // done
+    return hash_index_search(p_tenant->p_groups, id, (void **) pp_group);
+}
+
+int tenant_values ( tenant *p_tenant, user **pp_users, role **pp_roles, group **pp_groups )
+{
+
+    // argument check
+    if ( NULL == p_tenant ) goto no_tenant;
+
+    // copy out each kind of record
+    if ( pp_users  ) (void) hash_index_values(p_tenant->p_users , (void **) pp_users);
+    if ( pp_roles  ) (void) hash_index_values(p_tenant->p_roles , (void **) pp_roles);
+    if ( pp_groups ) (void) hash_index_values(p_tenant->p_groups, (void **) pp_groups);
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_tenant:
+                #ifndef NDEBUG
+                    log_error("[identity] [tenant] Null pointer provided for parameter \"p_tenant\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int tenant_user_insert ( tenant *p_tenant, user *p_user )
+{
+
+    // index the user by id
+    if ( 0 == hash_index_insert(p_tenant->p_users, p_user) ) return 0;
+
+    // index the user by name
+    if ( 0 == hash_index_insert(p_tenant->p_user_names, p_user) ) goto failed_to_index_name;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // data errors
+        {
+            failed_to_index_name:
+                (void) hash_index_remove(p_tenant->p_users, p_user);
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int tenant_user_remove ( tenant *p_tenant, user *p_user )
+{
+
+    // remove the user from both indices
+    (void) hash_index_remove(p_tenant->p_user_names, p_user),
+    (void) hash_index_remove(p_tenant->p_users     , p_user);
+
+    // success
+    return 1;
+}
+
+int tenant_role_insert ( tenant *p_tenant, role *p_role )
+{
+
+    // done
+    return hash_index_insert(p_tenant->p_roles, p_role);
+}
+
+int tenant_role_remove ( tenant *p_tenant, role *p_role )
+{
+
+    // done
+    return hash_index_remove(p_tenant->p_roles, p_role);
+}
+
+int tenant_group_insert ( tenant *p_tenant, group *p_group )
+{
+
+    // done
+    return hash_index_insert(p_tenant->p_groups, p_group);
+}
+
+int tenant_group_remove ( tenant *p_tenant, group *p_group )
+{
+
+    // done
+    return hash_index_remove(p_tenant->p_groups, p_group);
+}
+
+int tenant_destroy ( tenant **pp_tenant )
+{
+
+    // argument check
+    if ( NULL == pp_tenant ) goto no_tenant;
+
+    // initialized data
+    tenant *p_tenant = *pp_tenant;
+
+    // no more pointer for caller
+    *pp_tenant = NULL;
+
+    // fast exit
+    if ( NULL == p_tenant ) return 1;
+
+    // release the indices. The records belong to whoever loaded them
+    if ( p_tenant->p_users      ) (void) hash_index_destroy(&p_tenant->p_users);
+    if ( p_tenant->p_user_names ) (void) hash_index_destroy(&p_tenant->p_user_names);
+    if ( p_tenant->p_roles      ) (void) hash_index_destroy(&p_tenant->p_roles);
+    if ( p_tenant->p_groups     ) (void) hash_index_destroy(&p_tenant->p_groups);
+
+    // release the tenant
+    p_tenant = default_allocator(p_tenant, 0);
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_tenant:
+                #ifndef NDEBUG
+                    log_error("[identity] [tenant] Null pointer provided for parameter \"pp_tenant\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
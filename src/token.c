@@ -0,0 +1,549 @@
+/** !
+ * Token
+ *
+ * @file src/token.c
+ *
+ * @author Jacob Smith
+ */
+
+// header
+#include <identity/token.h>
+
+// structure definitions
+struct token_key_s
+{
+    bool     used;
+    uint8_t  id;
+    hmac_key _key;
+};
+
+struct token_keyring_s
+{
+    mutex               _lock;
+    struct token_key_s *p_signing;                // the newest key, or null
+    struct token_key_s  _keys[TOKEN_KEYS_MAX];
+};
+
+// function declarations
+void token_u64_store ( unsigned char *p_bytes, uint64_t value );
+uint64_t token_u64_load ( const unsigned char *p_bytes );
+struct token_key_s *token_key_find ( token_keyring *p_keyring, uint8_t key_id );
+bool token_verify_locked ( token_keyring *p_keyring, const unsigned char *p_token, size_t len, time_t now, token_claims *p_claims );
+
+void token_u64_store ( unsigned char *p_bytes, uint64_t value )
+{
+
+    // little endian, whatever the host
+    for (size_t i = 0; i < 8; i++)
+        p_bytes[i] = (unsigned char) ( value >> ( 8 * i ) );
+}
+
+uint64_t token_u64_load ( const unsigned char *p_bytes )
+{
+
+    // initialized data
+    uint64_t value = 0;
+
+    // little endian, whatever the host
+    for (size_t i = 0; i < 8; i++)
+        value |= (uint64_t) p_bytes[i] << ( 8 * i );
+
+    // done
+    return value;
+}
+
+struct token_key_s *token_key_find ( token_keyring *p_keyring, uint8_t key_id )
+{
+
+    // search the keyring
+    for (size_t i = 0; i < TOKEN_KEYS_MAX; i++)
+        if ( p_keyring->_keys[i].used && key_id == p_keyring->_keys[i].id )
+            return &p_keyring->_keys[i];
+
+    // not found
+    return NULL;
+}
+
+int token_keyring_construct ( token_keyring **pp_keyring )
+{
+
+    // argument check
+    if ( NULL == pp_keyring ) goto no_keyring;
+
+    // initialized data
+    token_keyring *p_keyring = default_allocator(NULL, sizeof(token_keyring));
+
+    // error check
+    if ( NULL == p_keyring ) goto no_mem;
+
+    // start empty
+    memset(p_keyring, 0, sizeof(token_keyring));
+
+    // construct the lock
+    if ( 0 == mutex_create(&p_keyring->_lock) ) goto failed_to_construct_mutex;
+
+    // return a pointer to the caller
+    *pp_keyring = p_keyring;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_keyring:
+                #ifndef NDEBUG
+                    log_error("[identity] [token] Null pointer provided for parameter \"pp_keyring\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // sync errors
+        {
+            failed_to_construct_mutex:
+                #ifndef NDEBUG
+                    log_error("[identity] [token] Failed to construct mutex in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // clean up
+                p_keyring = default_allocator(p_keyring, 0);
+
+                // error
+                return 0;
+        }
+
+        // standard library errors
+        {
+            no_mem:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int token_keyring_key_add ( token_keyring *p_keyring, uint8_t key_id, const void *p_secret, size_t len )
+{
+
+    // argument check
+    if ( NULL == p_keyring ) goto no_keyring;
+    if ( NULL ==  p_secret ) goto no_secret;
+    if ( 0    ==       len ) goto no_secret;
+
+    // initialized data
+    struct token_key_s  _key   = { .used = true, .id = key_id };
+    struct token_key_s *p_slot = NULL;
+
+    // absorb the secret
+    hmac_key_construct(&_key._key, p_secret, len);
+
+    // lock
+    mutex_lock(&p_keyring->_lock);
+
+    // replace the key with the same id, else take a free slot
+    p_slot = token_key_find(p_keyring, key_id);
+    for (size_t i = 0; NULL == p_slot && i < TOKEN_KEYS_MAX; i++)
+        if ( false == p_keyring->_keys[i].used ) p_slot = &p_keyring->_keys[i];
+
+    // error check
+    if ( NULL == p_slot ) goto keyring_full;
+
+    // store the key, which signs from now on
+    *p_slot              = _key,
+    p_keyring->p_signing = p_slot;
+
+    // unlock
+    mutex_unlock(&p_keyring->_lock);
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_keyring:
+                #ifndef NDEBUG
+                    log_error("[identity] [token] Null pointer provided for parameter \"p_keyring\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_secret:
+                #ifndef NDEBUG
+                    log_error("[identity] [token] Null pointer or empty secret provided for parameter \"p_secret\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // token errors
+        {
+            keyring_full:
+                #ifndef NDEBUG
+                    log_error("[identity] [token] Keyring already holds %d keys in call to function \"%s\"\n", TOKEN_KEYS_MAX, __FUNCTION__);
+                #endif
+
+                // unlock
+                mutex_unlock(&p_keyring->_lock);
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int token_keyring_key_remove ( token_keyring *p_keyring, uint8_t key_id )
+{
+
+    // argument check
+    if ( NULL == p_keyring ) goto no_keyring;
+
+    // initialized data
+    struct token_key_s *p_key = NULL;
+
+    // lock
+    mutex_lock(&p_keyring->_lock);
+
+    // find the key
+    p_key = token_key_find(p_keyring, key_id);
+
+    // error check
+    if ( NULL                 == p_key ) goto no_such_key;
+    if ( p_keyring->p_signing == p_key ) goto signing_key;
+
+    // forget the key
+    memset(p_key, 0, sizeof(struct token_key_s));
+
+    // unlock
+    mutex_unlock(&p_keyring->_lock);
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_keyring:
+                #ifndef NDEBUG
+                    log_error("[identity] [token] Null pointer provided for parameter \"p_keyring\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // token errors
+        {
+            no_such_key:
+                #ifndef NDEBUG
+                    log_error("[identity] [token] No key with id %u in call to function \"%s\"\n", key_id, __FUNCTION__);
+                #endif
+
+                // unlock
+                mutex_unlock(&p_keyring->_lock);
+
+                // error
+                return 0;
+
+            signing_key:
+                #ifndef NDEBUG
+                    log_error("[identity] [token] Key %u signs tokens, so it can not be removed, in call to function \"%s\"\n", key_id, __FUNCTION__);
+                #endif
+
+                // unlock
+                mutex_unlock(&p_keyring->_lock);
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int token_claims_role_add ( token_claims *p_claims, size_t role_id )
+{
+
+    // error check
+    if ( TOKEN_BITSET_MAX * 8 <= role_id ) return 0;
+
+    // set the bit
+    p_claims->_roles[role_id / 8] |= (unsigned char) ( 1 << ( role_id % 8 ) );
+
+    // grow the bitset to cover it
+    if ( p_claims->roles_len <= role_id / 8 ) p_claims->roles_len = role_id / 8 + 1;
+
+    // success
+    return 1;
+}
+
+int token_claims_group_add ( token_claims *p_claims, size_t group_id )
+{
+
+    // error check
+    if ( TOKEN_BITSET_MAX * 8 <= group_id ) return 0;
+
+    // set the bit
+    p_claims->_groups[group_id / 8] |= (unsigned char) ( 1 << ( group_id % 8 ) );
+
+    // grow the bitset to cover it
+    if ( p_claims->groups_len <= group_id / 8 ) p_claims->groups_len = group_id / 8 + 1;
+
+    // success
+    return 1;
+}
+
+bool token_claims_has_role ( const token_claims *p_claims, size_t role_id )
+{
+
+    // done
+    return role_id / 8 < p_claims->roles_len && ( p_claims->_roles[role_id / 8] >> ( role_id % 8 ) ) & 1;
+}
+
+bool token_claims_in_group ( const token_claims *p_claims, size_t group_id )
+{
+
+    // done
+    return group_id / 8 < p_claims->groups_len && ( p_claims->_groups[group_id / 8] >> ( group_id % 8 ) ) & 1;
+}
+
+int token_sign ( token_keyring *p_keyring, const token_claims *p_claims, unsigned char *p_token, size_t *p_len )
+{
+
+    // argument check
+    if ( NULL == p_keyring ) goto no_keyring;
+    if ( NULL ==  p_claims ) goto no_claims;
+    if ( NULL ==   p_token ) goto no_token;
+    if ( NULL ==     p_len ) goto no_len;
+    if ( TOKEN_BITSET_MAX < p_claims->roles_len || TOKEN_BITSET_MAX < p_claims->groups_len ) goto bitset_too_long;
+
+    // initialized data
+    size_t len = TOKEN_HEADER_SIZE + p_claims->roles_len + p_claims->groups_len;
+
+    // lock
+    mutex_lock(&p_keyring->_lock);
+
+    // error check
+    if ( NULL == p_keyring->p_signing ) goto no_signing_key;
+
+    // header
+    p_token[0] = TOKEN_VERSION,
+    p_token[1] = p_keyring->p_signing->id,
+    p_token[2] = (unsigned char) p_claims->roles_len,
+    p_token[3] = (unsigned char) p_claims->groups_len;
+    memset(&p_token[4], 0, 4);
+
+    // claims
+    token_u64_store(&p_token[8] , p_claims->user_id),
+    token_u64_store(&p_token[16], p_claims->org_id),
+    token_u64_store(&p_token[24], (uint64_t) p_claims->expires);
+    memcpy(&p_token[TOKEN_HEADER_SIZE]                      , p_claims->_roles , p_claims->roles_len),
+    memcpy(&p_token[TOKEN_HEADER_SIZE + p_claims->roles_len], p_claims->_groups, p_claims->groups_len);
+
+    // sign
+    hmac_sha256(&p_keyring->p_signing->_key, p_token, len, &p_token[len]);
+
+    // unlock
+    mutex_unlock(&p_keyring->_lock);
+
+    // return the length to the caller
+    *p_len = len + TOKEN_MAC_SIZE;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_keyring:
+                #ifndef NDEBUG
+                    log_error("[identity] [token] Null pointer provided for parameter \"p_keyring\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_claims:
+                #ifndef NDEBUG
+                    log_error("[identity] [token] Null pointer provided for parameter \"p_claims\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_token:
+                #ifndef NDEBUG
+                    log_error("[identity] [token] Null pointer provided for parameter \"p_token\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_len:
+                #ifndef NDEBUG
+                    log_error("[identity] [token] Null pointer provided for parameter \"p_len\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            bitset_too_long:
+                #ifndef NDEBUG
+                    log_error("[identity] [token] Bitset is longer than %d bytes in call to function \"%s\"\n", TOKEN_BITSET_MAX, __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // token errors
+        {
+            no_signing_key:
+                #ifndef NDEBUG
+                    log_error("[identity] [token] Keyring has no key in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // unlock
+                mutex_unlock(&p_keyring->_lock);
+
+                // error
+                return 0;
+        }
+    }
+}
+
+bool token_verify_locked ( token_keyring *p_keyring, const unsigned char *p_token, size_t len, time_t now, token_claims *p_claims )
+{
+
+    // initialized data
+    const struct token_key_s *p_key      = NULL;
+    sha256_hash               _mac       = { 0 };
+    size_t                    roles_len  = 0,
+                              groups_len = 0;
+
+    // error check
+    if ( NULL == p_token || TOKEN_HEADER_SIZE + TOKEN_MAC_SIZE > len ) return false;
+    if ( TOKEN_VERSION != p_token[0] ) return false;
+
+    // measure the bitsets
+    roles_len  = p_token[2],
+    groups_len = p_token[3];
+
+    // error check
+    if ( TOKEN_BITSET_MAX < roles_len || TOKEN_BITSET_MAX < groups_len ) return false;
+    if ( TOKEN_HEADER_SIZE + roles_len + groups_len + TOKEN_MAC_SIZE != len ) return false;
+
+    // find the key
+    p_key = token_key_find(p_keyring, p_token[1]);
+
+    // error check
+    if ( NULL == p_key ) return false;
+
+    // compute the mac, and compare it
+    hmac_sha256(&p_key->_key, p_token, len - TOKEN_MAC_SIZE, _mac);
+    if ( false == hmac_equals(_mac, &p_token[len - TOKEN_MAC_SIZE]) ) return false;
+
+    // the token expired
+    if ( (int64_t) token_u64_load(&p_token[24]) <= (int64_t) now ) return false;
+
+    // return the claims to the caller
+    if ( p_claims )
+    {
+        p_claims->user_id    = token_u64_load(&p_token[8]),
+        p_claims->org_id     = token_u64_load(&p_token[16]),
+        p_claims->expires    = (int64_t) token_u64_load(&p_token[24]),
+        p_claims->roles_len  = roles_len,
+        p_claims->groups_len = groups_len;
+        memcpy(p_claims->_roles , &p_token[TOKEN_HEADER_SIZE]            , roles_len),
+        memcpy(p_claims->_groups, &p_token[TOKEN_HEADER_SIZE + roles_len], groups_len);
+    }
+
+    // success
+    return true;
+}
+
+bool token_verify ( token_keyring *p_keyring, const unsigned char *p_token, size_t len, time_t now, token_claims *p_claims )
+{
+
+    // initialized data
+    bool valid = false;
+
+    // verify the token
+    mutex_lock(&p_keyring->_lock);
+    valid = token_verify_locked(p_keyring, p_token, len, now, p_claims);
+    mutex_unlock(&p_keyring->_lock);
+
+    // done
+    return valid;
+}
+
+size_t token_verify_batch ( token_keyring *p_keyring, const unsigned char *const *pp_tokens, const size_t *_lens, size_t count, time_t now, token_claims *_claims, bool *_valid )
+{
+
+    // initialized data
+    size_t valid = 0;
+
+    // verify every token under one lock
+    mutex_lock(&p_keyring->_lock);
+    for (size_t i = 0; i < count; i++)
+        _valid[i] = token_verify_locked(p_keyring, pp_tokens[i], _lens[i], now, ( _claims ) ? &_claims[i] : NULL),
+        valid    += _valid[i];
+    mutex_unlock(&p_keyring->_lock);
+
+    // done
+    return valid;
+}
+
+int token_keyring_destroy ( token_keyring **pp_keyring )
+{
+
+    // argument check
+    if ( NULL == pp_keyring ) goto no_keyring;
+
+    // initialized data
+    token_keyring *p_keyring = *pp_keyring;
+
+    // no more pointer for caller
+    *pp_keyring = NULL;
+
+    // fast exit
+    if ( NULL == p_keyring ) return 1;
+
+    // forget every key
+    memset(p_keyring->_keys, 0, sizeof(p_keyring->_keys));
+
+    // release the keyring
+    mutex_destroy(&p_keyring->_lock);
+    p_keyring = default_allocator(p_keyring, 0);
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_keyring:
+                #ifndef NDEBUG
+                    log_error("[identity] [token] Null pointer provided for parameter \"pp_keyring\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
@@ -9,24 +9,38 @@
 // header
 #include <identity/user.h>
 
+// standard library
+#include <sys/random.h>
+
+// identity
+#include <identity/protocol.h>
+#include <identity/hmac.h>
+
 // structure definitions
+//
+// A user is one contiguous record. The group ids, the role ids and the name
+// follow the fixed fields, at offsets from the start of the record, so a
+// record means the same thing on the heap and in a mapped snapshot
 struct user_s
 {
-    size_t       id;
-    size_t       org_id;
-    array       *p_groups;
-    array       *p_roles;
-    char        *p_name;
+    uint64_t     id;
+    uint64_t     org_id;
+    uint64_t     size;          // bytes in the whole record
+    uint64_t     name_hash;
+    uint32_t     name_len;
+    uint32_t     name_offset;
+    uint32_t     groups_len;
+    uint32_t     groups_offset;
+    uint32_t     roles_len;
+    uint32_t     roles_offset;
+    uint32_t     iterations;    // 0 if _password_hash is the digest itself
+    uint32_t     _reserved;
+    unsigned char _salt[USER_SALT_SIZE];
     sha256_hash  _password_hash;
 };
 
-// function definition
-int number_pack ( void *p_buffer, const void *const p_value )
-{
-
-    // done
-    return pack_pack(p_buffer, "%i64", p_value);
-}
+// function declarations
+const char *user_name ( const user *p_user );
 
 int user_construct
 (
@@ -41,52 +55,157 @@ int user_construct
     size_t *p_groups, size_t groups_len,
     size_t *p_roles , size_t roles_len 
 )
+{
+
+    // argument check
+    if ( NULL == p_password ) goto no_password;
+
+    // initialized data
+    sha256_state  _state  = { 0 };
+    sha256_hash   _digest = { 0 },
+                  _hash   = { 0 };
+    unsigned char _salt[USER_SALT_SIZE] = { 0 };
+
+    // hash the password, as a client would
+    sha256_construct(&_state),
+    sha256_update(&_state, (const unsigned char *) p_password, strlen(p_password)),
+    sha256_final(&_state, _digest);
+
+    // salt
+    if ( -1 == getentropy(_salt, sizeof(_salt)) ) goto failed_to_get_entropy;
+
+    // stretch
+    hmac_pbkdf2(_digest, sizeof(sha256_hash), _salt, sizeof(_salt), USER_PASSWORD_ITERATIONS, _hash);
+
+    // construct the user
+    return user_construct_hash(pp_user, id, p_name, USER_PASSWORD_ITERATIONS, _salt, _hash, org_id, p_groups, groups_len, p_roles, roles_len);
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_password:
+                #ifndef NDEBUG
+                    log_error("[identity] [user] Null pointer provided for parameter \"p_password\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // standard library errors
+        {
+            failed_to_get_entropy:
+                #ifndef NDEBUG
+                    log_error("[standard library] Call to function \"getentropy\" failed in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int user_construct_digest
+(
+    user **pp_user,
+
+    size_t id,
+    const char *p_name,
+    const sha256_hash digest,
+
+    size_t org_id,
+
+    const size_t *p_groups, size_t groups_len,
+    const size_t *p_roles , size_t roles_len 
+)
+{
+
+    // an unsalted user stores the digest itself
+    return user_construct_hash(pp_user, id, p_name, 0, NULL, digest, org_id, p_groups, groups_len, p_roles, roles_len);
+}
+
+int user_construct_hash
+(
+    user **pp_user,
+
+    size_t id,
+    const char *p_name,
+    uint32_t iterations,
+    const unsigned char salt[USER_SALT_SIZE],
+    const sha256_hash hash,
+
+    size_t org_id,
+
+    const size_t *p_groups, size_t groups_len,
+    const size_t *p_roles , size_t roles_len 
+)
 {
 
     // argument check
     if ( NULL ==  pp_user ) goto no_user;
     if ( NULL ==   p_name ) goto no_name;
+    if ( NULL ==     hash ) goto no_hash;
+    if ( NULL == salt && 0 < iterations ) goto no_salt;
     if ( NULL == p_groups && 0 < groups_len ) goto no_groups;
     if ( NULL ==  p_roles && 0 <  roles_len ) goto no_roles;
 
     // initialized data
-    user *p_user = default_allocator(NULL, sizeof(user));
-    sha256_state _state = { 0 };
+    size_t    name_len      = strlen(p_name);
+    size_t    groups_offset = sizeof(user),
+              roles_offset  = groups_offset + groups_len * sizeof(uint64_t),
+              name_offset   = roles_offset  + roles_len  * sizeof(uint64_t),
+              size          = ( name_offset + name_len + 1 + 7 ) & ~(size_t) 7;
+    user     *p_user        = NULL;
+    uint64_t *p_ids         = NULL;
+
+    // error check
+    if ( USER_NAME_MAX < name_len ) goto name_too_long;
+    if ( USER_GROUPS_MAX < groups_len ) goto too_many_groups;
+    if ( USER_ROLES_MAX  <  roles_len ) goto too_many_roles;
+
+    // allocate the record
+    p_user = default_allocator(NULL, size);
 
     // error check
     if ( NULL == p_user ) goto no_mem;
 
+    // zero the record, so packed records have no stray bytes
+    memset(p_user, 0, size);
+
     // populate the user struct
     *p_user = (user)
     {
-        .id       = id,
-        .org_id   = org_id,
-        .p_groups = NULL,
-        .p_roles  = NULL,
-        .p_name   = strdup(p_name),
+        .id            = id,
+        .org_id        = org_id,
+        .size          = size,
+        .name_hash     = user_name_hash(p_name, name_len),
+        .name_len      = (uint32_t) name_len,
+        .name_offset   = (uint32_t) name_offset,
+        .groups_len    = (uint32_t) groups_len,
+        .groups_offset = (uint32_t) groups_offset,
+        .roles_len     = (uint32_t) roles_len,
+        .roles_offset  = (uint32_t) roles_offset,
+        .iterations    = iterations
     };
 
-    // error check
-    if ( NULL ==  p_user->p_name ) goto no_mem_1;
-
-    // construct a group array
-    if ( 0 == array_construct(&p_user->p_groups, groups_len + 1) ) goto no_mem_2;
-
-    // construct a role array
-    if ( 0 == array_construct(&p_user->p_roles, roles_len + 1) ) goto no_mem_4;
-
-    // populate the group array
+    // store the group ids
+    p_ids = (uint64_t *)( (char *) p_user + groups_offset );
     for (size_t i = 0; i < groups_len; ++i)
-        (void) array_add(p_user->p_groups, (void *) p_groups[i]);
+        p_ids[i] = p_groups[i];
 
-    // populate the role array
+    // store the role ids
+    p_ids = (uint64_t *)( (char *) p_user + roles_offset );
     for (size_t i = 0; i < roles_len; ++i)
-        (void) array_add(p_user->p_roles, (void *) p_roles[i]);
+        p_ids[i] = p_roles[i];
+
+    // store the name
+    memcpy((char *) p_user + name_offset, p_name, name_len);
     
-    // hash the password
-    sha256_construct(&_state),
-    sha256_update(&_state, (const unsigned char *) p_password, strlen(p_password)),
-    sha256_final(&_state, p_user->_password_hash);
+    // store the salt and the hash
+    if ( salt ) memcpy(p_user->_salt, salt, USER_SALT_SIZE);
+    memcpy(p_user->_password_hash, hash, sizeof(sha256_hash));
 
     // return a pointer to the caller
     *pp_user = p_user;
@@ -115,9 +234,17 @@ int user_construct
                 // error
                 return 0;
 
-            no_email:
+            no_hash:
+                #ifndef NDEBUG
+                    log_error("[identity] [user] Null pointer provided for parameter \"hash\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_salt:
                 #ifndef NDEBUG
-                    log_error("[identity] [user] Null pointer provided for parameter \"p_email\" in call to function \"%s\"\n", __FUNCTION__);
+                    log_error("[identity] [user] Null pointer provided for parameter \"salt\" in call to function \"%s\"\n", __FUNCTION__);
                 #endif
 
                 // error
@@ -140,11 +267,35 @@ int user_construct
                 return 0;
         }
     
+        // user errors
+        {
+            name_too_long:
+                #ifndef NDEBUG
+                    log_error("[identity] [user] Parameter \"p_name\" is longer than %d bytes in call to function \"%s\"\n", USER_NAME_MAX, __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            too_many_groups:
+                #ifndef NDEBUG
+                    log_error("[identity] [user] Parameter \"groups_len\" is greater than %d in call to function \"%s\"\n", USER_GROUPS_MAX, __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            too_many_roles:
+                #ifndef NDEBUG
+                    log_error("[identity] [user] Parameter \"roles_len\" is greater than %d in call to function \"%s\"\n", USER_ROLES_MAX, __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    
         // standard library errors
         {
-            no_mem_4: array_destroy(&p_user->p_groups, 0);
-            no_mem_2:   p_user->p_name = default_allocator(p_user->p_name , 0);
-            no_mem_1:           p_user = default_allocator(p_user         , 0);
             no_mem:
                 #ifndef NDEBUG
                     log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
@@ -156,6 +307,40 @@ int user_construct
     }
 }
 
+int user_json_ids_get ( json_value *p_ids, size_t *_ids, size_t ids_max, size_t *p_ids_len )
+{
+
+    // initialized data
+    json_value *_p_values[USER_GROUPS_MAX > USER_ROLES_MAX ? USER_GROUPS_MAX : USER_ROLES_MAX] = { 0 };
+    size_t      len = 0;
+
+    // an absent property is an empty list
+    if ( NULL == p_ids ) return *p_ids_len = 0, 1;
+
+    // type check
+    if ( JSON_VALUE_ARRAY != p_ids->type ) return 0;
+
+    // error check
+    len = array_size(p_ids->list);
+    if ( ids_max < len ) return 0;
+
+    // get the values
+    array_get(p_ids->list, (void **) _p_values, NULL);
+
+    // type check
+    for (size_t i = 0; i < len; i++)
+    {
+        if ( JSON_VALUE_INTEGER != _p_values[i]->type ) return 0;
+        _ids[i] = (size_t) _p_values[i]->integer;
+    }
+
+    // return the length to the caller
+    *p_ids_len = len;
+
+    // success
+    return 1;
+}
+
 int user_from_json
 (
     user       **pp_user,
@@ -168,12 +353,20 @@ int user_from_json
     if ( NULL == p_value ) goto no_value;
 
     // initialized data
-    user *p_user = default_allocator(NULL, sizeof(user));
-    dict *p_dict = NULL;
-    
-
-    // error check
-    if ( NULL == p_user ) goto no_mem;
+    dict        *p_dict     = NULL;
+    json_value  *p_id       = NULL,
+                *p_name     = NULL,
+                *p_org_id   = NULL,
+                *p_pass     = NULL,
+                *p_salt     = NULL,
+                *p_iters    = NULL;
+    size_t       _groups[USER_GROUPS_MAX] = { 0 },
+                 _roles [USER_ROLES_MAX]  = { 0 };
+    size_t       groups_len = 0,
+                 roles_len  = 0;
+    uint32_t     iterations = 0;
+    sha256_hash  _digest    = { 0 };
+    unsigned char _salt[USER_SALT_SIZE] = { 0 };
 
     // type check
     if ( JSON_VALUE_OBJECT != p_value->type ) goto wrong_type;
@@ -181,10 +374,58 @@ int user_from_json
     // store the object
     p_dict = p_value->object;
 
+    // get the properties
+    p_id     = dict_get(p_dict, "id");
+    p_name   = dict_get(p_dict, "name");
+    p_org_id = dict_get(p_dict, "org_id");
+    p_pass   = dict_get(p_dict, "pass");
+    p_salt   = dict_get(p_dict, "salt");
+    p_iters  = dict_get(p_dict, "iterations");
 
+    // error check
+    if ( NULL ==   p_id ) goto no_id;
+    if ( NULL == p_name ) goto no_name;
+    if ( NULL == p_pass ) goto no_pass;
 
-    // success
-    return 1;
+    // type check
+    if ( JSON_VALUE_INTEGER !=   p_id->type ) goto id_wrong_type;
+    if ( JSON_VALUE_STRING  != p_name->type ) goto name_wrong_type;
+    if ( p_org_id && JSON_VALUE_INTEGER != p_org_id->type ) goto org_id_wrong_type;
+
+    // decode the password digest
+    if ( JSON_VALUE_STRING != p_pass->type || 2 * sizeof(sha256_hash) != strlen(p_pass->string) ) goto pass_wrong_type;
+    if ( 0 == protocol_hex_decode(p_pass->string, 2 * sizeof(sha256_hash), _digest) ) goto pass_wrong_type;
+
+    // a stretched hash comes with its cost and its salt
+    if ( p_iters )
+    {
+
+        // type check
+        if ( JSON_VALUE_INTEGER != p_iters->type || 1 > p_iters->integer || UINT32_MAX < p_iters->integer ) goto iterations_wrong_type;
+        if ( NULL == p_salt || JSON_VALUE_STRING != p_salt->type || 2 * USER_SALT_SIZE != strlen(p_salt->string) ) goto salt_wrong_type;
+        if ( 0 == protocol_hex_decode(p_salt->string, 2 * USER_SALT_SIZE, _salt) ) goto salt_wrong_type;
+
+        // store the cost
+        iterations = (uint32_t) p_iters->integer;
+    }
+
+    // get the group and role ids
+    if ( 0 == user_json_ids_get(dict_get(p_dict, "group_ids"), _groups, USER_GROUPS_MAX, &groups_len) ) goto group_ids_wrong_type;
+    if ( 0 == user_json_ids_get(dict_get(p_dict, "role_ids") , _roles , USER_ROLES_MAX , &roles_len ) ) goto role_ids_wrong_type;
+
+    // construct the user
+    return user_construct_hash
+    (
+        pp_user,
+        (size_t) p_id->integer,
+        p_name->string,
+        iterations,
+        _salt,
+        _digest,
+        ( p_org_id ) ? (size_t) p_org_id->integer : 0,
+        _groups, groups_len,
+        _roles , roles_len
+    );
 
     // error handling
     {
@@ -217,13 +458,90 @@ int user_from_json
 
                 // error
                 return 0;
-        }
 
-        // standard library errors
-        {
-            no_mem:
+            no_id:
                 #ifndef NDEBUG
-                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                    log_error("[identity] [user] Parameter \"p_value\" missing property \"id\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_name:
+                #ifndef NDEBUG
+                    log_error("[identity] [user] Parameter \"p_value\" missing property \"name\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_pass:
+                #ifndef NDEBUG
+                    log_error("[identity] [user] Parameter \"p_value\" missing property \"pass\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            id_wrong_type:
+                #ifndef NDEBUG
+                    log_error("[identity] [user] Property \"id\" of parameter \"p_value\" must be of type [ integer ] in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            name_wrong_type:
+                #ifndef NDEBUG
+                    log_error("[identity] [user] Property \"name\" of parameter \"p_value\" must be of type [ string ] in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            org_id_wrong_type:
+                #ifndef NDEBUG
+                    log_error("[identity] [user] Property \"org_id\" of parameter \"p_value\" must be of type [ integer ] in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            pass_wrong_type:
+                #ifndef NDEBUG
+                    log_error("[identity] [user] Property \"pass\" of parameter \"p_value\" must be a hex SHA-256 digest in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            iterations_wrong_type:
+                #ifndef NDEBUG
+                    log_error("[identity] [user] Property \"iterations\" of parameter \"p_value\" must be a positive 32 bit [ integer ] in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            salt_wrong_type:
+                #ifndef NDEBUG
+                    log_error("[identity] [user] Property \"salt\" of parameter \"p_value\" must be %d hex bytes in call to function \"%s\"\n", USER_SALT_SIZE, __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            group_ids_wrong_type:
+                #ifndef NDEBUG
+                    log_error("[identity] [user] Property \"group_ids\" of parameter \"p_value\" must be of type [ array ] of at most %d [ integer ] in call to function \"%s\"\n", USER_GROUPS_MAX, __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            role_ids_wrong_type:
+                #ifndef NDEBUG
+                    log_error("[identity] [user] Property \"role_ids\" of parameter \"p_value\" must be of type [ array ] of at most %d [ integer ] in call to function \"%s\"\n", USER_ROLES_MAX, __FUNCTION__);
                 #endif
 
                 // error
@@ -238,17 +556,19 @@ int user_print ( user *p_user )
     // argument check
     if ( NULL == p_user ) goto no_user;
 
+    // initialized data
+    char _hex[2 * sizeof(sha256_hash) + 1] = { 0 };
+
     // formatting
     log_info("user @%p\n", (void *)p_user);
     printf(" - ID: %lld\n", p_user->id);
     printf(" - Organization ID: %lld\n", p_user->org_id);
-    printf(" - Name: %s\n", p_user->p_name);
-    printf(" - Pass: ");
-    for (size_t i = 0; i < sizeof(sha256_hash); i++)
-        printf("%hhx", p_user->_password_hash[i]);
-    putchar('\n');
-    printf(" - Roles[%d]: \n", array_size(p_user->p_roles));
-    printf(" - Groups[%d]: \n", array_size(p_user->p_groups));
+    printf(" - Name: %s\n", user_name(p_user));
+    printf(" - Iterations: %u\n", p_user->iterations);
+    printf(" - Salt: %.*s\n", (int) protocol_hex_encode(p_user->_salt, USER_SALT_SIZE, _hex), _hex);
+    printf(" - Pass: %.*s\n", (int) protocol_hex_encode(p_user->_password_hash, sizeof(sha256_hash), _hex), _hex);
+    printf(" - Roles[%u]: \n", p_user->roles_len);
+    printf(" - Groups[%u]: \n", p_user->groups_len);
 
     // success
     return 1;
@@ -273,28 +593,86 @@ int user_comparator ( size_t id_a, size_t id_b )
 {
 
     // success
-    return id_b - id_a;
+    return ( id_b > id_a ) - ( id_b < id_a );
 }
 
-int user_password_comparator ( void *id_a, void *id_b )
+void *user_key_accessor ( user *p_user )
 {
 
     // success
-    return memcmp(id_a, id_b, sizeof(sha256_hash));
+    return (void *)(size_t) p_user->id;
 }
 
-void *user_key_accessor ( user *p_user )
+void *user_name_key_accessor ( user *p_user )
 {
 
     // success
-    return (void *)p_user->id;
+    return (void *)(size_t) p_user->name_hash;
 }
 
-void *user_password_key_accessor ( user *p_user )
+void *user_org_name_key_accessor ( user *p_user )
 {
 
     // success
-    return (void *)&p_user->_password_hash;
+    return (void *)user_org_name_hash(p_user->org_id, p_user->name_hash);
+}
+
+hash64 user_name_hash ( const char *p_name, size_t name_len )
+{
+
+    // done
+    return hash_fnv64(p_name, name_len);
+}
+
+hash64 user_org_name_hash ( size_t org_id, hash64 name_hash )
+{
+
+    // mix the organization into the name hash
+    return name_hash ^ ( ( (hash64) org_id + 1 ) * 0x9e3779b97f4a7c15ULL );
+}
+
+const char *user_name ( const user *p_user )
+{
+
+    // done
+    return (const char *) p_user + p_user->name_offset;
+}
+
+bool user_name_equals ( const user *p_user, const char *p_name, size_t name_len )
+{
+
+    // done
+    return p_user->name_len == name_len && 0 == memcmp(user_name(p_user), p_name, name_len);
+}
+
+size_t user_org_id_get ( const user *p_user )
+{
+
+    // done
+    return p_user->org_id;
+}
+
+uint32_t user_password_cost ( const user *p_user )
+{
+
+    // done
+    return p_user->iterations;
+}
+
+bool user_password_verify ( const user *p_user, const sha256_hash digest )
+{
+
+    // initialized data
+    sha256_hash _hash = { 0 };
+
+    // unsalted users store the digest itself
+    if ( 0 == p_user->iterations ) return hmac_equals(p_user->_password_hash, digest);
+
+    // stretch the digest with the user's salt and cost
+    hmac_pbkdf2(digest, sizeof(sha256_hash), p_user->_salt, USER_SALT_SIZE, p_user->iterations, _hash);
+
+    // done
+    return hmac_equals(p_user->_password_hash, _hash);
 }
 
 int user_name_get ( user *p_user, char *_name )
@@ -304,8 +682,8 @@ int user_name_get ( user *p_user, char *_name )
     if ( NULL == p_user ) goto no_user;
     if ( NULL ==  _name ) goto no_name;
 
-    // initialized data
-    strcpy(_name, p_user->p_name);
+    // copy the name
+    memcpy(_name, user_name(p_user), p_user->name_len + 1);
 
     // success
     return 1;
@@ -335,36 +713,115 @@ int user_name_get ( user *p_user, char *_name )
     }
 }
 
-int user_pack ( void *p_buffer, const user *const p_user )
+int user_groups_get ( const user *p_user, const uint64_t **pp_groups, size_t *p_groups_len )
 {
 
-    // initialized data
-    char *p_offset = (char *) p_buffer;
+    // return the group ids to the caller
+    *pp_groups    = (const uint64_t *)( (const char *) p_user + p_user->groups_offset ),
+    *p_groups_len = p_user->groups_len;
 
-    // pack user id
-    p_offset += pack_pack(p_offset, "%i64", p_user->id),
+    // success
+    return 1;
+}
 
-    // pack organization id
-    p_offset += pack_pack(p_offset, "%i64", p_user->org_id),
+int user_roles_get ( const user *p_user, const uint64_t **pp_roles, size_t *p_roles_len )
+{
 
-    // pack the groups
-    p_offset += array_pack(p_offset, p_user->p_groups, number_pack),
+    // return the role ids to the caller
+    *pp_roles    = (const uint64_t *)( (const char *) p_user + p_user->roles_offset ),
+    *p_roles_len = p_user->roles_len;
 
-    // pack the roles
-    p_offset += array_pack(p_offset, p_user->p_roles, number_pack),
+    // success
+    return 1;
+}
 
-    // pack the name
-    p_offset += pack_pack(p_offset, "%s", p_user->p_name);
+int user_pack ( void *p_buffer, const user *const p_user )
+{
+
+    // argument check
+    if ( NULL == p_user ) goto no_user;
+
+    // the record is already packed. A null buffer asks for the size
+    if ( p_buffer ) memcpy(p_buffer, p_user, p_user->size);
 
     // done
-    return (void *)p_offset - (void *)p_buffer;
+    return (int) p_user->size;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_user:
+                #ifndef NDEBUG
+                    log_error("[identity] [user] Null pointer provided for parameter \"p_user\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
 }
 
-int user_unpack ( void *const p_value, void *p_buffer )
+int user_unpack ( user **pp_user, void *p_buffer, size_t size )
 {
 
-    // 
+    // argument check
+    if ( NULL ==  pp_user ) goto no_user;
+    if ( NULL == p_buffer ) goto no_buffer;
+
+    // initialized data
+    user *p_user = p_buffer;
+
+    // check the fixed fields
+    if ( 0 != ( (size_t) p_buffer & 7 ) ) goto bad_record;
+    if ( size < sizeof(user) || p_user->size < sizeof(user) || p_user->size > size || 0 != ( p_user->size & 7 ) ) goto bad_record;
+
+    // check the id lists
+    if ( p_user->groups_offset < sizeof(user) || 0 != ( p_user->groups_offset & 7 ) || (uint64_t) p_user->groups_offset + (uint64_t) p_user->groups_len * sizeof(uint64_t) > p_user->size ) goto bad_record;
+    if ( p_user->roles_offset  < sizeof(user) || 0 != ( p_user->roles_offset  & 7 ) || (uint64_t) p_user->roles_offset  + (uint64_t) p_user->roles_len  * sizeof(uint64_t) > p_user->size ) goto bad_record;
+
+    // check the name
+    if ( p_user->name_offset < sizeof(user) || (uint64_t) p_user->name_offset + p_user->name_len >= p_user->size ) goto bad_record;
+    if ( '\0' != user_name(p_user)[p_user->name_len] ) goto bad_record;
+
+    // bind the record in place
+    *pp_user = p_user;
 
     // done
-    return 0;
+    return (int) p_user->size;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_user:
+                #ifndef NDEBUG
+                    log_error("[identity] [user] Null pointer provided for parameter \"pp_user\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_buffer:
+                #ifndef NDEBUG
+                    log_error("[identity] [user] Null pointer provided for parameter \"p_buffer\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // user errors
+        {
+            bad_record:
+                #ifndef NDEBUG
+                    log_error("[identity] [user] Malformed user record in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
 }
@@ -0,0 +1,966 @@
+/** !
+ * Write ahead log
+ *
+ * @file src/wal.c
+ *
+ * @author Jacob Smith
+ */
+
+// feature test macros
+#define _GNU_SOURCE
+
+// header
+#include <identity/wal.h>
+
+// standard library
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <assert.h>
+
+// type definitions
+typedef int (fn_wal_pack)   ( void *p_buffer, const void *const p_value );
+typedef int (fn_wal_unpack) ( void **pp_value, void *p_buffer, size_t size );
+
+// structure definitions
+struct wal_file_header_s
+{
+    char     _magic[8];
+    uint32_t version;
+    uint32_t endian;   // WAL_ENDIAN, as the writer stored it
+};
+
+struct wal_header_s
+{
+    uint64_t sequence;
+    uint64_t checksum;
+    uint32_t type;
+    uint32_t size;
+};
+
+struct wal_s
+{
+    int                 fd;
+    mutex               _lock;
+    condition_variable  _durable;    // broadcast after every write
+    char               *p_pending;   // appended, not yet written
+    size_t              pending_len;
+    size_t              pending_max;
+    char               *p_writing;   // the batch being written
+    size_t              writing_max;
+    uint64_t            appended;    // the sequence of the last appended record
+    uint64_t            durable;     // the sequence of the last record on disk
+    bool                flushing;    // a writer is writing a batch
+    bool                failed;      // a write failed, and the log is unusable
+    fn_wal_durable     *pfn_durable; // takes each batch once it is on disk
+    void               *p_context;
+};
+
+static_assert(sizeof(struct wal_header_s) == WAL_HEADER_SIZE, "WAL_HEADER_SIZE is the size of a record header");
+static_assert(sizeof(struct wal_file_header_s) % 8 == 0, "records after the log header start on an 8 byte boundary");
+
+// the header every log starts with
+static const struct wal_file_header_s _file_header = { ._magic = WAL_MAGIC, .version = WAL_VERSION, .endian = WAL_ENDIAN };
+
+// function declarations
+uint64_t wal_checksum ( const struct wal_header_s *p_header, const void *p_value );
+int wal_write ( int fd, const char *p_buffer, size_t len );
+size_t wal_record_check ( const void *p_record, size_t len );
+int wal_org_id_pack ( void *p_buffer, const uint64_t *p_org_id );
+int wal_org_id_unpack ( uint64_t **pp_org_id, void *p_buffer, size_t size );
+
+// the pack and unpack functions of each record type
+static fn_wal_pack *const _pfn_pack[WAL_RECORD_QUANTITY] =
+{
+    [WAL_RECORD_ORG]        = (fn_wal_pack *) org_pack,
+    [WAL_RECORD_ROLE]       = (fn_wal_pack *) role_pack,
+    [WAL_RECORD_GROUP]      = (fn_wal_pack *) group_pack,
+    [WAL_RECORD_USER]       = (fn_wal_pack *) user_pack,
+    [WAL_RECORD_ORG_UNLOAD] = (fn_wal_pack *) wal_org_id_pack
+};
+
+static fn_wal_unpack *const _pfn_unpack[WAL_RECORD_QUANTITY] =
+{
+    [WAL_RECORD_ORG]        = (fn_wal_unpack *) org_unpack,
+    [WAL_RECORD_ROLE]       = (fn_wal_unpack *) role_unpack,
+    [WAL_RECORD_GROUP]      = (fn_wal_unpack *) group_unpack,
+    [WAL_RECORD_USER]       = (fn_wal_unpack *) user_unpack,
+    [WAL_RECORD_ORG_UNLOAD] = (fn_wal_unpack *) wal_org_id_unpack
+};
+
+int wal_org_id_pack ( void *p_buffer, const uint64_t *p_org_id )
+{
+
+    // the value is the id. A null buffer asks for the size
+    if ( p_buffer ) memcpy(p_buffer, p_org_id, sizeof(uint64_t));
+
+    // done
+    return (int) sizeof(uint64_t);
+}
+
+int wal_org_id_unpack ( uint64_t **pp_org_id, void *p_buffer, size_t size )
+{
+
+    // error check
+    if ( sizeof(uint64_t) != size ) return 0;
+
+    // bind the id in place
+    *pp_org_id = p_buffer;
+
+    // done
+    return (int) sizeof(uint64_t);
+}
+
+uint64_t wal_checksum ( const struct wal_header_s *p_header, const void *p_value )
+{
+
+    // done
+    return hash_fnv64(p_value, p_header->size)
+         ^ ( p_header->sequence * 0x9e3779b97f4a7c15ULL )
+         ^ ( (uint64_t) p_header->type << 32 | p_header->size );
+}
+
+int wal_write ( int fd, const char *p_buffer, size_t len )
+{
+
+    // write until done
+    while ( len )
+    {
+
+        // initialized data
+        ssize_t written = write(fd, p_buffer, len);
+
+        // retry interrupted writes
+        if ( -1 == written && EINTR == errno ) continue;
+
+        // error check
+        if ( 0 >= written ) return 0;
+
+        // next
+        p_buffer += written,
+        len      -= (size_t) written;
+    }
+
+    // success
+    return 1;
+}
+
+size_t wal_record_pack ( void *p_buffer, enum wal_record_e type, const void *p_value, uint64_t sequence )
+{
+
+    // initialized data
+    struct wal_header_s  _header = { .sequence = sequence, .type = type };
+    int                  size    = 0;
+
+    // error check
+    if ( type < WAL_RECORD_ORG || type >= WAL_RECORD_QUANTITY ) return 0;
+
+    // measure the value
+    size = _pfn_pack[type](NULL, p_value);
+
+    // error check
+    if ( 0 >= size ) return 0;
+
+    // the size of the value
+    _header.size = (uint32_t) size;
+
+    // measure the record
+    if ( NULL == p_buffer ) return sizeof(_header) + (size_t) size;
+
+    // pack the value after the header
+    (void) _pfn_pack[type]((char *) p_buffer + sizeof(_header), p_value);
+
+    // finish the header, and store it
+    _header.checksum = wal_checksum(&_header, (char *) p_buffer + sizeof(_header));
+    memcpy(p_buffer, &_header, sizeof(_header));
+
+    // done
+    return sizeof(_header) + (size_t) size;
+}
+
+size_t wal_record_size ( const void *p_header )
+{
+
+    // initialized data
+    struct wal_header_s _header = { 0 };
+
+    // copy the header
+    memcpy(&_header, p_header, sizeof(_header));
+
+    // error check
+    if ( _header.type < WAL_RECORD_ORG || _header.type >= WAL_RECORD_QUANTITY ) return 0;
+    if ( 0 == _header.size || 0 != ( _header.size & 7 ) ) return 0;
+
+    // done
+    return sizeof(_header) + _header.size;
+}
+
+uint64_t wal_record_sequence ( const void *p_header )
+{
+
+    // initialized data
+    struct wal_header_s _header = { 0 };
+
+    // copy the header
+    memcpy(&_header, p_header, sizeof(_header));
+
+    // done
+    return _header.sequence;
+}
+
+size_t wal_record_check ( const void *p_record, size_t len )
+{
+
+    // initialized data
+    struct wal_header_s _header = { 0 };
+    size_t              size    = 0;
+
+    // error check
+    if ( len < sizeof(_header) ) return 0;
+
+    // check the header
+    size = wal_record_size(p_record);
+    if ( 0 == size || size > len ) return 0;
+
+    // copy the header
+    memcpy(&_header, p_record, sizeof(_header));
+
+    // check the value
+    if ( _header.checksum != wal_checksum(&_header, (const char *) p_record + sizeof(_header)) ) return 0;
+
+    // done
+    return size;
+}
+
+size_t wal_record_unpack ( const void *p_record, size_t len, uint64_t *p_sequence, enum wal_record_e *p_type, void **pp_value )
+{
+
+    // initialized data
+    struct wal_header_s  _header = { 0 };
+    size_t               size    = wal_record_check(p_record, len);
+    void                *p_value = NULL;
+
+    // error check
+    if ( 0 == size ) return 0;
+
+    // copy the header
+    memcpy(&_header, p_record, sizeof(_header));
+
+    // copy the value into its own allocation
+    p_value = default_allocator(NULL, _header.size);
+
+    // error check
+    if ( NULL == p_value ) return 0;
+
+    // copy the value
+    memcpy(p_value, (const char *) p_record + sizeof(_header), _header.size);
+
+    // bind the value
+    if ( (int) _header.size != _pfn_unpack[_header.type](&p_value, p_value, _header.size) ) goto failed_to_unpack;
+
+    // return the record to the caller
+    *p_sequence = _header.sequence,
+    *p_type     = (enum wal_record_e) _header.type,
+    *pp_value   = p_value;
+
+    // done
+    return size;
+
+    // error handling
+    {
+
+        // data errors
+        {
+            failed_to_unpack:
+                #ifndef NDEBUG
+                    log_error("[identity] [wal] Failed to unpack record %llu in call to function \"%s\"\n", (unsigned long long) _header.sequence, __FUNCTION__);
+                #endif
+
+                // release the value
+                p_value = default_allocator(p_value, 0);
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int wal_replay ( const char *p_path, uint64_t after, fn_wal_replay *pfn_replay, void *p_context, uint64_t *p_last_sequence )
+{
+
+    // argument check
+    if ( NULL ==          p_path ) goto no_path;
+    if ( NULL ==      pfn_replay ) goto no_replay;
+    if ( NULL == p_last_sequence ) goto no_last_sequence;
+
+    // initialized data
+    FILE                     *p_file     = fopen(p_path, "rb");
+    char                     *p_buffer   = NULL;
+    long                      len        = 0;
+    size_t                    offset     = sizeof(struct wal_file_header_s),
+                              replayed   = 0,
+                              failures   = 0;
+    uint64_t                  sequence   = 0;
+    struct wal_file_header_s  _header    = { 0 };
+
+    // a missing log is an empty log
+    if ( NULL == p_file ) { *p_last_sequence = after; return 1; }
+
+    // get the size of the log
+    if ( 0 != fseek(p_file, 0, SEEK_END) ) goto failed_to_read;
+    len = ftell(p_file);
+    if ( 0 > len || 0 != fseek(p_file, 0, SEEK_SET) ) goto failed_to_read;
+
+    // allocate a buffer
+    p_buffer = default_allocator(NULL, (size_t) len + 1);
+
+    // error check
+    if ( NULL == p_buffer ) goto no_mem;
+
+    // read the log
+    if ( (size_t) len != fread(p_buffer, 1, (size_t) len, p_file) ) goto failed_to_read;
+
+    // done with the file
+    fclose(p_file), p_file = NULL;
+
+    // a log cut short inside its header holds no records. wal_construct writes it again
+    if ( (size_t) len < sizeof(_header) )
+    {
+        if ( 0 != memcmp(p_buffer, &_file_header, (size_t) len) ) goto bad_header;
+        len    = 0,
+        offset = 0;
+    }
+
+    // check the header
+    else
+    {
+        memcpy(&_header, p_buffer, sizeof(_header));
+        if ( 0 != memcmp(_header._magic, _file_header._magic, sizeof(_header._magic)) ) goto bad_header;
+        if ( WAL_VERSION != _header.version ) goto wrong_version;
+        if ( WAL_ENDIAN  != _header.endian  ) goto wrong_endian;
+    }
+
+    // replay each record
+    while ( offset < (size_t) len )
+    {
+
+        // initialized data
+        const char        *p_record = p_buffer + offset;
+        size_t             size     = wal_record_check(p_record, (size_t) len - offset);
+        enum wal_record_e  type     = 0;
+        void              *p_value  = NULL;
+
+        // stop at a torn or corrupt record, or one out of order
+        if ( 0 == size || wal_record_sequence(p_record) <= sequence ) break;
+
+        // the record is whole
+        sequence  = wal_record_sequence(p_record),
+        offset   += size;
+
+        // skip records the snapshot already holds
+        if ( sequence <= after ) continue;
+
+        // unpack the value, and apply it
+        if      ( 0 == wal_record_unpack(p_record, size, &sequence, &type, &p_value) ) failures++;
+        else if ( pfn_replay(p_context, type, p_value) )                              replayed++;
+        else                                                                           failures++;
+    }
+
+    // cut off the torn tail, so appends follow the last whole record
+    if ( offset < (size_t) len )
+    {
+
+        // log
+        log_warning("[identity] [wal] Discarding %zu bytes after sequence %llu in \"%s\"\n", (size_t) len - offset, (unsigned long long) sequence, p_path);
+
+        // truncate the log
+        if ( 0 != truncate(p_path, (off_t) offset) ) goto failed_to_truncate;
+    }
+
+    // release the buffer
+    p_buffer = default_allocator(p_buffer, 0);
+
+    // log
+    if ( replayed || failures ) log_info("[identity] [wal] Replayed %zu records from \"%s\" (%zu failed)\n", replayed, p_path, failures);
+
+    // return the last sequence to the caller
+    *p_last_sequence = ( sequence > after ) ? sequence : after;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_path:
+                #ifndef NDEBUG
+                    log_error("[identity] [wal] Null pointer provided for parameter \"p_path\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_replay:
+                #ifndef NDEBUG
+                    log_error("[identity] [wal] Null pointer provided for parameter \"pfn_replay\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_last_sequence:
+                #ifndef NDEBUG
+                    log_error("[identity] [wal] Null pointer provided for parameter \"p_last_sequence\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // data errors
+        {
+            bad_header:
+                #ifndef NDEBUG
+                    log_error("[identity] [wal] \"%s\" is not a write ahead log in call to function \"%s\"\n", p_path, __FUNCTION__);
+                #endif
+
+                // clean up
+                p_buffer = default_allocator(p_buffer, 0);
+
+                // error
+                return 0;
+
+            wrong_version:
+                #ifndef NDEBUG
+                    log_error("[identity] [wal] \"%s\" is version %u, expected %u in call to function \"%s\"\n", p_path, _header.version, WAL_VERSION, __FUNCTION__);
+                #endif
+
+                // clean up
+                p_buffer = default_allocator(p_buffer, 0);
+
+                // error
+                return 0;
+
+            wrong_endian:
+                #ifndef NDEBUG
+                    log_error("[identity] [wal] \"%s\" was written with another byte order in call to function \"%s\"\n", p_path, __FUNCTION__);
+                #endif
+
+                // clean up
+                p_buffer = default_allocator(p_buffer, 0);
+
+                // error
+                return 0;
+        }
+
+        // standard library errors
+        {
+            no_mem:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // clean up
+                if ( p_file ) fclose(p_file);
+                p_buffer = default_allocator(p_buffer, 0);
+
+                // error
+                return 0;
+
+            failed_to_read:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to read \"%s\" in call to function \"%s\"\n", p_path, __FUNCTION__);
+                #endif
+
+                // clean up
+                fclose(p_file);
+                p_buffer = default_allocator(p_buffer, 0);
+
+                // error
+                return 0;
+
+            failed_to_truncate:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to truncate \"%s\" in call to function \"%s\"\n", p_path, __FUNCTION__);
+                #endif
+
+                // clean up
+                p_buffer = default_allocator(p_buffer, 0);
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int wal_construct ( wal **pp_wal, const char *p_path, uint64_t sequence )
+{
+
+    // argument check
+    if ( NULL == pp_wal ) goto no_wal;
+    if ( NULL == p_path ) goto no_path;
+
+    // initialized data
+    wal         *p_wal = default_allocator(NULL, sizeof(wal));
+    struct stat  _stat = { 0 };
+
+    // error check
+    if ( NULL == p_wal ) goto no_mem;
+
+    // populate the wal struct
+    *p_wal = (wal)
+    {
+        .fd          = open(p_path, O_WRONLY | O_APPEND | O_CREAT, 0600),
+        .p_pending   = default_allocator(NULL, WAL_BUFFER_SIZE),
+        .pending_len = 0,
+        .pending_max = WAL_BUFFER_SIZE,
+        .p_writing   = default_allocator(NULL, WAL_BUFFER_SIZE),
+        .writing_max = WAL_BUFFER_SIZE,
+        .appended    = sequence,
+        .durable     = sequence,
+        .flushing    = false,
+        .failed      = false,
+        .pfn_durable = NULL,
+        .p_context   = NULL
+    };
+
+    // error check
+    if ( -1 == p_wal->fd ) goto failed_to_open;
+    if ( NULL == p_wal->p_pending || NULL == p_wal->p_writing ) goto no_mem_1;
+
+    // start a new log, or one cut short inside its header, with the header
+    if ( -1 == fstat(p_wal->fd, &_stat) ) goto failed_to_write_header;
+    if ( (size_t) _stat.st_size < sizeof(_file_header) )
+        if ( 0 != ftruncate(p_wal->fd, 0) || 0 == wal_write(p_wal->fd, (const char *) &_file_header, sizeof(_file_header)) || 0 != fdatasync(p_wal->fd) ) goto failed_to_write_header;
+
+    // construct the lock and the condition
+    if ( 0 == mutex_create(&p_wal->_lock) ) goto failed_to_construct_mutex;
+    if ( 0 == condition_variable_create(&p_wal->_durable) ) goto failed_to_construct_condition_variable;
+
+    // return a pointer to the caller
+    *pp_wal = p_wal;
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_wal:
+                #ifndef NDEBUG
+                    log_error("[identity] [wal] Null pointer provided for parameter \"pp_wal\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_path:
+                #ifndef NDEBUG
+                    log_error("[identity] [wal] Null pointer provided for parameter \"p_path\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // sync errors
+        {
+            failed_to_construct_condition_variable:
+                mutex_destroy(&p_wal->_lock);
+
+                // fall through
+                goto failed_to_construct_mutex;
+
+            failed_to_construct_mutex:
+                #ifndef NDEBUG
+                    log_error("[identity] [wal] Failed to construct lock in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // clean up
+                close(p_wal->fd);
+                p_wal->p_pending = default_allocator(p_wal->p_pending, 0);
+                p_wal->p_writing = default_allocator(p_wal->p_writing, 0);
+                p_wal            = default_allocator(p_wal, 0);
+
+                // error
+                return 0;
+        }
+
+        // standard library errors
+        {
+            failed_to_open:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to open \"%s\" in call to function \"%s\"\n", p_path, __FUNCTION__);
+                #endif
+
+                // clean up
+                p_wal->p_pending = default_allocator(p_wal->p_pending, 0);
+                p_wal->p_writing = default_allocator(p_wal->p_writing, 0);
+                p_wal            = default_allocator(p_wal, 0);
+
+                // error
+                return 0;
+
+            failed_to_write_header:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to write the header of \"%s\" in call to function \"%s\"\n", p_path, __FUNCTION__);
+                #endif
+
+                // clean up
+                close(p_wal->fd);
+                p_wal->p_pending = default_allocator(p_wal->p_pending, 0);
+                p_wal->p_writing = default_allocator(p_wal->p_writing, 0);
+                p_wal            = default_allocator(p_wal, 0);
+
+                // error
+                return 0;
+
+            no_mem_1:
+                close(p_wal->fd);
+                p_wal->p_pending = default_allocator(p_wal->p_pending, 0);
+                p_wal->p_writing = default_allocator(p_wal->p_writing, 0);
+                p_wal            = default_allocator(p_wal, 0);
+
+                // fall through
+                goto no_mem;
+
+            no_mem:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+uint64_t wal_sequence ( wal *p_wal )
+{
+
+    // initialized data
+    uint64_t sequence = 0;
+
+    // get the sequence
+    mutex_lock(&p_wal->_lock);
+    sequence = p_wal->appended;
+    mutex_unlock(&p_wal->_lock);
+
+    // done
+    return sequence;
+}
+
+int wal_append ( wal *p_wal, enum wal_record_e type, const void *p_value, uint64_t *p_sequence )
+{
+
+    // argument check
+    if ( NULL ==      p_wal ) goto no_wal;
+    if ( NULL ==    p_value ) goto no_value;
+    if ( NULL == p_sequence ) goto no_sequence;
+    if ( type < WAL_RECORD_ORG || type >= WAL_RECORD_QUANTITY ) goto bad_type;
+
+    // initialized data
+    size_t len = wal_record_pack(NULL, type, p_value, 0);
+
+    // error check
+    if ( 0 == len ) goto failed_to_pack;
+
+    // lock
+    mutex_lock(&p_wal->_lock);
+
+    // error check
+    if ( p_wal->failed ) goto failed;
+
+    // grow the pending buffer
+    if ( p_wal->pending_len + len > p_wal->pending_max )
+    {
+
+        // initialized data
+        size_t  pending_max = p_wal->pending_max * 2;
+        char   *p_pending   = NULL;
+
+        // double until the record fits
+        while ( p_wal->pending_len + len > pending_max ) pending_max *= 2;
+
+        // grow
+        p_pending = default_allocator(p_wal->p_pending, pending_max);
+
+        // error check
+        if ( NULL == p_pending ) goto no_mem;
+
+        // store the buffer
+        p_wal->p_pending   = p_pending,
+        p_wal->pending_max = pending_max;
+    }
+
+    // pack the record
+    (void) wal_record_pack(p_wal->p_pending + p_wal->pending_len, type, p_value, ++p_wal->appended);
+    p_wal->pending_len += len;
+
+    // return the sequence to the caller
+    *p_sequence = p_wal->appended;
+
+    // unlock
+    mutex_unlock(&p_wal->_lock);
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_wal:
+                #ifndef NDEBUG
+                    log_error("[identity] [wal] Null pointer provided for parameter \"p_wal\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_value:
+                #ifndef NDEBUG
+                    log_error("[identity] [wal] Null pointer provided for parameter \"p_value\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            no_sequence:
+                #ifndef NDEBUG
+                    log_error("[identity] [wal] Null pointer provided for parameter \"p_sequence\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            bad_type:
+                #ifndef NDEBUG
+                    log_error("[identity] [wal] Parameter \"type\" is not a record type in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+
+        // wal errors
+        {
+            failed_to_pack:
+                #ifndef NDEBUG
+                    log_error("[identity] [wal] Failed to pack a record in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+
+            failed:
+                #ifndef NDEBUG
+                    log_error("[identity] [wal] The log failed an earlier write in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // unlock
+                mutex_unlock(&p_wal->_lock);
+
+                // error
+                return 0;
+        }
+
+        // standard library errors
+        {
+            no_mem:
+                #ifndef NDEBUG
+                    log_error("[standard library] Failed to allocate memory in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // unlock
+                mutex_unlock(&p_wal->_lock);
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int wal_commit ( wal *p_wal, uint64_t sequence )
+{
+
+    // argument check
+    if ( NULL == p_wal ) goto no_wal;
+
+    // initialized data
+    int result = 0;
+
+    // lock
+    mutex_lock(&p_wal->_lock);
+
+    // wait for the record to reach the disk
+    while ( p_wal->durable < sequence && false == p_wal->failed )
+    {
+
+        // another writer is writing a batch. wait for it
+        if ( p_wal->flushing )
+        {
+            condition_variable_wait(&p_wal->_durable, &p_wal->_lock);
+            continue;
+        }
+
+        // write everything appended so far
+        {
+
+            // initialized data
+            char           *p_batch     = p_wal->p_pending;
+            size_t          batch_len   = p_wal->pending_len,
+                            batch_max   = p_wal->pending_max;
+            uint64_t        target      = p_wal->appended;
+            bool            written     = false;
+            fn_wal_durable *pfn_durable = p_wal->pfn_durable;
+            void           *p_context   = p_wal->p_context;
+
+            // take the pending records, and give appenders the other buffer
+            p_wal->p_pending   = p_wal->p_writing,
+            p_wal->pending_max = p_wal->writing_max,
+            p_wal->pending_len = 0,
+            p_wal->flushing    = true;
+
+            // write and sync without the lock, so appenders form the next batch
+            mutex_unlock(&p_wal->_lock);
+            written = wal_write(p_wal->fd, p_batch, batch_len) && 0 == fdatasync(p_wal->fd);
+
+            // hand the durable batch on, before the next batch is written
+            if ( written && pfn_durable ) (void) pfn_durable(p_context, p_batch, batch_len);
+            mutex_lock(&p_wal->_lock);
+
+            // return the buffer
+            p_wal->p_writing   = p_batch,
+            p_wal->writing_max = batch_max,
+            p_wal->flushing    = false;
+
+            // the batch is durable, or the log is unusable
+            if ( written ) p_wal->durable = target;
+            else           p_wal->failed  = true;
+
+            // wake every waiter
+            condition_variable_broadcast(&p_wal->_durable);
+        }
+    }
+
+    // the record is durable
+    result = ( p_wal->durable >= sequence );
+
+    // unlock
+    mutex_unlock(&p_wal->_lock);
+
+    // done
+    return result;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_wal:
+                #ifndef NDEBUG
+                    log_error("[identity] [wal] Null pointer provided for parameter \"p_wal\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+void wal_durable_set ( wal *p_wal, fn_wal_durable *pfn_durable, void *p_context )
+{
+
+    // set the function
+    mutex_lock(&p_wal->_lock);
+    p_wal->pfn_durable = pfn_durable,
+    p_wal->p_context   = p_context;
+    mutex_unlock(&p_wal->_lock);
+}
+
+int wal_checkpoint ( wal *p_wal, uint64_t sequence )
+{
+
+    // argument check
+    if ( NULL == p_wal ) goto no_wal;
+
+    // initialized data
+    int result = 0;
+
+    // lock
+    mutex_lock(&p_wal->_lock);
+
+    // empty the log, but for its header, if every record in it is durable, and in the snapshot
+    if ( false == p_wal->flushing && p_wal->appended == sequence && p_wal->durable == sequence )
+        result = ( 0 == ftruncate(p_wal->fd, (off_t) sizeof(_file_header)) && 0 == fdatasync(p_wal->fd) );
+
+    // unlock
+    mutex_unlock(&p_wal->_lock);
+
+    // done
+    return result;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_wal:
+                #ifndef NDEBUG
+                    log_error("[identity] [wal] Null pointer provided for parameter \"p_wal\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
+
+int wal_destroy ( wal **pp_wal )
+{
+
+    // argument check
+    if ( NULL == pp_wal ) goto no_wal;
+
+    // initialized data
+    wal *p_wal = *pp_wal;
+
+    // no more pointer for caller
+    *pp_wal = NULL;
+
+    // flush every appended record
+    (void) wal_commit(p_wal, p_wal->appended);
+
+    // release the log
+    close(p_wal->fd);
+    condition_variable_destroy(&p_wal->_durable);
+    mutex_destroy(&p_wal->_lock);
+    p_wal->p_pending = default_allocator(p_wal->p_pending, 0);
+    p_wal->p_writing = default_allocator(p_wal->p_writing, 0);
+    p_wal            = default_allocator(p_wal, 0);
+
+    // success
+    return 1;
+
+    // error handling
+    {
+
+        // argument errors
+        {
+            no_wal:
+                #ifndef NDEBUG
+                    log_error("[identity] [wal] Null pointer provided for parameter \"pp_wal\" in call to function \"%s\"\n", __FUNCTION__);
+                #endif
+
+                // error
+                return 0;
+        }
+    }
+}
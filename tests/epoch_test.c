@@ -0,0 +1,226 @@
+/** !
+ * Epoch tests
+ *
+ * Retires a value under a reader that is holding it, and checks it outlives
+ * the reader. Then replaces a value over and over under readers that keep
+ * reading it, and checks no reader sees a released value
+ *
+ * @file tests/epoch_test.c
+ *
+ * @author Jacob Smith
+ */
+
+// header
+#include <identity/epoch.h>
+
+// preprocessor definitions
+#define EPOCH_TEST_MAGIC    0x45504f4348ULL
+#define EPOCH_TEST_POISON   0xdeadbeefULL
+#define EPOCH_TEST_READERS  4
+#define EPOCH_TEST_REPLACES 20000
+
+// structure definitions
+struct epoch_test_value_s
+{
+    uint64_t magic;
+    uint64_t version;
+};
+
+// data
+static _Atomic(struct epoch_test_value_s *) _p_published = NULL;
+static atomic_size_t                         _freed       = 0;
+static atomic_size_t                         _torn        = 0;
+static atomic_bool                           _entered     = false;
+static atomic_bool                           _leave       = false;
+static atomic_bool                           _stop        = false;
+
+struct epoch_test_value_s *epoch_test_value ( uint64_t version )
+{
+
+    // initialized data
+    struct epoch_test_value_s *p_value = malloc(sizeof(struct epoch_test_value_s));
+
+    // error check
+    if ( NULL == p_value ) abort();
+
+    // populate the value
+    *p_value = (struct epoch_test_value_s)
+    {
+        .magic   = EPOCH_TEST_MAGIC,
+        .version = version
+    };
+
+    // done
+    return p_value;
+}
+
+void epoch_test_free ( void *p_value )
+{
+
+    // initialized data
+    struct epoch_test_value_s *p_epoch_test_value = p_value;
+
+    // poison, so a reader that still holds the value sees it
+    p_epoch_test_value->magic = EPOCH_TEST_POISON;
+
+    // release
+    free(p_epoch_test_value);
+
+    // count
+    atomic_fetch_add(&_freed, 1);
+}
+
+int epoch_test_holder ( void *p_parameter )
+{
+
+    // initialized data
+    struct epoch_test_value_s *p_value = NULL;
+
+    // unused
+    (void) p_parameter;
+
+    // read the value
+    epoch_enter();
+    p_value = atomic_load(&_p_published);
+
+    // hold it until the writer has retired it
+    atomic_store(&_entered, true);
+    while ( false == atomic_load(&_leave) ) thrd_yield();
+
+    // it must still be there
+    if ( EPOCH_TEST_MAGIC != p_value->magic ) atomic_fetch_add(&_torn, 1);
+
+    // leave
+    epoch_exit();
+
+    // done
+    return 0;
+}
+
+int epoch_test_reader ( void *p_parameter )
+{
+
+    // unused
+    (void) p_parameter;
+
+    // read until the writer is done
+    while ( false == atomic_load(&_stop) )
+    {
+
+        // initialized data
+        struct epoch_test_value_s *p_value = NULL;
+
+        // read the value, twice over a yield
+        epoch_enter();
+        p_value = atomic_load(&_p_published);
+        if ( EPOCH_TEST_MAGIC != p_value->magic ) atomic_fetch_add(&_torn, 1);
+        thrd_yield();
+        if ( EPOCH_TEST_MAGIC != p_value->magic ) atomic_fetch_add(&_torn, 1);
+        epoch_exit();
+    }
+
+    // done
+    return 0;
+}
+
+int epoch_test_retire_held ( void )
+{
+
+    // initialized data
+    thrd_t   holder  = { 0 };
+    uint64_t epoch   = 0;
+    int      passed  = 1;
+
+    // publish a value, and let a reader take it
+    atomic_store(&_p_published, epoch_test_value(0));
+    atomic_store(&_freed, 0);
+    atomic_store(&_torn, 0);
+    if ( thrd_success != thrd_create(&holder, epoch_test_holder, NULL) ) abort();
+    while ( false == atomic_load(&_entered) ) thrd_yield();
+
+    // replace it under the reader
+    epoch_retire(atomic_exchange(&_p_published, epoch_test_value(1)), epoch_test_free);
+
+    // the reader still holds it
+    epoch = epoch_advance();
+    if ( atomic_load(&_freed) ) { printf("a value was released under a reader\n"); passed = 0; }
+    if ( epoch_passed(epoch) )  { printf("an epoch passed under a reader\n"); passed = 0; }
+
+    // let the reader go
+    atomic_store(&_leave, true);
+    thrd_join(holder, NULL);
+
+    // now it can go
+    epoch_synchronize();
+    if ( 1 != atomic_load(&_freed) ) { printf("%zu values were released, not 1\n", atomic_load(&_freed)); passed = 0; }
+    if ( false == epoch_passed(epoch) ) { printf("an epoch did not pass without readers\n"); passed = 0; }
+    if ( atomic_load(&_torn) ) { printf("the reader saw a released value\n"); passed = 0; }
+
+    // clean up
+    epoch_test_free(atomic_exchange(&_p_published, NULL));
+
+    // log
+    printf("held   %s\n", ( passed ) ? "passed" : "failed");
+
+    // done
+    return passed;
+}
+
+int epoch_test_concurrent_readers ( void )
+{
+
+    // initialized data
+    thrd_t _readers[EPOCH_TEST_READERS] = { 0 };
+    int    passed                       = 1;
+
+    // publish a value, and start the readers
+    atomic_store(&_p_published, epoch_test_value(0));
+    atomic_store(&_freed, 0);
+    atomic_store(&_torn, 0);
+    atomic_store(&_stop, false);
+    for (size_t i = 0; i < EPOCH_TEST_READERS; i++)
+        if ( thrd_success != thrd_create(&_readers[i], epoch_test_reader, NULL) ) abort();
+
+    // replace the value under them
+    for (uint64_t i = 1; i <= EPOCH_TEST_REPLACES; i++)
+        epoch_retire(atomic_exchange(&_p_published, epoch_test_value(i)), epoch_test_free);
+
+    // stop the readers
+    atomic_store(&_stop, true);
+    for (size_t i = 0; i < EPOCH_TEST_READERS; i++) thrd_join(_readers[i], NULL);
+
+    // every retired value is released, once
+    epoch_synchronize();
+    if ( EPOCH_TEST_REPLACES != atomic_load(&_freed) ) { printf("%zu values were released, not %d\n", atomic_load(&_freed), EPOCH_TEST_REPLACES); passed = 0; }
+    if ( atomic_load(&_torn) ) { printf("readers saw a released value %zu times\n", atomic_load(&_torn)); passed = 0; }
+
+    // clean up
+    epoch_test_free(atomic_exchange(&_p_published, NULL));
+
+    // log
+    printf("many   %s\n", ( passed ) ? "passed" : "failed");
+
+    // done
+    return passed;
+}
+
+int main ( int argc, const char *argv[] )
+{
+
+    // unused
+    (void) argc;
+    (void) argv;
+
+    // initialized data
+    int passed = 1;
+
+    // run every test
+    passed &= epoch_test_retire_held();
+    passed &= epoch_test_concurrent_readers();
+
+    // log
+    printf("epoch %s\n", ( passed ) ? "passed" : "failed");
+
+    // done
+    return ( passed ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
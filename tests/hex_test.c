@@ -0,0 +1,170 @@
+/** !
+ * Hex tests
+ *
+ * Every kernel must agree with the scalar loop, on random input of every
+ * length around the block sizes, and must reject the same invalid input
+ *
+ * @file tests/hex_test.c
+ *
+ * @author Jacob Smith
+ */
+
+// header
+#include <identity/hex.h>
+
+// preprocessor definitions
+#define HEX_TEST_LEN_MAX 160
+#define HEX_TEST_ROUNDS  64
+
+// type definitions
+typedef size_t (fn_hex_encode)( const unsigned char *p_bytes, size_t len, char *p_hex );
+typedef int    (fn_hex_decode)( const char *p_hex, size_t hex_len, unsigned char *p_bytes );
+
+// structure definitions
+struct hex_test_kernels_s
+{
+    const char    *p_name;
+    fn_hex_encode *pfn_encode;
+    fn_hex_decode *pfn_decode;
+};
+
+// function declarations
+/// the kernels in src/hex.c
+size_t hex_encode_scalar ( const unsigned char *p_bytes, size_t len, char *p_hex );
+int    hex_decode_scalar ( const char *p_hex, size_t hex_len, unsigned char *p_bytes );
+
+#if defined(__x86_64__) && ( defined(__GNUC__) || defined(__clang__) )
+    #define HEX_TEST_X86_64
+    size_t hex_encode_sse2 ( const unsigned char *p_bytes, size_t len, char *p_hex );
+    int    hex_decode_sse2 ( const char *p_hex, size_t hex_len, unsigned char *p_bytes );
+    size_t hex_encode_avx2 ( const unsigned char *p_bytes, size_t len, char *p_hex );
+    int    hex_decode_avx2 ( const char *p_hex, size_t hex_len, unsigned char *p_bytes );
+#endif
+
+// data
+static uint64_t _state = 0x9e3779b97f4a7c15ULL;
+
+uint64_t hex_test_random ( void )
+{
+
+    // xorshift, so every run sees the same input
+    _state ^= _state << 13,
+    _state ^= _state >> 7,
+    _state ^= _state << 17;
+
+    // done
+    return _state;
+}
+
+size_t hex_test_encode ( const struct hex_test_kernels_s *p_kernels, const unsigned char *p_bytes, size_t len, char *p_hex )
+{
+
+    // whole blocks, then the tail, like hex_encode
+    size_t done = p_kernels->pfn_encode(p_bytes, len, p_hex);
+
+    // the tail
+    (void) hex_encode_scalar(&p_bytes[done], len - done, &p_hex[2 * done]);
+
+    // done
+    return 2 * len;
+}
+
+int hex_test_decode ( const struct hex_test_kernels_s *p_kernels, const char *p_hex, size_t hex_len, unsigned char *p_bytes )
+{
+
+    // whole blocks, then the tail, like hex_decode
+    int done = p_kernels->pfn_decode(p_hex, hex_len, p_bytes);
+
+    // error check
+    if ( done < 0 ) return 0;
+
+    // the tail
+    return 0 <= hex_decode_scalar(&p_hex[2 * (size_t) done], hex_len - 2 * (size_t) done, &p_bytes[done]);
+}
+
+int hex_test_kernels ( const struct hex_test_kernels_s *p_kernels )
+{
+
+    // initialized data
+    static const char _invalid[] = { 'g', 'G', 'z', '/', ':', '@', '`', ' ', '\0', '\x7f', '\x80', '\xff' };
+    unsigned char     _bytes[HEX_TEST_LEN_MAX],
+                      _decoded[HEX_TEST_LEN_MAX],
+                      _expected[HEX_TEST_LEN_MAX];
+    char              _hex[2 * HEX_TEST_LEN_MAX],
+                      _reference[2 * HEX_TEST_LEN_MAX];
+    size_t            failures = 0;
+
+    // every length, a few times each
+    for (size_t len = 0; len <= HEX_TEST_LEN_MAX; len++)
+    for (size_t round = 0; round < HEX_TEST_ROUNDS; round++)
+    {
+
+        // random bytes
+        for (size_t i = 0; i < len; i++) _bytes[i] = (unsigned char) hex_test_random();
+
+        // encode, and compare with the scalar loop
+        (void) hex_encode_scalar(_bytes, len, _reference);
+        (void) hex_test_encode(p_kernels, _bytes, len, _hex);
+        if ( 0 != memcmp(_hex, _reference, 2 * len) ) { printf("%s encoded %zu bytes wrongly\n", p_kernels->p_name, len); failures++; }
+
+        // mix the case, then decode
+        for (size_t i = 0; i < 2 * len; i++)
+            if ( _hex[i] >= 'a' && ( hex_test_random() & 1 ) ) _hex[i] = (char) ( _hex[i] - 'a' + 'A' );
+        if ( 0 == hex_test_decode(p_kernels, _hex, 2 * len, _decoded) || 0 != memcmp(_decoded, _bytes, len) )
+            { printf("%s decoded %zu bytes wrongly\n", p_kernels->p_name, len); failures++; }
+
+        // one invalid character anywhere must fail, like the scalar loop
+        if ( len )
+        {
+
+            // initialized data
+            size_t at = hex_test_random() % ( 2 * len );
+
+            // spoil a character
+            _hex[at] = _invalid[hex_test_random() % sizeof(_invalid)];
+
+            // error check
+            if ( -1 != hex_decode_scalar(_hex, 2 * len, _expected) ) { printf("scalar accepted %zu bytes with a bad character at %zu\n", len, at); failures++; }
+            if ( 0 != hex_test_decode(p_kernels, _hex, 2 * len, _decoded) ) { printf("%s accepted %zu bytes with a bad character at %zu\n", p_kernels->p_name, len, at); failures++; }
+        }
+    }
+
+    // log
+    printf("%-6s %s\n", p_kernels->p_name, ( failures ) ? "failed" : "passed");
+
+    // done
+    return ( 0 == failures );
+}
+
+int main ( int argc, const char *argv[] )
+{
+
+    // unused
+    (void) argc;
+    (void) argv;
+
+    // initialized data
+    int           passed    = 1;
+    unsigned char _bytes[3] = { 0 };
+
+    // the scalar kernels
+    passed &= hex_test_kernels(&(struct hex_test_kernels_s) { "scalar", hex_encode_scalar, hex_decode_scalar });
+
+    // the x86-64 kernels
+    #ifdef HEX_TEST_X86_64
+        passed &= hex_test_kernels(&(struct hex_test_kernels_s) { "sse2", hex_encode_sse2, hex_decode_sse2 });
+
+        __builtin_cpu_init();
+        if ( __builtin_cpu_supports("avx2") )
+            passed &= hex_test_kernels(&(struct hex_test_kernels_s) { "avx2", hex_encode_avx2, hex_decode_avx2 });
+    #endif
+
+    // the dispatched kernels refuse odd lengths
+    if ( hex_decode("abc", 3, _bytes) ) { printf("hex_decode accepted an odd length\n"); passed = 0; }
+
+    // log
+    printf("hex %s with the %s kernels\n", ( passed ) ? "passed" : "failed", hex_kernel_name());
+
+    // done
+    return ( passed ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,331 @@
+/** !
+ * Permission matcher tests
+ *
+ * Checks literal, '*' and trailing '*' permissions against a table of cases,
+ * then checks the automaton against a plain segment by segment matcher on
+ * random permissions and paths
+ *
+ * @file tests/permission_test.c
+ *
+ * @author Jacob Smith
+ */
+
+// header
+#include <identity/permission.h>
+
+// preprocessor definitions
+#define PERMISSION_TEST_ROLES       32
+#define PERMISSION_TEST_PERMISSIONS 4
+#define PERMISSION_TEST_PATHS       4096
+#define PERMISSION_TEST_LEN_MAX     96
+
+// structure definitions
+struct permission_test_case_s
+{
+    const char *p_permission;
+    const char *p_action;
+    const char *p_resource;
+    bool        match;
+};
+
+// data
+static uint64_t _state = 0x9e3779b97f4a7c15ULL;
+
+static const struct permission_test_case_s _cases[] =
+{
+
+    // literals
+    { "read:docs/readme"  , "read" , "docs/readme"    , true  },
+    { "read:docs/readme"  , "read" , "docs/other"     , false },
+    { "read:docs/readme"  , "write", "docs/readme"    , false },
+    { "read:docs/readme"  , "read" , "docs"           , false },
+    { "read:docs/readme"  , "read" , "docs/readme/v2" , false },
+
+    // '*' stands for exactly one segment
+    { "read:docs/*/edit"  , "read" , "docs/a/edit"    , true  },
+    { "read:docs/*/edit"  , "read" , "docs/a/b/edit"  , false },
+    { "read:docs/*/edit"  , "read" , "docs/edit"      , false },
+    { "*:docs/readme"     , "write", "docs/readme"    , true  },
+    { "*:docs/readme"     , "write", "docs/other"     , false },
+
+    // a trailing '*' stands for one or more
+    { "read:docs/*"       , "read" , "docs/a"         , true  },
+    { "read:docs/*"       , "read" , "docs/a/b/c"     , true  },
+    { "read:docs/*"       , "read" , "docs"           , false },
+    { "read:*"            , "read" , "anything/at/all", true  },
+    { "*:*"               , "manage", "users"         , true  },
+    { "read:*/b/*"        , "read" , "a/b/c/d"        , true  },
+    { "read:*/b/*"        , "read" , "a/c/c/d"        , false },
+    { "read:*/b/*"        , "read" , "a/b"            , false }
+};
+
+uint64_t permission_test_random ( void )
+{
+
+    // xorshift, so every run sees the same input
+    _state ^= _state << 13,
+    _state ^= _state >> 7,
+    _state ^= _state << 17;
+
+    // done
+    return _state;
+}
+
+bool permission_test_reference ( const char *p_permission, const char *p_action, const char *p_resource )
+{
+
+    // initialized data
+    char        _path[PERMISSION_TEST_LEN_MAX + 2] = { 0 };
+    const char *p = p_permission,
+               *q = _path;
+
+    // the action and the resource, as one path
+    snprintf(_path, sizeof(_path), "%s/%s", p_action, p_resource);
+
+    // compare one segment at a time
+    for (;;)
+    {
+
+        // initialized data
+        size_t p_len = strcspn(p, ":/"),
+               q_len = strcspn(q, "/");
+        bool   last  = ( '\0' == p[p_len] );
+
+        // a trailing '*' takes the rest of the path
+        if ( last && 1 == p_len && '*' == *p ) return true;
+
+        // the segments must match
+        if ( !( 1 == p_len && '*' == *p ) && ( p_len != q_len || 0 != strncmp(p, q, p_len) ) ) return false;
+
+        // both end together
+        if ( last || '\0' == q[q_len] ) return last && '\0' == q[q_len];
+
+        // next segment
+        p += p_len + 1,
+        q += q_len + 1;
+    }
+}
+
+void permission_test_path ( char *p_buffer, size_t segments, bool wildcards )
+{
+
+    // initialized data
+    static const char *const _segments[] = { "a", "b", "c" };
+
+    // random segments, and sometimes a '*'
+    for (size_t i = 0; i < segments; i++)
+    {
+
+        // initialized data
+        const char *p_segment = ( wildcards && 0 == permission_test_random() % 3 ) ? "*" : _segments[permission_test_random() % 3];
+
+        // append
+        strcat(p_buffer, p_segment);
+        if ( i + 1 < segments ) strcat(p_buffer, "/");
+    }
+}
+
+int permission_test_cases ( void )
+{
+
+    // initialized data
+    size_t failures = 0;
+
+    // each case alone
+    for (size_t i = 0; i < sizeof(_cases) / sizeof(*_cases); i++)
+    {
+
+        // initialized data
+        permission_matcher *p_matcher      = NULL;
+        role               *p_role         = NULL;
+        char               *_p_permissions[] = { (char *) _cases[i].p_permission };
+        const uint32_t     *_ids           = NULL;
+        size_t              ids_len        = 0;
+        uint64_t            _set[1]        = { 0 };
+        uint32_t            _matches[PERMISSION_MATCH_MAX];
+        size_t              matched        = 0;
+
+        // compile one role with one permission
+        if ( 0 == role_construct(&p_role, 1, "role", 0, _p_permissions, 1) ) return 0;
+        if ( 0 == permission_matcher_construct(&p_matcher, &p_role, 1) ) return 0;
+
+        // the set of the role
+        (void) permission_matcher_role_get(p_matcher, 1, &_ids, &ids_len);
+        for (size_t j = 0; j < ids_len; j++) _set[_ids[j] >> 6] |= 1ULL << ( _ids[j] & 63 );
+
+        // match
+        matched = permission_matcher_match(p_matcher, _cases[i].p_action, _cases[i].p_resource, _matches, PERMISSION_MATCH_MAX);
+
+        // check
+        if ( ( 1 == matched ) != _cases[i].match || permission_matcher_any(p_matcher, _cases[i].p_action, _cases[i].p_resource, _set) != _cases[i].match )
+        {
+            printf("\"%s\" %s \"%s:%s\"\n", _cases[i].p_permission, ( _cases[i].match ) ? "did not match" : "matched", _cases[i].p_action, _cases[i].p_resource);
+            failures++;
+        }
+
+        // clean up
+        (void) permission_matcher_destroy(&p_matcher);
+        p_role = default_allocator(p_role, 0);
+    }
+
+    // log
+    printf("cases  %s\n", ( failures ) ? "failed" : "passed");
+
+    // done
+    return ( 0 == failures );
+}
+
+int permission_test_random_paths ( void )
+{
+
+    // initialized data
+    static char         _permissions[PERMISSION_TEST_ROLES][PERMISSION_TEST_PERMISSIONS][PERMISSION_TEST_LEN_MAX];
+    char               *_p_permissions[PERMISSION_TEST_PERMISSIONS];
+    role               *_p_roles[PERMISSION_TEST_ROLES] = { 0 };
+    uint64_t            _sets[PERMISSION_TEST_ROLES][64] = { 0 };
+    permission_matcher *p_matcher = NULL;
+    size_t              failures  = 0;
+
+    // random roles
+    for (size_t r = 0; r < PERMISSION_TEST_ROLES; r++)
+    {
+        for (size_t i = 0; i < PERMISSION_TEST_PERMISSIONS; i++)
+        {
+            _permissions[r][i][0] = '\0';
+            strcat(_permissions[r][i], ( 0 == permission_test_random() % 4 ) ? "*:" : "read:");
+            permission_test_path(_permissions[r][i], 1 + permission_test_random() % 4, true);
+            _p_permissions[i] = _permissions[r][i];
+        }
+        if ( 0 == role_construct(&_p_roles[r], r, "role", 0, _p_permissions, PERMISSION_TEST_PERMISSIONS) ) return 0;
+    }
+
+    // compile
+    if ( 0 == permission_matcher_construct(&p_matcher, _p_roles, PERMISSION_TEST_ROLES) ) return 0;
+
+    // the set of each role
+    for (size_t r = 0; r < PERMISSION_TEST_ROLES; r++)
+    {
+
+        // initialized data
+        const uint32_t *_ids    = NULL;
+        size_t          ids_len = 0;
+
+        // set a bit per permission
+        (void) permission_matcher_role_get(p_matcher, r, &_ids, &ids_len);
+        for (size_t j = 0; j < ids_len; j++) _sets[r][_ids[j] >> 6] |= 1ULL << ( _ids[j] & 63 );
+    }
+
+    // random paths. Each role must match exactly when one of its permissions does
+    for (size_t i = 0; i < PERMISSION_TEST_PATHS; i++)
+    {
+
+        // initialized data
+        char _resource[PERMISSION_TEST_LEN_MAX] = { 0 };
+
+        // a path without wildcards
+        permission_test_path(_resource, 1 + permission_test_random() % 5, false);
+
+        for (size_t r = 0; r < PERMISSION_TEST_ROLES; r++)
+        {
+
+            // initialized data
+            bool expected = false;
+
+            // the plain matcher
+            for (size_t j = 0; j < PERMISSION_TEST_PERMISSIONS; j++)
+                expected |= permission_test_reference(_permissions[r][j], "read", _resource);
+
+            // the automaton
+            if ( permission_matcher_any(p_matcher, "read", _resource, _sets[r]) != expected )
+            {
+                printf("role %zu %s \"read:%s\"\n", r, ( expected ) ? "did not match" : "matched", _resource);
+                failures++;
+            }
+        }
+    }
+
+    // clean up
+    (void) permission_matcher_destroy(&p_matcher);
+    for (size_t r = 0; r < PERMISSION_TEST_ROLES; r++) _p_roles[r] = default_allocator(_p_roles[r], 0);
+
+    // log
+    printf("random %s\n", ( failures ) ? "failed" : "passed");
+
+    // done
+    return ( 0 == failures );
+}
+
+int permission_test_many_matches ( void )
+{
+
+    // initialized data
+    static char         _permissions[512][32];
+    char               *_p_permissions[512];
+    role               *_p_roles[3]  = { 0 };
+    uint64_t            _set[64]     = { 0 };
+    const uint32_t     *_ids         = NULL;
+    size_t              ids_len      = 0;
+    permission_matcher *p_matcher    = NULL;
+    bool                passed       = false;
+
+    // every mix of literal and '*' over 9 segments. The all literal one is last
+    for (unsigned bits = 0; bits < 512; bits++)
+    {
+
+        // initialized data
+        char *p = _permissions[bits];
+
+        // build
+        p += sprintf(p, "read:");
+        for (unsigned i = 0; i < 9; i++)
+            p += sprintf(p, ( i ) ? "/%c" : "%c", ( bits >> i & 1 ) ? 'a' + (char) i : '*');
+
+        // store
+        _p_permissions[bits] = _permissions[bits];
+    }
+
+    // two roles share the first 511, more than PERMISSION_MATCH_MAX. The third holds the last
+    if ( 0 == role_construct(&_p_roles[0], 1, "many", 0, &_p_permissions[0]  , 256) ) return 0;
+    if ( 0 == role_construct(&_p_roles[1], 2, "more", 0, &_p_permissions[256], 255) ) return 0;
+    if ( 0 == role_construct(&_p_roles[2], 3, "mine", 0, &_p_permissions[511], 1) ) return 0;
+    if ( 0 == permission_matcher_construct(&p_matcher, _p_roles, 3) ) return 0;
+
+    // the set of the third role
+    (void) permission_matcher_role_get(p_matcher, 3, &_ids, &ids_len);
+    for (size_t j = 0; j < ids_len; j++) _set[_ids[j] >> 6] |= 1ULL << ( _ids[j] & 63 );
+
+    // its one permission matches, however many others match first
+    passed = permission_matcher_any(p_matcher, "read", "a/b/c/d/e/f/g/h/i", _set);
+
+    // clean up
+    (void) permission_matcher_destroy(&p_matcher);
+    for (size_t r = 0; r < 3; r++) _p_roles[r] = default_allocator(_p_roles[r], 0);
+
+    // log
+    printf("many   %s\n", ( passed ) ? "passed" : "failed");
+
+    // done
+    return passed;
+}
+
+int main ( int argc, const char *argv[] )
+{
+
+    // unused
+    (void) argc;
+    (void) argv;
+
+    // initialized data
+    int passed = 1;
+
+    // run every test
+    passed &= permission_test_cases();
+    passed &= permission_test_random_paths();
+    passed &= permission_test_many_matches();
+
+    // log
+    printf("permission %s\n", ( passed ) ? "passed" : "failed");
+
+    // done
+    return ( passed ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}